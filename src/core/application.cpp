@@ -72,6 +72,8 @@
 #include "core.h"
 #include "coreinstanceobject.h"
 #include "rootwindowsmanager.h"
+#include "pluginmanager.h"
+#include "startupprofiler.h"
 #include "config.h"
 
 #ifdef Q_OS_MAC
@@ -537,6 +539,13 @@ namespace LeechCraft
 		Splash_->showMessage (tr ("Finalizing..."), Qt::AlignLeft | Qt::AlignBottom, QColor ("#FF3000"));
 
 		Splash_->finish (rwm->GetMainWindow (0));
+
+		const auto profiler = Core::Instance ().GetPluginManager ()->GetStartupProfiler ();
+		qDebug () << "main window is ready in"
+				<< profiler->GetElapsedUs () / 1000
+				<< "ms; resident set size is"
+				<< StartupProfiler::GetResidentSetSize () / 1024
+				<< "KiB";
 	}
 
 	void Application::handleQuit ()
@@ -241,6 +241,8 @@ namespace LeechCraft
 		PluginManager_->Init (map.count ("safe-mode"));
 
 		NewTabMenuManager_->SetToolbarActions (GetActions2Embed ());
+		for (const auto& info : PluginManager_->GetLazyPlugins ())
+			NewTabMenuManager_->AddLazyPlugin (info);
 
 		disconnect (LocalSocketHandler_.get (),
 				SIGNAL (gotEntity (const LeechCraft::Entity&)),
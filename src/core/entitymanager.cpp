@@ -187,8 +187,21 @@ namespace LeechCraft
 			if (desired)
 				handlers << desired;
 			else
+			{
 				handlers = GetObjects (e, &numDownloaders, &numHandlers);
 
+				/* Lazily registered handlers can't be queried without
+				 * loading them, so they are loaded only when the entity
+				 * is really handled and no loaded plugin can do that.
+				 */
+				if (handlers.isEmpty () &&
+						handling &&
+						!(e.Parameters_ & OnlyDownload) &&
+						!Core::Instance ().IsShuttingDown () &&
+						Core::Instance ().GetPluginManager ()->ActivateLazyEntityHandlers ())
+					handlers = GetObjects (e, &numDownloaders, &numHandlers);
+			}
+
 			if (handlers.isEmpty () && !desired)
 				return handling ? NoHandlersAvailable (e) : false;
 
@@ -254,6 +267,18 @@ namespace LeechCraft
 
 	bool EntityManager::HandleEntity (Entity e, QObject *desired)
 	{
+		// The lazy handlers can't be activated while the plugins are initialized.
+		const auto pm = Core::Instance ().GetPluginManager ();
+		if (!desired &&
+				pm->IsInitializing () &&
+				!(e.Parameters_ & OnlyDownload) &&
+				pm->HasLazyEntityHandlers () &&
+				GetObjects (e).isEmpty ())
+		{
+			pm->RunAfterInit ([e] { EntityManager ().HandleEntity (e); });
+			return true;
+		}
+
 		QObjectList handlers;
 		const bool foundOk = GetPreparedObjectList (e, desired, handlers, true);
 		if (!foundOk || handlers.isEmpty ())
@@ -0,0 +1,261 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "lazyplugininfo.h"
+#include <memory>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QPixmap>
+#include <interfaces/iinfo.h>
+#include <interfaces/ihavesettings.h>
+#include <interfaces/ihaveshortcuts.h>
+#include <interfaces/ientityhandler.h>
+#include <interfaces/iplugin2.h>
+#include <interfaces/ipluginready.h>
+#include <interfaces/ipluginadaptor.h>
+#include <interfaces/iactionsexporter.h>
+#include <interfaces/idatafilter.h>
+#include <interfaces/idownload.h>
+#include <interfaces/ifinder.h>
+#include <interfaces/ihavediaginfo.h>
+#include <interfaces/ihaverecoverabletabs.h>
+#include <interfaces/iimportexport.h>
+#include <interfaces/ijobholder.h>
+#include <interfaces/imediaplayer.h>
+#include <interfaces/ipersistentstorageplugin.h>
+#include <interfaces/iquarkcomponentprovider.h>
+#include <interfaces/iscriptloader.h>
+#include <interfaces/ispellcheckprovider.h>
+#include <interfaces/istartupwizard.h>
+#include <interfaces/isummaryrepresentation.h>
+#include <interfaces/isyncable.h>
+#include <interfaces/itaggablejobs.h>
+#include <interfaces/itexteditor.h>
+#include <interfaces/iwebbrowser.h>
+#include <interfaces/iwebfilestorage.h>
+#include <interfaces/iwkfontssettable.h>
+#include <interfaces/an/ianemitter.h>
+#include <interfaces/an/ianrulesstorage.h>
+#include <interfaces/data/iimgsource.h>
+#include <interfaces/devices/iremovabledevmanager.h>
+#include <interfaces/media/ialbumartprovider.h>
+#include <interfaces/media/iartistbiofetcher.h>
+#include <interfaces/media/iaudiopile.h>
+#include <interfaces/media/iaudioscrobbler.h>
+#include <interfaces/media/icurrentsongkeeper.h>
+#include <interfaces/media/idiscographyprovider.h>
+#include <interfaces/media/ieventsprovider.h>
+#include <interfaces/media/ihypesprovider.h>
+#include <interfaces/media/ilyricsfinder.h>
+#include <interfaces/media/iradiostationprovider.h>
+#include <interfaces/media/irecentreleases.h>
+#include <interfaces/media/irecommendedartists.h>
+#include <interfaces/media/isimilarartists.h>
+#include <interfaces/media/itagsfetcher.h>
+
+namespace LeechCraft
+{
+	namespace
+	{
+		template<typename T>
+		bool ImplementsAny (QObject *obj)
+		{
+			return qobject_cast<T> (obj) != nullptr;
+		}
+
+		template<typename T, typename U, typename... Rest>
+		bool ImplementsAny (QObject *obj)
+		{
+			return ImplementsAny<T> (obj) || ImplementsAny<U, Rest...> (obj);
+		}
+
+		/* Interfaces that the core or other plugins look for among
+		 * all the loaded plugins, so a plugin implementing any of them
+		 * should be loaded right away. This includes IHaveSettings and
+		 * IHaveShortcuts: the settings tab and the shortcut manager
+		 * only pick up the plugins present at startup.
+		 */
+		bool ImplementsServiceInterfaces (QObject *obj)
+		{
+			return ImplementsAny<IHaveSettings*, IHaveShortcuts*,
+					IPlugin2*, IPluginReady*, IPluginAdaptor*,
+					IActionsExporter*, IDataFilter*, IDownload*, IFinder*,
+					IHaveDiagInfo*, IHaveRecoverableTabs*, IImportExport*,
+					IJobHolder*, IMediaPlayer*, IPersistentStoragePlugin*,
+					IQuarkComponentProvider*, IScriptLoader*, ISpellCheckProvider*,
+					IStartupWizard*, ISummaryRepresentation*, ISyncable*,
+					ITaggableJobs*, ITextEditor*, IWebBrowser*, IWebFileStorage*,
+					IWkFontsSettable*, IANEmitter*, IANRulesStorage*, IImgSource*,
+					IRemovableDevManager*> (obj) ||
+				ImplementsAny<Media::IAlbumArtProvider*, Media::IArtistBioFetcher*,
+					Media::IAudioPile*, Media::IAudioScrobbler*, Media::ICurrentSongKeeper*,
+					Media::IDiscographyProvider*, Media::IEventsProvider*,
+					Media::IHypesProvider*, Media::ILyricsFinder*,
+					Media::IRadioStationProvider*, Media::IRecentReleases*,
+					Media::IRecommendedArtists*, Media::ISimilarArtists*,
+					Media::ITagsFetcher*> (obj);
+		}
+
+		/* Bumped whenever the eligibility rules change, so that the
+		 * metadata saved by older versions is considered stale.
+		 */
+		const int MetadataVersion = 2;
+
+		QString GetLibraryStamp (const QString& path)
+		{
+			const QFileInfo fi { path };
+			return QString::number (MetadataVersion) + ':' +
+					QString::number (fi.size ()) + ':' +
+					QString::number (fi.lastModified ().toMSecsSinceEpoch ());
+		}
+
+		const int IconSize = 32;
+	}
+
+	bool IsLazyEligible (QObject *obj)
+	{
+		const auto iht = qobject_cast<IHaveTabs*> (obj);
+		if (!iht && !qobject_cast<IEntityHandler*> (obj))
+			return false;
+
+		if (ImplementsServiceInterfaces (obj))
+			return false;
+
+		// Tabs opened by default are opened during startup anyway.
+		if (iht)
+			for (const auto& tc : iht->GetTabClasses ())
+				if (tc.Features_ & TFByDefault)
+					return false;
+
+		return true;
+	}
+
+	void SaveLazyPluginInfo (QSettings& settings, const QString& path, QObject *obj)
+	{
+		const auto ii = qobject_cast<IInfo*> (obj);
+		const auto& stamp = GetLibraryStamp (path);
+
+		settings.beginGroup (path);
+		settings.beginGroup ("Lazy");
+		if (settings.value ("Stamp").toString () == stamp)
+		{
+			settings.endGroup ();
+			settings.endGroup ();
+			return;
+		}
+
+		settings.remove ("");
+
+		settings.setValue ("Stamp", stamp);
+		settings.setValue ("Eligible", IsLazyEligible (obj));
+		settings.setValue ("ID", ii->GetUniqueID ());
+		settings.setValue ("Icon", ii->GetIcon ().pixmap (IconSize, IconSize));
+		settings.setValue ("Provides", ii->Provides ());
+		settings.setValue ("Needs", ii->Needs ());
+		settings.setValue ("IsEntityHandler", qobject_cast<IEntityHandler*> (obj) != nullptr);
+
+		const auto iht = qobject_cast<IHaveTabs*> (obj);
+		const auto& tabClasses = iht ? iht->GetTabClasses () : TabClasses_t {};
+		settings.beginWriteArray ("TabClasses");
+		for (int i = 0; i < tabClasses.size (); ++i)
+		{
+			const auto& tc = tabClasses.at (i);
+
+			settings.setArrayIndex (i);
+			settings.setValue ("TabClass", tc.TabClass_);
+			settings.setValue ("VisibleName", tc.VisibleName_);
+			settings.setValue ("Description", tc.Description_);
+			settings.setValue ("Icon", tc.Icon_.pixmap (IconSize, IconSize));
+			settings.setValue ("Priority", tc.Priority_);
+			settings.setValue ("Features", static_cast<int> (tc.Features_));
+		}
+		settings.endArray ();
+
+		settings.endGroup ();
+		settings.endGroup ();
+	}
+
+	void ClearLazyPluginInfo (QSettings& settings, const QString& path)
+	{
+		settings.beginGroup (path);
+		settings.remove ("Lazy");
+		settings.endGroup ();
+	}
+
+	boost::optional<LazyPluginInfo> LoadLazyPluginInfo (QSettings& settings, const QString& path)
+	{
+		settings.beginGroup (path);
+		std::shared_ptr<void> pathGuard (nullptr,
+				[&settings] (void*) { settings.endGroup (); });
+
+		const auto& name = settings.value ("Name").toString ();
+
+		settings.beginGroup ("Lazy");
+		std::shared_ptr<void> lazyGuard (nullptr,
+				[&settings] (void*) { settings.endGroup (); });
+
+		if (settings.value ("Stamp").toString () != GetLibraryStamp (path))
+			return {};
+
+		LazyPluginInfo info
+		{
+			path,
+			settings.value ("ID").toByteArray (),
+			name,
+			QIcon { settings.value ("Icon").value<QPixmap> () },
+			settings.value ("Provides").toStringList (),
+			settings.value ("Needs").toStringList (),
+			{},
+			settings.value ("IsEntityHandler").toBool (),
+			settings.value ("Eligible").toBool ()
+		};
+
+		const int size = settings.beginReadArray ("TabClasses");
+		for (int i = 0; i < size; ++i)
+		{
+			settings.setArrayIndex (i);
+
+			TabClassInfo tc;
+			tc.TabClass_ = settings.value ("TabClass").toByteArray ();
+			tc.VisibleName_ = settings.value ("VisibleName").toString ();
+			tc.Description_ = settings.value ("Description").toString ();
+			tc.Icon_ = QIcon { settings.value ("Icon").value<QPixmap> () };
+			tc.Priority_ = settings.value ("Priority").toUInt ();
+			tc.Features_ = TabFeatures (QFlag (settings.value ("Features").toInt ()));
+			info.TabClasses_ << tc;
+		}
+		settings.endArray ();
+
+		if (info.ID_.isEmpty ())
+			return {};
+
+		return info;
+	}
+}
@@ -0,0 +1,96 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <QString>
+#include <QStringList>
+#include <QIcon>
+#include <interfaces/ihavetabs.h>
+
+class QObject;
+class QSettings;
+
+namespace LeechCraft
+{
+	/** Cached metadata of a plugin that may be activated lazily.
+	 *
+	 * The metadata is collected from the plugin instance during a run
+	 * where the plugin is loaded and is stored in the plugins group of
+	 * the "-pg" settings under the path of the plugin library, so that
+	 * on next startups the plugin could be registered without loading
+	 * its library.
+	 */
+	struct LazyPluginInfo
+	{
+		QString Path_;
+		QByteArray ID_;
+		QString Name_;
+		QIcon Icon_;
+
+		QStringList Provides_;
+		QStringList Needs_;
+
+		TabClasses_t TabClasses_;
+		bool IsEntityHandler_;
+
+		/** Whether the plugin itself only provides tabs or handles
+		 * entities, see IsLazyEligible().
+		 */
+		bool IsEligible_;
+	};
+
+	/** Checks whether the given plugin instance only provides tab
+	 * classes and/or handles entities, so that nothing else in the
+	 * core or other plugins would look for it during startup.
+	 */
+	bool IsLazyEligible (QObject*);
+
+	/** Stores the metadata of the given plugin to the settings group
+	 * of the library at path unless the library hasn't changed since
+	 * the metadata was last saved. The settings are expected to be in
+	 * the plugins group already.
+	 */
+	void SaveLazyPluginInfo (QSettings&, const QString& path, QObject*);
+
+	/** Removes the lazy activation metadata for the library at path,
+	 * if any.
+	 */
+	void ClearLazyPluginInfo (QSettings&, const QString& path);
+
+	/** Loads the metadata for the library at path, returning nothing
+	 * if there is no metadata or if it's stale, that is, the library
+	 * has been modified since the metadata was saved.
+	 *
+	 * The metadata is returned even for plugins that aren't eligible
+	 * for lazy activation, since their dependencies still matter.
+	 */
+	boost::optional<LazyPluginInfo> LoadLazyPluginInfo (QSettings&, const QString& path);
+}
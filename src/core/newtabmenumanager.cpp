@@ -30,12 +30,15 @@
 #include "newtabmenumanager.h"
 #include <algorithm>
 #include <QMenu>
+#include <QPointer>
 #include <QtDebug>
 #include "interfaces/iinfo.h"
 #include "interfaces/ihavetabs.h"
 #include <interfaces/iplugin2.h>
 #include "xmlsettingsmanager.h"
 #include "core.h"
+#include "pluginmanager.h"
+#include "lazyplugininfo.h"
 
 namespace LeechCraft
 {
@@ -54,6 +57,13 @@ namespace LeechCraft
 
 		IInfo *ii = qobject_cast<IInfo*> (obj);
 
+		for (const auto act : LazyActions_.take (ii->GetUniqueID ()))
+		{
+			for (const auto widget : act->associatedWidgets ())
+				widget->removeAction (act);
+			act->deleteLater ();
+		}
+
 		for (const auto& info : imt->GetTabClasses ())
 		{
 			if (!(info.Features_ & TFOpenableByRequest))
@@ -88,6 +98,34 @@ namespace LeechCraft
 		}
 	}
 
+	void NewTabMenuManager::AddLazyPlugin (const LazyPluginInfo& plugin)
+	{
+		const auto tcCount = std::count_if (plugin.TabClasses_.begin (), plugin.TabClasses_.end (),
+				[] (const TabClassInfo& tc) { return tc.Features_ & TFOpenableByRequest; });
+
+		for (const auto& info : plugin.TabClasses_)
+		{
+			if (!(info.Features_ & TFOpenableByRequest))
+				continue;
+
+			QAction *newAct = new QAction (info.Icon_,
+					AccelerateName (info.VisibleName_),
+					this);
+			connect (newAct,
+					SIGNAL (triggered ()),
+					this,
+					SLOT (handleNewTabRequested ()));
+			newAct->setProperty ("LazyPluginID", plugin.ID_);
+			newAct->setProperty ("TabClass", info.TabClass_);
+			newAct->setStatusTip (info.Description_);
+			newAct->setToolTip (info.Description_);
+
+			LazyActions_ [plugin.ID_] << newAct;
+
+			InsertActionWParent (newAct, plugin.Name_, plugin.Icon_, tcCount > 1);
+		}
+	}
+
 	void NewTabMenuManager::SetToolbarActions (QList<QList<QAction*>> lists)
 	{
 		QList<QAction*> ones;
@@ -227,6 +265,68 @@ namespace LeechCraft
 			ToggleHide (pObj, tabClass, false);
 	}
 
+	void NewTabMenuManager::OpenLazyTab (QAction *action)
+	{
+		const auto& id = action->property ("LazyPluginID").toByteArray ();
+		const auto& tabClass = action->property ("TabClass").toByteArray ();
+
+		const auto pm = Core::Instance ().GetPluginManager ();
+		const auto pObj = pm->ActivateLazyPlugin (id);
+		if (!pObj && pm->IsInitializing ())
+		{
+			const QPointer<QAction> safeAction { action };
+			pm->RunAfterInit ([this, safeAction]
+					{
+						if (safeAction)
+							OpenLazyTab (safeAction);
+					});
+			return;
+		}
+
+		if (!pObj)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to activate"
+					<< id;
+
+			for (const auto act : LazyActions_.take (id))
+			{
+				for (const auto widget : act->associatedWidgets ())
+					widget->removeAction (act);
+				act->deleteLater ();
+			}
+			return;
+		}
+
+		// Activation has replaced the placeholders with the real actions.
+		if (const auto realAct = FindAction (NewTabMenu_, pObj, tabClass))
+		{
+			OpenTab (realAct);
+			return;
+		}
+
+		if (const auto tabs = qobject_cast<IHaveTabs*> (pObj))
+			tabs->TabOpenRequested (tabClass);
+	}
+
+	QAction* NewTabMenuManager::FindAction (QMenu *menu, QObject *pObj, const QByteArray& tabClass)
+	{
+		for (const auto action : menu->actions ())
+		{
+			if (const auto submenu = action->menu ())
+			{
+				if (const auto found = FindAction (submenu, pObj, tabClass))
+					return found;
+				continue;
+			}
+
+			if (action->property ("TabClass").toByteArray () == tabClass &&
+					action->property ("PluginObj").value<QObject*> () == pObj)
+				return action;
+		}
+		return nullptr;
+	}
+
 	namespace
 	{
 		QAction* FindActionBefore (const QString& name, QMenu *menu)
@@ -262,10 +362,14 @@ namespace LeechCraft
 				[] (const TabClassInfo& tc) { return tc.Features_ & TFOpenableByRequest; });
 
 		const auto ii = qobject_cast<IInfo*> (pObj);
-		const auto& name = ii->GetName ();
+		InsertActionWParent (act, ii->GetName (), ii->GetIcon (), sub || tcCount > 1);
+	}
 
+	void NewTabMenuManager::InsertActionWParent (QAction *act,
+			const QString& name, const QIcon& icon, bool sub)
+	{
 		auto rootMenu = NewTabMenu_;
-		if (sub || tcCount > 1)
+		if (sub)
 		{
 			bool menuFound = false;
 			for (auto menuAct : rootMenu->actions ())
@@ -279,7 +383,7 @@ namespace LeechCraft
 			if (!menuFound)
 			{
 				auto menu = new QMenu (name, rootMenu);
-				menu->setIcon (ii->GetIcon ());
+				menu->setIcon (icon);
 				rootMenu->insertMenu (FindActionBefore (name, rootMenu), menu);
 				rootMenu = menu;
 			}
@@ -299,6 +403,9 @@ namespace LeechCraft
 			return;
 		}
 
-		OpenTab (action);
+		if (!action->property ("LazyPluginID").isNull ())
+			OpenLazyTab (action);
+		else
+			OpenTab (action);
 	}
 }
@@ -31,16 +31,20 @@
 #define NEWTABMENUMANAGER_H
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QString>
 #include <QSet>
 
 class QMenu;
 class QAction;
+class QIcon;
 
 class ITabWidget;
 
 namespace LeechCraft
 {
+	struct LazyPluginInfo;
+
 	class NewTabMenuManager : public QObject
 	{
 		Q_OBJECT
@@ -50,10 +54,14 @@ namespace LeechCraft
 		QList<QObject*> RegisteredMultiTabs_;
 		QSet<QChar> UsedAccelerators_;
 		QMap<QObject*, QMap<QString, QAction*>> HiddenActions_;
+
+		// Placeholders for tabs of plugins that aren't activated yet
+		QHash<QByteArray, QList<QAction*>> LazyActions_;
 	public:
 		NewTabMenuManager (QObject* = 0);
 
 		void AddObject (QObject*);
+		void AddLazyPlugin (const LazyPluginInfo&);
 		void SetToolbarActions (QList<QList<QAction*>>);
 		void SingleRemoved (ITabWidget*);
 
@@ -66,8 +74,11 @@ namespace LeechCraft
 		QString AccelerateName (QString);
 		void ToggleHide (QObject*, const QByteArray&, bool);
 		void OpenTab (QAction*);
+		void OpenLazyTab (QAction*);
+		QAction* FindAction (QMenu*, QObject*, const QByteArray&);
 		void InsertAction (QAction*);
 		void InsertActionWParent (QAction*, QObject*, bool sub);
+		void InsertActionWParent (QAction*, const QString&, const QIcon&, bool sub);
 	private slots:
 		void handleNewTabRequested ();
 	signals:
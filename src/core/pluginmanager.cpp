@@ -41,6 +41,7 @@
 #include <util/util.h>
 #include <util/exceptions.h>
 #include <util/sll/prelude.h>
+#include <util/sys/paths.h>
 #include <interfaces/iinfo.h>
 #include <interfaces/iplugin2.h>
 #include <interfaces/ipluginready.h>
@@ -52,6 +53,7 @@
 #include "xmlsettingsmanager.h"
 #include "coreproxy.h"
 #include "plugintreebuilder.h"
+#include "startupprofiler.h"
 #include "config.h"
 #include "coreinstanceobject.h"
 #include "shortcutmanager.h"
@@ -70,6 +72,8 @@ namespace LeechCraft
 	: QAbstractItemModel (parent)
 	, DBusMode_ (static_cast<Application*> (qApp)->GetVarMap ().count ("multiprocess"))
 	, PluginTreeBuilder_ (new PluginTreeBuilder)
+	, Profiler_ (std::make_shared<StartupProfiler> ())
+	, Initializing_ (false)
 	, CacheValid_ (false)
 	{
 		Headers_ << tr ("Name")
@@ -350,7 +354,10 @@ namespace LeechCraft
 			{
 				qDebug () << "Initializing" << ii->GetName ();
 				emit loadProgress (tr ("Initializing %1: stage one...").arg (ii->GetName ()));
-				ii->Init (std::make_shared<CoreProxy> ());
+				{
+					StartupProfiler::Measurement m { Profiler_.get (), GetProfilerKey (obj), StartupProfiler::Stage::Init };
+					ii->Init (std::make_shared<CoreProxy> ());
+				}
 
 				const auto& path = GetPluginLibraryPath (obj);
 				if (path.isEmpty ())
@@ -401,9 +408,53 @@ namespace LeechCraft
 		}
 	}
 
+	QString PluginManager::GetProfilerKey (const QObject *obj) const
+	{
+		const auto& path = GetPluginLibraryPath (obj);
+		if (!path.isEmpty ())
+			return path;
+
+		const auto ii = qobject_cast<IInfo*> (obj);
+		return ii ? ii->GetName () : QString {};
+	}
+
+	void PluginManager::ReportStartupProfile () const
+	{
+		const auto& summary = Profiler_->GetSummary ();
+
+		if (!LazyPlugins_.isEmpty ())
+			qDebug () << LazyPlugins_.size ()
+					<< "plugins are registered for lazy activation";
+
+		qDebug () << "slowest plugins to start:";
+		for (const auto& item : summary.mid (0, 10))
+			qDebug () << "\t"
+					<< item.Name_
+					<< "wall:" << item.TotalWallUs_ / 1000. << "ms;"
+					<< "cpu:" << item.TotalCpuUs_ / 1000. << "ms";
+
+		try
+		{
+			const auto& dir = Util::CreateIfNotExists ({});
+			Profiler_->WriteTrace (dir.filePath ("startup-trace.json"));
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+		}
+	}
+
 	void PluginManager::Init (bool safeMode)
 	{
 		DefaultPluginIcon_ = QIcon ("lcicons:/resources/images/defaultpluginicon.svg");
+
+		Initializing_ = true;
+
+		if (!safeMode && !DBusMode_ &&
+				XmlSettingsManager::Instance ()->property ("LazyPluginActivation").toBool ())
+			SelectLazyPlugins ();
+
 		CheckPlugins ();
 		FillInstances ();
 
@@ -452,6 +503,7 @@ namespace LeechCraft
 			try
 			{
 				emit loadProgress (tr ("Initializing %1: stage two...").arg (ii->GetName ()));
+				StartupProfiler::Measurement m { Profiler_.get (), GetProfilerKey (obj), StartupProfiler::Stage::SecondInit };
 				ii->SecondInit ();
 			}
 			catch (const std::exception& e)
@@ -466,9 +518,23 @@ namespace LeechCraft
 		}
 
 		for (const auto plugin : GetAllPlugins ())
+		{
+			StartupProfiler::Measurement m { Profiler_.get (), GetProfilerKey (plugin), StartupProfiler::Stage::PostSecondInit };
 			Core::Instance ().PostSecondInit (plugin);
+		}
 
 		TryUnload (failed);
+
+		SaveLazyPluginsInfo ();
+
+		ReportStartupProfile ();
+
+		Initializing_ = false;
+
+		const auto afterInit = AfterInit_;
+		AfterInit_.clear ();
+		for (const auto& func : afterInit)
+			func ();
 	}
 
 	void PluginManager::Release ()
@@ -706,6 +772,49 @@ namespace LeechCraft
 		return PluginLoadErrors_;
 	}
 
+	StartupProfiler* PluginManager::GetStartupProfiler () const
+	{
+		return Profiler_.get ();
+	}
+
+	bool PluginManager::IsInitializing () const
+	{
+		return Initializing_;
+	}
+
+	void PluginManager::RunAfterInit (const std::function<void ()>& func)
+	{
+		if (Initializing_)
+			AfterInit_ << func;
+		else
+			func ();
+	}
+
+	QList<LazyPluginInfo> PluginManager::GetLazyPlugins () const
+	{
+		return LazyPlugins_.values ();
+	}
+
+	bool PluginManager::HasLazyEntityHandlers () const
+	{
+		return std::any_of (LazyPlugins_.begin (), LazyPlugins_.end (),
+				[] (const LazyPluginInfo& info) { return info.IsEntityHandler_; });
+	}
+
+	bool PluginManager::ActivateLazyEntityHandlers ()
+	{
+		QList<QByteArray> ids;
+		for (const auto& info : LazyPlugins_)
+			if (info.IsEntityHandler_)
+				ids << info.ID_;
+
+		bool activated = false;
+		for (const auto& id : ids)
+			if (LazyPlugins_.contains (id) && ActivateLazyPlugin (id))
+				activated = true;
+		return activated;
+	}
+
 	QStringList PluginManager::FindPluginsPaths () const
 	{
 		QStringList result;
@@ -882,8 +991,13 @@ namespace LeechCraft
 		QHash<QByteArray, QString> id2source;
 
 		QList<std::function<void (Loaders::IPluginLoader_ptr)>> checks;
+		const auto profiler = Profiler_.get ();
 		checks << Checks::IsFile
-				<< Checks::TryLoad
+				<< [profiler] (Loaders::IPluginLoader_ptr loader)
+					{
+						StartupProfiler::Measurement m { profiler, loader->GetFileName (), StartupProfiler::Stage::Load };
+						Checks::TryLoad (loader);
+					}
 				<< Checks::APILevel;
 
 		auto thrCheck = [checks] (Loaders::IPluginLoader_ptr loader) -> boost::optional<Checks::Fail>
@@ -919,7 +1033,11 @@ namespace LeechCraft
 			}
 
 		checks.clear ();
-		checks << Checks::TryInstance;
+		checks << [profiler] (Loaders::IPluginLoader_ptr loader)
+				{
+					StartupProfiler::Measurement m { profiler, loader->GetFileName (), StartupProfiler::Stage::Instance };
+					Checks::TryInstance (loader);
+				};
 
 		for (int i = 0; i < PluginContainers_.size (); ++i)
 		{
@@ -984,6 +1102,8 @@ namespace LeechCraft
 			QString name = info->GetName ();
 			QString pinfo = info->GetInfo ();
 
+			Profiler_->SetName (loader->GetFileName (), name);
+
 			settings.beginGroup (loader->GetFileName ());
 			settings.setValue ("Name", name);
 			settings.setValue ("Info", pinfo);
@@ -993,6 +1113,279 @@ namespace LeechCraft
 		settings.endGroup ();
 	}
 
+	void PluginManager::SelectLazyPlugins ()
+	{
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "-pg");
+		settings.beginGroup ("Plugins");
+		std::shared_ptr<void> groupGuard (nullptr,
+				[&settings] (void*) { settings.endGroup (); });
+
+		QList<LazyPluginInfo> infos;
+		for (const auto& loader : PluginContainers_)
+		{
+			const auto& info = LoadLazyPluginInfo (settings, loader->GetFileName ());
+			if (!info)
+			{
+				qDebug () << Q_FUNC_INFO
+						<< "no up-to-date metadata for"
+						<< loader->GetFileName ()
+						<< "; loading all plugins right away";
+				return;
+			}
+
+			infos << *info;
+		}
+
+		/* A plugin can't be activated lazily if a plugin that is loaded
+		 * right away needs a feature it provides.
+		 */
+		QSet<QString> eagerNeeds;
+		for (const auto& info : infos)
+			if (!info.IsEligible_)
+				eagerNeeds += QSet<QString>::fromList (info.Needs_);
+
+		bool changed = true;
+		while (changed)
+		{
+			changed = false;
+			for (auto& info : infos)
+				if (info.IsEligible_ &&
+						!QSet<QString>::fromList (info.Provides_).intersect (eagerNeeds).isEmpty ())
+				{
+					info.IsEligible_ = false;
+					eagerNeeds += QSet<QString>::fromList (info.Needs_);
+					changed = true;
+				}
+		}
+
+		for (const auto& info : infos)
+		{
+			if (!info.IsEligible_ || LazyPlugins_.contains (info.ID_))
+				continue;
+
+			LazyPlugins_ [info.ID_] = info;
+			PluginContainers_.erase (std::remove_if (PluginContainers_.begin (), PluginContainers_.end (),
+						[&info] (const Loaders::IPluginLoader_ptr& loader)
+							{ return loader->GetFileName () == info.Path_; }),
+					PluginContainers_.end ());
+		}
+	}
+
+	void PluginManager::SaveLazyPluginsInfo ()
+	{
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "-pg");
+		settings.beginGroup ("Plugins");
+
+		const auto& initialized = PluginTreeBuilder_->GetResult ();
+		for (const auto& loader : PluginContainers_)
+		{
+			const auto inst = loader->Instance ();
+			if (!initialized.contains (inst))
+				continue;
+
+			try
+			{
+				SaveLazyPluginInfo (settings, loader->GetFileName (), inst);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to save metadata for"
+						<< loader->GetFileName ()
+						<< e.what ();
+			}
+		}
+
+		settings.endGroup ();
+	}
+
+	void PluginManager::CollectLazyDeps (const QByteArray& id, QList<LazyPluginInfo>& result) const
+	{
+		if (std::any_of (result.begin (), result.end (),
+				[&id] (const LazyPluginInfo& info) { return info.ID_ == id; }))
+			return;
+
+		const auto& info = LazyPlugins_.value (id);
+		result << info;
+
+		for (const auto& feature : info.Needs_)
+		{
+			const bool isProvided = std::any_of (Plugins_.begin (), Plugins_.end (),
+					[&feature] (QObject *obj)
+						{ return qobject_cast<IInfo*> (obj)->Provides ().contains (feature); });
+			if (isProvided)
+				continue;
+
+			for (const auto& other : LazyPlugins_)
+				if (other.Provides_.contains (feature))
+					CollectLazyDeps (other.ID_, result);
+		}
+	}
+
+	QObject* PluginManager::ActivateLazyPlugin (const QByteArray& id)
+	{
+		if (!LazyPlugins_.contains (id))
+			return GetPluginByID (id);
+
+		/* Plugins may request activation from their Init() or
+		 * SecondInit(), but activating in the middle of Init() would
+		 * run the second stage and PostSecondInit() for the new plugins
+		 * twice.
+		 */
+		if (Initializing_)
+		{
+			RunAfterInit ([this, id] { ActivateLazyPlugin (id); });
+			return nullptr;
+		}
+
+		QList<LazyPluginInfo> toActivate;
+		CollectLazyDeps (id, toActivate);
+
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "-pg");
+		settings.beginGroup ("Plugins");
+		std::shared_ptr<void> groupGuard (nullptr,
+				[&settings] (void*) { settings.endGroup (); });
+
+		QObjectList newObjects;
+		for (const auto& info : toActivate)
+		{
+			LazyPlugins_.remove (info.ID_);
+
+			qDebug () << Q_FUNC_INFO
+					<< "activating"
+					<< info.Name_
+					<< "from"
+					<< info.Path_;
+
+			const auto pos = std::find_if (AvailablePlugins_.begin (), AvailablePlugins_.end (),
+					[&info] (const Loaders::IPluginLoader_ptr& loader)
+						{ return loader->GetFileName () == info.Path_; });
+			if (pos == AvailablePlugins_.end ())
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "no loader for"
+						<< info.Path_;
+				continue;
+			}
+
+			const auto loader = *pos;
+			try
+			{
+				{
+					StartupProfiler::Measurement m { Profiler_.get (), info.Path_, StartupProfiler::Stage::Load };
+					Checks::TryLoad (loader);
+				}
+				Checks::APILevel (loader);
+				{
+					StartupProfiler::Measurement m { Profiler_.get (), info.Path_, StartupProfiler::Stage::Instance };
+					Checks::TryInstance (loader);
+				}
+			}
+			catch (const Checks::Fail& f)
+			{
+				PluginLoadErrors_ << f.Error_;
+				ClearLazyPluginInfo (settings, info.Path_);
+				continue;
+			}
+
+			const auto inst = loader->Instance ();
+			Profiler_->SetName (info.Path_, info.Name_);
+			PluginContainers_ << loader;
+			Obj2Loader_ [inst] = loader;
+			Plugins_ << inst;
+			newObjects << inst;
+		}
+
+		PluginTreeBuilder_->AddObjects (newObjects);
+		PluginTreeBuilder_->Calculate ();
+		CacheValid_ = false;
+		PluginID2PluginCache_.clear ();
+
+		QObjectList initialized;
+		auto getPending = [this, &newObjects, &initialized] () -> QObjectList
+		{
+			QObjectList result;
+			for (const auto obj : PluginTreeBuilder_->GetResult ())
+				if (newObjects.contains (obj) && !initialized.contains (obj))
+					result << obj;
+			return result;
+		};
+
+		auto ordered = getPending ();
+		QObject *failedObj = 0;
+		while ((failedObj = TryFirstInit (ordered)))
+		{
+			initialized += ordered.mid (0, ordered.indexOf (failedObj));
+
+			PluginTreeBuilder_->RemoveObject (failedObj);
+			PluginTreeBuilder_->Calculate ();
+
+			ordered = getPending ();
+		}
+		initialized += ordered;
+
+		QObjectList failed;
+		for (const auto obj : newObjects)
+			if (!initialized.contains (obj))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< obj
+						<< "failed to initialize or has unfulfilled dependencies";
+				failed << obj;
+
+				PluginTreeBuilder_->RemoveObject (obj);
+				Plugins_.removeAll (obj);
+				ClearLazyPluginInfo (settings, Obj2Loader_ [obj]->GetFileName ());
+			}
+		if (!failed.isEmpty ())
+			PluginTreeBuilder_->Calculate ();
+		TryUnload (failed);
+
+		for (const auto obj : initialized)
+			Core::Instance ().Setup (obj);
+
+		auto coreInstanceObj = Core::Instance ().GetCoreInstanceObject ();
+		for (const auto obj : initialized)
+			if (qobject_cast<IHaveShortcuts*> (obj))
+				coreInstanceObj->GetShortcutManager ()->AddObject (obj);
+
+		for (const auto obj : initialized)
+		{
+			const auto ii = qobject_cast<IInfo*> (obj);
+			try
+			{
+				StartupProfiler::Measurement m { Profiler_.get (), GetProfilerKey (obj), StartupProfiler::Stage::SecondInit };
+				ii->SecondInit ();
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "while initializing"
+						<< obj
+						<< "got"
+						<< e.what ();
+			}
+		}
+
+		for (const auto obj : initialized)
+		{
+			{
+				StartupProfiler::Measurement m { Profiler_.get (), GetProfilerKey (obj), StartupProfiler::Stage::PostSecondInit };
+				Core::Instance ().PostSecondInit (obj);
+			}
+
+			const int row = AvailablePlugins_.indexOf (Obj2Loader_.value (obj));
+			emit dataChanged (index (row, 0), index (row, 1));
+
+			emit pluginInjected (obj);
+		}
+
+		return GetPluginByID (id);
+	}
+
 	void PluginManager::FillInstances ()
 	{
 		Q_FOREACH (auto loader, PluginContainers_)
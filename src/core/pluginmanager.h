@@ -30,13 +30,16 @@
 #ifndef PLUGINMANAGER_H
 #define PLUGINMANAGER_H
 #include <memory>
+#include <functional>
 #include <QAbstractItemModel>
 #include <QMap>
+#include <QHash>
 #include <QMultiMap>
 #include <QStringList>
 #include <QDir>
 #include <QIcon>
 #include "loaders/ipluginloader.h"
+#include "lazyplugininfo.h"
 #include "interfaces/iinfo.h"
 #include "interfaces/core/ipluginsmanager.h"
 
@@ -44,6 +47,7 @@ namespace LeechCraft
 {
 	class MainWindow;
 	class PluginTreeBuilder;
+	class StartupProfiler;
 
 	class PluginManager : public QAbstractItemModel
 						, public IPluginsManager
@@ -72,6 +76,13 @@ namespace LeechCraft
 		mutable QMap<QByteArray, QObject*> PluginID2PluginCache_;
 
 		std::shared_ptr<PluginTreeBuilder> PluginTreeBuilder_;
+		std::shared_ptr<StartupProfiler> Profiler_;
+
+		// Plugins registered from cached metadata but not loaded yet
+		QHash<QByteArray, LazyPluginInfo> LazyPlugins_;
+
+		bool Initializing_;
+		QList<std::function<void ()>> AfterInit_;
 
 		mutable bool CacheValid_;
 		mutable QObjectList SortedCache_;
@@ -122,11 +133,63 @@ namespace LeechCraft
 		QObject* GetProvider (const QString&) const;
 
 		const QStringList& GetPluginLoadErrors () const;
+
+		StartupProfiler* GetStartupProfiler () const;
+
+		/** Returns whether Init() is still running.
+		 */
+		bool IsInitializing () const;
+
+		/** Runs the given function right away if Init() has finished,
+		 * or right after it finishes otherwise.
+		 */
+		void RunAfterInit (const std::function<void ()>&);
+
+		QList<LazyPluginInfo> GetLazyPlugins () const;
+
+		/** Returns whether there are lazily registered entity handlers
+		 * that aren't activated yet.
+		 */
+		bool HasLazyEntityHandlers () const;
+
+		/** Loads and initializes the lazily registered plugin with the
+		 * given ID along with the lazy plugins it depends on. Returns
+		 * the plugin instance, or nullptr if it fails to activate.
+		 *
+		 * If the plugin is already active, its instance is returned.
+		 *
+		 * While Init() is running, the activation is postponed until
+		 * Init() finishes, and nullptr is returned.
+		 */
+		QObject* ActivateLazyPlugin (const QByteArray& id);
+
+		/** Activates all the lazily registered entity handlers.
+		 * Returns whether any of them has been activated.
+		 */
+		bool ActivateLazyEntityHandlers ();
 	private:
 		QStringList FindPluginsPaths () const;
 		void FindPlugins ();
 		void ScanPlugins (const QStringList&);
 
+		/** Moves the plugins that can be activated on demand from
+		 * PluginContainers_ to LazyPlugins_, basing on the metadata
+		 * cached during previous runs.
+		 */
+		void SelectLazyPlugins ();
+
+		/** Caches the metadata for lazy activation of all the loaded
+		 * plugins.
+		 */
+		void SaveLazyPluginsInfo ();
+
+		/** Appends to the list the lazy plugin with the given ID and
+		 * the lazy plugins providing the features it needs, unless
+		 * they are provided by already loaded plugins. The order is
+		 * up to PluginTreeBuilder.
+		 */
+		void CollectLazyDeps (const QByteArray& id, QList<LazyPluginInfo>&) const;
+
 		/** Tries to load all the plugins and filters out those who fail
 		 * various sanity checks.
 		 */
@@ -154,6 +217,14 @@ namespace LeechCraft
 		 */
 		void TryUnload (QObjectList);
 
+		/** Returns the key identifying the given plugin in the startup
+		 * profiler: the path to its library or, if there is no such,
+		 * its name.
+		 */
+		QString GetProfilerKey (const QObject*) const;
+
+		void ReportStartupProfile () const;
+
 		Loaders::IPluginLoader_ptr MakeLoader (const QString&);
 
 		QList<Plugins_t::iterator> FindProviders (const QString&);
@@ -31,6 +31,7 @@
 #include <QStyledItemDelegate>
 #include <QPushButton>
 #include <QSortFilterProxyModel>
+#include <QStandardItemModel>
 #include "util/gui/clearlineeditaddon.h"
 #include "interfaces/ihavesettings.h"
 #include "interfaces/iinfo.h"
@@ -39,6 +40,8 @@
 #include "coreinstanceobject.h"
 #include "settingstab.h"
 #include "coreproxy.h"
+#include "pluginmanager.h"
+#include "startupprofiler.h"
 
 namespace LeechCraft
 {
@@ -169,6 +172,47 @@ namespace LeechCraft
 				SLOT (setFilterFixedString (QString)));
 
 		new Util::ClearLineEditAddon (ICoreProxy_ptr (new CoreProxy ()), Ui_.FilterLine_);
+
+		FillStartupProfile ();
+	}
+
+	void PluginManagerDialog::FillStartupProfile ()
+	{
+		auto model = new QStandardItemModel (this);
+		model->setHorizontalHeaderLabels ({
+					tr ("Plugin"),
+					tr ("Load, ms"),
+					tr ("Instance, ms"),
+					tr ("Init, ms"),
+					tr ("Second init, ms"),
+					tr ("Post init, ms"),
+					tr ("Total, ms"),
+					tr ("CPU, ms")
+				});
+
+		auto makeTimeItem = [] (qint64 us)
+		{
+			auto item = new QStandardItem;
+			item->setData (us / 1000., Qt::DisplayRole);
+			item->setTextAlignment (Qt::AlignRight | Qt::AlignVCenter);
+			return item;
+		};
+
+		const auto profiler = Core::Instance ().GetPluginManager ()->GetStartupProfiler ();
+		for (const auto& summary : profiler->GetSummary ())
+		{
+			QList<QStandardItem*> row { new QStandardItem (summary.Name_) };
+			for (const auto wall : summary.WallUs_)
+				row << makeTimeItem (wall);
+			row << makeTimeItem (summary.TotalWallUs_);
+			row << makeTimeItem (summary.TotalCpuUs_);
+			model->appendRow (row);
+		}
+
+		Ui_.StartupTree_->setModel (model);
+		Ui_.StartupTree_->sortByColumn (model->columnCount () - 2, Qt::DescendingOrder);
+		for (int i = 0, cc = model->columnCount (); i < cc; ++i)
+			Ui_.StartupTree_->resizeColumnToContents (i);
 	}
 
 	void PluginManagerDialog::readjustColumns ()
@@ -44,6 +44,8 @@ namespace LeechCraft
 		QSortFilterProxyModel *FilterProxy_;
 	public:
 		PluginManagerDialog (QWidget* = 0);
+	private:
+		void FillStartupProfile ();
 	public slots:
 		void readjustColumns ();
 
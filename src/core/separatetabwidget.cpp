@@ -816,8 +816,15 @@ namespace LeechCraft
 			{
 				const QByteArray& newTabId = parts.at (0);
 				const QByteArray& tabClass = parts.at (1);
-				QObject *plugin = Core::Instance ()
-						.GetPluginManager ()->GetPluginByID (newTabId);
+				const auto pm = Core::Instance ().GetPluginManager ();
+				QObject *plugin = pm->ActivateLazyPlugin (newTabId);
+				if (!plugin && pm->IsInitializing ())
+				{
+					// The plugin will be activated once the plugins are initialized.
+					pm->RunAfterInit ([this] { handleAddDefaultTab (); });
+					return;
+				}
+
 				IHaveTabs *iht = qobject_cast<IHaveTabs*> (plugin);
 				if (!iht)
 					qWarning () << Q_FUNC_INFO
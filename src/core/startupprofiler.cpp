@@ -0,0 +1,265 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "startupprofiler.h"
+#include <algorithm>
+#include <QThread>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QtDebug>
+
+#if defined (Q_OS_WIN32)
+#include <windows.h>
+#elif defined (Q_OS_UNIX)
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace LeechCraft
+{
+	namespace
+	{
+		qint64 GetThreadCpuUs ()
+		{
+#if defined (Q_OS_WIN32)
+			FILETIME creation, exit, kernel, user;
+			if (!GetThreadTimes (GetCurrentThread (), &creation, &exit, &kernel, &user))
+				return 0;
+
+			auto toUs = [] (const FILETIME& ft)
+			{
+				return ((static_cast<qint64> (ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10;
+			};
+			return toUs (kernel) + toUs (user);
+#elif defined (Q_OS_UNIX) && defined (CLOCK_THREAD_CPUTIME_ID)
+			timespec ts;
+			if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts))
+				return 0;
+
+			return static_cast<qint64> (ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#else
+			return 0;
+#endif
+		}
+
+		QString EscapeJson (const QString& str)
+		{
+			QString result;
+			result.reserve (str.size () + 2);
+			for (const auto ch : str)
+				switch (ch.unicode ())
+				{
+				case '"':
+					result += "\\\"";
+					break;
+				case '\\':
+					result += "\\\\";
+					break;
+				case '\n':
+					result += "\\n";
+					break;
+				case '\t':
+					result += "\\t";
+					break;
+				default:
+					if (ch.unicode () < 0x20)
+						result += QString ("\\u%1").arg (ch.unicode (), 4, 16, QChar ('0'));
+					else
+						result += ch;
+					break;
+				}
+			return result;
+		}
+	}
+
+	StartupProfiler::Measurement::Measurement (StartupProfiler *profiler, const QString& key, Stage stage)
+	: Profiler_ (profiler)
+	, Key_ (key)
+	, Stage_ (stage)
+	, StartUs_ (profiler->Timer_.nsecsElapsed () / 1000)
+	, StartCpuUs_ (GetThreadCpuUs ())
+	{
+	}
+
+	StartupProfiler::Measurement::~Measurement ()
+	{
+		const auto wall = Profiler_->Timer_.nsecsElapsed () / 1000 - StartUs_;
+		const auto cpu = GetThreadCpuUs () - StartCpuUs_;
+		Profiler_->AddRecord (Key_, Stage_, StartUs_, wall, cpu);
+	}
+
+	StartupProfiler::StartupProfiler ()
+	{
+		Timer_.start ();
+	}
+
+	void StartupProfiler::SetName (const QString& key, const QString& name)
+	{
+		QMutexLocker locker (&Mutex_);
+		Key2Name_ [key] = name;
+	}
+
+	qint64 StartupProfiler::GetElapsedUs () const
+	{
+		return Timer_.nsecsElapsed () / 1000;
+	}
+
+	QList<StartupProfiler::Record> StartupProfiler::GetRecords () const
+	{
+		QMutexLocker locker (&Mutex_);
+		return Records_;
+	}
+
+	QList<StartupProfiler::PluginSummary> StartupProfiler::GetSummary () const
+	{
+		QMutexLocker locker (&Mutex_);
+
+		QHash<QString, PluginSummary> key2summary;
+		for (const auto& record : Records_)
+		{
+			auto pos = key2summary.find (record.Key_);
+			if (pos == key2summary.end ())
+			{
+				PluginSummary summary { GetName (record.Key_), {}, 0, 0 };
+				pos = key2summary.insert (record.Key_, summary);
+			}
+
+			pos->WallUs_ [static_cast<int> (record.Stage_)] += record.WallUs_;
+			pos->TotalWallUs_ += record.WallUs_;
+			pos->TotalCpuUs_ += record.CpuUs_;
+		}
+
+		auto result = key2summary.values ();
+		std::sort (result.begin (), result.end (),
+				[] (const PluginSummary& left, const PluginSummary& right)
+					{ return left.TotalWallUs_ > right.TotalWallUs_; });
+		return result;
+	}
+
+	bool StartupProfiler::WriteTrace (const QString& path) const
+	{
+		QFile file (path);
+		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< path
+					<< file.errorString ();
+			return false;
+		}
+
+		QMutexLocker locker (&Mutex_);
+
+		QTextStream out (&file);
+		out.setCodec ("UTF-8");
+		out << "{\"traceEvents\":[\n";
+
+		bool first = true;
+		for (const auto& record : Records_)
+		{
+			if (!first)
+				out << ",\n";
+			first = false;
+
+			const auto& name = EscapeJson (GetName (record.Key_));
+			out << "{\"name\":\"" << name
+					<< "\",\"cat\":\"" << GetStageName (record.Stage_)
+					<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.Thread_
+					<< ",\"ts\":" << record.StartUs_
+					<< ",\"dur\":" << record.WallUs_
+					<< ",\"args\":{\"stage\":\"" << GetStageName (record.Stage_)
+					<< "\",\"cpu_us\":" << record.CpuUs_
+					<< ",\"library\":\"" << EscapeJson (record.Key_)
+					<< "\"}}";
+		}
+
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return true;
+	}
+
+	QString StartupProfiler::GetStageName (Stage stage)
+	{
+		switch (stage)
+		{
+		case Stage::Load:
+			return "Load";
+		case Stage::Instance:
+			return "Instance";
+		case Stage::Init:
+			return "Init";
+		case Stage::SecondInit:
+			return "SecondInit";
+		case Stage::PostSecondInit:
+			return "PostSecondInit";
+		}
+
+		return {};
+	}
+
+	qint64 StartupProfiler::GetResidentSetSize ()
+	{
+#ifdef Q_OS_LINUX
+		QFile file ("/proc/self/statm");
+		if (!file.open (QIODevice::ReadOnly))
+			return -1;
+
+		const auto& fields = file.readAll ().split (' ');
+		if (fields.size () < 2)
+			return -1;
+
+		return fields.at (1).toLongLong () * sysconf (_SC_PAGESIZE);
+#else
+		return -1;
+#endif
+	}
+
+	void StartupProfiler::AddRecord (const QString& key, Stage stage, qint64 start, qint64 wall, qint64 cpu)
+	{
+		const auto thread = QThread::currentThreadId ();
+
+		QMutexLocker locker (&Mutex_);
+		if (!Threads_.contains (thread))
+		{
+			const auto idx = Threads_.size ();
+			Threads_ [thread] = idx;
+		}
+
+		Records_.append ({ key, stage, Threads_ [thread], start, wall, cpu });
+	}
+
+	QString StartupProfiler::GetName (const QString& key) const
+	{
+		const auto& name = Key2Name_.value (key);
+		if (!name.isEmpty ())
+			return name;
+
+		return QFileInfo (key).fileName ();
+	}
+}
@@ -0,0 +1,132 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+namespace LeechCraft
+{
+	/** Records the wall-clock and CPU time spent by each plugin in each
+	 * startup stage.
+	 *
+	 * The stages of a plugin are identified by a key, which is the path
+	 * to the plugin library if it's known, or the plugin name
+	 * otherwise. Measurements may be done from several threads at once.
+	 */
+	class StartupProfiler
+	{
+	public:
+		enum class Stage
+		{
+			Load,
+			Instance,
+			Init,
+			SecondInit,
+			PostSecondInit
+		};
+		static const int StagesCount = static_cast<int> (Stage::PostSecondInit) + 1;
+
+		struct Record
+		{
+			QString Key_;
+			Stage Stage_;
+			int Thread_;
+
+			qint64 StartUs_;
+			qint64 WallUs_;
+			qint64 CpuUs_;
+		};
+
+		struct PluginSummary
+		{
+			QString Name_;
+			qint64 WallUs_ [StagesCount];
+			qint64 TotalWallUs_;
+			qint64 TotalCpuUs_;
+		};
+
+		/** Measures the time between its construction and destruction
+		 * and records it as the given stage of the given plugin.
+		 */
+		class Measurement
+		{
+			StartupProfiler * const Profiler_;
+			const QString Key_;
+			const Stage Stage_;
+
+			const qint64 StartUs_;
+			const qint64 StartCpuUs_;
+		public:
+			Measurement (StartupProfiler*, const QString& key, Stage);
+			~Measurement ();
+
+			Measurement (const Measurement&) = delete;
+			Measurement& operator= (const Measurement&) = delete;
+		};
+	private:
+		QElapsedTimer Timer_;
+
+		mutable QMutex Mutex_;
+		QList<Record> Records_;
+		QHash<QString, QString> Key2Name_;
+		QHash<Qt::HANDLE, int> Threads_;
+	public:
+		StartupProfiler ();
+
+		void SetName (const QString& key, const QString& name);
+
+		/** Returns the time since the profiler has been created, which
+		 * is close to the application startup.
+		 */
+		qint64 GetElapsedUs () const;
+
+		QList<Record> GetRecords () const;
+		QList<PluginSummary> GetSummary () const;
+
+		/** Writes the recorded timeline in the Chrome trace event
+		 * format, suitable for chrome://tracing and similar viewers.
+		 */
+		bool WriteTrace (const QString& path) const;
+
+		static QString GetStageName (Stage);
+
+		/** Returns the resident set size of the process in bytes, or
+		 * -1 if it isn't known on this platform.
+		 */
+		static qint64 GetResidentSetSize ();
+	private:
+		void AddRecord (const QString&, Stage, qint64, qint64, qint64);
+		QString GetName (const QString&) const;
+	};
+}
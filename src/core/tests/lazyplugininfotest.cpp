@@ -0,0 +1,168 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "lazyplugininfotest.h"
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QSettings>
+#include "lazyplugininfo.h"
+
+QTEST_MAIN (LeechCraft::LazyPluginInfoTest)
+
+namespace LeechCraft
+{
+	namespace
+	{
+		bool WriteFile (const QString& path, const QByteArray& data)
+		{
+			QFile file (path);
+			return file.open (QIODevice::WriteOnly | QIODevice::Append) &&
+					file.write (data) == data.size ();
+		}
+	}
+
+	void LazyPluginInfoTest::init ()
+	{
+		Dir_ = QDir::temp ().filePath (QString ("lc_lazyplugininfo_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		QVERIFY (QDir {}.mkpath (Dir_));
+		QVERIFY (WriteFile (Dir_ + "/libleechcraft_fake.so", "some library"));
+	}
+
+	void LazyPluginInfoTest::cleanup ()
+	{
+		QDir dir (Dir_);
+		for (const auto& name : dir.entryList (QDir::Files | QDir::Hidden))
+			dir.remove (name);
+		QDir {}.rmdir (Dir_);
+	}
+
+	void LazyPluginInfoTest::tabsPluginIsEligible ()
+	{
+		FakeTabsPlugin plugin;
+		QVERIFY (IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::handlerIsEligible ()
+	{
+		FakeHandlerPlugin plugin;
+		QVERIFY (IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::plainPluginIsEager ()
+	{
+		FakePlugin plugin;
+		QVERIFY (!IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::defaultTabsAreEager ()
+	{
+		FakeTabsPlugin plugin { TFOpenableByRequest | TFByDefault };
+		QVERIFY (!IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::settingsAreEager ()
+	{
+		FakeSettingsTabsPlugin plugin;
+		QVERIFY (!IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::shortcutsAreEager ()
+	{
+		FakeShortcutsHandlerPlugin plugin;
+		QVERIFY (!IsLazyEligible (&plugin));
+	}
+
+	void LazyPluginInfoTest::metadataRoundTrip ()
+	{
+		const auto& path = Dir_ + "/libleechcraft_fake.so";
+		QSettings settings (Dir_ + "/settings.ini", QSettings::IniFormat);
+
+		FakeTabsPlugin plugin;
+		settings.beginGroup (path);
+		settings.setValue ("Name", plugin.GetName ());
+		settings.endGroup ();
+		SaveLazyPluginInfo (settings, path, &plugin);
+
+		const auto& info = LoadLazyPluginInfo (settings, path);
+		QVERIFY (info);
+		QCOMPARE (info->Path_, path);
+		QCOMPARE (info->ID_, plugin.GetUniqueID ());
+		QCOMPARE (info->Name_, plugin.GetName ());
+		QCOMPARE (info->Provides_, plugin.Provides ());
+		QCOMPARE (info->Needs_, plugin.Needs ());
+		QVERIFY (!info->IsEntityHandler_);
+		QVERIFY (info->IsEligible_);
+
+		QCOMPARE (info->TabClasses_.size (), 1);
+		const auto& tc = info->TabClasses_.at (0);
+		QCOMPARE (tc.TabClass_, QByteArray ("FakeTab"));
+		QCOMPARE (tc.VisibleName_, QString ("Fake tab"));
+		QCOMPARE (tc.Description_, QString ("Fake tab description"));
+		QCOMPARE (tc.Priority_, static_cast<quint16> (42));
+		QCOMPARE (static_cast<int> (tc.Features_), static_cast<int> (TFOpenableByRequest));
+
+		// The settings are left at the root group.
+		QVERIFY (settings.group ().isEmpty ());
+	}
+
+	void LazyPluginInfoTest::changedLibraryIsStale ()
+	{
+		const auto& path = Dir_ + "/libleechcraft_fake.so";
+		QSettings settings (Dir_ + "/settings.ini", QSettings::IniFormat);
+
+		FakeHandlerPlugin plugin;
+		SaveLazyPluginInfo (settings, path, &plugin);
+		QVERIFY (LoadLazyPluginInfo (settings, path));
+
+		QVERIFY (WriteFile (path, " with an update"));
+		QVERIFY (!LoadLazyPluginInfo (settings, path));
+
+		// Saving again refreshes the stale metadata.
+		SaveLazyPluginInfo (settings, path, &plugin);
+		const auto& info = LoadLazyPluginInfo (settings, path);
+		QVERIFY (info);
+		QVERIFY (info->IsEntityHandler_);
+		QVERIFY (info->TabClasses_.isEmpty ());
+	}
+
+	void LazyPluginInfoTest::clearRemovesMetadata ()
+	{
+		const auto& path = Dir_ + "/libleechcraft_fake.so";
+		QSettings settings (Dir_ + "/settings.ini", QSettings::IniFormat);
+
+		FakeTabsPlugin plugin;
+		SaveLazyPluginInfo (settings, path, &plugin);
+		QVERIFY (LoadLazyPluginInfo (settings, path));
+
+		ClearLazyPluginInfo (settings, path);
+		QVERIFY (!LoadLazyPluginInfo (settings, path));
+	}
+}
@@ -0,0 +1,142 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <interfaces/iinfo.h>
+#include <interfaces/ihavetabs.h>
+#include <interfaces/ientityhandler.h>
+#include <interfaces/ihavesettings.h>
+#include <interfaces/ihaveshortcuts.h>
+#include <interfaces/entitytesthandleresult.h>
+
+namespace LeechCraft
+{
+	class FakePlugin : public QObject
+					 , public IInfo
+	{
+		Q_OBJECT
+		Q_INTERFACES (IInfo)
+	public:
+		void Init (ICoreProxy_ptr) {}
+		void SecondInit () {}
+		void Release () {}
+		QByteArray GetUniqueID () const { return "org.LeechCraft.Fake"; }
+		QString GetName () const { return "Fake"; }
+		QString GetInfo () const { return "Fake plugin"; }
+		QIcon GetIcon () const { return {}; }
+		QStringList Provides () const { return { "fakefeature" }; }
+		QStringList Needs () const { return { "otherfeature" }; }
+	};
+
+	class FakeTabsPlugin : public FakePlugin
+						 , public IHaveTabs
+	{
+		Q_OBJECT
+		Q_INTERFACES (IHaveTabs)
+
+		const TabFeatures Features_;
+	public:
+		FakeTabsPlugin (TabFeatures features = TFOpenableByRequest)
+		: Features_ (features)
+		{
+		}
+
+		TabClasses_t GetTabClasses () const
+		{
+			TabClassInfo tc;
+			tc.TabClass_ = "FakeTab";
+			tc.VisibleName_ = "Fake tab";
+			tc.Description_ = "Fake tab description";
+			tc.Priority_ = 42;
+			tc.Features_ = Features_;
+			return { tc };
+		}
+
+		void TabOpenRequested (const QByteArray&) {}
+	signals:
+		void addNewTab (const QString&, QWidget*);
+		void removeTab (QWidget*);
+		void changeTabName (QWidget*, const QString&);
+		void changeTabIcon (QWidget*, const QIcon&);
+		void statusBarChanged (QWidget*, const QString&);
+		void raiseTab (QWidget*);
+	};
+
+	class FakeHandlerPlugin : public FakePlugin
+							, public IEntityHandler
+	{
+		Q_OBJECT
+		Q_INTERFACES (IEntityHandler)
+	public:
+		EntityTestHandleResult CouldHandle (const Entity&) const { return {}; }
+		void Handle (Entity) {}
+	};
+
+	class FakeSettingsTabsPlugin : public FakeTabsPlugin
+								 , public IHaveSettings
+	{
+		Q_OBJECT
+		Q_INTERFACES (IHaveSettings)
+	public:
+		Util::XmlSettingsDialog_ptr GetSettingsDialog () const { return {}; }
+	};
+
+	class FakeShortcutsHandlerPlugin : public FakeHandlerPlugin
+									 , public IHaveShortcuts
+	{
+		Q_OBJECT
+		Q_INTERFACES (IHaveShortcuts)
+	public:
+		void SetShortcut (const QString&, const QKeySequences_t&) {}
+		QMap<QString, ActionInfo> GetActionInfo () const { return {}; }
+	};
+
+	class LazyPluginInfoTest : public QObject
+	{
+		Q_OBJECT
+
+		QString Dir_;
+	private slots:
+		void init ();
+		void cleanup ();
+
+		void tabsPluginIsEligible ();
+		void handlerIsEligible ();
+		void plainPluginIsEager ();
+		void defaultTabsAreEager ();
+		void settingsAreEager ();
+		void shortcutsAreEager ();
+
+		void metadataRoundTrip ();
+		void changedLibraryIsStale ();
+		void clearRemovesMetadata ();
+	};
+}
@@ -0,0 +1,172 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "startupprofilertest.h"
+#include <QtTest>
+#include <QtConcurrentRun>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#if QT_VERSION >= 0x050000
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#endif
+#include "startupprofiler.h"
+
+QTEST_MAIN (LeechCraft::StartupProfilerTest)
+
+namespace LeechCraft
+{
+	namespace
+	{
+		// Busy-waits instead of sleeping, so that the CPU time grows too.
+		void Spin (int ms)
+		{
+			QElapsedTimer timer;
+			timer.start ();
+			while (timer.elapsed () < ms)
+				;
+		}
+
+		void Measure (StartupProfiler& profiler, const QString& key, StartupProfiler::Stage stage, int ms)
+		{
+			StartupProfiler::Measurement m { &profiler, key, stage };
+			Spin (ms);
+		}
+	}
+
+	void StartupProfilerTest::summaryAggregatesStages ()
+	{
+		StartupProfiler profiler;
+		profiler.SetName ("/usr/lib/leechcraft/plugins/libleechcraft_a.so", "Plugin A");
+
+		Measure (profiler, "/usr/lib/leechcraft/plugins/libleechcraft_a.so", StartupProfiler::Stage::Load, 20);
+		Measure (profiler, "/usr/lib/leechcraft/plugins/libleechcraft_a.so", StartupProfiler::Stage::Init, 10);
+		Measure (profiler, "/usr/lib/leechcraft/plugins/libleechcraft_a.so", StartupProfiler::Stage::Init, 10);
+
+		const auto& summary = profiler.GetSummary ();
+		QCOMPARE (summary.size (), 1);
+
+		const auto& a = summary.at (0);
+		QCOMPARE (a.Name_, QString ("Plugin A"));
+		QVERIFY (a.WallUs_ [static_cast<int> (StartupProfiler::Stage::Load)] >= 20000);
+		QVERIFY (a.WallUs_ [static_cast<int> (StartupProfiler::Stage::Init)] >= 20000);
+		QCOMPARE (a.WallUs_ [static_cast<int> (StartupProfiler::Stage::SecondInit)], 0LL);
+
+		qint64 total = 0;
+		for (const auto wall : a.WallUs_)
+			total += wall;
+		QCOMPARE (a.TotalWallUs_, total);
+
+#ifdef Q_OS_LINUX
+		QVERIFY (a.TotalCpuUs_ > 0);
+		QVERIFY (a.TotalCpuUs_ <= a.TotalWallUs_ + 1000);
+#endif
+	}
+
+	void StartupProfilerTest::summaryIsSortedByWallTime ()
+	{
+		StartupProfiler profiler;
+		Measure (profiler, "/plugins/libfast.so", StartupProfiler::Stage::Init, 5);
+		Measure (profiler, "/plugins/libslow.so", StartupProfiler::Stage::Init, 30);
+		Measure (profiler, "Named plugin", StartupProfiler::Stage::PostSecondInit, 15);
+
+		const auto& summary = profiler.GetSummary ();
+		QCOMPARE (summary.size (), 3);
+
+		// The plugins without a name are shown by their library name.
+		QCOMPARE (summary.at (0).Name_, QString ("libslow.so"));
+		QCOMPARE (summary.at (1).Name_, QString ("Named plugin"));
+		QCOMPARE (summary.at (2).Name_, QString ("libfast.so"));
+	}
+
+	void StartupProfilerTest::recordsCarryThreads ()
+	{
+		StartupProfiler profiler;
+		Measure (profiler, "main", StartupProfiler::Stage::Load, 1);
+
+		QtConcurrent::run ([&profiler] { Measure (profiler, "worker", StartupProfiler::Stage::Load, 1); })
+				.waitForFinished ();
+
+		const auto& records = profiler.GetRecords ();
+		QCOMPARE (records.size (), 2);
+		QCOMPARE (records.at (0).Key_, QString ("main"));
+		QCOMPARE (records.at (1).Key_, QString ("worker"));
+		QVERIFY (records.at (0).Thread_ != records.at (1).Thread_);
+		QVERIFY (records.at (0).StartUs_ <= records.at (1).StartUs_);
+	}
+
+	void StartupProfilerTest::traceIsValidJson ()
+	{
+		StartupProfiler profiler;
+		profiler.SetName ("/plugins/liba.so", "Weird \"quoted\" \\ name\n");
+		Measure (profiler, "/plugins/liba.so", StartupProfiler::Stage::Load, 2);
+		Measure (profiler, "/plugins/liba.so", StartupProfiler::Stage::Init, 2);
+		Measure (profiler, "/plugins/libb.so", StartupProfiler::Stage::SecondInit, 2);
+
+		const auto& path = QDir::temp ().filePath (QString ("lc_startup_trace_test_%1.json")
+					.arg (QCoreApplication::applicationPid ()));
+		QVERIFY (profiler.WriteTrace (path));
+
+		QFile file (path);
+		QVERIFY (file.open (QIODevice::ReadOnly));
+		const auto& data = file.readAll ();
+		file.close ();
+		QFile::remove (path);
+
+#if QT_VERSION >= 0x050000
+		QJsonParseError error;
+		const auto& doc = QJsonDocument::fromJson (data, &error);
+		QCOMPARE (error.error, QJsonParseError::NoError);
+
+		const auto& events = doc.object () ["traceEvents"].toArray ();
+		QCOMPARE (events.size (), 3);
+
+		const auto& records = profiler.GetRecords ();
+		for (int i = 0; i < events.size (); ++i)
+		{
+			const auto& event = events.at (i).toObject ();
+			const auto& record = records.at (i);
+			QCOMPARE (event ["ph"].toString (), QString ("X"));
+			QCOMPARE (static_cast<qint64> (event ["ts"].toDouble ()), record.StartUs_);
+			QCOMPARE (static_cast<qint64> (event ["dur"].toDouble ()), record.WallUs_);
+			QCOMPARE (event ["cat"].toString (), StartupProfiler::GetStageName (record.Stage_));
+			QCOMPARE (event ["args"].toObject () ["library"].toString (), record.Key_);
+		}
+
+		QCOMPARE (events.at (0).toObject () ["name"].toString (), QString ("Weird \"quoted\" \\ name\n"));
+		QCOMPARE (events.at (2).toObject () ["name"].toString (), QString ("libb.so"));
+#else
+		QVERIFY (data.startsWith ("{\"traceEvents\":["));
+		QVERIFY (data.contains ("\"name\":\"Weird \\\"quoted\\\" \\\\ name\\n\""));
+		QCOMPARE (data.count ("\"ph\":\"X\""), 3);
+#endif
+	}
+}
@@ -41,7 +41,7 @@ namespace LeechCraft
 namespace Aggregator
 {
 	Channel::Channel (const IDType_t& id)
-	: ChannelID_ (Core::Instance ().GetPool (PTChannel).GetID ())
+	: ChannelID_ (Core::Instance ().GetNextID (PTChannel))
 	, FeedID_ (id)
 	{
 	}
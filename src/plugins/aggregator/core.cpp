@@ -30,6 +30,8 @@
 #include <stdexcept>
 #include <numeric>
 #include <algorithm>
+#include <functional>
+#include <boost/optional.hpp>
 #include <QtDebug>
 #include <QImage>
 #include <QDir>
@@ -38,7 +40,12 @@
 #include <QTimer>
 #include <QTextCodec>
 #include <QXmlStreamWriter>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QCryptographicHash>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
 #include <interfaces/iwebbrowser.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/itagsmanager.h>
@@ -53,6 +60,7 @@
 #include "regexpmatchermanager.h"
 #include "xmlsettingsmanager.h"
 #include "parserfactory.h"
+#include "parsejob.h"
 #include "rss20parser.h"
 #include "rss10parser.h"
 #include "rss091parser.h"
@@ -108,6 +116,20 @@ namespace Aggregator
 
 	void Core::Release ()
 	{
+		for (const auto watcher : ParsingJobs_.keys ())
+			static_cast<QFutureWatcher<ParseResult>*> (watcher)->waitForFinished ();
+		ParsingJobs_.clear ();
+
+		for (const auto reply : PendingFetches_.keys ())
+		{
+			disconnect (reply,
+					0,
+					this,
+					0);
+			reply->abort ();
+		}
+		PendingFetches_.clear ();
+
 		if (DBUpThread_->isRunning ())
 			DBUpThread_->quit ();
 
@@ -140,9 +162,10 @@ namespace Aggregator
 		PluginManager_->AddPlugin (plugin);
 	}
 
-	Util::IDPool<IDType_t>& Core::GetPool (PoolType type)
+	IDType_t Core::GetNextID (PoolType type)
 	{
-		return Pools_ [type];
+		QMutexLocker locker (&PoolsMutex_);
+		return Pools_ [type].GetID ();
 	}
 
 	bool Core::CouldHandle (const LeechCraft::Entity& e)
@@ -402,7 +425,10 @@ namespace Aggregator
 
 	bool Core::ReinitStorage ()
 	{
-		Pools_.clear ();
+		{
+			QMutexLocker locker (&PoolsMutex_);
+			Pools_.clear ();
+		}
 		ChannelsModel_->Clear ();
 
 		StorageBackend_.reset (new DumbStorage);
@@ -470,6 +496,7 @@ namespace Aggregator
 						{ ChannelsModel_->AddChannel (chan); });
 		}
 
+		QMutexLocker locker (&PoolsMutex_);
 		for (int type = 0; type < PTMAX; ++type)
 		{
 			Util::IDPool<IDType_t> pool;
@@ -563,6 +590,7 @@ namespace Aggregator
 			emit channelRemoved (shorts [i].ChannelID_);
 		}
 		StorageBackend_->RemoveFeed (channel.FeedID_);
+		FetchStates_.remove (channel.FeedID_);
 
 		UpdateUnreadItemsNumber ();
 	}
@@ -778,9 +806,7 @@ namespace Aggregator
 			return QStringList ();
 		}
 
-		items_shorts_t items;
-		StorageBackend_->GetItems (items, cs.ChannelID_);
-		return GetCategories (items);
+		return StorageBackend_->GetItemsCategories (cs.ChannelID_);
 	}
 
 	QStringList Core::GetCategories (const items_shorts_t& items) const
@@ -1101,6 +1127,45 @@ namespace Aggregator
 				return it->PubDate_ < DateTime_;
 			}
 		};
+
+		const int MinAdaptiveInterval = 15;
+		const int MaxAdaptiveInterval = 24 * 60;
+
+		int BoundUpdateInterval (int minutes)
+		{
+			const auto global = XmlSettingsManager::Instance ()->
+					property ("UpdateInterval").toInt ();
+			const auto upper = std::max (MaxAdaptiveInterval, global);
+			return std::min (std::max (minutes, MinAdaptiveInterval), upper);
+		}
+
+		/* The feed is polled twice as often as it has been publishing
+		 * its most recent items, but not more often than the time since
+		 * its latest item suggests: a feed silent for a week is most
+		 * likely not going to publish anything in the next few minutes.
+		 */
+		int EstimateUpdateInterval (const channels_container_t& channels, int previous)
+		{
+			const auto& now = QDateTime::currentDateTime ();
+
+			QList<QDateTime> dates;
+			for (const auto& channel : channels)
+				for (const auto& item : channel->Items_)
+					if (item->PubDate_.isValid () && item->PubDate_ <= now)
+						dates << item->PubDate_;
+
+			if (dates.size () < 2)
+				return previous;
+
+			std::sort (dates.begin (), dates.end (), std::greater<QDateTime> ());
+
+			const int count = std::min (dates.size (), 10);
+			const qint64 span = dates.at (count - 1).secsTo (dates.first ());
+			const qint64 silence = dates.first ().secsTo (now);
+			const auto estimate = std::max (span / (count - 1), silence);
+
+			return BoundUpdateInterval (static_cast<int> (estimate / 2 / 60));
+		}
 	};
 
 	void Core::handleJobFinished (int id)
@@ -1132,64 +1197,166 @@ namespace Aggregator
 			return;
 		}
 
-		channels_container_t channels;
-		if (pj.Role_ != PendingJob::RFeedExternalData)
+		if (pj.Role_ == PendingJob::RFeedExternalData)
 		{
-			QByteArray data = file.readAll ();
-			QDomDocument doc;
-			QString errorMsg;
-			int errorLine, errorColumn;
-			if (!doc.setContent (data, true, &errorMsg, &errorLine, &errorColumn))
-			{
-				file.copy (QDir::tempPath () + "/failedFile.xml");
-				ErrorNotification (tr ("Feed error"),
-						tr ("XML file parse error: %1, line %2, column %3, filename %4, from %5")
-						.arg (errorMsg)
-						.arg (errorLine)
-						.arg (errorColumn)
-						.arg (pj.Filename_)
-						.arg (pj.URL_));
-				return;
-			}
+			HandleExternalData (pj.URL_, file);
+			UpdateUnreadItemsNumber ();
+			scheduleSave ();
+			return;
+		}
 
-			Parser *parser = ParserFactory::Instance ().Return (doc);
-			if (!parser)
-			{
-				file.copy (QDir::tempPath () + "/failedFile.xml");
-				ErrorNotification (tr ("Feed error"),
-						tr ("Could not find parser to parse file %1 from %2")
-						.arg (pj.Filename_)
-						.arg (pj.URL_));
-				return;
-			}
+		StartParsing (file.readAll (), pj);
+	}
 
-			IDType_t feedId = IDNotFound;
-			if (pj.Role_ == PendingJob::RFeedAdded)
-			{
-				const auto& feed = std::make_shared<Feed> ();
-				feed->URL_ = pj.URL_;
-				StorageBackend_->AddFeed (feed);
-				feedId = feed->FeedID_;
-			}
-			else
-				feedId = StorageBackend_->FindFeed (pj.URL_);
+	void Core::handleFeedFetched ()
+	{
+		auto reply = qobject_cast<QNetworkReply*> (sender ());
+		if (!reply || !PendingFetches_.contains (reply))
+			return;
+
+		reply->deleteLater ();
+		auto fetch = PendingFetches_.take (reply);
+
+		if (reply->error () != QNetworkReply::NoError)
+		{
+			if (!XmlSettingsManager::Instance ()->property ("BeSilent").toBool ())
+				ErrorNotification (tr ("Download error"),
+						tr ("Unable to fetch %1: %2.")
+							.arg (fetch.URL_)
+							.arg (reply->errorString ()));
+			return;
+		}
 
-			if (feedId == IDNotFound)
+		const auto& redirect = reply->attribute (QNetworkRequest::RedirectionTargetAttribute).toUrl ();
+		if (redirect.isValid ())
+		{
+			if (++fetch.Redirects_ > 5)
 			{
-				ErrorNotification (tr ("Feed error"),
-						tr ("Feed with url %1 not found.").arg (pj.URL_));
+				if (!XmlSettingsManager::Instance ()->property ("BeSilent").toBool ())
+					ErrorNotification (tr ("Download error"),
+							tr ("Too many redirects for:<br />%1").arg (fetch.URL_));
 				return;
 			}
 
-			channels = parser->ParseFeed (doc, feedId);
+			auto request = reply->request ();
+			request.setUrl (reply->url ().resolved (redirect));
+			StartFetch (request, fetch);
+			return;
+		}
+
+		auto state = GetFetchState (fetch.FeedID_);
+		state.LastFetched_ = QDateTime::currentDateTime ();
+
+		if (reply->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt () == 304)
+		{
+			HandleFeedUnchanged (state);
+			return;
+		}
+
+		const auto& data = reply->readAll ();
+		if (data.isEmpty ())
+		{
+			ErrorNotification (tr ("Feed error"),
+					tr ("Downloaded file from url %1 has null size.").arg (fetch.URL_));
+			return;
+		}
+
+		/* The validators are remembered even if the contents are the
+		 * same, so that the server could reply with 304 next time.
+		 */
+		state.ETag_ = reply->rawHeader ("ETag");
+		state.LastModified_ = reply->rawHeader ("Last-Modified");
+
+		const auto& hash = QCryptographicHash::hash (data, QCryptographicHash::Sha1);
+		if (hash == state.ContentHash_)
+		{
+			HandleFeedUnchanged (state);
+			return;
+		}
+
+		state.ContentHash_ = hash;
+
+		PendingJob pj =
+		{
+			PendingJob::RFeedUpdated,
+			fetch.URL_,
+			QString (),
+			QStringList (),
+			std::shared_ptr<Feed::FeedSettings> (),
+			std::make_shared<StorageBackend::FeedFetchState> (state)
+		};
+		StartParsing (data, pj);
+	}
+
+	void Core::handleFeedParsed ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<ParseResult>*> (sender ());
+		if (!watcher || !ParsingJobs_.contains (watcher))
+			return;
+
+		watcher->deleteLater ();
+		const auto& pj = ParsingJobs_.take (watcher);
+		auto result = watcher->result ();
+
+		if (result.Error_ != ParseResult::Error::None)
+		{
+			QFile failed (QDir::tempPath () + "/failedFile.xml");
+			if (failed.open (QIODevice::WriteOnly))
+				failed.write (result.FailedData_);
+		}
+
+		switch (result.Error_)
+		{
+		case ParseResult::Error::None:
+			break;
+		case ParseResult::Error::InvalidXml:
+			ErrorNotification (tr ("Feed error"),
+					tr ("XML file parse error: %1, line %2, column %3, filename %4, from %5")
+					.arg (result.XmlErrorMsg_)
+					.arg (result.XmlErrorLine_)
+					.arg (result.XmlErrorColumn_)
+					.arg (pj.Filename_)
+					.arg (pj.URL_));
+			return;
+		case ParseResult::Error::NoParser:
+			ErrorNotification (tr ("Feed error"),
+					tr ("Could not find parser to parse file %1 from %2")
+					.arg (pj.Filename_)
+					.arg (pj.URL_));
+			return;
+		}
+
+		IDType_t feedId = IDNotFound;
+		if (pj.Role_ == PendingJob::RFeedAdded)
+		{
+			const auto& feed = std::make_shared<Feed> ();
+			feed->URL_ = pj.URL_;
+			StorageBackend_->AddFeed (feed);
+			feedId = feed->FeedID_;
+		}
+		else
+			feedId = StorageBackend_->FindFeed (pj.URL_);
+
+		if (feedId == IDNotFound)
+		{
+			ErrorNotification (tr ("Feed error"),
+					tr ("Feed with url %1 not found.").arg (pj.URL_));
+			return;
+		}
+
+		result.SetFeedID (feedId);
+
+		if (pj.FetchState_)
+		{
+			auto state = *pj.FetchState_;
+			state.Interval_ = EstimateUpdateInterval (result.Channels_, state.Interval_);
+			SetFetchState (state);
 		}
 
 		if (pj.Role_ == PendingJob::RFeedAdded)
-			HandleFeedAdded (channels, pj);
+			HandleFeedAdded (result.Channels_, pj);
 		else if (pj.Role_ == PendingJob::RFeedUpdated)
-			HandleFeedUpdated (channels, pj);
-		else if (pj.Role_ == PendingJob::RFeedExternalData)
-			HandleExternalData (pj.URL_, file);
+			HandleFeedUpdated (result.Channels_, pj);
 		UpdateUnreadItemsNumber ();
 		scheduleSave ();
 	}
@@ -1247,6 +1414,8 @@ namespace Aggregator
 
 	void Core::updateFeeds ()
 	{
+		const bool adaptive = IsAdaptiveUpdatesEnabled ();
+
 		ids_t ids;
 		StorageBackend_->GetFeedsIDs (ids);
 		Q_FOREACH (IDType_t id, ids)
@@ -1269,6 +1438,10 @@ namespace Aggregator
 						<< e.what ();
 			}
 
+			// It's handled by custom timer as well.
+			if (adaptive && GetFetchState (id).Interval_)
+				continue;
+
 			UpdateFeed (id);
 		}
 		XmlSettingsManager::Instance ()->
@@ -1356,6 +1529,7 @@ namespace Aggregator
 		ids_t ids;
 		StorageBackend_->GetFeedsIDs (ids);
 		QDateTime current = QDateTime::currentDateTime ();
+		const bool adaptive = IsAdaptiveUpdatesEnabled ();
 		Q_FOREACH (IDType_t id, ids)
 		{
 			int ut = 0;
@@ -1365,7 +1539,6 @@ namespace Aggregator
 			}
 			catch (const StorageBackend::FeedSettingsNotFoundError&)
 			{
-				continue;
 			}
 			catch (const std::exception& e)
 			{
@@ -1376,13 +1549,19 @@ namespace Aggregator
 				continue;
 			}
 
+			// Explicitly set timeout takes precedence over the adaptive one.
+			if (!ut && adaptive)
+				ut = GetFetchState (id).Interval_;
+
 			// It's handled by normal timer.
 			if (!ut)
 				continue;
 
-			if (!Updates_.contains (id) ||
-					(Updates_ [id].isValid () &&
-						Updates_ [id].secsTo (current) / 60 > ut))
+			const auto& lastUpdate = Updates_.contains (id) ?
+					Updates_ [id] :
+					GetFetchState (id).LastFetched_;
+			if (!lastUpdate.isValid () ||
+					lastUpdate.secsTo (current) / 60 > ut)
 				UpdateFeed (id);
 		}
 	}
@@ -1399,64 +1578,36 @@ namespace Aggregator
 					this,
 					SLOT (rotateUpdatesQueue ()));
 
-		QString url = StorageBackend_->GetFeed (id)->URL_;
-		for (int key : PendingJobs_.keys ())
-			if (PendingJobs_ [key].URL_ == url)
+		const QString url = StorageBackend_->GetFeed (id)->URL_;
+		for (const auto reply : PendingFetches_.keys ())
+			if (PendingFetches_ [reply].FeedID_ == id)
 			{
-				QObject *provider = ID2Downloader_ [key];
-				IDownload *downloader = qobject_cast<IDownload*> (provider);
-				if (downloader)
-				{
-					qWarning () << Q_FUNC_INFO
-						<< "stalled task detected from"
-						<< downloader
-						<< "trying to kill...";
-					downloader->KillTask (key);
-					ID2Downloader_.remove (key);
-					PendingJobs_.remove (key);
-					qWarning () << Q_FUNC_INFO
-						<< "killed!";
-				}
-				else
-					qWarning () << Q_FUNC_INFO
-						<< "provider is not a downloader:"
-						<< provider
-						<< "; cannot kill the task";
+				qWarning () << Q_FUNC_INFO
+					<< "stalled request detected for"
+					<< url
+					<< "aborting...";
+				PendingFetches_.remove (reply);
+				reply->abort ();
+				reply->deleteLater ();
 			}
 
-		QString filename = Util::GetTemporaryName ();
-
-		Entity e = Util::MakeEntity (QUrl (url),
-				filename,
-				LeechCraft::Internal |
-					LeechCraft::DoNotNotifyUser |
-					LeechCraft::DoNotSaveInHistory |
-					LeechCraft::NotPersistent |
-					LeechCraft::DoNotAnnounceEntity);
-
-		PendingJob pj =
-		{
-			PendingJob::RFeedUpdated,
-			url,
-			filename,
-			QStringList (),
-			std::shared_ptr<Feed::FeedSettings> ()
-		};
-
-		int jobId = -1;
-		QObject *pr;
-		emit delegateEntity (e, &jobId, &pr);
-		if (jobId == -1)
-		{
-			qWarning () << Q_FUNC_INFO << url << "wasn't delegated";
-			emit gotEntity (Util::MakeNotification ("Aggregator",
-					tr ("Could not find plugin for feed with URL %1")
-						.arg (url), LeechCraft::PCritical_));
-			return;
-		}
-
-		HandleProvider (pr, jobId);
-		PendingJobs_ [jobId] = pj;
+		/* Feeds are fetched directly instead of being delegated to a
+		 * downloader so that conditional requests could be used: most
+		 * of the feeds don't change between two updates, and a 304 reply
+		 * or the same contents as the last time means there is nothing
+		 * to parse.
+		 */
+		QNetworkRequest request { QUrl (url) };
+		const auto& state = GetFetchState (id);
+		if (!state.ETag_.isEmpty ())
+			request.setRawHeader ("If-None-Match", state.ETag_);
+		if (!state.LastModified_.isEmpty ())
+			request.setRawHeader ("If-Modified-Since", state.LastModified_);
+		request.setAttribute (QNetworkRequest::CacheLoadControlAttribute,
+				QNetworkRequest::AlwaysNetwork);
+		request.setAttribute (QNetworkRequest::CacheSaveControlAttribute, false);
+
+		StartFetch (request, { id, url, 0 });
 		Updates_ [id] = QDateTime::currentDateTime ();
 	}
 
@@ -1641,6 +1792,9 @@ namespace Aggregator
 
 	void Core::UpdateFeed (const IDType_t& id)
 	{
+		if (UpdatesQueue_.contains (id))
+			return;
+
 		if (UpdatesQueue_.isEmpty ())
 			QTimer::singleShot (500,
 					this,
@@ -1649,6 +1803,64 @@ namespace Aggregator
 		UpdatesQueue_ << id;
 	}
 
+	void Core::StartFetch (QNetworkRequest request, const PendingFetch& fetch)
+	{
+		auto reply = Proxy_->GetNetworkAccessManager ()->get (request);
+		PendingFetches_ [reply] = fetch;
+		connect (reply,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleFeedFetched ()));
+	}
+
+	void Core::StartParsing (const QByteArray& data, const PendingJob& pj)
+	{
+		/* Building the DOM and running the parser over it is the most
+		 * expensive part of updating a feed, so it's done in the global
+		 * thread pool, one job per downloaded feed. The rest is done in
+		 * handleFeedParsed() once the job finishes.
+		 */
+		auto watcher = new QFutureWatcher<ParseResult> (this);
+		ParsingJobs_ [watcher] = pj;
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleFeedParsed ()));
+		watcher->setFuture (QtConcurrent::run ([data] { return ParseFeedData (data); }));
+	}
+
+	bool Core::IsAdaptiveUpdatesEnabled () const
+	{
+		return XmlSettingsManager::Instance ()->property ("AdaptiveUpdates").toBool () &&
+				XmlSettingsManager::Instance ()->property ("UpdateInterval").toInt ();
+	}
+
+	StorageBackend::FeedFetchState Core::GetFetchState (const IDType_t& id)
+	{
+		auto pos = FetchStates_.find (id);
+		if (pos == FetchStates_.end ())
+		{
+			const auto& state = StorageBackend_->GetFeedFetchState (id);
+			pos = FetchStates_.insert (id, state ? *state : StorageBackend::FeedFetchState (id));
+		}
+		return *pos;
+	}
+
+	void Core::SetFetchState (const StorageBackend::FeedFetchState& state)
+	{
+		FetchStates_ [state.FeedID_] = state;
+		StorageBackend_->SetFeedFetchState (state);
+	}
+
+	void Core::HandleFeedUnchanged (StorageBackend::FeedFetchState state)
+	{
+		const auto base = state.Interval_ ?
+				state.Interval_ :
+				XmlSettingsManager::Instance ()->property ("UpdateInterval").toInt ();
+		state.Interval_ = BoundUpdateInterval (base * 3 / 2);
+		SetFetchState (state);
+	}
+
 	void Core::HandleProvider (QObject *provider, int id)
 	{
 		ID2Downloader_ [id] = provider;
@@ -36,6 +36,7 @@
 #include <QPair>
 #include <QList>
 #include <QDateTime>
+#include <QMutex>
 #include <interfaces/idownload.h>
 #include <interfaces/core/icoreproxy.h>
 #include <interfaces/core/ihookproxy.h>
@@ -48,6 +49,7 @@
 
 class QTimer;
 class QNetworkReply;
+class QNetworkRequest;
 class QFile;
 class QSortFilterProxyModel;
 class QToolBar;
@@ -99,6 +101,7 @@ namespace Aggregator
 			QString Filename_;
 			QStringList Tags_;
 			std::shared_ptr<Feed::FeedSettings> FeedSettings_;
+			std::shared_ptr<StorageBackend::FeedFetchState> FetchState_;
 		};
 		struct ExternalData
 		{
@@ -111,6 +114,16 @@ namespace Aggregator
 			Feed_ptr RelatedFeed_;
 		};
 		QMap<int, PendingJob> PendingJobs_;
+		QHash<QObject*, PendingJob> ParsingJobs_;
+
+		struct PendingFetch
+		{
+			IDType_t FeedID_;
+			QString URL_;
+			int Redirects_;
+		};
+		QHash<QNetworkReply*, PendingFetch> PendingFetches_;
+		QHash<IDType_t, StorageBackend::FeedFetchState> FetchStates_;
 		QMap<QString, ExternalData> PendingJob2ExternalData_;
 		QList<QObject*> Downloaders_;
 		QMap<int, QObject*> ID2Downloader_;
@@ -138,6 +151,7 @@ namespace Aggregator
 		Core ();
 	private:
 		QHash<PoolType, Util::IDPool<IDType_t>> Pools_;
+		mutable QMutex PoolsMutex_;
 	public:
 		struct ChannelInfo
 		{
@@ -158,7 +172,12 @@ namespace Aggregator
 
 		void AddPlugin (QObject*);
 
-		Util::IDPool<IDType_t>& GetPool (PoolType);
+		/** Returns the next ID from the pool of the given type.
+		 *
+		 * This function is thread-safe, so items and channels may be
+		 * created by the feed parsers running in the worker threads.
+		 */
+		IDType_t GetNextID (PoolType);
 
 		bool CouldHandle (const LeechCraft::Entity&);
 		void Handle (LeechCraft::Entity);
@@ -244,6 +263,8 @@ namespace Aggregator
 		void handleJobFinished (int);
 		void handleJobRemoved (int);
 		void handleJobError (int, IDownload::Error);
+		void handleFeedParsed ();
+		void handleFeedFetched ();
 		void saveSettings ();
 		void handleChannelDataUpdated (Channel_ptr);
 		void handleCustomUpdates ();
@@ -262,6 +283,12 @@ namespace Aggregator
 				const PendingJob&);
 		void MarkChannel (const QModelIndex&, bool);
 		void UpdateFeed (const IDType_t&);
+		void StartFetch (QNetworkRequest, const PendingFetch&);
+		void StartParsing (const QByteArray&, const PendingJob&);
+		bool IsAdaptiveUpdatesEnabled () const;
+		StorageBackend::FeedFetchState GetFetchState (const IDType_t&);
+		void SetFetchState (const StorageBackend::FeedFetchState&);
+		void HandleFeedUnchanged (StorageBackend::FeedFetchState);
 		void HandleProvider (QObject*, int);
 		void ErrorNotification (const QString&, const QString&, bool = true) const;
 	signals:
@@ -31,6 +31,7 @@
 #include <stdexcept>
 #include <boost/optional.hpp>
 #include <QUrl>
+#include <QElapsedTimer>
 #include <QtDebug>
 #include <util/xpc/util.h>
 #include <util/xpc/defaulthookproxy.h>
@@ -227,20 +228,6 @@ namespace Aggregator
 		SB_->ToggleChannelUnread (channel, state);
 	}
 
-	namespace
-	{
-		// TODO CPP14 merge with plusadic
-		template<typename T, template<typename, typename...> class List = std::initializer_list>
-		boost::optional<T> GetFirst (const List<std::function<boost::optional<T> ()>>& producers)
-		{
-			for (const auto& prod : producers)
-					if (const auto& res = prod ())
-							return res;
-
-			return {};
-		}
-	}
-
 	void DBUpdateThreadWorker::updateFeed (channels_container_t channels, QString url)
 	{
 		auto feedId = SB_->FindFeed (url);
@@ -257,8 +244,13 @@ namespace Aggregator
 		const auto ipc = feedSettings.NumItems_;
 		const auto days = feedSettings.ItemAge_;
 
+		QElapsedTimer timer;
+		timer.start ();
+
 		for (const auto& channel : channels)
 		{
+			const auto batchGuard = SB_->StartBatch ();
+
 			Channel_ptr ourChannel;
 			try
 			{
@@ -277,26 +269,33 @@ namespace Aggregator
 			int newItems = 0;
 			int updatedItems = 0;
 
+			auto index = SB_->GetItemsIndex (ourChannel->ChannelID_);
 			for (const auto& item : channel->Items_)
 			{
-				if (const auto& ourItemID = GetFirst<IDType_t> ({
-							[&] { return SB_->FindItem (item->Title_, item->Link_, ourChannel->ChannelID_); },
-							[&] { return SB_->FindItemByLink (item->Link_, ourChannel->ChannelID_); },
-							[&] { return SB_->FindItemByTitle (item->Title_, ourChannel->ChannelID_); }
-						}))
+				if (const auto& ourItemID = index.Find (item->Title_, item->Link_))
 				{
 					const auto& ourItem = SB_->GetItem (*ourItemID);
 					if (UpdateItem (item, ourItem))
 						++updatedItems;
 				}
 				else if (AddItem (item, ourChannel, channelPart, feedSettings))
+				{
+					index.Add (item->ItemID_, item->Title_, item->Link_);
 					++newItems;
+				}
 			}
 
 			SB_->TrimChannel (ourChannel->ChannelID_, days, ipc);
 
 			NotifyUpdates (newItems, updatedItems, channel);
 		}
+
+		qDebug () << Q_FUNC_INFO
+				<< "updated"
+				<< url
+				<< "in"
+				<< timer.elapsed ()
+				<< "ms";
 	}
 }
 }
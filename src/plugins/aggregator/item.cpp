@@ -128,7 +128,7 @@ namespace Aggregator
 	}
 
 	Enclosure::Enclosure (const IDType_t& item)
-	: EnclosureID_ (Core::Instance ().GetPool (PTEnclosure).GetID ())
+	: EnclosureID_ (Core::Instance ().GetNextID (PTEnclosure))
 	, ItemID_ (item)
 	{
 	}
@@ -150,7 +150,7 @@ namespace Aggregator
 #define MRSS_IDMEM(a) MRSS##a##ID_
 #define MRSS_DEFINE_CTORS(a) \
 	MRSS_CN(a)::MRSS_CN(a) (const IDType_t& mrssEntry) \
-	: MRSS_IDMEM(a) (Core::Instance ().GetPool (MRSS_ENUM(a)).GetID ()) \
+	: MRSS_IDMEM(a) (Core::Instance ().GetNextID (MRSS_ENUM(a))) \
 	, MRSSEntryID_ (mrssEntry) \
 	{ \
 	} \
@@ -179,7 +179,7 @@ namespace Aggregator
 #undef MRSS_EXPANDER
 
 	MRSSEntry::MRSSEntry (const IDType_t& itemId)
-	: MRSSEntryID_ (Core::Instance ().GetPool (PTMRSSEntry).GetID ())
+	: MRSSEntryID_ (Core::Instance ().GetNextID (PTMRSSEntry))
 	, ItemID_ (itemId)
 	{
 	}
@@ -197,7 +197,7 @@ namespace Aggregator
 	}
 
 	Item::Item (const IDType_t& channel)
-	: ItemID_ (Core::Instance ().GetPool (PTItem).GetID ())
+	: ItemID_ (Core::Instance ().GetNextID (PTItem))
 	, ChannelID_ (channel)
 	{
 	}
@@ -46,6 +46,7 @@ namespace Aggregator
 	: QAbstractItemModel (parent)
 	, CurrentRow_ (-1)
 	, CurrentChannel_ (-1)
+	, CanFetchMore_ (false)
 	, StarredIcon_ (Core::Instance ().GetProxy ()->GetIconThemeManager ()->GetIcon ("mail-mark-important"))
 	, UnreadIcon_ (Core::Instance ().GetProxy ()->GetIconThemeManager ()->GetIcon ("mail-mark-unread"))
 	, ReadIcon_ (Core::Instance ().GetProxy ()->GetIconThemeManager ()->GetIcon ("mail-mark-read"))
@@ -103,9 +104,12 @@ namespace Aggregator
 		return CurrentItems_ [index.row ()];
 	}
 
-	const items_shorts_t& ItemsListModel::GetAllItems () const
+	QStringList ItemsListModel::GetAllCategories () const
 	{
-		return CurrentItems_;
+		if (CurrentChannel_ != static_cast<IDType_t> (-1))
+			return Core::Instance ().GetStorageBackend ()->GetItemsCategories (CurrentChannel_);
+
+		return Core::Instance ().GetCategories (CurrentItems_);
 	}
 
 	bool ItemsListModel::IsItemRead (int item) const
@@ -113,6 +117,20 @@ namespace Aggregator
 		return !CurrentItems_ [item].Unread_;
 	}
 
+	bool ItemsListModel::HasUnreadNotLoaded () const
+	{
+		if (!CanFetchMore_)
+			return false;
+
+		if (CurrentChannel_ == static_cast<IDType_t> (-1))
+			return true;
+
+		const auto loadedUnread = std::count_if (CurrentItems_.begin (), CurrentItems_.end (),
+				[] (const ItemShort& item) { return item.Unread_; });
+		const auto sb = Core::Instance ().GetStorageBackend ();
+		return sb->GetUnreadItems (CurrentChannel_) > loadedUnread;
+	}
+
 	QStringList ItemsListModel::GetCategories (int item) const
 	{
 		return CurrentItems_ [item].Categories_;
@@ -125,8 +143,9 @@ namespace Aggregator
 		CurrentChannel_ = channel;
 		CurrentRow_ = -1;
 		CurrentItems_.clear ();
-		if (channel != static_cast<IDType_t> (-1))
-			Core::Instance ().GetStorageBackend ()->GetItems (CurrentItems_, channel);
+		PendingItems_.clear ();
+		CanFetchMore_ = channel != static_cast<IDType_t> (-1);
+		CurrentItems_ = LoadNextPage ();
 
 		endResetModel ();
 	}
@@ -138,10 +157,9 @@ namespace Aggregator
 		CurrentChannel_ = -1;
 		CurrentRow_ = -1;
 		CurrentItems_.clear ();
-
-		StorageBackend *sb = Core::Instance ().GetStorageBackend ();
-		for (const IDType_t& itemId : items)
-			CurrentItems_.push_back (sb->GetItem (itemId)->ToShort ());
+		PendingItems_ = items;
+		CanFetchMore_ = !items.isEmpty ();
+		CurrentItems_ = LoadNextPage ();
 
 		endResetModel ();
 	}
@@ -204,6 +222,10 @@ namespace Aggregator
 			auto insertPos = std::find_if (CurrentItems_.begin (), CurrentItems_.end (),
 						[item] (const ItemShort& is) { return item->PubDate_ > is.PubDate_; });
 
+			// It belongs to one of the pages that haven't been loaded yet.
+			if (insertPos == CurrentItems_.end () && CanFetchMore_)
+				return;
+
 			int shift = std::distance (CurrentItems_.begin (), insertPos);
 
 			beginInsertRows (QModelIndex (), shift, shift);
@@ -423,6 +445,65 @@ namespace Aggregator
 		return parent.isValid () ? 0 : CurrentItems_.size ();
 	}
 
+	bool ItemsListModel::canFetchMore (const QModelIndex& parent) const
+	{
+		return !parent.isValid () && CanFetchMore_;
+	}
+
+	void ItemsListModel::fetchMore (const QModelIndex& parent)
+	{
+		if (parent.isValid ())
+			return;
+
+		const auto& page = LoadNextPage ();
+		if (page.empty ())
+			return;
+
+		const int size = CurrentItems_.size ();
+		beginInsertRows (QModelIndex (), size, size + page.size () - 1);
+		CurrentItems_.insert (CurrentItems_.end (), page.begin (), page.end ());
+		endInsertRows ();
+	}
+
+	namespace
+	{
+		const int PageSize = 200;
+	}
+
+	items_shorts_t ItemsListModel::LoadNextPage ()
+	{
+		items_shorts_t page;
+		if (!CanFetchMore_)
+			return page;
+
+		const auto sb = Core::Instance ().GetStorageBackend ();
+		if (CurrentChannel_ != static_cast<IDType_t> (-1))
+		{
+			sb->GetItemsPage (page, CurrentChannel_, CurrentItems_.size (), PageSize);
+			CanFetchMore_ = page.size () == static_cast<size_t> (PageSize);
+
+			/* Items added to the channel before we've been notified about
+			 * them shift the pages, so the beginning of this page may
+			 * repeat the end of the previous one.
+			 */
+			QSet<IDType_t> tail;
+			const auto tailSize = std::min<size_t> (CurrentItems_.size (), PageSize);
+			for (auto i = CurrentItems_.end () - tailSize; i != CurrentItems_.end (); ++i)
+				tail << i->ItemID_;
+			page.erase (std::remove_if (page.begin (), page.end (),
+						[&tail] (const ItemShort& item) { return tail.contains (item.ItemID_); }),
+					page.end ());
+		}
+		else
+		{
+			while (!PendingItems_.isEmpty () && page.size () < static_cast<size_t> (PageSize))
+				page.push_back (sb->GetItem (PendingItems_.takeFirst ())->ToShort ());
+			CanFetchMore_ = !PendingItems_.isEmpty ();
+		}
+
+		return page;
+	}
+
 	void ItemsListModel::reset (const IDType_t& type)
 	{
 		Reset (type);
@@ -53,6 +53,12 @@ namespace Aggregator
 		int CurrentRow_;
 		IDType_t CurrentChannel_;
 
+		/** IDs of the items that are to be shown but haven't been
+		 * loaded yet, if the model has been reset with a list of items.
+		 */
+		QList<IDType_t> PendingItems_;
+		bool CanFetchMore_;
+
 		const QIcon StarredIcon_;
 		const QIcon UnreadIcon_;
 		const QIcon ReadIcon_;
@@ -64,8 +70,13 @@ namespace Aggregator
 		void SetCurrentChannel (const IDType_t&);
 		void Selected (const QModelIndex&);
 		const ItemShort& GetItem (const QModelIndex&) const;
-		const items_shorts_t& GetAllItems () const;
+		QStringList GetAllCategories () const;
 		bool IsItemRead (int) const;
+
+		/** Returns whether the items that haven't been loaded yet contain
+		 * unread ones, as far as it can be told without loading them.
+		 */
+		bool HasUnreadNotLoaded () const;
 		QStringList GetCategories (int) const;
 		void Reset (const IDType_t&);
 		void Reset (const QList<IDType_t>&);
@@ -79,6 +90,11 @@ namespace Aggregator
 		QModelIndex index (int, int, const QModelIndex& = QModelIndex()) const;
 		QModelIndex parent (const QModelIndex&) const;
 		int rowCount (const QModelIndex& = QModelIndex ()) const;
+
+		bool canFetchMore (const QModelIndex&) const;
+		void fetchMore (const QModelIndex&);
+	private:
+		items_shorts_t LoadNextPage ();
 	public slots:
 		void reset (const IDType_t&);
 		void selected (const QModelIndex&);
@@ -547,8 +547,7 @@ namespace Aggregator
 		if (!isVisible ())
 			return;
 
-		const auto& items = Impl_->CurrentItemsModel_->GetAllItems ();
-		const auto& allCategories = Core::Instance ().GetCategories (items);
+		const auto& allCategories = Impl_->CurrentItemsModel_->GetAllCategories ();
 		Impl_->ItemsFilterModel_->categorySelectionChanged (allCategories);
 
 		if (!allCategories.isEmpty ())
@@ -1311,18 +1310,44 @@ namespace Aggregator
 			}
 		}
 
-		const auto rc = Impl_->ItemsFilterModel_->rowCount (current.parent ());
-		for (int i = current.row () + 1; i < rc; ++i)
+		/* Further pages are loaded only while the channel is known to
+		 * have unread items that aren't loaded yet, so that we don't end
+		 * up loading the whole channel just to find out there is nothing
+		 * unread left in it.
+		 */
+		auto hasUnreadNotLoaded = [this] () -> bool
 		{
-			const auto& next = current.sibling (i, current.column ());
-			if (!next.isValid ())
-				break;
+			if (Impl_->CurrentItemsModel_->HasUnreadNotLoaded ())
+				return true;
 
-			if (!next.data (ItemsListModel::ItemRole::IsRead).toBool ())
+			for (const auto& model : Impl_->SupplementaryModels_)
+				if (model->HasUnreadNotLoaded ())
+					return true;
+
+			return false;
+		};
+
+		while (true)
+		{
+			const auto rc = Impl_->ItemsFilterModel_->rowCount (current.parent ());
+			for (int i = current.row () + 1; i < rc; ++i)
 			{
-				Impl_->Ui_.Items_->setCurrentIndex (next);
-				return;
+				const auto& next = current.sibling (i, current.column ());
+				if (!next.isValid ())
+					break;
+
+				if (!next.data (ItemsListModel::ItemRole::IsRead).toBool ())
+				{
+					Impl_->Ui_.Items_->setCurrentIndex (next);
+					return;
+				}
 			}
+
+			if (!hasUnreadNotLoaded () ||
+					!Impl_->ItemsFilterModel_->canFetchMore ({}))
+				break;
+
+			Impl_->ItemsFilterModel_->fetchMore ({});
 		}
 
 		const auto& chanIdx = Impl_->LastSelectedChannel_;
@@ -0,0 +1,77 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "parsejob.h"
+#include <QDomDocument>
+#include "parser.h"
+#include "parserfactory.h"
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	ParseResult::ParseResult ()
+	: Error_ (Error::None)
+	, XmlErrorLine_ (0)
+	, XmlErrorColumn_ (0)
+	{
+	}
+
+	void ParseResult::SetFeedID (const IDType_t& feedId)
+	{
+		for (const auto& channel : Channels_)
+			channel->FeedID_ = feedId;
+	}
+
+	ParseResult ParseFeedData (const QByteArray& data)
+	{
+		ParseResult result;
+
+		QDomDocument doc;
+		if (!doc.setContent (data, true,
+				&result.XmlErrorMsg_, &result.XmlErrorLine_, &result.XmlErrorColumn_))
+		{
+			result.Error_ = ParseResult::Error::InvalidXml;
+			result.FailedData_ = data;
+			return result;
+		}
+
+		const auto parser = ParserFactory::Instance ().Return (doc);
+		if (!parser)
+		{
+			result.Error_ = ParseResult::Error::NoParser;
+			result.FailedData_ = data;
+			return result;
+		}
+
+		result.Channels_ = parser->ParseFeed (doc, IDNotFound);
+		return result;
+	}
+}
+}
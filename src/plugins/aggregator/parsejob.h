@@ -0,0 +1,78 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include "channel.h"
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	/** The result of parsing a downloaded feed document.
+	 *
+	 * The channels are bound to IDNotFound feed ID, since the feed ID
+	 * may be unknown (or even nonexistent) while the document is being
+	 * parsed. The caller is expected to fix it up via SetFeedID().
+	 */
+	struct ParseResult
+	{
+		enum class Error
+		{
+			None,
+			InvalidXml,
+			NoParser
+		} Error_;
+
+		QString XmlErrorMsg_;
+		int XmlErrorLine_;
+		int XmlErrorColumn_;
+
+		/** The raw document, kept only if parsing has failed.
+		 */
+		QByteArray FailedData_;
+
+		channels_container_t Channels_;
+
+		ParseResult ();
+
+		void SetFeedID (const IDType_t&);
+	};
+
+	/** Parses the given feed document with a suitable parser from
+	 * ParserFactory.
+	 *
+	 * This function is reentrant and is intended to be called from the
+	 * worker threads.
+	 */
+	ParseResult ParseFeedData (const QByteArray& data);
+}
+}
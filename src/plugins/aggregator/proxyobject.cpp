@@ -48,7 +48,7 @@ namespace Aggregator
 			if (item->ItemID_)
 				return;
 
-			item->ItemID_ = Core::Instance ().GetPool (PTItem).GetID ();
+			item->ItemID_ = Core::Instance ().GetNextID (PTItem);
 
 			for (auto& enc : item->Enclosures_)
 				enc.ItemID_ = item->ItemID_;
@@ -59,7 +59,7 @@ namespace Aggregator
 			if (channel->ChannelID_)
 				return;
 
-			channel->ChannelID_ = Core::Instance ().GetPool (PTChannel).GetID ();
+			channel->ChannelID_ = Core::Instance ().GetNextID (PTChannel);
 			for (const auto& item : channel->Items_)
 			{
 				item->ChannelID_ = channel->ChannelID_;
@@ -73,7 +73,7 @@ namespace Aggregator
 			if (feed->FeedID_)
 				return;
 
-			feed->FeedID_ = Core::Instance ().GetPool (PTFeed).GetID ();
+			feed->FeedID_ = Core::Instance ().GetNextID (PTFeed);
 
 			for (const auto& channel : feed->Channels_)
 			{
@@ -29,6 +29,8 @@
 
 #include "sqlstoragebackend.h"
 #include <stdexcept>
+#include <exception>
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <QDir>
 #include <QDebug>
@@ -51,6 +53,7 @@ namespace Aggregator
 {
 	SQLStorageBackend::SQLStorageBackend (StorageBackend::Type t, const QString& id)
 	: Type_ (t)
+	, InBatch_ (false)
 	{
 		QString strType;
 		switch (Type_)
@@ -187,6 +190,37 @@ namespace Aggregator
 				":auto_download_enclosures"
 				")").arg (orReplace));
 
+		FeedFetchStateGetter_ = QSqlQuery (DB_);
+		FeedFetchStateGetter_.prepare ("SELECT "
+				"etag, "
+				"last_modified, "
+				"content_hash, "
+				"update_interval, "
+				"last_fetched "
+				"FROM feeds_fetch_state "
+				"WHERE feed_id = :feed_id");
+
+		FeedFetchStateRemover_ = QSqlQuery (DB_);
+		FeedFetchStateRemover_.prepare ("DELETE FROM feeds_fetch_state "
+				"WHERE feed_id = :feed_id");
+
+		FeedFetchStateSetter_ = QSqlQuery (DB_);
+		FeedFetchStateSetter_.prepare ("INSERT INTO feeds_fetch_state ("
+				"feed_id, "
+				"etag, "
+				"last_modified, "
+				"content_hash, "
+				"update_interval, "
+				"last_fetched"
+				") VALUES ("
+				":feed_id, "
+				":etag, "
+				":last_modified, "
+				":content_hash, "
+				":update_interval, "
+				":last_fetched"
+				")");
+
 		ChannelsShortSelector_ = QSqlQuery (DB_);
 		ChannelsShortSelector_.prepare ("SELECT "
 				"channel_id, "
@@ -219,23 +253,9 @@ namespace Aggregator
 				"ORDER BY title");
 
 		UnreadItemsCounter_ = QSqlQuery (DB_);
-		switch (Type_)
-		{
-		case SBSQLite:
-			UnreadItemsCounter_.prepare ("SELECT COUNT (unread) "
-					"FROM items "
-					"WHERE channel_id = :channel_id "
-					"AND (unread = 1 OR unread = 'true')");
-			break;
-		case SBPostgres:
-			UnreadItemsCounter_.prepare ("SELECT COUNT (1) "
-					"FROM items "
-					"WHERE channel_id = :channel_id "
-					"AND unread");
-			break;
-		case SBMysql:
-			break;
-		}
+		UnreadItemsCounter_.prepare ("SELECT unread "
+				"FROM channels_unread "
+				"WHERE channel_id = :channel_id");
 
 		ItemsShortSelector_ = QSqlQuery (DB_);
 		ItemsShortSelector_.prepare ("SELECT "
@@ -248,7 +268,28 @@ namespace Aggregator
 				"FROM items "
 				"WHERE channel_id = :channel_id "
 				"ORDER BY pub_date DESC, "
-				"title DESC");
+				"title DESC, "
+				"item_id DESC");
+
+		ItemsShortPageSelector_ = QSqlQuery (DB_);
+		ItemsShortPageSelector_.prepare ("SELECT "
+				"item_id, "
+				"title, "
+				"url, "
+				"category, "
+				"pub_date, "
+				"unread "
+				"FROM items "
+				"WHERE channel_id = :channel_id "
+				"ORDER BY pub_date DESC, "
+				"title DESC, "
+				"item_id DESC "
+				"LIMIT :limit OFFSET :offset");
+
+		ItemsCategoriesSelector_ = QSqlQuery (DB_);
+		ItemsCategoriesSelector_.prepare ("SELECT DISTINCT category "
+				"FROM items "
+				"WHERE channel_id = :channel_id");
 
 		ItemFullSelector_ = QSqlQuery (DB_);
 		ItemFullSelector_.prepare ("SELECT "
@@ -1061,6 +1102,65 @@ namespace Aggregator
 			LeechCraft::Util::DBLock::DumpError (FeedSettingsSetter_);
 	}
 
+	boost::optional<StorageBackend::FeedFetchState> SQLStorageBackend::GetFeedFetchState (const IDType_t& feedId) const
+	{
+		FeedFetchStateGetter_.bindValue (":feed_id", feedId);
+		if (!FeedFetchStateGetter_.exec ())
+		{
+			Util::DBLock::DumpError (FeedFetchStateGetter_);
+			return {};
+		}
+
+		if (!FeedFetchStateGetter_.next ())
+			return {};
+
+		FeedFetchState result (feedId);
+		result.ETag_ = FeedFetchStateGetter_.value (0).toString ().toLatin1 ();
+		result.LastModified_ = FeedFetchStateGetter_.value (1).toString ().toLatin1 ();
+		result.ContentHash_ = QByteArray::fromHex (FeedFetchStateGetter_.value (2).toString ().toLatin1 ());
+		result.Interval_ = FeedFetchStateGetter_.value (3).toInt ();
+		result.LastFetched_ = FeedFetchStateGetter_.value (4).toDateTime ();
+		FeedFetchStateGetter_.finish ();
+
+		return result;
+	}
+
+	void SQLStorageBackend::SetFeedFetchState (const FeedFetchState& state)
+	{
+		Util::DBLock lock (DB_);
+		try
+		{
+			lock.Init ();
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			return;
+		}
+
+		FeedFetchStateRemover_.bindValue (":feed_id", state.FeedID_);
+		if (!FeedFetchStateRemover_.exec ())
+		{
+			Util::DBLock::DumpError (FeedFetchStateRemover_);
+			return;
+		}
+
+		FeedFetchStateSetter_.bindValue (":feed_id", state.FeedID_);
+		FeedFetchStateSetter_.bindValue (":etag", QString::fromLatin1 (state.ETag_));
+		FeedFetchStateSetter_.bindValue (":last_modified", QString::fromLatin1 (state.LastModified_));
+		FeedFetchStateSetter_.bindValue (":content_hash", QString::fromLatin1 (state.ContentHash_.toHex ()));
+		FeedFetchStateSetter_.bindValue (":update_interval", state.Interval_);
+		FeedFetchStateSetter_.bindValue (":last_fetched", state.LastFetched_);
+		if (!FeedFetchStateSetter_.exec ())
+		{
+			Util::DBLock::DumpError (FeedFetchStateSetter_);
+			return;
+		}
+
+		lock.Good ();
+	}
+
 	void SQLStorageBackend::GetChannels (channels_shorts_t& shorts, const IDType_t& feedId) const
 	{
 		ChannelsShortSelector_.bindValue (":feed_id", feedId);
@@ -1072,18 +1172,8 @@ namespace Aggregator
 
 		while (ChannelsShortSelector_.next ())
 		{
-			int unread = 0;
-
 			IDType_t id = ChannelsShortSelector_.value (0).value<IDType_t> ();
-
-			UnreadItemsCounter_.bindValue (":channel_id", id);
-			if (!UnreadItemsCounter_.exec () ||
-					!UnreadItemsCounter_.next ())
-				Util::DBLock::DumpError (UnreadItemsCounter_);
-			else
-				unread = UnreadItemsCounter_.value (0).toInt ();
-
-			UnreadItemsCounter_.finish ();
+			const int unread = GetUnreadItems (id);
 
 			QStringList tags = Core::Instance ().GetProxy ()->
 				GetTagsManager ()->Split (ChannelsShortSelector_.value (4).toString ());
@@ -1252,6 +1342,13 @@ namespace Aggregator
 		if (!ChannelNumberTrimmer_.exec ())
 			LeechCraft::Util::DBLock::DumpError (ChannelNumberTrimmer_);
 
+		if (InBatch_)
+		{
+			if (!BatchChannels_.contains (channelId))
+				BatchChannels_ [channelId] = Channel_ptr ();
+			return;
+		}
+
 		try
 		{
 			emit channelDataUpdated (GetChannel (channelId,
@@ -1277,45 +1374,81 @@ namespace Aggregator
 		}
 	}
 
+	namespace
+	{
+		void FillItemShorts (QSqlQuery& query, items_shorts_t& shorts, const IDType_t& channelId)
+		{
+			if (!query.exec ())
+			{
+				Util::DBLock::DumpError (query);
+				return;
+			}
+
+			while (query.next ())
+			{
+				ItemShort sh =
+				{
+					query.value (0).value<IDType_t> (),
+					channelId,
+					query.value (1).toString (),
+					query.value (2).toString (),
+					query.value (3).toString ()
+						.split ("<<<", QString::SkipEmptyParts),
+					query.value (4).toDateTime (),
+					query.value (5).toBool ()
+				};
+
+				shorts.push_back (sh);
+			}
+
+			query.finish ();
+		}
+	}
+
 	void SQLStorageBackend::GetItems (items_shorts_t& shorts,
 			const IDType_t& channelId) const
 	{
 		ItemsShortSelector_.bindValue (":channel_id", channelId);
+		FillItemShorts (ItemsShortSelector_, shorts, channelId);
+	}
 
-		if (!ItemsShortSelector_.exec ())
-		{
-			Util::DBLock::DumpError (ItemsShortSelector_);
-			return;
-		}
+	void SQLStorageBackend::GetItemsPage (items_shorts_t& shorts,
+			const IDType_t& channelId, int offset, int count) const
+	{
+		ItemsShortPageSelector_.bindValue (":channel_id", channelId);
+		ItemsShortPageSelector_.bindValue (":limit", count);
+		ItemsShortPageSelector_.bindValue (":offset", offset);
+		FillItemShorts (ItemsShortPageSelector_, shorts, channelId);
+	}
 
-		while (ItemsShortSelector_.next ())
+	QStringList SQLStorageBackend::GetItemsCategories (const IDType_t& channelId) const
+	{
+		ItemsCategoriesSelector_.bindValue (":channel_id", channelId);
+		if (!ItemsCategoriesSelector_.exec ())
 		{
-			ItemShort sh =
-			{
-				ItemsShortSelector_.value (0).value<IDType_t> (),
-				channelId,
-				ItemsShortSelector_.value (1).toString (),
-				ItemsShortSelector_.value (2).toString (),
-				ItemsShortSelector_.value (3).toString ()
-					.split ("<<<", QString::SkipEmptyParts),
-				ItemsShortSelector_.value (4).toDateTime (),
-				ItemsShortSelector_.value (5).toBool ()
-			};
-
-			shorts.push_back (sh);
+			Util::DBLock::DumpError (ItemsCategoriesSelector_);
+			return {};
 		}
 
-		ItemsShortSelector_.finish ();
+		QSet<QString> unique;
+		while (ItemsCategoriesSelector_.next ())
+			for (const auto& category : ItemsCategoriesSelector_.value (0).toString ()
+					.split ("<<<", QString::SkipEmptyParts))
+				unique << category;
+		ItemsCategoriesSelector_.finish ();
+
+		auto result = unique.toList ();
+		std::sort (result.begin (), result.end ());
+		return result;
 	}
 
 	int SQLStorageBackend::GetUnreadItems (const IDType_t& channelId) const
 	{
 		int unread = 0;
 		UnreadItemsCounter_.bindValue (":channel_id", channelId);
-		if (!UnreadItemsCounter_.exec () ||
-				!UnreadItemsCounter_.next ())
+		if (!UnreadItemsCounter_.exec ())
 			Util::DBLock::DumpError (UnreadItemsCounter_);
-		else
+		else if (UnreadItemsCounter_.next ())
 			unread = UnreadItemsCounter_.value (0).toInt ();
 
 		UnreadItemsCounter_.finish ();
@@ -1543,19 +1676,35 @@ namespace Aggregator
 		WriteEnclosures (item->Enclosures_);
 		WriteMRSSEntries (item->MRSSEntries_);
 
+		NotifyItemUpdated (item);
+	}
+
+	void SQLStorageBackend::NotifyItemUpdated (const Item_ptr& item)
+	{
+		const IDType_t cid = item->ChannelID_;
 		try
 		{
-			IDType_t cid = item->ChannelID_;
-			Channel_ptr channel = GetChannel (cid,
-					FindParentFeedForChannel (cid));
+			if (!InBatch_)
+			{
+				const auto& channel = GetChannel (cid, FindParentFeedForChannel (cid));
+				emit itemDataUpdated (item, channel);
+				emit channelDataUpdated (channel);
+				return;
+			}
+
+			/* The channel is fetched once per batch, and the updated
+			 * channel data is emitted when the batch ends.
+			 */
+			auto& channel = BatchChannels_ [cid];
+			if (!channel)
+				channel = GetChannel (cid, FindParentFeedForChannel (cid));
 			emit itemDataUpdated (item, channel);
-			emit channelDataUpdated (channel);
 		}
 		catch (const ChannelNotFoundError&)
 		{
 			qWarning () << Q_FUNC_INFO
 				<< "channel not found"
-				<< item->ChannelID_;
+				<< cid;
 		}
 	}
 
@@ -1666,20 +1815,7 @@ namespace Aggregator
 		WriteEnclosures (item->Enclosures_);
 		WriteMRSSEntries (item->MRSSEntries_);
 
-		try
-		{
-			IDType_t cid = item->ChannelID_;
-			Channel_ptr channel = GetChannel (cid,
-					FindParentFeedForChannel (cid));
-			emit itemDataUpdated (item, channel);
-			emit channelDataUpdated (channel);
-		}
-		catch (const ChannelNotFoundError&)
-		{
-			qWarning () << Q_FUNC_INFO
-				<< "channel not found"
-				<< item->ChannelID_;
-		}
+		NotifyItemUpdated (item);
 	}
 
 	namespace
@@ -1909,6 +2045,62 @@ namespace Aggregator
 		return success;
 	}
 
+	std::shared_ptr<void> SQLStorageBackend::StartBatch ()
+	{
+		if (InBatch_)
+			return {};
+
+		std::shared_ptr<Util::DBLock> lock (new Util::DBLock (DB_));
+		try
+		{
+			lock->Init ();
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to start transaction, the batch will be non-transactional:"
+					<< e.what ();
+			lock.reset ();
+		}
+
+		InBatch_ = true;
+
+		return std::shared_ptr<void> (nullptr,
+				[this, lock] (void*)
+				{
+					InBatch_ = false;
+
+					const auto channels = BatchChannels_.keys ();
+					BatchChannels_.clear ();
+
+					// The batch is destroyed during stack unwinding if any
+					// of its modifications has failed, so the transaction
+					// is rolled back by the lock and there is nothing new
+					// to notify about.
+					if (std::uncaught_exception ())
+					{
+						qWarning () << Q_FUNC_INFO
+								<< "batch aborted by an exception, rolling back";
+						return;
+					}
+
+					if (lock)
+						lock->Good ();
+
+					for (const auto& cid : channels)
+						try
+						{
+							emit channelDataUpdated (GetChannel (cid, FindParentFeedForChannel (cid)));
+						}
+						catch (const ChannelNotFoundError&)
+						{
+							qWarning () << Q_FUNC_INFO
+								<< "channel not found"
+								<< cid;
+						}
+				});
+	}
+
 	QString SQLStorageBackend::GetBoolType () const
 	{
 		switch (Type_)
@@ -1935,6 +2127,107 @@ namespace Aggregator
 		}
 	}
 
+	bool SQLStorageBackend::InitializeUnreadCounters ()
+	{
+		Util::DBLock lock (DB_);
+		try
+		{
+			lock.Init ();
+		}
+		catch (const std::runtime_error& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< e.what ();
+			return false;
+		}
+
+		QStringList queries;
+		queries << "CREATE TABLE channels_unread ("
+				"channel_id BIGINT PRIMARY KEY REFERENCES channels ON DELETE CASCADE, "
+				"unread INTEGER NOT NULL"
+				");";
+
+		/* The counters are kept up to date by the triggers below, so
+		 * the number of unread items in a channel is a single lookup
+		 * instead of counting the items each time.
+		 */
+		switch (Type_)
+		{
+		case SBSQLite:
+			queries << "CREATE TRIGGER channels_unread_insert AFTER INSERT ON items "
+					"WHEN NEW.unread = 1 OR NEW.unread = 'true' "
+					"BEGIN "
+						"INSERT OR IGNORE INTO channels_unread (channel_id, unread) VALUES (NEW.channel_id, 0); "
+						"UPDATE channels_unread SET unread = unread + 1 WHERE channel_id = NEW.channel_id; "
+					"END;";
+			queries << "CREATE TRIGGER channels_unread_delete AFTER DELETE ON items "
+					"WHEN OLD.unread = 1 OR OLD.unread = 'true' "
+					"BEGIN "
+						"UPDATE channels_unread SET unread = unread - 1 WHERE channel_id = OLD.channel_id; "
+					"END;";
+			queries << "CREATE TRIGGER channels_unread_update AFTER UPDATE OF unread ON items "
+					"BEGIN "
+						"UPDATE channels_unread SET unread = unread - (OLD.unread = 1 OR OLD.unread = 'true') "
+							"WHERE channel_id = OLD.channel_id; "
+						"INSERT OR IGNORE INTO channels_unread (channel_id, unread) VALUES (NEW.channel_id, 0); "
+						"UPDATE channels_unread SET unread = unread + (NEW.unread = 1 OR NEW.unread = 'true') "
+							"WHERE channel_id = NEW.channel_id; "
+					"END;";
+			queries << "INSERT INTO channels_unread (channel_id, unread) "
+					"SELECT channel_id, COUNT (1) FROM items "
+					"WHERE unread = 1 OR unread = 'true' "
+					"GROUP BY channel_id;";
+			break;
+		case SBPostgres:
+			queries << "CREATE FUNCTION update_channels_unread () RETURNS trigger AS $$ "
+					"BEGIN "
+						"IF TG_OP = 'DELETE' OR TG_OP = 'UPDATE' THEN "
+							"IF OLD.unread THEN "
+								"UPDATE channels_unread SET unread = unread - 1 WHERE channel_id = OLD.channel_id; "
+							"END IF; "
+						"END IF; "
+						"IF TG_OP = 'INSERT' OR TG_OP = 'UPDATE' THEN "
+							"IF NEW.unread THEN "
+								"UPDATE channels_unread SET unread = unread + 1 WHERE channel_id = NEW.channel_id; "
+								"IF NOT FOUND THEN "
+									"INSERT INTO channels_unread (channel_id, unread) VALUES (NEW.channel_id, 1); "
+								"END IF; "
+							"END IF; "
+						"END IF; "
+						"RETURN NULL; "
+					"END; "
+					"$$ LANGUAGE plpgsql;";
+			queries << "CREATE TRIGGER channels_unread_trigger "
+					"AFTER INSERT OR DELETE OR UPDATE OF unread ON items "
+					"FOR EACH ROW EXECUTE PROCEDURE update_channels_unread ();";
+			queries << "INSERT INTO channels_unread (channel_id, unread) "
+					"SELECT channel_id, COUNT (1) FROM items "
+					"WHERE unread "
+					"GROUP BY channel_id;";
+			break;
+		case SBMysql:
+			break;
+		}
+
+		QSqlQuery query (DB_);
+		for (const auto& str : queries)
+			if (!query.exec (str))
+			{
+				Util::DBLock::DumpError (query);
+				return false;
+			}
+
+		if (!query.exec ("CREATE INDEX idx_items_channel_id_pub_date ON items (channel_id, pub_date);"))
+		{
+			Util::DBLock::DumpError (query);
+			qWarning () << Q_FUNC_INFO
+					<< "could not create index, paging would be slow";
+		}
+
+		lock.Good ();
+		return true;
+	}
+
 	bool SQLStorageBackend::InitializeTables ()
 	{
 		QSqlQuery query (DB_);
@@ -1989,6 +2282,22 @@ namespace Aggregator
 			}
 		}
 
+		if (!tables.contains ("feeds_fetch_state"))
+		{
+			if (!query.exec ("CREATE TABLE feeds_fetch_state ("
+							"feed_id BIGINT PRIMARY KEY REFERENCES feeds ON DELETE CASCADE, "
+							"etag TEXT, "
+							"last_modified TEXT, "
+							"content_hash TEXT, "
+							"update_interval INTEGER NOT NULL, "
+							"last_fetched TIMESTAMP"
+							");"))
+			{
+				Util::DBLock::DumpError (query);
+				return false;
+			}
+		}
+
 		if (!tables.contains ("channels"))
 		{
 			if (!query.exec (QString ("CREATE TABLE channels ("
@@ -2044,6 +2353,10 @@ namespace Aggregator
 			}
 		}
 
+		if (!tables.contains ("channels_unread") &&
+				!InitializeUnreadCounters ())
+			return false;
+
 		if (!tables.contains ("enclosures"))
 		{
 			if (!query.exec ("CREATE TABLE enclosures ("
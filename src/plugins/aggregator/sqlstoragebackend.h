@@ -44,6 +44,9 @@ namespace Aggregator
 		QSqlDatabase DB_;
 
 		Type Type_;
+
+		bool InBatch_;
+		QHash<IDType_t, Channel_ptr> BatchChannels_;
 							/** Returns:
 							 * - last_update
 							 *
@@ -75,6 +78,30 @@ namespace Aggregator
 							 * - item_age
 							 */
 							FeedSettingsSetter_,
+							/** Returns:
+							 * - etag
+							 * - last_modified
+							 * - content_hash
+							 * - update_interval
+							 * - last_fetched
+							 *
+							 * Binds:
+							 * - feed_id
+							 */
+							FeedFetchStateGetter_,
+							/** Binds:
+							 * - feed_id
+							 */
+							FeedFetchStateRemover_,
+							/** Binds:
+							 * - feed_id
+							 * - etag
+							 * - last_modified
+							 * - content_hash
+							 * - update_interval
+							 * - last_fetched
+							 */
+							FeedFetchStateSetter_,
 							/** Returns:
 							 * - channel_id
 							 * - title
@@ -123,6 +150,22 @@ namespace Aggregator
 							 * - channel_id
 							 */
 							ItemsShortSelector_,
+							/** Returns the same as
+							 * ItemsShortSelector_.
+							 *
+							 * Binds:
+							 * - channel_id
+							 * - limit
+							 * - offset
+							 */
+							ItemsShortPageSelector_,
+							/** Returns:
+							 * - category
+							 *
+							 * Binds:
+							 * - channel_id
+							 */
+							ItemsCategoriesSelector_,
 							/** Returns:
 							 * - title
 							 * - url
@@ -581,6 +624,8 @@ namespace Aggregator
 		virtual IDType_t FindFeed (const QString&) const;
 		virtual Feed::FeedSettings GetFeedSettings (const IDType_t&) const;
 		virtual void SetFeedSettings (const Feed::FeedSettings&);
+		virtual boost::optional<FeedFetchState> GetFeedFetchState (const IDType_t&) const;
+		virtual void SetFeedFetchState (const FeedFetchState&);
 		virtual void GetChannels (channels_shorts_t&, const IDType_t&) const;
 		virtual Channel_ptr GetChannel (const IDType_t&,
 				const IDType_t&) const;
@@ -588,6 +633,8 @@ namespace Aggregator
 				const QString&, const IDType_t&) const;
 		virtual void TrimChannel (const IDType_t&, int, int);
 		virtual void GetItems (items_shorts_t&, const IDType_t&) const;
+		virtual void GetItemsPage (items_shorts_t&, const IDType_t&, int, int) const;
+		virtual QStringList GetItemsCategories (const IDType_t&) const;
 		virtual int GetUnreadItems (const IDType_t&) const;
 		virtual Item_ptr GetItem (const IDType_t&) const;
 		virtual boost::optional<IDType_t> FindItem (const QString&, const QString&, const IDType_t&) const;
@@ -617,10 +664,13 @@ namespace Aggregator
 
 		virtual IDType_t GetHighestID (const PoolType&) const;
 
+		virtual std::shared_ptr<void> StartBatch ();
+
 	private:
 		QString GetBoolType () const;
 		QString GetBlobType () const;
 		bool InitializeTables ();
+		bool InitializeUnreadCounters ();
 		QByteArray SerializePixmap (const QImage&) const;
 		QImage UnserializePixmap (const QByteArray&) const;
 
@@ -643,6 +693,7 @@ namespace Aggregator
 
 		IDType_t FindParentFeedForChannel (const IDType_t&) const;
 		void FillItem (const QSqlQuery&, Item_ptr&) const;
+		void NotifyItemUpdated (const Item_ptr&);
 		void WriteEnclosures (const QList<Enclosure>&);
 		void GetEnclosures (const IDType_t&, QList<Enclosure>&) const;
 		void WriteMRSSEntries (const QList<MRSSEntry>&);
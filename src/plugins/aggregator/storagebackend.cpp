@@ -29,6 +29,8 @@
 
 #include "storagebackend.h"
 #include <stdexcept>
+#include <algorithm>
+#include <boost/optional.hpp>
 #include <QFile>
 #include <QDebug>
 #include "sqlstoragebackend.h"
@@ -62,6 +64,115 @@ namespace Aggregator
 	{
 	}
 
+	namespace
+	{
+		/* The SQL lookups compare COALESCE (column,'') values, so a
+		 * missing (NULL) title or link matches an empty one. Keep the
+		 * index keys in the same form.
+		 */
+		QString NullToEmpty (const QString& str)
+		{
+			return str.isNull () ? QString ("") : str;
+		}
+	}
+
+	boost::optional<IDType_t> StorageBackend::ItemsIndex::Find (const QString& rawTitle, const QString& rawLink) const
+	{
+		const auto& title = NullToEmpty (rawTitle);
+		const auto& link = NullToEmpty (rawLink);
+
+		const auto exactPos = ByTitleLink_.find ({ title, link });
+		if (exactPos != ByTitleLink_.end ())
+			return *exactPos;
+
+		if (!link.isEmpty ())
+		{
+			const auto linkPos = ByLink_.find (link);
+			if (linkPos != ByLink_.end ())
+				return *linkPos;
+		}
+
+		const auto titlePos = ByTitle_.find (title);
+		if (titlePos != ByTitle_.end ())
+			return *titlePos;
+
+		return {};
+	}
+
+	void StorageBackend::ItemsIndex::Add (const IDType_t& id, const QString& rawTitle, const QString& rawLink)
+	{
+		const auto& title = NullToEmpty (rawTitle);
+		const auto& link = NullToEmpty (rawLink);
+
+		const QPair<QString, QString> titleLink { title, link };
+		if (!ByTitleLink_.contains (titleLink))
+			ByTitleLink_ [titleLink] = id;
+		if (!ByLink_.contains (link))
+			ByLink_ [link] = id;
+		if (!ByTitle_.contains (title))
+			ByTitle_ [title] = id;
+	}
+
+	StorageBackend::ItemsIndex StorageBackend::GetItemsIndex (const IDType_t& channel) const
+	{
+		items_shorts_t shorts;
+		GetItems (shorts, channel);
+
+		ItemsIndex index;
+		for (const auto& item : shorts)
+			index.Add (item.ItemID_, item.Title_, item.URL_);
+		return index;
+	}
+
+	void StorageBackend::GetItemsPage (items_shorts_t& items,
+			const IDType_t& channelId, int offset, int count) const
+	{
+		items_shorts_t all;
+		GetItems (all, channelId);
+
+		if (offset >= static_cast<int> (all.size ()))
+			return;
+
+		const auto begin = all.begin () + offset;
+		const auto end = begin + std::min<int> (count, all.end () - begin);
+		items.insert (items.end (), begin, end);
+	}
+
+	QStringList StorageBackend::GetItemsCategories (const IDType_t& channelId) const
+	{
+		items_shorts_t all;
+		GetItems (all, channelId);
+
+		QSet<QString> unique;
+		for (const auto& item : all)
+			for (const auto& category : item.Categories_)
+				unique << category;
+
+		auto result = unique.toList ();
+		std::sort (result.begin (), result.end ());
+		return result;
+	}
+
+	std::shared_ptr<void> StorageBackend::StartBatch ()
+	{
+		return {};
+	}
+
+	StorageBackend::FeedFetchState::FeedFetchState (IDType_t feedId)
+	: FeedID_ (feedId)
+	, Interval_ (0)
+	{
+	}
+
+	boost::optional<StorageBackend::FeedFetchState> StorageBackend::GetFeedFetchState (const IDType_t&) const
+	{
+		return {};
+	}
+
+	void StorageBackend::SetFeedFetchState (const FeedFetchState&)
+	{
+	}
+
 	StorageBackend_ptr StorageBackend::Create (const QString& strType, const QString& id)
 	{
 		StorageBackend::Type type;
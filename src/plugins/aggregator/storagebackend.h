@@ -29,9 +29,14 @@
 
 #pragma once
 
+#include <memory>
 #include <boost/optional/optional_fwd.hpp>
 #include <QObject>
+#include <QByteArray>
+#include <QDateTime>
 #include <QSet>
+#include <QHash>
+#include <QPair>
 #include <interfaces/core/ihookproxy.h>
 #include <interfaces/core/itagsmanager.h>
 #include "feed.h"
@@ -127,6 +132,64 @@ namespace Aggregator
 		 */
 		virtual void SetFeedSettings (const Feed::FeedSettings& settings) = 0;
 
+		/** @brief Describes how a feed has been fetched last time.
+		 *
+		 * This is used to issue conditional requests when updating the
+		 * feed and to adapt its update interval to how often it is
+		 * actually updated.
+		 */
+		struct FeedFetchState
+		{
+			/** @brief ID of the corresponding feed.
+			 */
+			IDType_t FeedID_;
+
+			/** @brief Value of the ETag header of the last response.
+			 */
+			QByteArray ETag_;
+
+			/** @brief Value of the Last-Modified header of the last
+			 * response.
+			 */
+			QByteArray LastModified_;
+
+			/** @brief Hash of the last successfully parsed contents.
+			 */
+			QByteArray ContentHash_;
+
+			/** @brief Adaptive update interval in minutes.
+			 *
+			 * 0 means that the interval isn't known yet and the feed
+			 * should be updated along with the other feeds.
+			 */
+			int Interval_;
+
+			/** @brief When the feed has been fetched last time.
+			 */
+			QDateTime LastFetched_;
+
+			FeedFetchState (IDType_t feedId = IDNotFound);
+		};
+
+		/** @brief Returns the fetch state of the feed.
+		 *
+		 * The default implementation doesn't persist the states and
+		 * always returns an empty optional object.
+		 *
+		 * @param[in] feedId ID of the feed.
+		 * @return The fetch state of the feed or an empty optional
+		 * object if the feed hasn't been fetched yet.
+		 */
+		virtual boost::optional<FeedFetchState> GetFeedFetchState (const IDType_t& feedId) const;
+
+		/** @brief Stores the fetch state of a feed.
+		 *
+		 * The state replaces the previous one of the same feed, if any.
+		 *
+		 * @param[in] state The new fetch state.
+		 */
+		virtual void SetFeedFetchState (const FeedFetchState& state);
+
 		/** @brief Get all the channels of a feed in the container.
 		 *
 		 * Returns short information about channels in the storage which
@@ -189,6 +252,36 @@ namespace Aggregator
 		virtual void GetItems (items_shorts_t& items,
 				const IDType_t& channelId) const = 0;
 
+		/** @brief Returns short information about a range of items in a
+		 * channel.
+		 *
+		 * The items are ordered the same way as by GetItems(), so this
+		 * function could be used to load the items of a big channel in
+		 * pages.
+		 *
+		 * The default implementation loads all the items via GetItems()
+		 * and returns the requested range.
+		 *
+		 * @param[out] items The container to which short information about
+		 * the items would be appended.
+		 * @param[in] channelId The ID of the channel.
+		 * @param[in] offset The number of items to skip.
+		 * @param[in] count The max number of items to return.
+		 */
+		virtual void GetItemsPage (items_shorts_t& items,
+				const IDType_t& channelId, int offset, int count) const;
+
+		/** @brief Returns the sorted list of categories of the items in
+		 * a channel.
+		 *
+		 * The default implementation loads all the items via GetItems()
+		 * and collects their categories.
+		 *
+		 * @param[in] channelId The ID of the channel.
+		 * @return The categories of the items in the channel.
+		 */
+		virtual QStringList GetItemsCategories (const IDType_t& channelId) const;
+
 		/** @brief Counts unread items number in a given channel.
 		 *
 		 * A possibly optimized version of getting items via
@@ -266,6 +359,74 @@ namespace Aggregator
 		virtual boost::optional<IDType_t> FindItemByLink (const QString& link,
 				const IDType_t& channel) const = 0;
 
+		/** @brief An in-memory index of items in a channel.
+		 *
+		 * This class allows finding the stored counterparts of the items
+		 * of an updated channel without querying the storage for each
+		 * item separately.
+		 *
+		 * Null titles and links are treated as empty ones, just like the
+		 * FindItem(), FindItemByLink() and FindItemByTitle() lookups of
+		 * the SQL backend treat NULL columns.
+		 *
+		 * @sa GetItemsIndex()
+		 */
+		class ItemsIndex
+		{
+			QHash<QPair<QString, QString>, IDType_t> ByTitleLink_;
+			QHash<QString, IDType_t> ByLink_;
+			QHash<QString, IDType_t> ByTitle_;
+		public:
+			/** @brief Finds the item with the given title and link.
+			 *
+			 * This function follows the same rules as calling
+			 * FindItem(), FindItemByLink() and FindItemByTitle() in this
+			 * order and returning the first found ID.
+			 *
+			 * @param[in] title Title of the item to be found.
+			 * @param[in] link Link of the item to be found.
+			 * @return ID of the found item or an empty optional object
+			 * if no such item exists.
+			 */
+			boost::optional<IDType_t> Find (const QString& title, const QString& link) const;
+
+			/** @brief Adds the item with the given ID to the index.
+			 *
+			 * If there are already items with the same title and/or
+			 * link, they take precedence over this one.
+			 *
+			 * @param[in] id ID of the item.
+			 * @param[in] title Title of the item.
+			 * @param[in] link Link of the item.
+			 */
+			void Add (const IDType_t& id, const QString& title, const QString& link);
+		};
+
+		/** @brief Builds the index of the items in the given channel.
+		 *
+		 * @param[in] channel ID of the channel.
+		 * @return The index of the items in the \em channel.
+		 */
+		ItemsIndex GetItemsIndex (const IDType_t& channel) const;
+
+		/** @brief Starts a batch of modifications.
+		 *
+		 * Modifications done while the returned object is alive may be
+		 * grouped together by the backend, for example, into a single
+		 * transaction. The channelDataUpdated() signal is emitted once
+		 * per modified channel when the batch ends.
+		 *
+		 * If the returned object is destroyed due to an exception, the
+		 * batch is considered failed: the backend may discard the
+		 * modifications, and no signals are emitted.
+		 *
+		 * The default implementation does nothing and returns a null
+		 * pointer.
+		 *
+		 * @return The object ending the batch upon its destruction.
+		 */
+		virtual std::shared_ptr<void> StartBatch ();
+
 		/** @brief Returns all items in the channel.
 		 *
 		 * Returns full information about all the items in the
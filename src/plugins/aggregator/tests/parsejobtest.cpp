@@ -0,0 +1,256 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "parsejobtest.h"
+#include <QtTest>
+#include <QtConcurrentMap>
+#include "../parsejob.h"
+#include "../parserfactory.h"
+#include "../rss20parser.h"
+#include "../atom10parser.h"
+#include "../item.h"
+
+QTEST_MAIN (LeechCraft::Aggregator::ParseJobTest)
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	namespace
+	{
+		const int CorpusFeeds = 200;
+		const int CorpusItems = 50;
+
+		QString ItemTitle (int feed, int item)
+		{
+			return QString ("Item %1 of feed %2").arg (item).arg (feed);
+		}
+
+		QString ItemLink (int feed, int item)
+		{
+			return QString ("http://example.com/feed%1/item%2.html").arg (feed).arg (item);
+		}
+
+		QString ItemBody (int feed, int item)
+		{
+			QString body;
+			for (int i = 0; i < 10; ++i)
+				body += QString ("Paragraph %1 of item %2 of feed %3. ")
+						.arg (i)
+						.arg (item)
+						.arg (feed);
+			return body;
+		}
+
+		QByteArray MakeRss20 (int feed, int items)
+		{
+			QString result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+					"<rss version=\"2.0\"><channel>";
+			result += QString ("<title>Feed %1</title>"
+					"<link>http://example.com/feed%1/</link>"
+					"<description>Test feed %1</description>"
+					"<lastBuildDate>Sat, 17 Oct 2026 12:00:00 +0000</lastBuildDate>")
+					.arg (feed);
+			for (int i = 0; i < items; ++i)
+				result += QString ("<item>"
+						"<title>%1</title>"
+						"<link>%2</link>"
+						"<guid>%2</guid>"
+						"<pubDate>Sat, 17 Oct 2026 %3:%4:00 +0000</pubDate>"
+						"<category>cat%5</category>"
+						"<description>%6</description>"
+						"</item>")
+						.arg (ItemTitle (feed, i))
+						.arg (ItemLink (feed, i))
+						.arg (i / 60 % 24, 2, 10, QChar ('0'))
+						.arg (i % 60, 2, 10, QChar ('0'))
+						.arg (i % 5)
+						.arg (ItemBody (feed, i));
+			result += "</channel></rss>";
+			return result.toUtf8 ();
+		}
+
+		QByteArray MakeAtom10 (int feed, int items)
+		{
+			QString result = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+					"<feed xmlns=\"http://www.w3.org/2005/Atom\">";
+			result += QString ("<title>Feed %1</title>"
+					"<link href=\"http://example.com/feed%1/\"/>"
+					"<subtitle>Test feed %1</subtitle>"
+					"<updated>2026-10-17T12:00:00Z</updated>"
+					"<author><name>Author %1</name></author>")
+					.arg (feed);
+			for (int i = 0; i < items; ++i)
+				result += QString ("<entry>"
+						"<title>%1</title>"
+						"<link href=\"%2\"/>"
+						"<id>%2</id>"
+						"<updated>2026-10-17T%3:%4:00Z</updated>"
+						"<category term=\"cat%5\"/>"
+						"<content>%6</content>"
+						"</entry>")
+						.arg (ItemTitle (feed, i))
+						.arg (ItemLink (feed, i))
+						.arg (i / 60 % 24, 2, 10, QChar ('0'))
+						.arg (i % 60, 2, 10, QChar ('0'))
+						.arg (i % 5)
+						.arg (ItemBody (feed, i));
+			result += "</feed>";
+			return result.toUtf8 ();
+		}
+
+		QList<QByteArray> MakeCorpus ()
+		{
+			QList<QByteArray> corpus;
+			for (int i = 0; i < CorpusFeeds; ++i)
+				corpus << (i % 2 ? MakeAtom10 (i, CorpusItems) : MakeRss20 (i, CorpusItems));
+			return corpus;
+		}
+
+		QStringList GetTitles (const ParseResult& result)
+		{
+			QStringList titles;
+			for (const auto& channel : result.Channels_)
+				for (const auto& item : channel->Items_)
+					titles << item->Title_;
+			return titles;
+		}
+
+		void CheckFeed (const ParseResult& result, int feed, int items)
+		{
+			QCOMPARE (result.Error_, ParseResult::Error::None);
+			QCOMPARE (result.Channels_.size (), static_cast<size_t> (1));
+
+			const auto& channel = result.Channels_.front ();
+			QCOMPARE (channel->Title_, QString ("Feed %1").arg (feed));
+			QCOMPARE (channel->FeedID_, IDNotFound);
+			QCOMPARE (static_cast<int> (channel->Items_.size ()), items);
+
+			for (int i = 0; i < items; ++i)
+			{
+				const auto& item = channel->Items_.at (i);
+				QCOMPARE (item->Title_, ItemTitle (feed, i));
+				QCOMPARE (item->Link_, ItemLink (feed, i));
+				QCOMPARE (item->ChannelID_, channel->ChannelID_);
+				QVERIFY (item->PubDate_.isValid ());
+				QVERIFY (item->Description_.contains ("Paragraph 9"));
+
+				if (QTest::currentTestFailed ())
+					return;
+			}
+		}
+	}
+
+	void ParseJobTest::initTestCase ()
+	{
+		ParserFactory::Instance ().Register (&RSS20Parser::Instance ());
+		ParserFactory::Instance ().Register (&Atom10Parser::Instance ());
+	}
+
+	void ParseJobTest::parseRss20 ()
+	{
+		CheckFeed (ParseFeedData (MakeRss20 (1, 20)), 1, 20);
+	}
+
+	void ParseJobTest::parseAtom10 ()
+	{
+		CheckFeed (ParseFeedData (MakeAtom10 (2, 20)), 2, 20);
+	}
+
+	void ParseJobTest::invalidXml ()
+	{
+		auto data = MakeRss20 (3, 5);
+		data.chop (10);
+
+		const auto& result = ParseFeedData (data);
+		QCOMPARE (result.Error_, ParseResult::Error::InvalidXml);
+		QVERIFY (!result.XmlErrorMsg_.isEmpty ());
+		QCOMPARE (result.FailedData_, data);
+		QVERIFY (result.Channels_.empty ());
+	}
+
+	void ParseJobTest::unknownFormat ()
+	{
+		const QByteArray data = "<?xml version=\"1.0\"?><html><body/></html>";
+
+		const auto& result = ParseFeedData (data);
+		QCOMPARE (result.Error_, ParseResult::Error::NoParser);
+		QCOMPARE (result.FailedData_, data);
+		QVERIFY (result.Channels_.empty ());
+	}
+
+	void ParseJobTest::parallelMatchesSerial ()
+	{
+		const auto& corpus = MakeCorpus ();
+		const auto& parallel = QtConcurrent::blockingMapped<QList<ParseResult>> (corpus, &ParseFeedData);
+		QCOMPARE (parallel.size (), corpus.size ());
+
+		for (int i = 0; i < corpus.size (); ++i)
+		{
+			CheckFeed (parallel.at (i), i, CorpusItems);
+			if (QTest::currentTestFailed ())
+				return;
+
+			QCOMPARE (GetTitles (parallel.at (i)), GetTitles (ParseFeedData (corpus.at (i))));
+		}
+	}
+
+	void ParseJobTest::benchParse_data ()
+	{
+		QTest::addColumn<bool> ("parallel");
+
+		QTest::newRow ("serial") << false;
+		QTest::newRow ("parallel") << true;
+	}
+
+	void ParseJobTest::benchParse ()
+	{
+		QFETCH (bool, parallel);
+
+		const auto& corpus = MakeCorpus ();
+
+		int items = 0;
+		QBENCHMARK
+		{
+			QList<ParseResult> results;
+			if (parallel)
+				results = QtConcurrent::blockingMapped<QList<ParseResult>> (corpus, &ParseFeedData);
+			else
+				for (const auto& data : corpus)
+					results << ParseFeedData (data);
+
+			items = 0;
+			for (const auto& result : results)
+				for (const auto& channel : result.Channels_)
+					items += channel->Items_.size ();
+		}
+		QCOMPARE (items, CorpusFeeds * CorpusItems);
+	}
+}
+}
@@ -0,0 +1,297 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "reconciletest.h"
+#include <stdexcept>
+#include <boost/optional.hpp>
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <interfaces/core/icoreproxy.h>
+#include <interfaces/core/itagsmanager.h>
+#include "../core.h"
+#include "../feed.h"
+#include "../channel.h"
+#include "../item.h"
+
+QTEST_MAIN (LeechCraft::Aggregator::ReconcileTest)
+
+namespace LeechCraft
+{
+namespace Aggregator
+{
+	namespace
+	{
+		const int StoredItems = 500;
+		const int IncomingItems = 50;
+		const int NewItems = 10;
+
+		class StubTagsManager : public ITagsManager
+		{
+		public:
+			tag_id GetID (const QString& tag) { return tag; }
+			QString GetTag (tag_id id) const { return id; }
+			QStringList GetAllTags () const { return {}; }
+			QStringList Split (const QString& string) const { return string.split (' ', QString::SkipEmptyParts); }
+			QStringList SplitToIDs (const QString& string) { return Split (string); }
+			QString Join (const QStringList& tags) const { return tags.join (" "); }
+			QString JoinIDs (const QStringList& tagIDs) const { return Join (tagIDs); }
+			QAbstractItemModel* GetModel () { return nullptr; }
+			QObject* GetQObject () { return nullptr; }
+		};
+
+		/* SQLStorageBackend converts channel tags via the core tags
+		 * manager, and that's all it needs from the proxy.
+		 */
+		class StubCoreProxy : public ICoreProxy
+		{
+			mutable StubTagsManager TagsManager_;
+		public:
+			QNetworkAccessManager* GetNetworkAccessManager () const { return nullptr; }
+			IShortcutProxy* GetShortcutProxy () const { return nullptr; }
+			QModelIndex MapToSource (const QModelIndex& index) const { return index; }
+			Util::BaseSettingsManager* GetSettingsManager () const { return nullptr; }
+			IIconThemeManager* GetIconThemeManager () const { return nullptr; }
+			IColorThemeManager* GetColorThemeManager () const { return nullptr; }
+			IRootWindowsManager* GetRootWindowsManager () const { return nullptr; }
+			ITagsManager* GetTagsManager () const { return &TagsManager_; }
+			QStringList GetSearchCategories () const { return {}; }
+			int GetID () { return 0; }
+			void FreeID (int) {}
+			IPluginsManager* GetPluginsManager () const { return nullptr; }
+			IEntityManager* GetEntityManager () const { return nullptr; }
+			QString GetVersion () const { return {}; }
+			void RegisterSkinnable (QAction*) {}
+			bool IsShuttingDown () { return false; }
+		};
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		QString ItemTitle (int item)
+		{
+			return QString ("Item %1").arg (item);
+		}
+
+		QString ItemLink (int item)
+		{
+			return QString ("http://example.com/item%1.html").arg (item);
+		}
+
+		Item_ptr MakeItem (const IDType_t& channelId, const QString& title, const QString& link)
+		{
+			Item_ptr item (new Item (channelId));
+			item->Title_ = title;
+			item->Link_ = link;
+			item->Guid_ = link;
+			item->Description_ = "Description of " + title;
+			item->PubDate_ = QDateTime::currentDateTime ();
+			item->Unread_ = true;
+			return item;
+		}
+
+		Channel_ptr AddChannel (const StorageBackend_ptr& sb, const QString& url, int items)
+		{
+			Feed_ptr feed (new Feed);
+			feed->URL_ = url;
+
+			Channel_ptr channel (new Channel (feed->FeedID_));
+			channel->Title_ = "Channel for " + url;
+			channel->Link_ = url;
+			channel->LastBuild_ = QDateTime::currentDateTime ();
+			for (int i = 0; i < items; ++i)
+				channel->Items_.push_back (MakeItem (channel->ChannelID_, ItemTitle (i), ItemLink (i)));
+			feed->Channels_.push_back (channel);
+
+			sb->AddFeed (feed);
+			return channel;
+		}
+
+		boost::optional<IDType_t> FindByLookups (const StorageBackend_ptr& sb,
+				const QString& title, const QString& link, const IDType_t& channelId)
+		{
+			if (const auto& id = sb->FindItem (title, link, channelId))
+				return id;
+			if (const auto& id = sb->FindItemByLink (link, channelId))
+				return id;
+			return sb->FindItemByTitle (title, channelId);
+		}
+
+		/* Most of the incoming items are already stored, the rest are
+		 * new, like in a typical feed update.
+		 */
+		QList<QPair<QString, QString>> MakeIncoming ()
+		{
+			QList<QPair<QString, QString>> result;
+			for (int i = 0; i < IncomingItems - NewItems; ++i)
+				result.append ({ ItemTitle (i), ItemLink (i) });
+			for (int i = 0; i < NewItems; ++i)
+				result.append ({ ItemTitle (StoredItems + i), ItemLink (StoredItems + i) });
+			return result;
+		}
+	}
+
+	void ReconcileTest::initTestCase ()
+	{
+		TestHome_ = QDir::temp ().filePath (QString ("lc_aggregator_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		RemoveDir (TestHome_);
+		QVERIFY (QDir {}.mkpath (TestHome_ + "/.leechcraft/aggregator"));
+		qputenv ("HOME", QFile::encodeName (TestHome_));
+
+		Core::Instance ().SetProxy (std::make_shared<StubCoreProxy> ());
+
+		SB_ = StorageBackend::Create (StorageBackend::SBSQLite, "test");
+		SB_->Prepare ();
+	}
+
+	void ReconcileTest::cleanupTestCase ()
+	{
+		SB_.reset ();
+		RemoveDir (TestHome_);
+	}
+
+	void ReconcileTest::indexMatchesLookups ()
+	{
+		const auto& channel = AddChannel (SB_, "http://example.com/lookups.xml", 20);
+		const auto cid = channel->ChannelID_;
+
+		SB_->AddItem (MakeItem (cid, QString (), "http://example.com/untitled.html"));
+		SB_->AddItem (MakeItem (cid, "Linkless", QString ()));
+
+		const QList<QPair<QString, QString>> probes
+		{
+			{ ItemTitle (1), ItemLink (1) },
+			{ ItemTitle (2), "http://example.com/moved.html" },
+			{ "Renamed", ItemLink (3) },
+			{ QString (), "http://example.com/untitled.html" },
+			{ "", "http://example.com/untitled.html" },
+			{ "Linkless", QString () },
+			{ "Linkless", "" },
+			{ QString (), QString () },
+			{ "", "" },
+			{ QString (), "http://example.com/other.html" },
+			{ "", "http://example.com/other.html" },
+			{ "Unknown", "http://example.com/unknown.html" }
+		};
+
+		const auto& index = SB_->GetItemsIndex (cid);
+		for (const auto& probe : probes)
+		{
+			const auto& expected = FindByLookups (SB_, probe.first, probe.second, cid);
+			const auto& actual = index.Find (probe.first, probe.second);
+			QCOMPARE (static_cast<bool> (actual), static_cast<bool> (expected));
+			if (expected)
+				QCOMPARE (*actual, *expected);
+		}
+	}
+
+	void ReconcileTest::completedBatchCommits ()
+	{
+		const auto& channel = AddChannel (SB_, "http://example.com/commit.xml", 5);
+		const auto& item = MakeItem (channel->ChannelID_, "Committed", "http://example.com/committed.html");
+
+		{
+			const auto batch = SB_->StartBatch ();
+			SB_->AddItem (item);
+		}
+
+		const auto& found = SB_->FindItem (item->Title_, item->Link_, channel->ChannelID_);
+		QVERIFY (found);
+		QCOMPARE (*found, item->ItemID_);
+	}
+
+	void ReconcileTest::abortedBatchRollsBack ()
+	{
+		const auto& channel = AddChannel (SB_, "http://example.com/rollback.xml", 5);
+		const auto& item = MakeItem (channel->ChannelID_, "Aborted", "http://example.com/aborted.html");
+
+		bool thrown = false;
+		try
+		{
+			const auto batch = SB_->StartBatch ();
+			SB_->AddItem (item);
+			throw std::runtime_error ("aborting the batch");
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		QVERIFY (thrown);
+
+		QVERIFY (!SB_->FindItem (item->Title_, item->Link_, channel->ChannelID_));
+		QVERIFY (SB_->FindItem (ItemTitle (0), ItemLink (0), channel->ChannelID_));
+	}
+
+	void ReconcileTest::benchReconcile_data ()
+	{
+		QTest::addColumn<bool> ("indexed");
+
+		QTest::newRow ("lookups") << false;
+		QTest::newRow ("index") << true;
+	}
+
+	void ReconcileTest::benchReconcile ()
+	{
+		QFETCH (bool, indexed);
+
+		static int run = 0;
+		const auto& channel = AddChannel (SB_,
+				QString ("http://example.com/bench%1.xml").arg (run++), StoredItems);
+		const auto cid = channel->ChannelID_;
+		const auto& incoming = MakeIncoming ();
+
+		int found = 0;
+		QBENCHMARK
+		{
+			found = 0;
+			if (indexed)
+			{
+				const auto& index = SB_->GetItemsIndex (cid);
+				for (const auto& pair : incoming)
+					if (index.Find (pair.first, pair.second))
+						++found;
+			}
+			else
+				for (const auto& pair : incoming)
+					if (FindByLookups (SB_, pair.first, pair.second, cid))
+						++found;
+		}
+		QCOMPARE (found, IncomingItems - NewItems);
+	}
+}
+}
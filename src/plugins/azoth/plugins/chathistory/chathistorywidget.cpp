@@ -66,6 +66,8 @@ namespace ChatHistory
 	, Amount_ (0)
 	, SearchShift_ (0)
 	, SearchResultPosition_ (-1)
+	, SearchPositionsValid_ (false)
+	, SearchPositionsCS_ (false)
 	, ContactSelectedAsGlobSearch_ (false)
 	, Toolbar_ (new QToolBar (tr ("Chat history")))
 	, EntryToFocus_ (entry)
@@ -123,10 +125,18 @@ namespace ChatHistory
 				SIGNAL (gotSearchPosition (const QString&, const QString&, int)),
 				this,
 				SLOT (handleGotSearchPosition (const QString&, const QString&, int)));
+		connect (Core::Instance ().get (),
+				SIGNAL (gotAllSearchPositions (QString, QString, QString, QList<int>)),
+				this,
+				SLOT (handleGotAllSearchPositions (QString, QString, QString, QList<int>)));
 		connect (Core::Instance ().get (),
 				SIGNAL (gotDaysForSheet (QString, QString, int, int, QList<int>)),
 				this,
 				SLOT (handleGotDaysForSheet (QString, QString, int, int, QList<int>)));
+		connect (Core::Instance ().get (),
+				SIGNAL (historyChanged (QString, QString)),
+				this,
+				SLOT (handleHistoryChanged (QString, QString)));
 
 		Toolbar_->addAction (tr ("Previous"),
 				this,
@@ -469,6 +479,21 @@ namespace ChatHistory
 		RequestLogs ();
 	}
 
+	void ChatHistoryWidget::handleGotAllSearchPositions (const QString& accountId,
+			const QString& entryId, const QString& text, const QList<int>& positions)
+	{
+		if (accountId != CurrentAccount_ ||
+				entryId != CurrentEntry_ ||
+				text != PreviousSearchText_)
+			return;
+
+		SearchPositions_ = positions;
+		SearchPositionsValid_ = true;
+		SearchPositionsCS_ = FindBox_->GetFlags () & ChatFindBox::FindCaseSensitively;
+
+		ShowSearchPosition ();
+	}
+
 	void ChatHistoryWidget::handleGotDaysForSheet (const QString& accountId,
 			const QString& entryId, int year, int month, const QList<int>& days)
 	{
@@ -486,11 +511,18 @@ namespace ChatHistory
 			Ui_.Calendar_->setDateTextFormat (QDate (year, month, day), fmt);
 	}
 
+	void ChatHistoryWidget::handleHistoryChanged (const QString& accountId, const QString& entryId)
+	{
+		if (accountId == CurrentAccount_ && entryId == CurrentEntry_)
+			SearchPositionsValid_ = false;
+	}
+
 	void ChatHistoryWidget::on_AccountBox__currentIndexChanged (int idx)
 	{
 		const QString& id = Ui_.AccountBox_->itemData (idx).toString ();
 		Core::Instance ()->GetUsersForAccount (id);
 		CurrentEntry_.clear ();
+		SearchPositionsValid_ = false;
 		UpdateDates ();
 	}
 
@@ -499,6 +531,7 @@ namespace ChatHistory
 		CurrentAccount_ = Ui_.AccountBox_->
 				itemData (Ui_.AccountBox_->currentIndex ()).toString ();
 		CurrentEntry_ = index.data (MRIDRole).toString ();
+		SearchPositionsValid_ = false;
 		if (!ContactSelectedAsGlobSearch_)
 		{
 			SearchShift_ = 0;
@@ -548,6 +581,7 @@ namespace ChatHistory
 		{
 			SearchShift_ = 0;
 			PreviousSearchText_ = text;
+			SearchPositionsValid_ = false;
 		}
 		else if (!(flags & ChatFindBox::FindBackwards))
 			++SearchShift_;
@@ -590,6 +624,7 @@ namespace ChatHistory
 			return;
 
 		Core::Instance ()->ClearHistory (CurrentAccount_, CurrentEntry_);
+		SearchPositionsValid_ = false;
 
 		Ui_.Contacts_->clearSelection ();
 		if (const auto item = FindContactItem (CurrentEntry_))
@@ -657,9 +692,27 @@ namespace ChatHistory
 
 	void ChatHistoryWidget::RequestSearch (ChatFindBox::FindFlags flags)
 	{
-		Core::Instance ()->Search (CurrentAccount_, CurrentEntry_,
-				PreviousSearchText_, SearchShift_,
-				flags & ChatFindBox::FindCaseSensitively);
+		const bool cs = flags & ChatFindBox::FindCaseSensitively;
+		if (CurrentEntry_.isEmpty ())
+		{
+			Core::Instance ()->Search (CurrentAccount_, CurrentEntry_,
+					PreviousSearchText_, SearchShift_, cs);
+			return;
+		}
+
+		if (SearchPositionsValid_ && SearchPositionsCS_ == cs)
+			ShowSearchPosition ();
+		else
+			Core::Instance ()->SearchAll (CurrentAccount_, CurrentEntry_,
+					PreviousSearchText_, cs);
+	}
+
+	void ChatHistoryWidget::ShowSearchPosition ()
+	{
+		const int position = SearchShift_ < SearchPositions_.size () ?
+				SearchPositions_.at (SearchShift_) :
+				0;
+		handleGotSearchPosition (CurrentAccount_, CurrentEntry_, position);
 	}
 }
 }
@@ -67,6 +67,9 @@ namespace ChatHistory
 		int Amount_;
 		int SearchShift_;
 		int SearchResultPosition_;
+		QList<int> SearchPositions_;
+		bool SearchPositionsValid_;
+		bool SearchPositionsCS_;
 		bool ContactSelectedAsGlobSearch_;
 		QString CurrentAccount_;
 		QString CurrentEntry_;
@@ -100,7 +103,10 @@ namespace ChatHistory
 		void handleGotUsersForAccount (const QStringList&, const QString&, const QStringList&);
 		void handleGotChatLogs (const QString&, const QString&, int, int, const QVariant&);
 		void handleGotSearchPosition (const QString&, const QString&, int);
+		void handleGotAllSearchPositions (const QString&, const QString&,
+				const QString&, const QList<int>&);
 		void handleGotDaysForSheet (const QString&, const QString&, int, int, const QList<int>&);
+		void handleHistoryChanged (const QString&, const QString&);
 
 		void on_AccountBox__currentIndexChanged (int);
 		void handleContactSelected (const QModelIndex&);
@@ -122,6 +128,7 @@ namespace ChatHistory
 		void UpdateDates ();
 		void RequestLogs ();
 		void RequestSearch (ChatFindBox::FindFlags);
+		void ShowSearchPosition ();
 	signals:
 		void removeSelf (QWidget*);
 
@@ -268,6 +268,18 @@ namespace ChatHistory
 				Q_ARG (QDateTime, dt));
 	}
 
+	void Core::SearchAll (const QString& accountId, const QString& entryId,
+			const QString& text, bool cs)
+	{
+		QMetaObject::invokeMethod (StorageThread_->GetStorage (),
+				"searchAll",
+				Qt::QueuedConnection,
+				Q_ARG (QString, accountId),
+				Q_ARG (QString, entryId),
+				Q_ARG (QString, text),
+				Q_ARG (bool, cs));
+	}
+
 	void Core::GetDaysForSheet (const QString& accountId, const QString& entryId, int year, int month)
 	{
 		QMetaObject::invokeMethod (StorageThread_->GetStorage (),
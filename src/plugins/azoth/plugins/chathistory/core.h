@@ -95,6 +95,8 @@ namespace ChatHistory
 		void Search (const QString& accountId, const QString& entryId,
 				const QString& text, int shift, bool cs);
 		void Search (const QString& accountId, const QString& entryId, const QDateTime& dt);
+		void SearchAll (const QString& accountId, const QString& entryId,
+				const QString& text, bool cs);
 		void GetDaysForSheet (const QString& accountId, const QString& entryId, int year, int month);
 		void ClearHistory (const QString& accountId, const QString& entryId);
 
@@ -110,9 +112,12 @@ namespace ChatHistory
 		 */
 		void gotChatLogs (const QString&, const QString&, int, int, const QVariant&);
 		void gotSearchPosition (const QString&, const QString&, int);
+		void gotAllSearchPositions (const QString& accountId, const QString& entryId,
+				const QString& text, const QList<int>& positions);
 
 		void gotDaysForSheet (const QString& accountId, const QString& entryId,
 				int year, int month, const QList<int>& days);
+		void historyChanged (const QString& accountId, const QString& entryId);
 	};
 }
 }
@@ -34,6 +34,9 @@
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QDir>
+#include <QRegExp>
+#include <QTimer>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <util/db/dblock.h>
 #include <util/sys/paths.h>
@@ -53,13 +56,16 @@ namespace ChatHistory
 	Storage::RawSearchResult::RawSearchResult ()
 	: EntryID_ (0)
 	, AccountID_ (0)
+	, Rowid_ (0)
 	{
 	}
 
-	Storage::RawSearchResult::RawSearchResult (qint32 entryId, qint32 accountId, const QDateTime& date)
+	Storage::RawSearchResult::RawSearchResult (qint32 entryId, qint32 accountId,
+			const QDateTime& date, qint64 rowid)
 	: EntryID_ (entryId)
 	, AccountID_ (accountId)
 	, Date_ (date)
+	, Rowid_ (rowid)
 	{
 	}
 
@@ -68,9 +74,79 @@ namespace ChatHistory
 		return Date_.isNull () || !EntryID_ || !AccountID_;
 	}
 
+	namespace
+	{
+		/** How long incoming messages are coalesced before being
+		 * written in a single transaction.
+		 */
+		const int FlushInterval = 500;
+
+		/** Flush right away once this many messages are pending, no
+		 * matter how long ago the batch was started.
+		 */
+		const int MaxPendingMessages = 1000;
+
+		const qint64 StatsInterval = 60 * 1000;
+
+		/** The (Id, AccountId, Date) index takes a while to build on large
+		 * histories, so it is created a bit later to let the first history
+		 * requests after the startup through.
+		 */
+		const int DateIndexDelay = 10 * 1000;
+
+		bool CreateDateIndex (const QString& path)
+		{
+			const QString connName { "History date index connection" };
+
+			bool result = false;
+			{
+				auto db = QSqlDatabase::addDatabase ("QSQLITE", connName);
+				db.setDatabaseName (path);
+				if (!db.open ())
+					Util::DBLock::DumpError (db.lastError ());
+				else
+				{
+					QElapsedTimer timer;
+					timer.start ();
+
+					QSqlQuery query { db };
+					result = query.exec ("CREATE INDEX IF NOT EXISTS azoth_history_id_accountid_date "
+							"ON azoth_history (Id, AccountId, Date);");
+					if (!result)
+						Util::DBLock::DumpError (query);
+					else
+						qDebug () << Q_FUNC_INFO
+								<< "created the date index in"
+								<< timer.elapsed ()
+								<< "ms";
+				}
+			}
+			QSqlDatabase::removeDatabase (connName);
+			return result;
+		}
+	}
+
 	Storage::Storage (QObject *parent)
 	: QObject (parent)
+	, PagesCache_ (16)
+	, FlushTimer_ (new QTimer (this))
+	, StatsMessages_ (0)
+	, StatsBatches_ (0)
+	, StatsDBTime_ (0)
+	, FtsAvailable_ (false)
+	, FtsBoundary_ (0)
+	, FtsIndexed_ (0)
+	, DateIndexWatcher_ (nullptr)
 	{
+		FlushTimer_->setSingleShot (true);
+		FlushTimer_->setInterval (FlushInterval);
+		connect (FlushTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (flushPending ()));
+
+		StatsTimer_.start ();
+
 		DB_.reset (new QSqlDatabase (QSqlDatabase::addDatabase ("QSQLITE", "History connection")));
 		DB_->setDatabaseName (Util::CreateIfNotExists ("azoth").filePath ("history.db"));
 		if (!DB_->open ())
@@ -84,6 +160,7 @@ namespace ChatHistory
 		QSqlQuery pragma (*DB_);
 		pragma.exec ("PRAGMA foreign_keys = ON;");
 		pragma.exec ("PRAGMA synchronous = OFF;");
+		pragma.exec ("PRAGMA journal_mode = WAL;");
 
 		InitializeTables ();
 
@@ -93,12 +170,6 @@ namespace ChatHistory
 		AccountSelector_ = QSqlQuery (*DB_);
 		AccountSelector_.prepare ("SELECT Id, AccountID FROM azoth_accounts");
 
-		UserIDSelector_ = QSqlQuery (*DB_);
-		UserIDSelector_.prepare ("SELECT Id FROM azoth_users WHERE EntryID = :entry_id");
-
-		AccountIDSelector_ = QSqlQuery (*DB_);
-		AccountIDSelector_.prepare ("SELECT Id FROM azoth_accounts WHERE AccountID = :account_id");
-
 		UserInserter_ = QSqlQuery (*DB_);
 		UserInserter_.prepare ("INSERT INTO azoth_users (EntryID) VALUES (:entry_id);");
 
@@ -153,12 +224,102 @@ namespace ChatHistory
 				"	ORDER BY Rowid DESC "
 				"	LIMIT 1 OFFSET :offset);");
 
+		AllSearcher_ = QSqlQuery (*DB_);
+		AllSearcher_.prepare ("SELECT Rowid FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND ((Message LIKE :text AND :insensitive) OR (Message GLOB :ctext AND :sensitive)) "
+				"ORDER BY Rowid DESC;");
+
+		Rowid2Pos_ = QSqlQuery (*DB_);
+		Rowid2Pos_.prepare ("SELECT COUNT(1) FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND Rowid >= :rowid;");
+
+		EntryRowidsGetter_ = QSqlQuery (*DB_);
+		EntryRowidsGetter_.prepare ("SELECT Rowid FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"ORDER BY Rowid DESC;");
+
+		if (FtsAvailable_)
+		{
+			/* Once the full-text index is built, every search only finds
+			 * the messages where each word of the query starts some word
+			 * of the message, and the LIKE/GLOB check then requires the
+			 * query to occur in them as a whole. Substrings in the middle
+			 * of words are found only by the scan-based searchers above,
+			 * which are used while the index is being built or if the
+			 * query has no words at all. CROSS JOIN forces SQLite to
+			 * iterate over the MATCH results instead of the whole table.
+			 */
+			const QString ftsFrom = "FROM azoth_history_fts CROSS JOIN azoth_history "
+					"ON azoth_history.Rowid = azoth_history_fts.docid "
+					"WHERE azoth_history_fts MATCH :match "
+					"AND ((azoth_history.Message LIKE :text AND :insensitive) "
+					"	OR (azoth_history.Message GLOB :ctext AND :sensitive)) ";
+
+			FtsSearcher_ = QSqlQuery (*DB_);
+			FtsSearcher_.prepare ("SELECT azoth_history.Rowid, Date " + ftsFrom +
+					"AND Id = :entry_id "
+					"AND AccountID = :account_id "
+					"ORDER BY azoth_history.Rowid DESC "
+					"LIMIT 1 OFFSET :offset;");
+
+			FtsSearcherWOContact_ = QSqlQuery (*DB_);
+			FtsSearcherWOContact_.prepare ("SELECT azoth_history.Rowid, Date, Id " + ftsFrom +
+					"AND AccountID = :account_id "
+					"ORDER BY azoth_history.Rowid DESC "
+					"LIMIT 1 OFFSET :offset;");
+
+			FtsSearcherWOContactAccount_ = QSqlQuery (*DB_);
+			FtsSearcherWOContactAccount_.prepare ("SELECT azoth_history.Rowid, Date, Id, AccountID " + ftsFrom +
+					"ORDER BY azoth_history.Rowid DESC "
+					"LIMIT 1 OFFSET :offset;");
+
+			FtsAllSearcher_ = QSqlQuery (*DB_);
+			FtsAllSearcher_.prepare ("SELECT azoth_history.Rowid " + ftsFrom +
+					"AND Id = :entry_id "
+					"AND AccountID = :account_id "
+					"ORDER BY azoth_history.Rowid DESC;");
+		}
+
 		HistoryGetter_ = QSqlQuery (*DB_);
-		HistoryGetter_.prepare ("SELECT Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
+		HistoryGetter_.prepare ("SELECT Rowid, Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
+				"FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND Rowid <= :rowid "
+				"ORDER BY Rowid DESC LIMIT :limit;");
+
+		HistoryNewerGetter_ = QSqlQuery (*DB_);
+		HistoryNewerGetter_.prepare ("SELECT Rowid, Date, Direction, Message, Variant, Type, RichMessage, EscapePolicy "
 				"FROM azoth_history "
 				"WHERE Id = :entry_id "
 				"AND AccountID = :account_id "
-				"ORDER BY Rowid DESC LIMIT :limit OFFSET :offset;");
+				"AND Rowid >= :rowid "
+				"ORDER BY Rowid ASC LIMIT :limit;");
+
+		PageAnchorGetter_ = QSqlQuery (*DB_);
+		PageAnchorGetter_.prepare ("SELECT Rowid FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"ORDER BY Rowid DESC LIMIT 1 OFFSET :offset;");
+
+		PageAnchorOlderGetter_ = QSqlQuery (*DB_);
+		PageAnchorOlderGetter_.prepare ("SELECT Rowid FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND Rowid < :rowid "
+				"ORDER BY Rowid DESC LIMIT 1 OFFSET :offset;");
+
+		PageAnchorNewerGetter_ = QSqlQuery (*DB_);
+		PageAnchorNewerGetter_.prepare ("SELECT Rowid FROM azoth_history "
+				"WHERE Id = :entry_id "
+				"AND AccountID = :account_id "
+				"AND Rowid > :rowid "
+				"ORDER BY Rowid ASC LIMIT 1 OFFSET :offset;");
 
 		HistoryClearer_ = QSqlQuery (*DB_);
 		HistoryClearer_.prepare ("DELETE FROM azoth_history WHERE Id = :entry_id AND AccountID = :account_id;");
@@ -199,6 +360,28 @@ namespace ChatHistory
 		}
 
 		PrepareEntryCache ();
+
+		if (FtsAvailable_ && !IsFtsReady ())
+			QTimer::singleShot (0,
+					this,
+					SLOT (indexHistoryChunk ()));
+
+		if (!HasIndex ("azoth_history_id_accountid_date"))
+			QTimer::singleShot (DateIndexDelay,
+					this,
+					SLOT (createDateIndex ()));
+	}
+
+	Storage::~Storage ()
+	{
+		if (DateIndexWatcher_)
+		{
+			DateIndexWatcher_->waitForFinished ();
+			delete DateIndexWatcher_;
+			DateIndexWatcher_ = nullptr;
+		}
+
+		flushPending ();
 	}
 
 	void Storage::InitializeTables ()
@@ -292,6 +475,8 @@ namespace ChatHistory
 		if (!hadAcc2User)
 			regenUsersCache ();
 
+		InitializeFts ();
+
 		lock.Good ();
 	}
 
@@ -330,64 +515,233 @@ namespace ChatHistory
 		}
 	}
 
-	QHash<QString, qint32> Storage::GetUsers ()
+	void Storage::InitializeFts ()
 	{
-		if (!UserSelector_.exec ())
+		QSqlQuery query { *DB_ };
+
+		auto dropTriggers = [&query]
 		{
-			Util::DBLock::DumpError (UserSelector_);
-			throw std::runtime_error ("Unable to perform user selection for Azoth history");
+			query.exec ("DROP TRIGGER IF EXISTS azoth_history_fts_insert;");
+			query.exec ("DROP TRIGGER IF EXISTS azoth_history_fts_delete;");
+		};
+
+		const auto& tables = DB_->tables ();
+		if (tables.contains ("azoth_history_fts"))
+		{
+			if (!query.exec ("SELECT docid FROM azoth_history_fts LIMIT 0;"))
+			{
+				Util::DBLock::DumpError (query);
+				qWarning () << Q_FUNC_INFO
+						<< "the full-text index exists but is unusable, falling back to plain search";
+				dropTriggers ();
+				return;
+			}
 		}
+		else
+		{
+			/* The index refers to the rows of azoth_history instead of
+			 * keeping its own copy of the messages. Everything that is
+			 * already in the history gets indexed in the background by
+			 * indexHistoryChunk(), the triggers below take care of the
+			 * rows that are outside of the yet unindexed range.
+			 */
+			if (!query.exec ("CREATE VIRTUAL TABLE azoth_history_fts USING fts4 "
+						"(content=\"azoth_history\", Message, tokenize=unicode61);") &&
+				!query.exec ("CREATE VIRTUAL TABLE azoth_history_fts USING fts4 "
+						"(content=\"azoth_history\", Message);"))
+			{
+				Util::DBLock::DumpError (query);
+				qWarning () << Q_FUNC_INFO
+						<< "SQLite FTS4 is unavailable, falling back to plain search";
+				dropTriggers ();
+				return;
+			}
 
-		QHash<QString, qint32> result;
-		while (UserSelector_.next ())
-			result [UserSelector_.value (1).toString ()] =
-					UserSelector_.value (0).toInt ();
+			if (!query.exec ("DROP TABLE IF EXISTS azoth_history_fts_state;") ||
+				!query.exec ("CREATE TABLE azoth_history_fts_state ("
+						"Boundary INTEGER, "
+						"Indexed INTEGER "
+						");") ||
+				!query.exec ("INSERT INTO azoth_history_fts_state (Boundary, Indexed) "
+						"SELECT COALESCE(MAX(Rowid), 0), 0 FROM azoth_history;"))
+			{
+				Util::DBLock::DumpError (query);
+				dropTriggers ();
+				return;
+			}
+		}
 
-		return result;
+		const QString indexedCond = "WHEN %1.Rowid > (SELECT Boundary FROM azoth_history_fts_state) "
+				"OR %1.Rowid <= (SELECT Indexed FROM azoth_history_fts_state) ";
+		if (!query.exec ("CREATE TRIGGER IF NOT EXISTS azoth_history_fts_insert "
+					"AFTER INSERT ON azoth_history " +
+					indexedCond.arg ("new") +
+					"BEGIN "
+					"INSERT INTO azoth_history_fts (docid, Message) VALUES (new.Rowid, new.Message); "
+					"END;") ||
+			!query.exec ("CREATE TRIGGER IF NOT EXISTS azoth_history_fts_delete "
+					"BEFORE DELETE ON azoth_history " +
+					indexedCond.arg ("old") +
+					"BEGIN "
+					"DELETE FROM azoth_history_fts WHERE docid = old.Rowid; "
+					"END;"))
+		{
+			Util::DBLock::DumpError (query);
+			dropTriggers ();
+			return;
+		}
+
+		if (!query.exec ("SELECT Boundary, Indexed FROM azoth_history_fts_state;") ||
+				!query.next ())
+		{
+			Util::DBLock::DumpError (query);
+			dropTriggers ();
+			return;
+		}
+
+		FtsBoundary_ = query.value (0).toLongLong ();
+		FtsIndexed_ = query.value (1).toLongLong ();
+		query.finish ();
+
+		FtsAvailable_ = true;
 	}
 
-	qint32 Storage::GetUserID (const QString& entryId)
+	bool Storage::IsFtsReady () const
 	{
-		UserIDSelector_.bindValue (":entry_id", entryId);
-		if (!UserIDSelector_.exec ())
+		return FtsAvailable_ && FtsIndexed_ >= FtsBoundary_;
+	}
+
+	bool Storage::HasIndex (const QString& name) const
+	{
+		QSqlQuery query { *DB_ };
+		query.prepare ("SELECT 1 FROM sqlite_master WHERE type = 'index' AND name = :name;");
+		query.bindValue (":name", name);
+		if (!query.exec ())
 		{
-			Util::DBLock::DumpError (UserIDSelector_);
-			throw std::runtime_error ("ChatHistory::Storage::GetUserID: unable to get user's ID");
+			Util::DBLock::DumpError (query);
+			return false;
 		}
 
-		if (!UserIDSelector_.next ())
-			return -1;
+		return query.next ();
+	}
 
-		qint32 result = UserIDSelector_.value (0).toInt ();
-		UserIDSelector_.finish ();
-		return result;
+	void Storage::createDateIndex ()
+	{
+		if (DateIndexWatcher_)
+			return;
+
+		/* Building the index takes a while on large histories, so it's
+		 * done on a separate connection to keep this one responsive to
+		 * the history requests. SQLite allows only one writer at a time
+		 * though, so the writes on this connection are postponed until
+		 * the index is built.
+		 */
+		DateIndexWatcher_ = new QFutureWatcher<bool> (this);
+		connect (DateIndexWatcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleDateIndexCreated ()));
+		DateIndexWatcher_->setFuture (QtConcurrent::run (CreateDateIndex, DB_->databaseName ()));
 	}
 
-	void Storage::AddUser (const QString& id, const QString& accountId)
+	void Storage::handleDateIndexCreated ()
 	{
-		UserInserter_.bindValue (":entry_id", id);
-		if (!UserInserter_.exec ())
-		{
-			Util::DBLock::DumpError (UserInserter_);
+		DateIndexWatcher_->deleteLater ();
+		DateIndexWatcher_ = nullptr;
+
+		flushPending ();
+
+		if (FtsAvailable_ && !IsFtsReady ())
+			indexHistoryChunk ();
+	}
+
+	void Storage::indexHistoryChunk ()
+	{
+		// Resumed by handleDateIndexCreated().
+		if (IsFtsReady () || DateIndexWatcher_)
 			return;
-		}
-		UserInserter_.finish ();
 
-		qint32 numericId = 0;
+		const qint64 chunkSize = 5000;
+		const auto upper = std::min (FtsIndexed_ + chunkSize, FtsBoundary_);
+
+		Util::DBLock lock (*DB_);
 		try
 		{
-			numericId = GetUserID (id);
+			lock.Init ();
 		}
 		catch (const std::exception& e)
 		{
 			qWarning () << Q_FUNC_INFO
-					<< "unable to refetch id for"
-					<< id
-					<< "with:"
+					<< "unable to start transaction:"
 					<< e.what ();
 			return;
 		}
 
+		QSqlQuery query { *DB_ };
+		query.prepare ("INSERT INTO azoth_history_fts (docid, Message) "
+				"SELECT Rowid, Message FROM azoth_history "
+				"WHERE Rowid > :lower AND Rowid <= :upper;");
+		query.bindValue (":lower", FtsIndexed_);
+		query.bindValue (":upper", upper);
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return;
+		}
+
+		query.prepare ("UPDATE azoth_history_fts_state SET Indexed = :indexed;");
+		query.bindValue (":indexed", upper);
+		if (!query.exec ())
+		{
+			Util::DBLock::DumpError (query);
+			return;
+		}
+
+		lock.Good ();
+		FtsIndexed_ = upper;
+
+		if (IsFtsReady ())
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "finished indexing"
+					<< FtsBoundary_
+					<< "history rows";
+			return;
+		}
+
+		QTimer::singleShot (0,
+				this,
+				SLOT (indexHistoryChunk ()));
+	}
+
+	QHash<QString, qint32> Storage::GetUsers ()
+	{
+		if (!UserSelector_.exec ())
+		{
+			Util::DBLock::DumpError (UserSelector_);
+			throw std::runtime_error ("Unable to perform user selection for Azoth history");
+		}
+
+		QHash<QString, qint32> result;
+		while (UserSelector_.next ())
+			result [UserSelector_.value (1).toString ()] =
+					UserSelector_.value (0).toInt ();
+
+		return result;
+	}
+
+	void Storage::AddUser (const QString& id, const QString& accountId)
+	{
+		UserInserter_.bindValue (":entry_id", id);
+		if (!UserInserter_.exec ())
+		{
+			Util::DBLock::DumpError (UserInserter_);
+			return;
+		}
+
+		const qint32 numericId = UserInserter_.lastInsertId ().toInt ();
+		UserInserter_.finish ();
+
 		Users_ [id] = numericId;
 
 		QSqlQuery acc2users (*DB_);
@@ -430,23 +784,6 @@ namespace ChatHistory
 		return result;
 	}
 
-	qint32 Storage::GetAccountID (const QString& accId)
-	{
-		AccountIDSelector_.bindValue (":account_id", accId);
-		if (!AccountIDSelector_.exec ())
-		{
-			Util::DBLock::DumpError (AccountIDSelector_);
-			throw std::runtime_error ("ChatHistory::Storage::GetAccountID: unable to get account ID");
-		}
-
-		if (!AccountIDSelector_.next ())
-			return -1;
-
-		qint32 result = AccountIDSelector_.value (0).toInt ();
-		AccountIDSelector_.finish ();
-		return result;
-	}
-
 	void Storage::AddAccount (const QString& id)
 	{
 		AccountInserter_.bindValue (":account_id", id);
@@ -455,20 +792,9 @@ namespace ChatHistory
 			Util::DBLock::DumpError (AccountInserter_);
 			return;
 		}
-		AccountInserter_.finish ();
 
-		try
-		{
-			Accounts_ [id] = GetAccountID (id);
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to refetch id for"
-					<< id
-					<< "with:"
-					<< e.what ();
-		}
+		Accounts_ [id] = AccountInserter_.lastInsertId ().toInt ();
+		AccountInserter_.finish ();
 	}
 
 	namespace
@@ -477,6 +803,26 @@ namespace ChatHistory
 		{
 			return std::shared_ptr<void> (nullptr, [&query] (void*) { query.finish (); });
 		}
+
+		void BindSearchText (QSqlQuery& query, const QString& text, bool cs)
+		{
+			query.bindValue (":text", '%' + text + '%');
+			query.bindValue (":ctext", '*' + text + '*');
+			query.bindValue (":sensitive", static_cast<int> (cs));
+			query.bindValue (":insensitive", static_cast<int> (!cs));
+		}
+
+		/** Turns the search text into a MATCH expression requiring every
+		 * word of the text to be a prefix of some token of the message.
+		 * Returns an empty string if the text has no words at all.
+		 */
+		QString MakeFtsMatch (const QString& text)
+		{
+			QStringList terms;
+			for (const auto& word : text.split (QRegExp ("[\\W_]+"), QString::SkipEmptyParts))
+				terms << '"' + word + "*\"";
+			return terms.join (" ");
+		}
 	}
 
 	Storage::RawSearchResult Storage::Search (const QString& accountId,
@@ -503,14 +849,35 @@ namespace ChatHistory
 
 		const qint32 intEntryId = Users_ [entryId];
 		const qint32 intAccId = Accounts_ [accountId];
+
+		const auto& match = MakeFtsMatch (text);
+		if (IsFtsReady () && !match.isEmpty ())
+		{
+			FtsSearcher_.bindValue (":match", match);
+			FtsSearcher_.bindValue (":entry_id", intEntryId);
+			FtsSearcher_.bindValue (":account_id", intAccId);
+			FtsSearcher_.bindValue (":offset", shift);
+			BindSearchText (FtsSearcher_, text, cs);
+			if (!FtsSearcher_.exec ())
+			{
+				Util::DBLock::DumpError (FtsSearcher_);
+				return RawSearchResult ();
+			}
+			auto guard = CleanupQueryGuard (FtsSearcher_);
+
+			if (!FtsSearcher_.next ())
+				return RawSearchResult ();
+
+			return RawSearchResult (intEntryId, intAccId,
+					FtsSearcher_.value (1).toDateTime (),
+					FtsSearcher_.value (0).toLongLong ());
+		}
+
 		LogsSearcher_.bindValue (":entry_id", intEntryId);
 		LogsSearcher_.bindValue (":account_id", intAccId);
 		LogsSearcher_.bindValue (":inner_entry_id", intEntryId);
 		LogsSearcher_.bindValue (":inner_account_id", intAccId);
-		LogsSearcher_.bindValue (":text", '%' + text + '%');
-		LogsSearcher_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcher_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcher_.bindValue (":insensitive", static_cast<int> (!cs));
+		BindSearchText (LogsSearcher_, text, cs);
 		LogsSearcher_.bindValue (":offset", shift);
 		if (!LogsSearcher_.exec ())
 		{
@@ -543,12 +910,33 @@ namespace ChatHistory
 		}
 
 		const qint32 intAccId = Accounts_ [accountId];
+
+		const auto& match = MakeFtsMatch (text);
+		if (IsFtsReady () && !match.isEmpty ())
+		{
+			FtsSearcherWOContact_.bindValue (":match", match);
+			FtsSearcherWOContact_.bindValue (":account_id", intAccId);
+			FtsSearcherWOContact_.bindValue (":offset", shift);
+			BindSearchText (FtsSearcherWOContact_, text, cs);
+			if (!FtsSearcherWOContact_.exec ())
+			{
+				Util::DBLock::DumpError (FtsSearcherWOContact_);
+				return RawSearchResult ();
+			}
+			auto guard = CleanupQueryGuard (FtsSearcherWOContact_);
+
+			if (!FtsSearcherWOContact_.next ())
+				return RawSearchResult ();
+
+			return RawSearchResult (FtsSearcherWOContact_.value (2).toInt (),
+					intAccId,
+					FtsSearcherWOContact_.value (1).toDateTime (),
+					FtsSearcherWOContact_.value (0).toLongLong ());
+		}
+
 		LogsSearcherWOContact_.bindValue (":account_id", intAccId);
 		LogsSearcherWOContact_.bindValue (":inner_account_id", intAccId);
-		LogsSearcherWOContact_.bindValue (":text", '%' + text + '%');
-		LogsSearcherWOContact_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcherWOContact_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcherWOContact_.bindValue (":insensitive", static_cast<int> (!cs));
+		BindSearchText (LogsSearcherWOContact_, text, cs);
 		LogsSearcherWOContact_.bindValue (":offset", shift);
 		if (!LogsSearcherWOContact_.exec ())
 		{
@@ -572,10 +960,28 @@ namespace ChatHistory
 
 	Storage::RawSearchResult Storage::Search (const QString& text, int shift, bool cs)
 	{
-		LogsSearcherWOContactAccount_.bindValue (":text", '%' + text + '%');
-		LogsSearcherWOContactAccount_.bindValue (":ctext", '*' + text + '*');
-		LogsSearcherWOContactAccount_.bindValue (":sensitive", static_cast<int> (cs));
-		LogsSearcherWOContactAccount_.bindValue (":insensitive", static_cast<int> (!cs));
+		const auto& match = MakeFtsMatch (text);
+		if (IsFtsReady () && !match.isEmpty ())
+		{
+			FtsSearcherWOContactAccount_.bindValue (":match", match);
+			FtsSearcherWOContactAccount_.bindValue (":offset", shift);
+			BindSearchText (FtsSearcherWOContactAccount_, text, cs);
+			if (!FtsSearcherWOContactAccount_.exec ())
+			{
+				Util::DBLock::DumpError (FtsSearcherWOContactAccount_);
+				return RawSearchResult ();
+			}
+			auto guard = CleanupQueryGuard (FtsSearcherWOContactAccount_);
+
+			if (!FtsSearcherWOContactAccount_.next ())
+				return RawSearchResult ();
+
+			return RawSearchResult (FtsSearcherWOContactAccount_.value (2).toInt (),
+					FtsSearcherWOContactAccount_.value (3).toInt (),
+					FtsSearcherWOContactAccount_.value (1).toDateTime (),
+					FtsSearcherWOContactAccount_.value (0).toLongLong ());
+		}
+
 		LogsSearcherWOContactAccount_.bindValue (":offset", shift);
 		if (!LogsSearcherWOContactAccount_.exec ())
 		{
@@ -621,8 +1027,34 @@ namespace ChatHistory
 		emit gotSearchPosition (Accounts_.key (accountId), Users_.key (entryId), index);
 	}
 
+	void Storage::SearchRowid (qint32 accountId, qint32 entryId, qint64 rowid)
+	{
+		Rowid2Pos_.bindValue (":rowid", rowid);
+		Rowid2Pos_.bindValue (":account_id", accountId);
+		Rowid2Pos_.bindValue (":entry_id", entryId);
+		if (!Rowid2Pos_.exec ())
+		{
+			Util::DBLock::DumpError (Rowid2Pos_);
+			return;
+		}
+
+		if (!Rowid2Pos_.next ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to navigate to next record";
+			return;
+		}
+
+		const int index = Rowid2Pos_.value (0).toInt ();
+		Rowid2Pos_.finish ();
+
+		emit gotSearchPosition (Accounts_.key (accountId), Users_.key (entryId), index);
+	}
+
 	void Storage::regenUsersCache ()
 	{
+		flushPending ();
+
 		QSqlQuery query (*DB_);
 		if (!query.exec ("DELETE FROM azoth_acc2users2;") ||
 			!query.exec ("INSERT INTO azoth_acc2users2 (AccountId, UserId) SELECT DISTINCT AccountId, Id FROM azoth_history;"))
@@ -632,52 +1064,31 @@ namespace ChatHistory
 		}
 	}
 
-	void Storage::addMessage (const QVariantMap& data)
+	bool Storage::StoreMessage (const QVariantMap& data)
 	{
-		Util::DBLock lock (*DB_);
-		try
-		{
-			lock.Init ();
-		}
-		catch (const std::exception& e)
-		{
-			qWarning () << Q_FUNC_INFO
-					<< "unable to start transaction:"
-					<< e.what ();
-			return;
-		}
-
 		const QString& accountID = data ["AccountID"].toString ();
 		if (!Accounts_.contains (accountID))
 		{
-			try
-			{
-				AddAccount (accountID);
-			}
-			catch (const std::exception& e)
+			AddAccount (accountID);
+			if (!Accounts_.contains (accountID))
 			{
 				qWarning () << Q_FUNC_INFO
 						<< accountID
-						<< "unable to add account ID to the DB:"
-						<< e.what ();
-				return;
+						<< "unable to add account ID to the DB";
+				return false;
 			}
 		}
 
 		const QString& entryID = data ["EntryID"].toString ();
 		if (!Users_.contains (entryID))
 		{
-			try
-			{
-				AddUser (entryID, accountID);
-			}
-			catch (const std::exception& e)
+			AddUser (entryID, accountID);
+			if (!Users_.contains (entryID))
 			{
 				qWarning () << Q_FUNC_INFO
 						<< entryID
-						<< "unable to add the user to the DB:"
-						<< e.what ();
-				return;
+						<< "unable to add the user to the DB";
+				return false;
 			}
 		}
 
@@ -723,19 +1134,153 @@ namespace ChatHistory
 		if (!MessageDumper_.exec ())
 		{
 			Util::DBLock::DumpError (MessageDumper_);
-			return;
+			return false;
 		}
 
+		return true;
+	}
+
+	void Storage::UpdateLoggingStats (int count, qint64 dbTime)
+	{
+		StatsMessages_ += count;
+		++StatsBatches_;
+		StatsDBTime_ += dbTime;
+
+		const auto elapsed = StatsTimer_.elapsed ();
+		if (elapsed < StatsInterval)
+			return;
+
+		qDebug () << Q_FUNC_INFO
+				<< "logged"
+				<< StatsMessages_
+				<< "messages in"
+				<< StatsBatches_
+				<< "batches:"
+				<< StatsMessages_ * 1000.0 / elapsed
+				<< "messages/sec sustained,"
+				<< (StatsDBTime_ ? StatsMessages_ * 1000.0 / StatsDBTime_ : 0)
+				<< "messages/sec while writing";
+
+		StatsMessages_ = 0;
+		StatsBatches_ = 0;
+		StatsDBTime_ = 0;
+		StatsTimer_.restart ();
+	}
+
+	void Storage::addMessage (const QVariantMap& data)
+	{
+		PendingMessages_ << data;
+
+		if (PendingMessages_.size () >= MaxPendingMessages)
+			flushPending ();
+		else if (!FlushTimer_->isActive ())
+			FlushTimer_->start ();
+	}
+
+	bool Storage::StoreBatch (const QList<QVariantMap>& batch,
+			QSet<QPair<QString, QString>>& changed)
+	{
+		/* StoreMessage() may add new accounts and users both to the
+		 * database and to these caches, so they are restored if the
+		 * transaction is rolled back.
+		 */
+		const auto accounts = Accounts_;
+		const auto users = Users_;
+		const auto entryCache = EntryCache_;
+
+		Util::DBLock lock (*DB_);
+		lock.Init ();
+
+		for (const auto& data : batch)
+			if (!StoreMessage (data))
+			{
+				Accounts_ = accounts;
+				Users_ = users;
+				EntryCache_ = entryCache;
+				return false;
+			}
+
 		lock.Good ();
+
+		for (const auto& data : batch)
+		{
+			const auto& accountId = data ["AccountID"].toString ();
+			const auto& entryId = data ["EntryID"].toString ();
+			changed << qMakePair (accountId, entryId);
+
+			const auto& conv = qMakePair (Users_.value (entryId), Accounts_.value (accountId));
+			if (conv == CachedConversation_)
+				PagesCache_.clear ();
+		}
+
+		return true;
+	}
+
+	void Storage::flushPending ()
+	{
+		FlushTimer_->stop ();
+
+		// Flushed again by handleDateIndexCreated().
+		if (PendingMessages_.isEmpty () || DateIndexWatcher_)
+			return;
+
+		QElapsedTimer timer;
+		timer.start ();
+
+		int stored = 0;
+		QSet<QPair<QString, QString>> changed;
+		try
+		{
+			if (StoreBatch (PendingMessages_, changed))
+			{
+				stored = PendingMessages_.size ();
+				PendingMessages_.clear ();
+			}
+			else
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "rolled back a batch of"
+						<< PendingMessages_.size ()
+						<< "messages, storing them one by one";
+
+				while (!PendingMessages_.isEmpty ())
+				{
+					if (StoreBatch ({ PendingMessages_.first () }, changed))
+						++stored;
+					else
+						qWarning () << Q_FUNC_INFO
+								<< "dropping a message that cannot be stored";
+
+					PendingMessages_.removeFirst ();
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to start transaction:"
+					<< e.what ();
+			FlushTimer_->start ();
+		}
+
+		if (stored)
+			UpdateLoggingStats (stored, timer.elapsed ());
+
+		for (const auto& pair : changed)
+			emit historyChanged (pair.first, pair.second);
 	}
 
 	void Storage::getOurAccounts ()
 	{
+		flushPending ();
+
 		emit gotOurAccounts (Accounts_.keys ());
 	}
 
 	void Storage::getUsersForAccount (const QString& accountId)
 	{
+		flushPending ();
+
 		if (!Accounts_.contains (accountId))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -768,6 +1313,8 @@ namespace ChatHistory
 	void Storage::getChatLogs (const QString& accountId,
 			const QString& entryId, int backpages, int amount)
 	{
+		flushPending ();
+
 		if (!Accounts_.contains (accountId))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -787,37 +1334,215 @@ namespace ChatHistory
 			return;
 		}
 
-		HistoryGetter_.bindValue (":entry_id", Users_ [entryId]);
-		HistoryGetter_.bindValue (":account_id", Accounts_ [accountId]);
-		HistoryGetter_.bindValue (":limit", amount);
-		HistoryGetter_.bindValue (":offset", amount * backpages);
+		const qint32 intEntryId = Users_ [entryId];
+		const qint32 intAccId = Accounts_ [accountId];
 
-		if (!HistoryGetter_.exec ())
+		const auto& conv = qMakePair (intEntryId, intAccId);
+		if (conv != CachedConversation_)
 		{
-			Util::DBLock::DumpError (HistoryGetter_);
-			return;
+			PagesCache_.clear ();
+			CachedConversation_ = conv;
 		}
 
-		QList<QVariant> result;
-		while (HistoryGetter_.next ())
+		const auto& key = qMakePair (amount, backpages);
+		if (!PagesCache_.contains (key))
 		{
+			auto page = new HistoryPage;
+			if (!FetchPage (intEntryId, intAccId, backpages, amount, *page))
+			{
+				delete page;
+				return;
+			}
+			PagesCache_.insert (key, page);
+		}
+
+		emit gotChatLogs (accountId, entryId, backpages, amount, PagesCache_ [key]->Messages_);
+
+		QMetaObject::invokeMethod (this,
+				"prefetchPages",
+				Qt::QueuedConnection,
+				Q_ARG (int, intEntryId),
+				Q_ARG (int, intAccId),
+				Q_ARG (int, backpages),
+				Q_ARG (int, amount));
+	}
+
+	qint64 Storage::GetPageAnchor (qint32 entryId, qint32 accountId, int page, int amount)
+	{
+		/* Page numbers are positional, so the messages before the page
+		 * have to be counted anyway, but they are counted from the
+		 * nearest cached page of the conversation instead of its newest
+		 * message whenever that's closer.
+		 */
+		QSqlQuery *getter = &PageAnchorGetter_;
+		qint64 rowid = 0;
+		int offset = page * amount;
+		for (const auto& key : PagesCache_.keys ())
+		{
+			if (key.first != amount || key.second == page)
+				continue;
+
+			const auto cached = PagesCache_.object (key);
+			if (cached->Messages_.isEmpty ())
+				continue;
+
+			if (key.second < page)
+			{
+				if (cached->Messages_.size () < amount)
+					return 0;
+
+				const auto distance = (page - key.second - 1) * amount;
+				if (distance < offset)
+				{
+					getter = &PageAnchorOlderGetter_;
+					rowid = cached->Oldest_;
+					offset = distance;
+				}
+			}
+			else
+			{
+				const auto distance = (key.second - page) * amount - 1;
+				if (distance < offset)
+				{
+					getter = &PageAnchorNewerGetter_;
+					rowid = cached->Newest_;
+					offset = distance;
+				}
+			}
+		}
+
+		getter->bindValue (":entry_id", entryId);
+		getter->bindValue (":account_id", accountId);
+		getter->bindValue (":offset", offset);
+		if (getter != &PageAnchorGetter_)
+			getter->bindValue (":rowid", rowid);
+		if (!getter->exec ())
+		{
+			Util::DBLock::DumpError (*getter);
+			return -1;
+		}
+
+		const qint64 anchor = getter->next () ?
+				getter->value (0).toLongLong () :
+				0;
+		getter->finish ();
+		return anchor;
+	}
+
+	bool Storage::FetchPage (qint32 entryId, qint32 accountId,
+			int page, int amount, HistoryPage& result)
+	{
+		result.Newest_ = 0;
+		result.Oldest_ = 0;
+
+		/* Pages are located by the rowids of their neighbours whenever
+		 * those are known, so paging back and forth through a long
+		 * conversation doesn't make SQLite skip over all the newer
+		 * messages with OFFSET. Otherwise the first rowid of the page is
+		 * looked up in the (Id, AccountId) index without touching the
+		 * rows themselves, starting from the nearest cached page.
+		 */
+		QSqlQuery *getter = &HistoryGetter_;
+		qint64 rowid = 0;
+		if (const auto newer = PagesCache_.object ({ amount, page - 1 }))
+		{
+			if (newer->Messages_.size () < amount)
+				return true;
+
+			rowid = newer->Oldest_ - 1;
+		}
+		else if (const auto older = PagesCache_.object ({ amount, page + 1 }))
+		{
+			if (!older->Messages_.isEmpty ())
+			{
+				getter = &HistoryNewerGetter_;
+				rowid = older->Newest_ + 1;
+			}
+		}
+
+		if (!rowid)
+		{
+			rowid = GetPageAnchor (entryId, accountId, page, amount);
+			if (rowid < 0)
+				return false;
+			if (!rowid)
+				return true;
+		}
+
+		getter->bindValue (":entry_id", entryId);
+		getter->bindValue (":account_id", accountId);
+		getter->bindValue (":rowid", rowid);
+		getter->bindValue (":limit", amount);
+		if (!getter->exec ())
+		{
+			Util::DBLock::DumpError (*getter);
+			return false;
+		}
+
+		const bool descending = getter == &HistoryGetter_;
+		while (getter->next ())
+		{
+			const qint64 id = getter->value (0).toLongLong ();
+			if (!result.Newest_ || id > result.Newest_)
+				result.Newest_ = id;
+			if (!result.Oldest_ || id < result.Oldest_)
+				result.Oldest_ = id;
+
 			QVariantMap map;
-			map ["Date"] = HistoryGetter_.value (0);
-			map ["Direction"] = HistoryGetter_.value (1);
-			map ["Message"] = HistoryGetter_.value (2);
-			map ["Variant"] = HistoryGetter_.value (3);
-			map ["Type"] = HistoryGetter_.value (4);
-			map ["RichMessage"] = HistoryGetter_.value (5);
-			map ["EscapePolicy"] = HistoryGetter_.value (6);
-			result.prepend (map);
+			map ["Date"] = getter->value (1);
+			map ["Direction"] = getter->value (2);
+			map ["Message"] = getter->value (3);
+			map ["Variant"] = getter->value (4);
+			map ["Type"] = getter->value (5);
+			map ["RichMessage"] = getter->value (6);
+			map ["EscapePolicy"] = getter->value (7);
+
+			if (descending)
+				result.Messages_.prepend (map);
+			else
+				result.Messages_.append (map);
 		}
+		getter->finish ();
+
+		return true;
+	}
 
-		emit gotChatLogs (accountId, entryId, backpages, amount, result);
+	void Storage::prefetchPages (int entryId, int accountId, int page, int amount)
+	{
+		if (qMakePair (entryId, accountId) != CachedConversation_)
+			return;
+
+		const auto current = PagesCache_.object ({ amount, page });
+		if (!current)
+			return;
+
+		QList<int> pages;
+		if (current->Messages_.size () == amount)
+			pages << page + 1;
+		if (page > 0)
+			pages << page - 1;
+
+		for (const auto prefetched : pages)
+		{
+			const auto& key = qMakePair (amount, prefetched);
+			if (PagesCache_.contains (key))
+				continue;
+
+			auto historyPage = new HistoryPage;
+			if (!FetchPage (entryId, accountId, prefetched, amount, *historyPage))
+			{
+				delete historyPage;
+				return;
+			}
+			PagesCache_.insert (key, historyPage);
+		}
 	}
 
 	void Storage::search (const QString& accountId,
 			const QString& entryId, const QString& text, int shift, bool cs)
 	{
+		flushPending ();
+
 		RawSearchResult res;
 		if (!accountId.isEmpty () && !entryId.isEmpty ())
 			res = Search (accountId, entryId, text, shift, cs);
@@ -835,11 +1560,101 @@ namespace ChatHistory
 		if (res.IsEmpty ())
 			return;
 
-		SearchDate (res.AccountID_, res.EntryID_, res.Date_);
+		if (res.Rowid_)
+			SearchRowid (res.AccountID_, res.EntryID_, res.Rowid_);
+		else
+			SearchDate (res.AccountID_, res.EntryID_, res.Date_);
+	}
+
+	void Storage::searchAll (const QString& accountId,
+			const QString& entryId, const QString& text, bool cs)
+	{
+		flushPending ();
+
+		if (!Accounts_.contains (accountId))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "Accounts_ doesn't contain"
+					<< accountId
+					<< "; raw contents"
+					<< Accounts_;
+			return;
+		}
+		if (!Users_.contains (entryId))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "Users_ doesn't contain"
+					<< entryId
+					<< "; raw contents"
+					<< Users_;
+			return;
+		}
+
+		const qint32 intEntryId = Users_ [entryId];
+		const qint32 intAccId = Accounts_ [accountId];
+
+		const auto& match = MakeFtsMatch (text);
+		const bool useFts = IsFtsReady () && !match.isEmpty ();
+
+		auto collectRowids = [&] (QSqlQuery& searcher, QList<qint64>& rowids) -> bool
+		{
+			if (&searcher == &FtsAllSearcher_)
+				searcher.bindValue (":match", match);
+			searcher.bindValue (":entry_id", intEntryId);
+			searcher.bindValue (":account_id", intAccId);
+			BindSearchText (searcher, text, cs);
+			if (!searcher.exec ())
+			{
+				Util::DBLock::DumpError (searcher);
+				return false;
+			}
+
+			while (searcher.next ())
+				rowids << searcher.value (0).toLongLong ();
+			searcher.finish ();
+			return true;
+		};
+
+		QList<qint64> rowids;
+		if (!collectRowids (useFts ? FtsAllSearcher_ : AllSearcher_, rowids))
+			return;
+
+		QList<int> positions;
+		if (!rowids.isEmpty ())
+		{
+			/* Both lists are sorted by descending rowid, so a single pass
+			 * over the (Id, AccountId) index is enough to turn every found
+			 * rowid into its position counted from the most recent message.
+			 */
+			EntryRowidsGetter_.bindValue (":entry_id", intEntryId);
+			EntryRowidsGetter_.bindValue (":account_id", intAccId);
+			if (!EntryRowidsGetter_.exec ())
+			{
+				Util::DBLock::DumpError (EntryRowidsGetter_);
+				return;
+			}
+
+			auto rowidPos = rowids.begin ();
+			int position = 0;
+			while (rowidPos != rowids.end () && EntryRowidsGetter_.next ())
+			{
+				++position;
+				if (EntryRowidsGetter_.value (0).toLongLong () != *rowidPos)
+					continue;
+
+				positions << position;
+				++rowidPos;
+			}
+			EntryRowidsGetter_.finish ();
+		}
+
+		emit gotAllSearchPositions (accountId, entryId, text, positions);
 	}
 
 	void Storage::searchDate (const QString& account, const QString& entry, const QDateTime& dt)
 	{
+		flushPending ();
+
 		if (!Accounts_.contains (account))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -866,6 +1681,8 @@ namespace ChatHistory
 
 	void Storage::getDaysForSheet (const QString& account, const QString& entry, int year, int month)
 	{
+		flushPending ();
+
 		if (!Accounts_.contains (account))
 		{
 			qWarning () << Q_FUNC_INFO
@@ -914,6 +1731,8 @@ namespace ChatHistory
 
 	void Storage::clearHistory (const QString& accountId, const QString& entryId)
 	{
+		flushPending ();
+
 		if (!Accounts_.contains (accountId) ||
 				!Users_.contains (entryId))
 		{
@@ -927,6 +1746,8 @@ namespace ChatHistory
 		Util::DBLock lock (*DB_);
 		lock.Init ();
 
+		PagesCache_.clear ();
+
 		const auto userId = Users_.take (entryId);
 		HistoryClearer_.bindValue (":entry_id", userId);
 		HistoryClearer_.bindValue (":account_id", Accounts_ [accountId]);
@@ -943,6 +1764,8 @@ namespace ChatHistory
 			Util::DBLock::DumpError (UserClearer_);
 
 		lock.Good ();
+
+		emit historyChanged (accountId, entryId);
 	}
 }
 }
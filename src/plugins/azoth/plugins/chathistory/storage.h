@@ -32,10 +32,15 @@
 #include <memory>
 #include <QSqlQuery>
 #include <QHash>
+#include <QSet>
+#include <QCache>
 #include <QVariant>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
 
 class QSqlDatabase;
+class QTimer;
 
 namespace LeechCraft
 {
@@ -52,8 +57,6 @@ namespace ChatHistory
 		std::shared_ptr<QSqlDatabase> DB_;
 		QSqlQuery UserSelector_;
 		QSqlQuery AccountSelector_;
-		QSqlQuery UserIDSelector_;
-		QSqlQuery AccountIDSelector_;
 		QSqlQuery UserInserter_;
 		QSqlQuery AccountInserter_;
 		QSqlQuery MessageDumper_;
@@ -63,7 +66,18 @@ namespace ChatHistory
 		QSqlQuery LogsSearcher_;
 		QSqlQuery LogsSearcherWOContact_;
 		QSqlQuery LogsSearcherWOContactAccount_;
+		QSqlQuery AllSearcher_;
+		QSqlQuery FtsSearcher_;
+		QSqlQuery FtsSearcherWOContact_;
+		QSqlQuery FtsSearcherWOContactAccount_;
+		QSqlQuery FtsAllSearcher_;
+		QSqlQuery Rowid2Pos_;
+		QSqlQuery EntryRowidsGetter_;
 		QSqlQuery HistoryGetter_;
+		QSqlQuery HistoryNewerGetter_;
+		QSqlQuery PageAnchorGetter_;
+		QSqlQuery PageAnchorOlderGetter_;
+		QSqlQuery PageAnchorNewerGetter_;
 		QSqlQuery HistoryClearer_;
 		QSqlQuery UserClearer_;
 		QSqlQuery EntryCacheSetter_;
@@ -75,58 +89,132 @@ namespace ChatHistory
 
 		QHash<qint32, QString> EntryCache_;
 
+		struct HistoryPage
+		{
+			QList<QVariant> Messages_;
+			qint64 Newest_;
+			qint64 Oldest_;
+		};
+
+		/** Pages of the conversation that has been requested last,
+		 * keyed by the (amount, page number) pair.
+		 */
+		QCache<QPair<int, int>, HistoryPage> PagesCache_;
+		QPair<qint32, qint32> CachedConversation_;
+
+		QList<QVariantMap> PendingMessages_;
+		QTimer *FlushTimer_;
+
+		qint64 StatsMessages_;
+		qint64 StatsBatches_;
+		qint64 StatsDBTime_;
+		QElapsedTimer StatsTimer_;
+
+		bool FtsAvailable_;
+		qint64 FtsBoundary_;
+		qint64 FtsIndexed_;
+
+		/** Watches the date index being built on a separate
+		 * connection, null if it isn't being built right now.
+		 */
+		QFutureWatcher<bool> *DateIndexWatcher_;
+
 		struct RawSearchResult
 		{
 			qint32 EntryID_;
 			qint32 AccountID_;
 			QDateTime Date_;
+			qint64 Rowid_;
 
 			RawSearchResult ();
-			RawSearchResult (qint32 entryId, qint32 accountId, const QDateTime& date);
+			RawSearchResult (qint32 entryId, qint32 accountId,
+					const QDateTime& date, qint64 rowid = 0);
 
 			bool IsEmpty () const;
 		};
 	public:
 		Storage (QObject* = 0);
+		~Storage ();
 	private:
 		void InitializeTables ();
 		void UpdateTables ();
+		void InitializeFts ();
+		bool IsFtsReady () const;
+		bool HasIndex (const QString&) const;
 
 		QHash<QString, qint32> GetUsers ();
-		qint32 GetUserID (const QString&);
 		void AddUser (const QString& id, const QString& accountId);
 
 		void PrepareEntryCache ();
 
+		bool StoreMessage (const QVariantMap&);
+
+		/** Stores the messages in a single transaction, which is rolled
+		 * back if any of them fails to be stored.
+		 *
+		 * Throws if the transaction cannot be started.
+		 */
+		bool StoreBatch (const QList<QVariantMap>&, QSet<QPair<QString, QString>>& changed);
+
+		qint64 GetPageAnchor (qint32 entryId, qint32 accountId, int page, int amount);
+		bool FetchPage (qint32 entryId, qint32 accountId, int page, int amount, HistoryPage& result);
+		void UpdateLoggingStats (int count, qint64 dbTime);
+
 		QHash<QString, qint32> GetAccounts ();
-		qint32 GetAccountID (const QString&);
 		void AddAccount (const QString& id);
 		RawSearchResult Search (const QString& accountId, const QString& entryId,
 				const QString& text, int shift, bool cs);
 		RawSearchResult Search (const QString& accountId, const QString& text, int shift, bool cs);
 		RawSearchResult Search (const QString& text, int shift, bool cs);
 		void SearchDate (qint32, qint32, const QDateTime&);
+		void SearchRowid (qint32, qint32, qint64);
 	public slots:
 		void regenUsersCache ();
 
 		void addMessage (const QVariantMap&);
+		void flushPending ();
 		void getOurAccounts ();
 		void getUsersForAccount (const QString&);
 		void getChatLogs (const QString& accountId,
 				const QString& entryId, int backpages, int amount);
+		/** Finds the message containing the text, skipping shift newer
+		 * matching messages.
+		 *
+		 * Once the full-text index is ready, only the messages where
+		 * every word of the text starts a word of the message are found,
+		 * same as in searchAll().
+		 */
 		void search (const QString& accountId, const QString& entryId,
 				const QString& text, int shift, bool cs);
+		void searchAll (const QString& accountId, const QString& entryId,
+				const QString& text, bool cs);
 		void searchDate (const QString& accountId, const QString& entryId, const QDateTime& dt);
 		void getDaysForSheet (const QString& accountId, const QString& entryId, int year, int month);
 		void clearHistory (const QString& accountId, const QString& entryId);
+	private slots:
+		void indexHistoryChunk ();
+		void createDateIndex ();
+		void handleDateIndexCreated ();
+		void prefetchPages (int entryId, int accountId, int page, int amount);
 	signals:
 		void gotOurAccounts (const QStringList&);
 		void gotUsersForAccount (const QStringList&, const QString&, const QStringList&);
 		void gotChatLogs (const QString&, const QString&,
 				int, int, const QVariant&);
 		void gotSearchPosition (const QString&, const QString&, int);
+
+		/** Positions are in the same format as in gotSearchPosition(),
+		 * sorted from the most recent message to the oldest one.
+		 */
+		void gotAllSearchPositions (const QString& accountId, const QString& entryId,
+				const QString& text, const QList<int>& positions);
 		void gotDaysForSheet (const QString& accountId, const QString& entryId,
 				int year, int month, const QList<int>& days);
+
+		/** Emitted when messages are added to or removed from the history
+		 * with the given entry, invalidating the search positions.
+		 */
+		void historyChanged (const QString& accountId, const QString& entryId);
 	};
 }
 }
@@ -82,11 +82,21 @@ namespace ChatHistory
 				Core::Instance ().get (),
 				SIGNAL (gotSearchPosition (const QString&, const QString&, int)),
 				Qt::QueuedConnection);
+		connect (Storage_.get (),
+				SIGNAL (gotAllSearchPositions (QString, QString, QString, QList<int>)),
+				Core::Instance ().get (),
+				SIGNAL (gotAllSearchPositions (QString, QString, QString, QList<int>)),
+				Qt::QueuedConnection);
 		connect (Storage_.get (),
 				SIGNAL (gotDaysForSheet (QString, QString, int, int, QList<int>)),
 				Core::Instance ().get (),
 				SIGNAL (gotDaysForSheet (QString, QString, int, int, QList<int>)),
 				Qt::QueuedConnection);
+		connect (Storage_.get (),
+				SIGNAL (historyChanged (QString, QString)),
+				Core::Instance ().get (),
+				SIGNAL (historyChanged (QString, QString)),
+				Qt::QueuedConnection);
 	}
 }
 }
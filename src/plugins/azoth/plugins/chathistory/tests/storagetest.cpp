@@ -0,0 +1,177 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "storagetest.h"
+#include <QtTest>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <interfaces/azoth/imessage.h>
+#include "storage.h"
+
+QTEST_MAIN (LeechCraft::Azoth::ChatHistory::StorageTest)
+
+namespace LeechCraft
+{
+namespace Azoth
+{
+namespace ChatHistory
+{
+	namespace
+	{
+		const QString TestConnection = "StorageTest connection";
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		QVariantMap MakeMessage (const QString& entryId, int num, const QString& body)
+		{
+			QVariantMap data;
+			data ["AccountID"] = "account@test";
+			data ["EntryID"] = entryId;
+			data ["VisibleName"] = entryId;
+			data ["DateTime"] = QDateTime (QDate (2014, 1, 1)).addSecs (num);
+			data ["Direction"] = num % 2 ? "IN" : "OUT";
+			data ["Body"] = body;
+			data ["OtherVariant"] = QString ();
+			data ["RichBody"] = QString ();
+			data ["EscapePolicy"] = "Esc";
+			data ["Type"] = static_cast<int> (IMessage::Type::ChatMessage);
+			return data;
+		}
+
+		int Count (const QString& queryStr, const QString& entryId)
+		{
+			QSqlQuery query { QSqlDatabase::database (TestConnection) };
+			query.prepare (queryStr);
+			query.bindValue (":entry_id", entryId);
+			if (!query.exec () || !query.next ())
+				return -1;
+			return query.value (0).toInt ();
+		}
+
+		int CountMessages (const QString& entryId)
+		{
+			return Count ("SELECT COUNT(1) FROM azoth_history "
+					"JOIN azoth_users ON azoth_history.Id = azoth_users.Id "
+					"WHERE azoth_users.EntryID = :entry_id;", entryId);
+		}
+
+		int CountAccountLinks (const QString& entryId)
+		{
+			return Count ("SELECT COUNT(1) FROM azoth_acc2users2 "
+					"JOIN azoth_users ON azoth_acc2users2.UserId = azoth_users.Id "
+					"WHERE azoth_users.EntryID = :entry_id;", entryId);
+		}
+	}
+
+	void StorageTest::initTestCase ()
+	{
+		TestHome_ = QDir::temp ().filePath (QString ("lc_azoth_chathistory_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		RemoveDir (TestHome_);
+		QVERIFY (QDir {}.mkpath (TestHome_));
+		qputenv ("HOME", QFile::encodeName (TestHome_));
+
+		Storage_.reset (new Storage);
+
+		auto db = QSqlDatabase::addDatabase ("QSQLITE", TestConnection);
+		db.setDatabaseName (QDir { TestHome_ }.filePath (".leechcraft/azoth/history.db"));
+		QVERIFY (db.open ());
+	}
+
+	void StorageTest::cleanupTestCase ()
+	{
+		Storage_.reset ();
+		QSqlDatabase::database (TestConnection).close ();
+		QSqlDatabase::removeDatabase (TestConnection);
+		RemoveDir (TestHome_);
+	}
+
+	void StorageTest::stressBatches ()
+	{
+		const int contacts = 100;
+		const int perContact = 1000;
+
+		QList<QVariantMap> messages;
+		for (int i = 0; i < perContact; ++i)
+			for (int c = 0; c < contacts; ++c)
+				messages << MakeMessage (QString ("stress%1@test").arg (c),
+						i, QString ("message %1 to %2").arg (i).arg (c));
+		QCOMPARE (messages.size (), 100000);
+
+		QBENCHMARK_ONCE
+		{
+			for (const auto& message : messages)
+				Storage_->addMessage (message);
+			Storage_->flushPending ();
+		}
+
+		for (int c = 0; c < contacts; ++c)
+			QCOMPARE (CountMessages (QString ("stress%1@test").arg (c)), perContact);
+	}
+
+	void StorageTest::failedMessageRollsBackBatch ()
+	{
+		QSqlQuery query { QSqlDatabase::database (TestConnection) };
+		QVERIFY (query.exec ("CREATE TRIGGER poison_message BEFORE INSERT ON azoth_history "
+					"WHEN new.Message = 'poison' "
+					"BEGIN SELECT RAISE(ABORT, 'poisoned message'); END;"));
+
+		/* The poisoned message comes first, so the contact it adds gets
+		 * rolled back along with it and has to be added again later.
+		 */
+		Storage_->addMessage (MakeMessage ("poisoned@test", 0, "poison"));
+		Storage_->addMessage (MakeMessage ("poisoned@test", 1, "first"));
+		for (int i = 0; i < 5; ++i)
+			Storage_->addMessage (MakeMessage ("fine@test", i, QString ("fine %1").arg (i)));
+		Storage_->addMessage (MakeMessage ("poisoned@test", 2, "second"));
+		Storage_->flushPending ();
+
+		QVERIFY (query.exec ("DROP TRIGGER poison_message;"));
+
+		QCOMPARE (CountMessages ("poisoned@test"), 2);
+		QCOMPARE (CountAccountLinks ("poisoned@test"), 1);
+		QCOMPARE (CountMessages ("fine@test"), 5);
+
+		Storage_->addMessage (MakeMessage ("poisoned@test", 3, "third"));
+		Storage_->flushPending ();
+		QCOMPARE (CountMessages ("poisoned@test"), 3);
+	}
+}
+}
+}
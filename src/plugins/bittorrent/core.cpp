@@ -56,6 +56,8 @@
 #include <QTextCodec>
 #include <QDataStream>
 #include <QDesktopServices>
+#include <QFutureWatcher>
+#include <QtConcurrentMap>
 
 #if QT_VERSION >= 0x050000
 #include <QUrlQuery>
@@ -88,6 +90,9 @@
 #include "peersmodel.h"
 #include "torrentfilesmodel.h"
 #include "livestreammanager.h"
+#include "resumedatasaver.h"
+#include "settingsarray.h"
+#include "statuscolumns.h"
 #include "torrentmaker.h"
 #include "notifymanager.h"
 #include "sessionsettingsmanager.h"
@@ -131,7 +136,9 @@ namespace BitTorrent
 	, CurrentTorrent_ (-1)
 	, FinishedTimer_ (new QTimer ())
 	, WarningWatchdog_ (new QTimer ())
+	, RestoreStallTimer_ (new QTimer ())
 	, LiveStreamManager_ (new LiveStreamManager ())
+	, ResumeDataSaver_ (new ResumeDataSaver (QDir::homePath () + "/.leechcraft/bittorrent"))
 	, SaveScheduled_ (false)
 	, Toolbar_ (0)
 	, TabWidget_ (0)
@@ -146,6 +153,10 @@ namespace BitTorrent
 				SIGNAL (gotEntity (const LeechCraft::Entity&)),
 				this,
 				SIGNAL (gotEntity (const LeechCraft::Entity&)));
+		connect (LiveStreamManager_.get (),
+				SIGNAL (alertsRequested ()),
+				this,
+				SLOT (queryLibtorrentForWarnings ()));
 	}
 
 	void Core::SetWidgets (QToolBar *tool, QWidget *tab)
@@ -253,6 +264,13 @@ namespace BitTorrent
 				SLOT (queryLibtorrentForWarnings ()));
 		WarningWatchdog_->start (2000);
 
+		RestoreStallTimer_->setSingleShot (true);
+		RestoreStallTimer_->setInterval (30 * 1000);
+		connect (RestoreStallTimer_.get (),
+				SIGNAL (timeout ()),
+				this,
+				SLOT (handleRestoreStalled ()));
+
 		connect (SessionSettingsMgr_,
 				SIGNAL (scrapeRequested ()),
 				this,
@@ -267,8 +285,15 @@ namespace BitTorrent
 
 	void Core::Release ()
 	{
+		if (RestoreWatcher_)
+		{
+			RestoreWatcher_->cancel ();
+			RestoreWatcher_->waitForFinished ();
+		}
+
 		Session_->pause ();
 		writeSettings ();
+		ResumeDataSaver_->Finish ();
 
 		FinishedTimer_.reset ();
 		WarningWatchdog_.reset ();
@@ -499,7 +524,7 @@ namespace BitTorrent
 			return QVariant ();
 
 		const auto& h = Handles_.at (row).Handle_;
-		const auto& status = GetCachedStatus (h);
+		const auto& status = GetCachedStatus (row);
 
 		switch (role)
 		{
@@ -978,8 +1003,11 @@ namespace BitTorrent
 
 		beginInsertRows ({}, Handles_.size (), Handles_.size ());
 		Handles_ << tmp;
+		IndexRow (Handles_.size () - 1);
 		endInsertRows ();
 
+		MarkTorrentsListDirty ();
+
 		return tmp.ID_;
 	}
 
@@ -1058,6 +1086,7 @@ namespace BitTorrent
 				newId,
 				params
 			});
+		IndexRow (Handles_.size () - 1);
 		endInsertRows ();
 
 		if (tryLive)
@@ -1066,7 +1095,7 @@ namespace BitTorrent
 			handle.resume ();
 		}
 
-		ScheduleSave ();
+		MarkTorrentsListDirty ();
 		return newId;
 	}
 
@@ -1075,7 +1104,7 @@ namespace BitTorrent
 		for (int i = 0, size = Handles_.size (); i != size; ++i)
 			if (Handles_.at (i).ID_ == id)
 			{
-				RemoveTorrent (id);
+				RemoveTorrent (i);
 				return;
 			}
 		qWarning () << Q_FUNC_INFO
@@ -1093,10 +1122,11 @@ namespace BitTorrent
 		Session_->remove_torrent (Handles_.at (pos).Handle_, roptions);
 		int id = Handles_.at (pos).ID_;
 		Handles_.removeAt (pos);
+		RebuildRowsIndex ();
 		Proxy_->FreeID (id);
 		endRemoveRows ();
 
-		ScheduleSave ();
+		MarkTorrentsListDirty ();
 		emit taskRemoved (id);
 	}
 
@@ -1241,6 +1271,7 @@ namespace BitTorrent
 		{
 			Handles_ [idx].FilePriorities_.at (file) = priority;
 			Handles_.at (idx).Handle_.prioritize_files (Handles_.at (idx).FilePriorities_);
+			MarkTorrentDirty (idx);
 		}
 		catch (...)
 		{
@@ -1320,7 +1351,7 @@ namespace BitTorrent
 		if (!CheckValidity (idx))
 			return false;
 
-		return GetCachedStatus (Handles_.at (idx).Handle_).auto_managed;
+		return GetCachedStatus (idx).auto_managed;
 	};
 
 	void Core::SetTorrentManaged (bool man, int idx)
@@ -1330,6 +1361,7 @@ namespace BitTorrent
 
 		Handles_.at (idx).Handle_.auto_managed (man);
 		Handles_ [idx].AutoManaged_ = man;
+		MarkTorrentDirty (idx);
 	}
 
 	bool Core::IsTorrentSequentialDownload (int idx) const
@@ -1337,7 +1369,7 @@ namespace BitTorrent
 		if (!CheckValidity (idx))
 			return false;
 
-		return GetCachedStatus (Handles_.at (idx).Handle_).sequential_download;
+		return GetCachedStatus (idx).sequential_download;
 	}
 
 	void Core::SetTorrentSequentialDownload (bool seq, int idx)
@@ -1353,7 +1385,7 @@ namespace BitTorrent
 		if (!CheckValidity (idx))
 			return false;
 
-		return GetCachedStatus (Handles_.at (idx).Handle_).super_seeding;
+		return GetCachedStatus (idx).super_seeding;
 	}
 
 	void Core::SetTorrentSuperSeeding (bool sup, int idx)
@@ -1390,12 +1422,14 @@ namespace BitTorrent
 					0);
 		Session_->set_ip_filter (filter);
 
+		IPFilterDirty_ = true;
 		ScheduleSave ();
 	}
 
 	void Core::ClearFilter ()
 	{
 		Session_->set_ip_filter (libtorrent::ip_filter ());
+		IPFilterDirty_ = true;
 		ScheduleSave ();
 	}
 
@@ -1444,24 +1478,10 @@ namespace BitTorrent
 			return;
 		}
 
-		QFile file (QDir::homePath () +
-				"/.leechcraft/bittorrent/" +
-				torrent->TorrentFileName_ +
-				".resume");
-
-		if (!file.open (QIODevice::WriteOnly))
-		{
-			qWarning () << QString ("Could not open file %1 for write: %2")
-				.arg (file.fileName ())
-				.arg (file.errorString ());
-			return;
-		}
-
-		std::deque<char> outbuf;
+		QByteArray outbuf;
 		libtorrent::bencode (std::back_inserter (outbuf), *a.resume_data.get ());
 
-		for (size_t i = 0; i < outbuf.size (); ++i)
-			file.write (&outbuf.at (i), 1);
+		ResumeDataSaver_->Add (torrent->TorrentFileName_ + ".resume", outbuf);
 	}
 
 	void Core::HandleMetadata (const libtorrent::metadata_received_alert& a)
@@ -1488,6 +1508,8 @@ namespace BitTorrent
 		const auto& info = a.handle.get_torrent_info ();
 #endif
 		torrent->TorrentFileName_ = QString::fromUtf8 (info.name ().c_str ()) + ".torrent";
+		torrent->TorrentFileSaved_ = false;
+		torrent->SettingsDirty_ = true;
 		torrent->FilePriorities_.resize (info.num_files ());
 		std::fill (torrent->FilePriorities_.begin (),
 				torrent->FilePriorities_.end (), 1);
@@ -1505,6 +1527,19 @@ namespace BitTorrent
 		ScheduleSave ();
 	}
 
+	void Core::HandleStorageMoved (const libtorrent::storage_moved_alert& a)
+	{
+		const auto torrent = FindHandle (a.handle);
+		if (torrent == Handles_.end ())
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "this torrent doesn't exist anymore";
+			return;
+		}
+
+		MarkTorrentDirty (std::distance (Handles_.begin (), torrent));
+	}
+
 	void Core::PieceRead (const libtorrent::read_piece_alert& a)
 	{
 		LiveStreamManager_->PieceRead (a);
@@ -1512,12 +1547,11 @@ namespace BitTorrent
 
 	void Core::UpdateStatus (const std::vector<libtorrent::torrent_status>& statuses)
 	{
+		const int allColumns = (1 << columnCount ()) - 1;
+
 		for (const auto& status : statuses)
 		{
-			const auto handle = status.handle;
-			Handle2Status_ [handle] = status;
-
-			const auto pos = FindHandle (handle);
+			const auto pos = FindHandle (status.handle);
 			if (pos == Handles_.end ())
 			{
 				qWarning () << Q_FUNC_INFO
@@ -1525,8 +1559,23 @@ namespace BitTorrent
 				continue;
 			}
 
+			const auto mask = pos->Status_ ?
+					GetChangedColumns (*pos->Status_, status) :
+					allColumns;
+			pos->Status_ = status;
+
+			if (!mask)
+				continue;
+
+			int first = 0;
+			while (!(mask & (1 << first)))
+				++first;
+			int last = columnCount () - 1;
+			while (!(mask & (1 << last)))
+				--last;
+
 			const auto row = std::distance (Handles_.begin (), pos);
-			emit dataChanged (index (row, 0), index (row, columnCount () - 1));
+			emit dataChanged (index (row, first), index (row, last));
 		}
 	}
 
@@ -1564,10 +1613,14 @@ namespace BitTorrent
 			Handles_.at (*i).Handle_.queue_position_up ();
 			std::swap (Handles_ [*i],
 					Handles_ [*i - 1]);
+			IndexRow (*i - 1);
+			IndexRow (*i);
 
 			emit dataChanged (index (*i - 1, 0),
 					index (*i, columnCount () - 1));
 		}
+
+		MarkTorrentsListDirty ();
 	}
 
 	void Core::MoveDown (const std::vector<int>& selections)
@@ -1586,10 +1639,14 @@ namespace BitTorrent
 			Handles_.at (*i).Handle_.queue_position_down ();
 			std::swap (Handles_ [*i],
 					Handles_ [*i + 1]);
+			IndexRow (*i);
+			IndexRow (*i + 1);
 
 			emit dataChanged (index (*i, 0),
 					index (*i + 1, columnCount () - 1));
 		}
+
+		MarkTorrentsListDirty ();
 	}
 
 	void Core::MoveToTop (const std::vector<int>& selections)
@@ -1658,26 +1715,57 @@ namespace BitTorrent
 		return result;
 	}
 
+	namespace
+	{
+		QByteArray GetInfoHashKey (const libtorrent::sha1_hash& hash)
+		{
+			const auto& str = hash.to_string ();
+			return QByteArray (str.data (), str.size ());
+		}
+
+		QByteArray GetInfoHashKey (const libtorrent::torrent_handle& handle)
+		{
+			return GetInfoHashKey (handle.info_hash ());
+		}
+	}
+
 	auto Core::FindHandle (const libtorrent::torrent_handle& h) -> HandleDict_t::iterator
 	{
-		return std::find_if (Handles_.begin (), Handles_.end (),
-				[&h] (const TorrentStruct& ts) { return ts.Handle_ == h; });
+		const auto row = InfoHash2Row_.value (GetInfoHashKey (h), -1);
+		if (row < 0 || Handles_.at (row).Handle_ != h)
+			return Handles_.end ();
+
+		return Handles_.begin () + row;
 	}
 
 	auto Core::FindHandle (const libtorrent::torrent_handle& h) const -> HandleDict_t::const_iterator
 	{
-		return std::find_if (Handles_.begin (), Handles_.end (),
-				[&h] (const TorrentStruct& ts) { return ts.Handle_ == h; });
+		const auto row = InfoHash2Row_.value (GetInfoHashKey (h), -1);
+		if (row < 0 || Handles_.at (row).Handle_ != h)
+			return Handles_.end ();
+
+		return Handles_.begin () + row;
 	}
 
-	libtorrent::torrent_status Core::GetCachedStatus (const libtorrent::torrent_handle& handle) const
+	void Core::IndexRow (int row)
 	{
-		if (Handle2Status_.contains (handle))
-			return Handle2Status_ [handle];
+		InfoHash2Row_ [GetInfoHashKey (Handles_.at (row).Handle_)] = row;
+	}
 
-		const auto& status = handle.status (0);
-		Handle2Status_ [handle] = status;
-		return status;
+	void Core::RebuildRowsIndex ()
+	{
+		InfoHash2Row_.clear ();
+		InfoHash2Row_.reserve (Handles_.size ());
+		for (int i = 0, size = Handles_.size (); i < size; ++i)
+			IndexRow (i);
+	}
+
+	const libtorrent::torrent_status& Core::GetCachedStatus (int row) const
+	{
+		const auto& torrent = Handles_.at (row);
+		if (!torrent.Status_)
+			torrent.Status_ = torrent.Handle_.status (0);
+		return *torrent.Status_;
 	}
 
 	void Core::MoveToTop (int row)
@@ -1690,7 +1778,10 @@ namespace BitTorrent
 
 		beginInsertRows (QModelIndex (), 0, 0);
 		Handles_.push_front (tmp);
+		RebuildRowsIndex ();
 		endInsertRows ();
+
+		MarkTorrentsListDirty ();
 	}
 
 	void Core::MoveToBottom (int row)
@@ -1703,90 +1794,50 @@ namespace BitTorrent
 
 		beginInsertRows (QModelIndex (), Handles_.size (), Handles_.size ());
 		Handles_.push_back (tmp);
+		RebuildRowsIndex ();
 		endInsertRows ();
+
+		MarkTorrentsListDirty ();
 	}
 
 	void Core::RestoreTorrents ()
 	{
+		RestoreTimer_.start ();
+
+		const auto storageMode = GetCurrentStorageMode ();
+
 		QSettings settings (QCoreApplication::organizationName (),
 				QCoreApplication::applicationName () + "_Torrent");
 		settings.beginGroup ("Core");
 		int torrents = settings.beginReadArray ("AddedTorrents");
 		qDebug () << Q_FUNC_INFO << "gonna restore" << torrents << "torrents";
+
+		QList<RestoredTorrent> saved;
 		for (int i = 0; i < torrents; ++i)
 		{
 			settings.setArrayIndex (i);
-			const auto& pathStr = settings.value ("SavePath").toString ();
-			const auto& path = std::string (pathStr.toUtf8 ().constData ());
-			QString filename = settings.value ("Filename").toString ();
-			QFile torrent (QDir::homePath () + "/.leechcraft/bittorrent/" + filename);
-			if (!torrent.open (QIODevice::ReadOnly))
-			{
-				emit error (tr ("Could not open saved torrent %1 for read.").arg (filename));
-				continue;
-			}
-			QByteArray data = torrent.readAll ();
-			torrent.close ();
-			if (data.isEmpty ())
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "empty torrent data for"
-						<< filename;
-				continue;
-			}
-
-			QFile resumeDataFile (QDir::homePath () + "/.leechcraft/bittorrent/" +
-					filename + ".resume");
-			QByteArray resumed;
-			if (resumeDataFile.open (QIODevice::ReadOnly))
-			{
-				resumed = resumeDataFile.readAll ();
-				resumeDataFile.close ();
-			}
 
-			bool automanaged = settings.value ("AutoManaged", true).toBool ();
-			TaskParameters taskParameters = static_cast<TaskParameters> (settings
+			RestoredTorrent torrent;
+			torrent.Filename_ = settings.value ("Filename").toString ();
+			torrent.Tags_ = settings.value ("Tags").toStringList ();
+			torrent.AutoManaged_ = settings.value ("AutoManaged", true).toBool ();
+			torrent.Parameters_ = static_cast<TaskParameters> (settings
 						.value ("Parameters").toInt ());
 
-			auto handle = RestoreSingleTorrent (data,
-					resumed,
-					path,
-					automanaged,
-					taskParameters & NoAutostart);
-			if (!handle.is_valid ())
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "got invalid handle for"
-						<< filename;
-				continue;
-			}
-
-			std::vector<int> priorities;
-			QByteArray prioritiesLine = settings.value ("Priorities").toByteArray ();
+			const auto& prioritiesLine = settings.value ("Priorities").toByteArray ();
 			std::copy (prioritiesLine.begin (), prioritiesLine.end (),
-					std::back_inserter (priorities));
-
-			if (priorities.empty ())
-			{
-				priorities.resize (handle.get_torrent_info ().num_files ());
-				std::fill (priorities.begin (), priorities.end (), 1);
-			}
+					std::back_inserter (torrent.Priorities_));
 
-			handle.prioritize_files (priorities);
+			auto& atp = torrent.Params_;
+			atp.storage_mode = storageMode;
+			atp.save_path = std::string (settings.value ("SavePath").toString ().toUtf8 ().constData ());
+			if (!torrent.AutoManaged_)
+				atp.flags &= ~libtorrent::add_torrent_params::flag_auto_managed;
+			if (torrent.Parameters_ & NoAutostart)
+				atp.flags |= libtorrent::add_torrent_params::flag_paused;
+			atp.flags |= libtorrent::add_torrent_params::flag_duplicate_is_error;
 
-			beginInsertRows ({}, Handles_.size (), Handles_.size ());
-			Handles_.append ({
-					priorities,
-					handle,
-					data,
-					filename,
-					settings.value ("Tags").toStringList (),
-					automanaged,
-					Proxy_->GetID (),
-					taskParameters
-				});
-			endInsertRows ();
-			qDebug () << "restored a torrent";
+			saved << torrent;
 		}
 		settings.endArray ();
 
@@ -1801,67 +1852,302 @@ namespace BitTorrent
 		}
 		settings.endArray ();
 		settings.endGroup ();
+
+		IPFilterDirty_ = false;
+
+		SavedTorrentsCount_ = saved.size ();
+		TorrentsListDirty_ = false;
+
+		if (saved.isEmpty ())
+			return;
+
+		/* The torrents are added asynchronously, so poll for the
+		 * add_torrent_alerts more often until everything's restored.
+		 */
+		WarningWatchdog_->start (100);
+		SessionSettingsMgr_->SetRestoring (true);
+
+		RestoreWatcher_ = new QFutureWatcher<RestoredTorrent> (this);
+		connect (RestoreWatcher_,
+				SIGNAL (resultReadyAt (int)),
+				this,
+				SLOT (handleSavedTorrentLoaded ()));
+		RestoreWatcher_->setFuture (QtConcurrent::mapped (saved, &Core::LoadSavedTorrent));
 	}
 
-	bool Core::DecodeEntry (const QByteArray& data, libtorrent::lazy_entry& e)
+	auto Core::LoadSavedTorrent (RestoredTorrent torrent) -> RestoredTorrent
 	{
-		boost::system::error_code ec;
-		if (libtorrent::lazy_bdecode (data.constData (), data.constData () + data.size (), e, ec))
+		const auto& dir = QDir::homePath () + "/.leechcraft/bittorrent/";
+
+		QFile file (dir + torrent.Filename_);
+		if (!file.open (QIODevice::ReadOnly))
 		{
-			emit error (tr ("Bad bencoding in saved torrent data: %1")
-						.arg (QString::fromUtf8 (ec.message ().c_str ())));
-			return false;
+			torrent.Error_ = tr ("Could not open saved torrent %1 for read.").arg (torrent.Filename_);
+			return torrent;
 		}
 
-		return true;
-	}
+		torrent.TorrentFileContents_ = file.readAll ();
+		if (torrent.TorrentFileContents_.isEmpty ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "empty torrent data for"
+					<< torrent.Filename_;
+			torrent.Error_ = tr ("Saved torrent %1 is empty.").arg (torrent.Filename_);
+			return torrent;
+		}
 
-	libtorrent::torrent_handle Core::RestoreSingleTorrent (const QByteArray& data,
-			const QByteArray& resumeData,
-			const boost::filesystem::path& path,
-			bool automanaged,
-			bool pause)
-	{
-		libtorrent::torrent_handle handle;
+		QByteArray resumed;
+		QFile resumeDataFile (dir + torrent.Filename_ + ".resume");
+		if (resumeDataFile.open (QIODevice::ReadOnly))
+			resumed = resumeDataFile.readAll ();
+
+		const auto& data = torrent.TorrentFileContents_;
 
 		libtorrent::lazy_entry e;
-		if (!DecodeEntry (data, e))
-			return handle;
+		boost::system::error_code ec;
+		if (libtorrent::lazy_bdecode (data.constData (), data.constData () + data.size (), e, ec))
+		{
+			torrent.Error_ = tr ("Bad bencoding in saved torrent data: %1")
+					.arg (QString::fromUtf8 (ec.message ().c_str ()));
+			return torrent;
+		}
 
 		try
 		{
-			libtorrent::add_torrent_params atp;
+			auto& atp = torrent.Params_;
 			atp.ti = new libtorrent::torrent_info (e);
-			atp.storage_mode = GetCurrentStorageMode ();
-			atp.save_path = path.string ();
-			if (!automanaged)
-				atp.flags &= ~libtorrent::add_torrent_params::flag_auto_managed;
-			if (pause)
-				atp.flags |= libtorrent::add_torrent_params::flag_paused;
-			atp.flags |= libtorrent::add_torrent_params::flag_duplicate_is_error;
 
 #if LIBTORRENT_VERSION_NUM >= 10000
-			std::copy (resumeData.constData (),
-					resumeData.constData () + resumeData.size (),
+			std::copy (resumed.constData (),
+					resumed.constData () + resumed.size (),
 					std::back_inserter (atp.resume_data));
 #else
 			atp.resume_data = new std::vector<char>;
-			std::copy (resumeData.constData (),
-					resumeData.constData () + resumeData.size (),
+			std::copy (resumed.constData (),
+					resumed.constData () + resumed.size (),
 					std::back_inserter (*atp.resume_data));
 #endif
+		}
+		catch (const std::exception& ex)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< torrent.Filename_
+					<< ex.what ();
+			torrent.Error_ = tr ("Could not load saved torrent %1: %2.")
+					.arg (torrent.Filename_)
+					.arg (QString::fromUtf8 (ex.what ()));
+		}
 
-			handle = Session_->add_torrent (atp);
-			if (XmlSettingsManager::Instance ()->property ("ResolveCountries").toBool ())
-				handle.resolve_countries (true);
+		return torrent;
+	}
+
+	void Core::AddRestoredTorrent (const RestoredTorrent& torrent)
+	{
+		if (!torrent.Error_.isEmpty ())
+		{
+			emit error (torrent.Error_);
+			return;
 		}
-		catch (const libtorrent::libtorrent_exception& e)
+
+		const auto& key = GetInfoHashKey (torrent.Params_.ti->info_hash ());
+		if (PendingRestores_.contains (key))
 		{
-			qWarning () << Q_FUNC_INFO << e.what ();
-			HandleLibtorrentException (e);
+			qWarning () << Q_FUNC_INFO
+					<< "duplicate saved torrent"
+					<< torrent.Filename_;
+			return;
 		}
 
-		return handle;
+		PendingRestores_ [key] = torrent;
+		Session_->async_add_torrent (torrent.Params_);
+		RestoreStallTimer_->start ();
+	}
+
+	bool Core::IsRestoring () const
+	{
+		return RestoreWatcher_ || !PendingRestores_.isEmpty ();
+	}
+
+	void Core::AddLoadedTorrents ()
+	{
+		if (!RestoreWatcher_)
+			return;
+
+		/* The torrents are added to the session in the order they were
+		 * saved in, so that the queue positions are preserved. The
+		 * number of torrents being added is limited so that the
+		 * add_torrent_alerts don't overflow the alerts queue.
+		 */
+		const int maxPending = 200;
+
+		const auto& future = RestoreWatcher_->future ();
+		while (NextRestoredResult_ < SavedTorrentsCount_ &&
+				PendingRestores_.size () < maxPending &&
+				future.isResultReadyAt (NextRestoredResult_))
+			AddRestoredTorrent (future.resultAt (NextRestoredResult_++));
+
+		if (NextRestoredResult_ < SavedTorrentsCount_)
+			return;
+
+		qDebug () << Q_FUNC_INFO
+				<< "loaded saved torrents in"
+				<< RestoreTimer_.elapsed ()
+				<< "ms";
+
+		RestoreWatcher_->deleteLater ();
+		RestoreWatcher_ = nullptr;
+	}
+
+	void Core::CheckRestoreFinished ()
+	{
+		if (IsRestoring ())
+			return;
+
+		RestoreStallTimer_->stop ();
+		WarningWatchdog_->start (2000);
+		SessionSettingsMgr_->SetRestoring (false);
+
+		qDebug () << Q_FUNC_INFO
+				<< "restored"
+				<< Handles_.size ()
+				<< "of"
+				<< SavedTorrentsCount_
+				<< "torrents in"
+				<< RestoreTimer_.elapsed ()
+				<< "ms";
+
+		/* The saved array can be reused as is only if the rows match
+		 * its entries one to one. Every saved torrent has either been
+		 * added or has failed by now, so a mismatch means the failed
+		 * ones should be dropped from the list.
+		 */
+		if (Handles_.size () != SavedTorrentsCount_)
+			TorrentsListDirty_ = true;
+
+		ScheduleSave ();
+	}
+
+	void Core::handleSavedTorrentLoaded ()
+	{
+		AddLoadedTorrents ();
+		CheckRestoreFinished ();
+	}
+
+	void Core::HandleTorrentAdded (const libtorrent::add_torrent_alert& a)
+	{
+		if (!a.params.ti)
+			return;
+
+		const auto& key = GetInfoHashKey (a.params.ti->info_hash ());
+		if (!PendingRestores_.contains (key))
+			return;
+
+		const auto torrent = PendingRestores_.take (key);
+		RestoreStallTimer_->start ();
+		AddLoadedTorrents ();
+
+		if (a.error)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to restore"
+					<< torrent.Filename_
+					<< a.error.message ().c_str ();
+			emit error (tr ("Could not restore torrent %1: %2.")
+					.arg (torrent.Filename_)
+					.arg (QString::fromUtf8 (a.error.message ().c_str ())));
+			CheckRestoreFinished ();
+			return;
+		}
+
+		AddRestoredRow (torrent, a.handle);
+		CheckRestoreFinished ();
+	}
+
+	void Core::AddRestoredRow (const RestoredTorrent& torrent, libtorrent::torrent_handle handle)
+	{
+		if (XmlSettingsManager::Instance ()->property ("ResolveCountries").toBool ())
+			handle.resolve_countries (true);
+
+		auto priorities = torrent.Priorities_;
+		if (priorities.empty ())
+			priorities.resize (torrent.Params_.ti->num_files (), 1);
+		handle.prioritize_files (priorities);
+
+		beginInsertRows ({}, Handles_.size (), Handles_.size ());
+		Handles_.append ({
+				priorities,
+				handle,
+				torrent.TorrentFileContents_,
+				torrent.Filename_,
+				torrent.Tags_,
+				torrent.AutoManaged_,
+				Proxy_->GetID (),
+				torrent.Parameters_
+			});
+		Handles_.last ().TorrentFileSaved_ = true;
+		Handles_.last ().SettingsDirty_ = false;
+		IndexRow (Handles_.size () - 1);
+		endInsertRows ();
+
+		if (Handles_.size () == 1)
+			qDebug () << Q_FUNC_INFO
+					<< "first torrent shown in"
+					<< RestoreTimer_.elapsed ()
+					<< "ms";
+	}
+
+	void Core::handleRestoreStalled ()
+	{
+		if (PendingRestores_.isEmpty ())
+			return;
+
+		/* Some add_torrent_alerts may have been lost, for example due to
+		 * the alerts queue overflow, so pick up what has actually made it
+		 * to the session. The rest may still be being added, so they are
+		 * kept pending and checked again later: dropping them here would
+		 * lose them from the saved torrents list.
+		 */
+		qWarning () << Q_FUNC_INFO
+				<< "no add_torrent_alerts for"
+				<< PendingRestores_.size ()
+				<< "torrents, checking the session";
+
+		for (auto i = PendingRestores_.begin (); i != PendingRestores_.end (); )
+		{
+			const auto& handle = Session_->find_torrent (i->Params_.ti->info_hash ());
+			if (!handle.is_valid ())
+			{
+				++i;
+				continue;
+			}
+
+			AddRestoredRow (*i, handle);
+			i = PendingRestores_.erase (i);
+		}
+
+		if (!PendingRestores_.isEmpty ())
+		{
+			qWarning () << Q_FUNC_INFO
+					<< PendingRestores_.size ()
+					<< "torrents are still being added";
+			RestoreStallTimer_->start ();
+		}
+
+		AddLoadedTorrents ();
+		CheckRestoreFinished ();
+	}
+
+	bool Core::DecodeEntry (const QByteArray& data, libtorrent::lazy_entry& e)
+	{
+		boost::system::error_code ec;
+		if (libtorrent::lazy_bdecode (data.constData (), data.constData () + data.size (), e, ec))
+		{
+			emit error (tr ("Bad bencoding in saved torrent data: %1")
+						.arg (QString::fromUtf8 (ec.message ().c_str ())));
+			return false;
+		}
+
+		return true;
 	}
 
 	void Core::HandleSingleFinished (int i)
@@ -1959,6 +2245,7 @@ namespace BitTorrent
 		Handles_ [torrent].Tags_.clear ();
 		Q_FOREACH (QString tag, tags)
 			Handles_ [torrent].Tags_ << Proxy_->GetTagsManager ()->GetID (tag);
+		MarkTorrentDirty (torrent);
 	}
 
 	void Core::ScheduleSave ()
@@ -1973,6 +2260,18 @@ namespace BitTorrent
 		SaveScheduled_ = true;
 	}
 
+	void Core::MarkTorrentDirty (int row)
+	{
+		Handles_ [row].SettingsDirty_ = true;
+		ScheduleSave ();
+	}
+
+	void Core::MarkTorrentsListDirty ()
+	{
+		TorrentsListDirty_ = true;
+		ScheduleSave ();
+	}
+
 	void Core::HandleLibtorrentException (const libtorrent::libtorrent_exception& e)
 	{
 		emit error (tr ("Error code %1 of category:<blockquote>%2</blockquote>"
@@ -1984,25 +2283,17 @@ namespace BitTorrent
 				.arg (e.what ()));
 	}
 
-	void Core::writeSettings ()
+	void Core::SaveTorrentsList (QSettings& settings)
 	{
-		SaveScheduled_ = false;
-		QDir home = QDir::home ();
-		if (!home.exists (".leechcraft/bittorrent"))
-			if (!home.mkdir (".leechcraft/bittorrent"))
-			{
-				emit error (QDir::toNativeSeparators (tr ("Could not create path %1/.leechcraft/bittorrent"))
-						.arg (QDir::toNativeSeparators (QDir::homePath ())));
-				return;
-			}
+		/* If the set or the order of the torrents hasn't changed, only
+		 * the entries of the changed torrents are rewritten.
+		 */
+		const bool rewriteAll = TorrentsListDirty_;
+		TorrentsListDirty_ = false;
 
-		QSettings settings (QCoreApplication::organizationName (),
-				QCoreApplication::applicationName () + "_Torrent");
-		settings.beginGroup ("Core");
-		settings.beginWriteArray ("AddedTorrents");
+		BeginWriteArray (settings, "AddedTorrents", Handles_.size (), rewriteAll);
 		for (int i = 0; i < Handles_.size (); ++i)
 		{
-			settings.setArrayIndex (i);
 			if (!CheckValidity (i))
 			{
 				qWarning () << Q_FUNC_INFO
@@ -2021,40 +2312,52 @@ namespace BitTorrent
 			CurrentTorrent_ = i;
 			try
 			{
-				QFile file_info (QDir::homePath () +
-						"/.leechcraft/bittorrent/" +
-						Handles_.at (i).TorrentFileName_);
-				if (!file_info.open (QIODevice::WriteOnly))
-					emit error (QString ("Cannot write settings! "
-								"Cannot open file %1 for write!")
-							.arg (Handles_.at (i).TorrentFileName_));
-				else
+				auto& torrent = Handles_ [i];
+				if (!torrent.TorrentFileSaved_)
 				{
-					file_info.write (Handles_.at (i).TorrentFileContents_);
-					file_info.close ();
+					QFile file_info (QDir::homePath () +
+							"/.leechcraft/bittorrent/" +
+							torrent.TorrentFileName_);
+					if (!file_info.open (QIODevice::WriteOnly))
+						emit error (QString ("Cannot write settings! "
+									"Cannot open file %1 for write!")
+								.arg (torrent.TorrentFileName_));
+					else
+					{
+						file_info.write (torrent.TorrentFileContents_);
+						file_info.close ();
+						torrent.TorrentFileSaved_ = true;
+					}
+				}
 
-					const auto& handle = Handles_.at (i).Handle_;
-					if (handle.need_save_resume_data ())
-						handle.save_resume_data ();
+				const auto& handle = torrent.Handle_;
+				if (handle.need_save_resume_data ())
+					handle.save_resume_data ();
 
+				if (torrent.TorrentFileSaved_ &&
+						(rewriteAll || torrent.SettingsDirty_))
+				{
+					settings.setArrayIndex (i);
 					settings.setValue ("SavePath",
 							QString::fromUtf8 (handle.save_path ().c_str ()));
 					settings.setValue ("Filename",
-							Handles_.at (i).TorrentFileName_);
+							torrent.TorrentFileName_);
 					settings.setValue ("Tags",
-							Handles_.at (i).Tags_);
+							torrent.Tags_);
 					settings.setValue ("ID",
-							Handles_.at (i).ID_);
+							torrent.ID_);
 					settings.setValue ("Parameters",
-							static_cast<int> (Handles_.at (i).Parameters_));
+							static_cast<int> (torrent.Parameters_));
 					settings.setValue ("AutoManaged",
-							Handles_.at (i).AutoManaged_);
+							torrent.AutoManaged_);
 
 					QByteArray prioritiesLine;
-					std::copy (Handles_.at (i).FilePriorities_.begin (),
-							Handles_.at (i).FilePriorities_.end (),
+					std::copy (torrent.FilePriorities_.begin (),
+							torrent.FilePriorities_.end (),
 							std::back_inserter (prioritiesLine));
 					settings.setValue ("Priorities", prioritiesLine);
+
+					torrent.SettingsDirty_ = false;
 				}
 			}
 			catch (const std::exception& e)
@@ -2068,20 +2371,48 @@ namespace BitTorrent
 			CurrentTorrent_ = oldCurrent;
 		}
 		settings.endArray ();
+	}
 
-		settings.beginWriteArray ("IPFilter");
-		settings.remove ("");
-		QMap<BanRange_t, bool> filter = GetFilter ();
-		QList<BanRange_t> keys = filter.keys ();
-		int i = 0;
-		Q_FOREACH (BanRange_t key, keys)
+	void Core::writeSettings ()
+	{
+		SaveScheduled_ = false;
+		QDir home = QDir::home ();
+		if (!home.exists (".leechcraft/bittorrent"))
+			if (!home.mkdir (".leechcraft/bittorrent"))
+			{
+				emit error (QDir::toNativeSeparators (tr ("Could not create path %1/.leechcraft/bittorrent"))
+						.arg (QDir::toNativeSeparators (QDir::homePath ())));
+				return;
+			}
+
+		QSettings settings (QCoreApplication::organizationName (),
+				QCoreApplication::applicationName () + "_Torrent");
+		settings.beginGroup ("Core");
+
+		if (IsRestoring ())
+			qDebug () << Q_FUNC_INFO
+					<< "not saving the torrents list while restoring it";
+		else
+			SaveTorrentsList (settings);
+
+		if (IPFilterDirty_)
 		{
-			settings.setArrayIndex (i++);
-			settings.setValue ("First", key.first);
-			settings.setValue ("Last", key.second);
-			settings.setValue ("Block", filter [key]);
+			settings.beginWriteArray ("IPFilter");
+			settings.remove ("");
+			QMap<BanRange_t, bool> filter = GetFilter ();
+			QList<BanRange_t> keys = filter.keys ();
+			int i = 0;
+			Q_FOREACH (BanRange_t key, keys)
+			{
+				settings.setArrayIndex (i++);
+				settings.setValue ("First", key.first);
+				settings.setValue ("Last", key.second);
+				settings.setValue ("Block", filter [key]);
+			}
+			settings.endArray ();
+
+			IPFilterDirty_ = false;
 		}
-		settings.endArray ();
 		settings.endGroup ();
 
 		boost::uint32_t saveflags = 0xffffffff;
@@ -2176,6 +2507,8 @@ namespace BitTorrent
 
 		void operator() (const libtorrent::storage_moved_alert& a) const
 		{
+			Core::Instance ()->HandleStorageMoved (a);
+
 			const auto& text = QObject::tr ("Storage for torrent:<br />%1"
 						"<br />moved successfully to:<br />%2")
 					.arg (QString::fromUtf8 (a.handle.name ().c_str ()))
@@ -2196,6 +2529,11 @@ namespace BitTorrent
 			Core::Instance ()->HandleMetadata (a);
 		}
 
+		void operator() (const libtorrent::add_torrent_alert& a) const
+		{
+			Core::Instance ()->HandleTorrentAdded (a);
+		}
+
 		void operator() (const libtorrent::file_renamed_alert& a) const
 		{
 			Core::Instance ()->HandleFileRenamed (a);
@@ -2359,6 +2697,7 @@ namespace BitTorrent
 					, libtorrent::storage_moved_alert
 					, libtorrent::storage_moved_failed_alert
 					, libtorrent::metadata_received_alert
+					, libtorrent::add_torrent_alert
 					, libtorrent::file_error_alert
 					, libtorrent::file_renamed_alert
 					, libtorrent::file_rename_failed_alert
@@ -36,8 +36,10 @@
 #include <QAbstractItemModel>
 #include <QPair>
 #include <QList>
+#include <QHash>
 #include <QVector>
 #include <QIcon>
+#include <QElapsedTimer>
 #include <libtorrent/alert_types.hpp>
 #include <libtorrent/torrent_info.hpp>
 #include <libtorrent/torrent_handle.hpp>
@@ -55,6 +57,10 @@ class QDomElement;
 class QToolBar;
 class QStandardItemModel;
 class QDataStream;
+class QSettings;
+
+template<typename>
+class QFutureWatcher;
 
 namespace libtorrent
 {
@@ -78,6 +84,7 @@ namespace BitTorrent
 	class TorrentFilesModel;
 	class RepresentationModel;
 	class LiveStreamManager;
+	class ResumeDataSaver;
 	class SessionSettingsManager;
 	struct NewTorrentParams;
 
@@ -111,6 +118,21 @@ namespace BitTorrent
 
 			bool PauseAfterCheck_ = false;
 
+			/** The last known status of the torrent, updated from the
+			 * state_update_alert or fetched on demand.
+			 */
+			mutable boost::optional<libtorrent::torrent_status> Status_;
+
+			/** Whether the .torrent file has already been written to
+			 * the disk. The file never changes afterwards, so it's
+			 * written only once.
+			 */
+			bool TorrentFileSaved_ = false;
+			/** Whether the settings of this torrent have changed since
+			 * they were last written to the QSettings.
+			 */
+			bool SettingsDirty_ = true;
+
 			TorrentStruct (const libtorrent::torrent_handle& handle,
 					const QStringList& tags,
 					int id,
@@ -143,8 +165,6 @@ namespace BitTorrent
 		};
 
 		friend struct SimpleDispatcher;
-
-		mutable QMap<libtorrent::torrent_handle, libtorrent::torrent_status> Handle2Status_;
 	public:
 		struct PerTrackerStats
 		{
@@ -161,6 +181,23 @@ namespace BitTorrent
 			int operator() (int, const Core::TorrentStruct& str);
 		};
 
+		/** The saved torrent being restored: its settings are read on
+		 * the GUI thread, while the files are read and decoded in the
+		 * thread pool.
+		 */
+		struct RestoredTorrent
+		{
+			QString Filename_;
+			QByteArray TorrentFileContents_;
+			QStringList Tags_;
+			bool AutoManaged_;
+			TaskParameters Parameters_;
+			std::vector<int> Priorities_;
+
+			libtorrent::add_torrent_params Params_;
+			QString Error_;
+		};
+
 		NotifyManager *NotifyManager_;
 
 		libtorrent::session *Session_;
@@ -168,12 +205,27 @@ namespace BitTorrent
 
 		typedef QList<TorrentStruct> HandleDict_t;
 		HandleDict_t Handles_;
+		QHash<QByteArray, int> InfoHash2Row_;
 		QList<QString> Headers_;
 		mutable int CurrentTorrent_;
 		std::shared_ptr<QTimer> FinishedTimer_, WarningWatchdog_;
+
+		/** Fires if no add_torrent_alert has arrived for a while during
+		 * the restore.
+		 */
+		std::shared_ptr<QTimer> RestoreStallTimer_;
 		std::shared_ptr<LiveStreamManager> LiveStreamManager_;
+		std::shared_ptr<ResumeDataSaver> ResumeDataSaver_;
 		QString ExternalAddress_;
 		bool SaveScheduled_;
+		bool TorrentsListDirty_ = true;
+		bool IPFilterDirty_ = true;
+
+		QFutureWatcher<RestoredTorrent> *RestoreWatcher_ = nullptr;
+		int NextRestoredResult_ = 0;
+		int SavedTorrentsCount_ = 0;
+		QHash<QByteArray, RestoredTorrent> PendingRestores_;
+		QElapsedTimer RestoreTimer_;
 		QToolBar *Toolbar_;
 		QWidget *TabWidget_;
 		ICoreProxy_ptr Proxy_;
@@ -336,6 +388,8 @@ namespace BitTorrent
 
 		void SaveResumeData (const libtorrent::save_resume_data_alert&) const;
 		void HandleMetadata (const libtorrent::metadata_received_alert&);
+		void HandleStorageMoved (const libtorrent::storage_moved_alert&);
+		void HandleTorrentAdded (const libtorrent::add_torrent_alert&);
 		void PieceRead (const libtorrent::read_piece_alert&);
 		void UpdateStatus (const std::vector<libtorrent::torrent_status>&);
 
@@ -351,17 +405,21 @@ namespace BitTorrent
 		HandleDict_t::iterator FindHandle (const libtorrent::torrent_handle&);
 		HandleDict_t::const_iterator FindHandle (const libtorrent::torrent_handle&) const;
 
-		libtorrent::torrent_status GetCachedStatus (const libtorrent::torrent_handle&) const;
+		void IndexRow (int);
+		void RebuildRowsIndex ();
+
+		const libtorrent::torrent_status& GetCachedStatus (int) const;
 
 		void MoveToTop (int);
 		void MoveToBottom (int);
 		void RestoreTorrents ();
+		static RestoredTorrent LoadSavedTorrent (RestoredTorrent);
+		void AddRestoredTorrent (const RestoredTorrent&);
+		void AddLoadedTorrents ();
+		void AddRestoredRow (const RestoredTorrent&, libtorrent::torrent_handle);
+		bool IsRestoring () const;
+		void CheckRestoreFinished ();
 		bool DecodeEntry (const QByteArray&, libtorrent::lazy_entry&);
-		libtorrent::torrent_handle RestoreSingleTorrent (const QByteArray&,
-				const QByteArray&,
-				const boost::filesystem::path&,
-				bool,
-				bool);
 
 		void HandleSingleFinished (int);
 		void HandleFileRenamed (const libtorrent::file_renamed_alert&);
@@ -379,8 +437,14 @@ namespace BitTorrent
 		 */
 		void UpdateTagsImpl (const QStringList& tags, int torrent);
 		void ScheduleSave ();
+		void SaveTorrentsList (QSettings&);
+		void MarkTorrentDirty (int);
+		void MarkTorrentsListDirty ();
 		void HandleLibtorrentException (const libtorrent::libtorrent_exception&);
 	private slots:
+		void handleSavedTorrentLoaded ();
+		void handleRestoreStalled ();
+
 		void writeSettings ();
 		void checkFinished ();
 		void scrape ();
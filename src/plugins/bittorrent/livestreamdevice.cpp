@@ -28,20 +28,36 @@
  **********************************************************************/
 
 #include "livestreamdevice.h"
+#include <QTimer>
 #include <QtDebug>
-#include "core.h"
 
 namespace LeechCraft
 {
 namespace BitTorrent
 {
+	namespace
+	{
+		/** How many bytes ahead of the read cursor get piece deadlines.
+		 */
+		const qint64 ReadAheadWindow = 16 * 1024 * 1024;
+
+		/** The maximum size of the pieces kept in memory.
+		 */
+		const qint64 MaxCacheSize = 64 * 1024 * 1024;
+
+		const int MinWindowPieces = 4;
+	}
+
 	LiveStreamDevice::LiveStreamDevice (const libtorrent::torrent_handle& h, QObject *parent)
 	: QIODevice (parent)
 	, Handle_ (h)
 	, NumPieces_ (h.get_torrent_info ().num_pieces ())
+	, PieceLength_ (h.get_torrent_info ().piece_length ())
+	, TotalSize_ (h.get_torrent_info ().total_size ())
 	, ReadPos_ (0)
 	, Offset_ (0)
 	, IsReady_ (false)
+	, RescheduleTimer_ (new QTimer (this))
 	{
 		boost::filesystem::path tpath = h.save_path ();
 		boost::filesystem::path fpath = h.get_torrent_info ().file_at (0).path;
@@ -53,25 +69,18 @@ namespace BitTorrent
 				<< "could not open internal IO device"
 				<< QIODevice::errorString ();
 
+		connect (RescheduleTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (handleRescheduleTimeout ()));
+		RescheduleTimer_->start (500);
+
 		reschedule ();
 	}
 
 	qint64 LiveStreamDevice::bytesAvailable () const
 	{
-		qint64 result = 0;
-		const libtorrent::torrent_info& ti = Handle_.get_torrent_info ();;
-		const libtorrent::bitfield& pieces = Handle_.status ().pieces;
-		qDebug () << Q_FUNC_INFO << Offset_ << ReadPos_ << pieces [ReadPos_];
-		for (int i = ReadPos_; pieces [i]; ++i)
-		{
-			result += ti.piece_size (i);
-			qDebug () << "added:" << result;
-		}
-		result -= Offset_;
-		if (result < 0)
-			result = 0;
-		qDebug () << "result:" << result;
-		return result;
+		return GetBufferedAhead ();
 	}
 
 	bool LiveStreamDevice::isSequential () const
@@ -91,29 +100,32 @@ namespace BitTorrent
 
 	qint64 LiveStreamDevice::pos () const
 	{
-		qint64 result = 0;
-		const libtorrent::torrent_info& ti = Handle_.get_torrent_info ();;
-		for (int i = 0; i < ReadPos_; ++i)
-			result += ti.piece_size (i);
-		result += Offset_;
-		return result;
+		return static_cast<qint64> (ReadPos_) * PieceLength_ + Offset_;
 	}
 
 	bool LiveStreamDevice::seek (qint64 pos)
 	{
+		if (pos < 0 || pos > TotalSize_)
+			return false;
+
 		QIODevice::seek (pos);
 		qDebug () << Q_FUNC_INFO << pos;
 
-		const libtorrent::torrent_info& ti = Handle_.get_torrent_info ();
+		const int oldPos = ReadPos_;
 
-		int i = 0;
-		while (pos >= ti.piece_size (i))
-			pos -= ti.piece_size (i++);
+		ReadPos_ = pos / PieceLength_;
+		Offset_ = pos % PieceLength_;
 
-		ReadPos_ = i;
-		Offset_ = pos;
+		/* The old deadlines are dropped if the new cursor is out of the
+		 * old window, otherwise libtorrent would still be fetching the
+		 * pieces around the old position first.
+		 */
+		const int windowPieces = std::max<int> (MinWindowPieces, ReadAheadWindow / PieceLength_);
+		if (IsReady_ &&
+				(ReadPos_ < oldPos || ReadPos_ >= oldPos + windowPieces))
+			Handle_.clear_piece_deadlines ();
 
-		qDebug () << ReadPos_ << Offset_;
+		IsStalled_ = false;
 
 		reschedule ();
 
@@ -122,11 +134,21 @@ namespace BitTorrent
 
 	qint64 LiveStreamDevice::size () const
 	{
-		return Handle_.status ().total_wanted;
+		return TotalSize_;
 	}
 
-	void LiveStreamDevice::PieceRead (const libtorrent::read_piece_alert&)
+	void LiveStreamDevice::PieceRead (const libtorrent::read_piece_alert& a)
 	{
+		RequestedReads_.remove (a.piece);
+
+		if (a.ec)
+			qWarning () << Q_FUNC_INFO
+					<< "unable to read piece"
+					<< a.piece
+					<< a.ec.message ().c_str ();
+		else if (a.piece >= ReadPos_)
+			CachePiece (a.piece, QByteArray (a.buffer.get (), a.size));
+
 		CheckReady ();
 		CheckNextChunk ();
 		reschedule ();
@@ -134,10 +156,10 @@ namespace BitTorrent
 
 	void LiveStreamDevice::CheckReady ()
 	{
-		const libtorrent::bitfield& pieces = Handle_.status ().pieces;
+		Pieces_ = Handle_.status (libtorrent::torrent_handle::query_pieces).pieces;
 		if (!IsReady_ &&
-				pieces [0] &&
-				pieces [NumPieces_ - 1])
+				HasPiece (0) &&
+				HasPiece (NumPieces_ - 1))
 		{
 			std::vector<int> prios (NumPieces_, 1);
 			Handle_.prioritize_pieces (prios);
@@ -147,29 +169,58 @@ namespace BitTorrent
 		}
 	}
 
+	qint64 LiveStreamDevice::GetBufferedAhead () const
+	{
+		qint64 result = -Offset_;
+		for (int i = ReadPos_; i < NumPieces_ && HasPiece (i); ++i)
+			result += GetPieceSize (i);
+		return std::max<qint64> (result, 0);
+	}
+
+	int LiveStreamDevice::GetStallsCount () const
+	{
+		return StallsCount_;
+	}
+
 	qint64 LiveStreamDevice::readData (char *data, qint64 max)
 	{
-		const libtorrent::torrent_info& ti = Handle_.get_torrent_info ();
-		if (!File_.open (QIODevice::ReadOnly))
+		const auto startPos = ReadPos_;
+
+		qint64 result = 0;
+		while (result < max && ReadPos_ < NumPieces_ && HasPiece (ReadPos_))
 		{
-			qWarning () << Q_FUNC_INFO
-				<< "could not open underlying file"
-				<< File_.fileName ()
-				<< File_.errorString ();
-			return -1;
+			const auto pieceSize = GetPieceSize (ReadPos_);
+			const auto chunk = std::min<qint64> (max - result, pieceSize - Offset_);
+			if (!ReadPiece (ReadPos_, Offset_, data + result, chunk))
+				break;
+
+			result += chunk;
+			Offset_ += chunk;
+			if (Offset_ >= pieceSize)
+			{
+				Offset_ = 0;
+				++ReadPos_;
+			}
 		}
-		qint64 ba = bytesAvailable ();
-		File_.seek (pos ());
-		const qint64 result = File_.read (data, std::min (max, ba));
-		File_.close ();
-
-		qDebug () << Q_FUNC_INFO << result << Offset_ << ReadPos_ << max << ba;
 
-		Offset_ += result;
-		while (Offset_ >= ti.piece_size (ReadPos_))
-			Offset_ -= ti.piece_size (ReadPos_++);
+		if (!result && max && ReadPos_ < NumPieces_)
+		{
+			if (!IsStalled_)
+			{
+				IsStalled_ = true;
+				++StallsCount_;
+				qDebug () << Q_FUNC_INFO
+						<< "stalled at piece"
+						<< ReadPos_
+						<< "total stalls:"
+						<< StallsCount_;
+			}
+		}
+		else
+			IsStalled_ = false;
 
-		qDebug () << Offset_ << ReadPos_ << bytesAvailable ();
+		if (ReadPos_ != startPos)
+			reschedule ();
 
 		return result;
 	}
@@ -179,58 +230,147 @@ namespace BitTorrent
 		return -1;
 	}
 
-	void LiveStreamDevice::CheckNextChunk ()
+	int LiveStreamDevice::GetPieceSize (int piece) const
+	{
+		return piece == NumPieces_ - 1 ?
+				TotalSize_ - static_cast<qint64> (piece) * PieceLength_ :
+				PieceLength_;
+	}
+
+	bool LiveStreamDevice::HasPiece (int piece) const
+	{
+		return Cache_.contains (piece) ||
+				(piece < Pieces_.size () && Pieces_ [piece]);
+	}
+
+	bool LiveStreamDevice::ReadPiece (int piece, int offset, char *data, qint64 size)
+	{
+		if (Cache_.contains (piece))
+		{
+			CacheLRU_.removeOne (piece);
+			CacheLRU_ << piece;
+
+			const auto& buffer = Cache_ [piece];
+			std::copy (buffer.constData () + offset,
+					buffer.constData () + offset + size,
+					data);
+			return true;
+		}
+
+		if (!File_.isOpen () && !File_.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "could not open underlying file"
+				<< File_.fileName ()
+				<< File_.errorString ();
+			return false;
+		}
+
+		if (!File_.seek (static_cast<qint64> (piece) * PieceLength_ + offset) ||
+				File_.read (data, size) != size)
+		{
+			qWarning () << Q_FUNC_INFO
+				<< "could not read piece"
+				<< piece
+				<< "from"
+				<< File_.fileName ()
+				<< File_.errorString ();
+			return false;
+		}
+
+		return true;
+	}
+
+	void LiveStreamDevice::CachePiece (int piece, const QByteArray& data)
 	{
-		bool hasMoreData = false;
-		const libtorrent::bitfield& pieces = Handle_.status ().pieces;
-		for (int i = ReadPos_ + 1;
-				i < NumPieces_ && pieces [i];
-				++i, hasMoreData = true);
+		if (Cache_.contains (piece))
+			return;
+
+		while (CacheSize_ + data.size () > MaxCacheSize && !CacheLRU_.isEmpty ())
+			CacheSize_ -= Cache_.take (CacheLRU_.takeFirst ()).size ();
+
+		Cache_ [piece] = data;
+		CacheLRU_ << piece;
+		CacheSize_ += data.size ();
+	}
 
-		if (hasMoreData)
+	void LiveStreamDevice::CheckNextChunk ()
+	{
+		if (GetBufferedAhead ())
 			emit readyRead ();
 	}
 
 	void LiveStreamDevice::reschedule ()
 	{
-		Core::Instance ()->queryLibtorrentForWarnings ();
-
-		const libtorrent::bitfield& pieces = Handle_.status ().pieces;
+		const auto& status = Handle_.status (libtorrent::torrent_handle::query_pieces);
+		Pieces_ = status.pieces;
 
-		int speed = Handle_.status ().download_payload_rate;
-		int size = Handle_.get_torrent_info ().piece_length ();
+		const int speed = status.download_payload_rate;
 		const int time = speed ?
-			static_cast<double> (size) / speed * 1000 :
+			std::max (static_cast<double> (PieceLength_) / speed * 1000, 100.) :
 			60000;
 
-		int thisDeadline = 0;
-		for (int i = ReadPos_; i < NumPieces_; ++i)
-			if (!pieces [i])
-				Handle_.set_piece_deadline (i,
-						IsReady_ ?
-							(thisDeadline += time) :
-							1000000,
-						1);
 		if (!IsReady_)
 		{
+			for (int i = ReadPos_; i < NumPieces_; ++i)
+				if (!HasPiece (i))
+					Handle_.set_piece_deadline (i, 1000000,
+							libtorrent::torrent_handle::alert_when_available);
+
 			std::vector<int> prios (NumPieces_, 0);
-			if (pieces.size () > 1)
+			if (NumPieces_ > 1)
 				prios [1] = 1;
 
-			if (!pieces [0])
+			if (!HasPiece (0))
 			{
 				qDebug () << "scheduling first piece";
-				Handle_.set_piece_deadline (0, 500, 1);
+				Handle_.set_piece_deadline (0, 500,
+						libtorrent::torrent_handle::alert_when_available);
 				prios [0] = 7;
 			}
-			if (!pieces [NumPieces_ - 1])
+			if (!HasPiece (NumPieces_ - 1))
 			{
 				qDebug () << "scheduling last piece";
-				Handle_.set_piece_deadline (NumPieces_ - 1, 500, 1);
+				Handle_.set_piece_deadline (NumPieces_ - 1, 500,
+						libtorrent::torrent_handle::alert_when_available);
 				prios [NumPieces_ - 1] = 7;
 			}
 			Handle_.prioritize_pieces (prios);
+			return;
 		}
+
+		/* Only the pieces in the window get the deadlines, the
+		 * downloaded ones are read ahead into the cache instead.
+		 */
+		const int windowPieces = std::max<int> (MinWindowPieces, ReadAheadWindow / PieceLength_);
+		const int windowEnd = std::min (NumPieces_, ReadPos_ + windowPieces);
+
+		int thisDeadline = 0;
+		for (int i = ReadPos_; i < windowEnd; ++i)
+		{
+			if (Cache_.contains (i))
+				continue;
+
+			if (!HasPiece (i))
+				Handle_.set_piece_deadline (i,
+						thisDeadline += time,
+						libtorrent::torrent_handle::alert_when_available);
+			else if (!RequestedReads_.contains (i))
+			{
+				Handle_.read_piece (i);
+				RequestedReads_ << i;
+			}
+		}
+	}
+
+	void LiveStreamDevice::handleRescheduleTimeout ()
+	{
+		emit alertsRequested ();
+
+		const auto hadData = GetBufferedAhead ();
+		reschedule ();
+		if (!hadData && GetBufferedAhead ())
+			emit readyRead ();
 	}
 }
 }
@@ -29,28 +29,53 @@
 
 #pragma once
 
-#include <QVector>
+#include <QHash>
+#include <QSet>
 #include <QFile>
 #include <libtorrent/torrent_handle.hpp>
 #include <libtorrent/alert_types.hpp>
+#include <libtorrent/bitfield.hpp>
+
+class QTimer;
 
 namespace LeechCraft
 {
 namespace BitTorrent
 {
+	/** Streams the (first file of the) torrent while it's still being
+	 * downloaded.
+	 *
+	 * The pieces in a sliding window ahead of the read cursor get
+	 * staggered deadlines, so that libtorrent downloads them in order.
+	 * The pieces that are already available in this window are read
+	 * ahead into a bounded in-memory cache.
+	 */
 	class LiveStreamDevice : public QIODevice
 	{
 		Q_OBJECT
 
 		libtorrent::torrent_handle Handle_;
-		int NumPieces_;
-		int LastIndex_;
+		const int NumPieces_;
+		const int PieceLength_;
+		const qint64 TotalSize_;
 		// Which piece would be read next.
 		int ReadPos_;
 		// Offset in the next piece pointed by ReadPos_;
 		int Offset_;
 		bool IsReady_;
 		QFile File_;
+
+		libtorrent::bitfield Pieces_;
+
+		QHash<int, QByteArray> Cache_;
+		QList<int> CacheLRU_;
+		qint64 CacheSize_ = 0;
+		QSet<int> RequestedReads_;
+
+		int StallsCount_ = 0;
+		bool IsStalled_ = false;
+
+		QTimer * const RescheduleTimer_;
 	public:
 		LiveStreamDevice (const libtorrent::torrent_handle&,
 				QObject* = 0);
@@ -65,15 +90,34 @@ namespace BitTorrent
 
 		void PieceRead (const libtorrent::read_piece_alert&);
 		void CheckReady ();
+
+		/** Returns how many times the reader has run out of data.
+		 */
+		int GetStallsCount () const;
+
+		/** Returns the number of bytes available right after the read
+		 * cursor without waiting for the download.
+		 */
+		qint64 GetBufferedAhead () const;
 	protected:
 		virtual qint64 readData (char*, qint64);
 		virtual qint64 writeData (const char*, qint64);
 	private:
+		int GetPieceSize (int) const;
+		bool HasPiece (int) const;
+		bool ReadPiece (int piece, int offset, char *data, qint64 size);
+		void CachePiece (int, const QByteArray&);
 		void CheckNextChunk ();
 	private slots:
 		void reschedule ();
+		void handleRescheduleTimeout ();
 	signals:
 		void ready ();
+
+		/** Emitted when the pending libtorrent alerts (and thus the
+		 * read_piece_alerts for this device) should be processed.
+		 */
+		void alertsRequested ();
 	};
 }
 }
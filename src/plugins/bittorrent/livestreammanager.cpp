@@ -52,6 +52,10 @@ namespace BitTorrent
 					SIGNAL (ready ()),
 					this,
 					SLOT (handleDeviceReady ()));
+			connect (lsd,
+					SIGNAL (alertsRequested ()),
+					this,
+					SIGNAL (alertsRequested ()));
 			lsd->CheckReady ();
 		}
 	}
@@ -56,6 +56,7 @@ namespace BitTorrent
 		void handleDeviceReady ();
 	signals:
 		void gotEntity (const LeechCraft::Entity&);
+		void alertsRequested ();
 	};
 }
 }
@@ -0,0 +1,170 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+
+#include "resumedatasaver.h"
+#include <cstdio>
+#include <QFile>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		bool ReplaceFile (const QString& from, const QString& to)
+		{
+#ifdef Q_OS_WIN
+			QFile::remove (to);
+			return QFile::rename (from, to);
+#else
+			return !std::rename (QFile::encodeName (from).constData (),
+					QFile::encodeName (to).constData ());
+#endif
+		}
+
+		/* The data is written to a temporary file first and then moved
+		 * over the old one, so that a crash in the middle of writing
+		 * doesn't leave truncated resume data behind.
+		 */
+		void WriteFile (const QString& path, const QByteArray& data)
+		{
+			const auto& tmpPath = path + ".new";
+
+			QFile file (tmpPath);
+			if (!file.open (QIODevice::WriteOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "could not open file"
+						<< file.fileName ()
+						<< "for write:"
+						<< file.errorString ();
+				return;
+			}
+
+			if (file.write (data) != data.size () || !file.flush ())
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "could not write"
+						<< file.fileName ()
+						<< file.errorString ();
+				file.close ();
+				file.remove ();
+				return;
+			}
+			file.close ();
+
+			if (!ReplaceFile (tmpPath, path))
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "could not replace"
+						<< path;
+				QFile::remove (tmpPath);
+			}
+		}
+
+		void WriteBatch (const QString& dir, const QHash<QString, QByteArray>& batch)
+		{
+			QElapsedTimer timer;
+			timer.start ();
+
+			for (auto i = batch.begin (), end = batch.end (); i != end; ++i)
+				WriteFile (dir + '/' + i.key (), i.value ());
+
+			qDebug () << Q_FUNC_INFO
+					<< "wrote"
+					<< batch.size ()
+					<< "resume data files in"
+					<< timer.elapsed ()
+					<< "ms";
+		}
+	}
+
+	ResumeDataSaver::ResumeDataSaver (const QString& dir, QObject *parent)
+	: QObject (parent)
+	, Dir_ (dir)
+	, Watcher_ (new QFutureWatcher<void> (this))
+	{
+		connect (Watcher_,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleBatchWritten ()));
+	}
+
+	void ResumeDataSaver::Add (const QString& filename, const QByteArray& data)
+	{
+		Pending_ [filename] = data;
+
+		if (FlushScheduled_)
+			return;
+
+		FlushScheduled_ = true;
+		QTimer::singleShot (1000,
+				this,
+				SLOT (flush ()));
+	}
+
+	void ResumeDataSaver::Finish ()
+	{
+		Watcher_->waitForFinished ();
+
+		FlushScheduled_ = false;
+		if (Pending_.isEmpty ())
+			return;
+
+		WriteBatch (Dir_, Pending_);
+		Pending_.clear ();
+	}
+
+	void ResumeDataSaver::flush ()
+	{
+		FlushScheduled_ = false;
+
+		if (Pending_.isEmpty () || Watcher_->isRunning ())
+			return;
+
+		const auto dir = Dir_;
+		const auto batch = Pending_;
+		Pending_.clear ();
+
+		Watcher_->setFuture (QtConcurrent::run ([dir, batch] { WriteBatch (dir, batch); }));
+	}
+
+	void ResumeDataSaver::handleBatchWritten ()
+	{
+		if (!Pending_.isEmpty () && !FlushScheduled_)
+			flush ();
+	}
+}
+}
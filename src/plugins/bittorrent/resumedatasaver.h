@@ -0,0 +1,81 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QFuture>
+
+template<typename>
+class QFutureWatcher;
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	/** Writes the resume data of the torrents to the disk in a
+	 * background thread.
+	 *
+	 * The resume data is accumulated for a short period of time and
+	 * then written in one batch, and if the data for the same torrent
+	 * arrives several times before the batch is written, only the
+	 * latest version hits the disk.
+	 */
+	class ResumeDataSaver : public QObject
+	{
+		Q_OBJECT
+
+		const QString Dir_;
+
+		QHash<QString, QByteArray> Pending_;
+		bool FlushScheduled_ = false;
+
+		QFutureWatcher<void> * const Watcher_;
+	public:
+		ResumeDataSaver (const QString& dir, QObject* = 0);
+
+		/** Schedules writing the resume data to the given file name
+		 * relative to the directory passed to the constructor.
+		 */
+		void Add (const QString& filename, const QByteArray& data);
+
+		/** Synchronously writes everything that is still pending.
+		 *
+		 * This function blocks until the batch being written in the
+		 * background, if any, is done.
+		 */
+		void Finish ();
+	private slots:
+		void flush ();
+		void handleBatchWritten ();
+	};
+}
+}
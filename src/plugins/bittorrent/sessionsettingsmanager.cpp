@@ -339,9 +339,21 @@ namespace BitTorrent
 				this, "checkStorageSettings", Util::BaseSettingsManager::EventFlag::Select);
 	}
 
+	void SessionSettingsManager::SetRestoring (bool restoring)
+	{
+		if (IsRestoring_ == restoring)
+			return;
+
+		IsRestoring_ = restoring;
+		setLoggingSettings ();
+	}
+
 	void SessionSettingsManager::setLoggingSettings ()
 	{
-		boost::uint32_t mask = 0;
+		/* Status notifications include the add_torrent_alert, which is
+		 * needed to restore the saved torrents asynchronously.
+		 */
+		boost::uint32_t mask = IsRestoring_ ? libtorrent::alert::status_notification : 0;
 
 		if (XmlSettingsManager::Instance ()->property ("NotificationDHT").toBool ())
 			mask |= libtorrent::alert::dht_notification;
@@ -51,6 +51,8 @@ namespace BitTorrent
 		const ICoreProxy_ptr Proxy_;
 		QTimer * const ScrapeTimer_;
 		QTimer * const SettingsSaveTimer_;
+
+		bool IsRestoring_ = false;
 	public:
 		SessionSettingsManager (libtorrent::session*, const ICoreProxy_ptr& proxy, QObject* = nullptr);
 
@@ -63,6 +65,12 @@ namespace BitTorrent
 
 		void SetPreset (Preset);
 
+		/** Enables the status notifications needed to restore the saved
+		 * torrents asynchronously, regardless of the user settings, while
+		 * the restore is in progress.
+		 */
+		void SetRestoring (bool);
+
 		void SetOverallDownloadRate (int);
 		void SetOverallUploadRate (int);
 		void SetMaxDownloadingTorrents (int);
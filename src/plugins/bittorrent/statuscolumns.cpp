@@ -0,0 +1,101 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "statuscolumns.h"
+#include <libtorrent/torrent_handle.hpp>
+#include "core.h"
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	int GetChangedColumns (const libtorrent::torrent_status& o, const libtorrent::torrent_status& n)
+	{
+		int mask = 0;
+		auto mark = [&mask] (int column) { mask |= 1 << column; };
+
+		if (o.state != n.state ||
+				o.paused != n.paused ||
+				o.error != n.error)
+		{
+			mark (Core::ColumnName);
+			mark (Core::ColumnState);
+			mark (Core::ColumnProgress);
+		}
+
+		if (o.total_wanted_done != n.total_wanted_done ||
+				o.total_wanted != n.total_wanted)
+		{
+			mark (Core::ColumnName);
+			mark (Core::ColumnProgress);
+		}
+
+		// The state of a downloading torrent is shown along with its ETA.
+		if (n.state == libtorrent::torrent_status::downloading &&
+				(o.download_rate != n.download_rate ||
+					o.total_wanted_done != n.total_wanted_done ||
+					o.total_wanted != n.total_wanted))
+			mark (Core::ColumnState);
+
+		if (o.progress != n.progress ||
+				o.download_payload_rate != n.download_payload_rate ||
+				o.upload_payload_rate != n.upload_payload_rate ||
+				o.num_peers != n.num_peers ||
+				o.num_seeds != n.num_seeds ||
+				o.num_incomplete != n.num_incomplete ||
+				o.list_peers != n.list_peers ||
+				o.list_seeds != n.list_seeds)
+			mark (Core::ColumnProgress);
+
+		if (o.download_payload_rate != n.download_payload_rate)
+			mark (Core::ColumnDownSpeed);
+		if (o.upload_payload_rate != n.upload_payload_rate)
+			mark (Core::ColumnUpSpeed);
+		if (o.num_peers != n.num_peers ||
+				o.num_seeds != n.num_seeds)
+			mark (Core::ColumnLeechers);
+		if (o.num_seeds != n.num_seeds)
+			mark (Core::ColumnSeeders);
+		if (o.total_wanted != n.total_wanted)
+			mark (Core::ColumnSize);
+		if (o.all_time_download != n.all_time_download)
+		{
+			mark (Core::ColumnDownloaded);
+			mark (Core::ColumnRatio);
+		}
+		if (o.all_time_upload != n.all_time_upload)
+		{
+			mark (Core::ColumnUploaded);
+			mark (Core::ColumnRatio);
+		}
+
+		return mask;
+	}
+}
+}
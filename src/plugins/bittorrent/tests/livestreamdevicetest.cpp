@@ -0,0 +1,216 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "livestreamdevicetest.h"
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <libtorrent/session.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/alert_types.hpp>
+#include "livestreamdevice.h"
+
+QTEST_MAIN (LeechCraft::BitTorrent::LiveStreamDeviceTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		const int PieceSize = 64 * 1024;
+		const int DataSize = 48 * PieceSize + 1234;
+		const qint64 Timeout = 60000;
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		std::unique_ptr<libtorrent::session> MakeSession (int portFrom, int portTo)
+		{
+			std::unique_ptr<libtorrent::session> session
+			{
+				new libtorrent::session (libtorrent::fingerprint ("LC", 0, 0, 0, 0), 0)
+			};
+			session->set_alert_mask (libtorrent::alert::storage_notification |
+					libtorrent::alert::error_notification);
+
+			boost::system::error_code ec;
+			session->listen_on ({ portFrom, portTo }, ec);
+			if (ec)
+				qWarning () << Q_FUNC_INFO
+						<< "unable to listen:"
+						<< ec.message ().c_str ();
+			return session;
+		}
+
+		libtorrent::torrent_handle AddTorrent (libtorrent::session& session,
+				const std::vector<char>& torrent, const QString& savePath, bool seed)
+		{
+			boost::system::error_code ec;
+
+			libtorrent::add_torrent_params atp;
+			atp.ti = new libtorrent::torrent_info (&torrent [0], torrent.size (), ec);
+			atp.save_path = savePath.toUtf8 ().constData ();
+			atp.flags &= ~libtorrent::add_torrent_params::flag_auto_managed;
+			atp.flags &= ~libtorrent::add_torrent_params::flag_paused;
+			if (seed)
+				atp.flags |= libtorrent::add_torrent_params::flag_seed_mode;
+			return session.add_torrent (atp);
+		}
+
+		void DispatchAlerts (libtorrent::session& session, LiveStreamDevice& device)
+		{
+			std::deque<libtorrent::alert*> alerts;
+			session.pop_alerts (&alerts);
+			for (const auto alert : alerts)
+			{
+				if (const auto rpa = libtorrent::alert_cast<libtorrent::read_piece_alert> (alert))
+					device.PieceRead (*rpa);
+				delete alert;
+			}
+		}
+	}
+
+	void LiveStreamDeviceTest::initTestCase ()
+	{
+		Dir_ = QDir::temp ().filePath (QString ("lc_bittorrent_livestream_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		QVERIFY (QDir {}.mkpath (Dir_ + "/seed"));
+		QVERIFY (QDir {}.mkpath (Dir_ + "/leech"));
+
+		qsrand (42);
+		Data_.resize (DataSize);
+		for (auto& c : Data_)
+			c = static_cast<char> (qrand ());
+
+		const auto& dataPath = Dir_ + "/seed/stream.bin";
+		{
+			QFile file (dataPath);
+			QVERIFY (file.open (QIODevice::WriteOnly));
+			QCOMPARE (file.write (Data_), static_cast<qint64> (DataSize));
+		}
+
+		libtorrent::file_storage fs;
+		libtorrent::add_files (fs, dataPath.toUtf8 ().constData ());
+		libtorrent::create_torrent ct (fs, PieceSize);
+
+		boost::system::error_code ec;
+		libtorrent::set_piece_hashes (ct, (Dir_ + "/seed").toUtf8 ().constData (), ec);
+		QVERIFY2 (!ec, ec.message ().c_str ());
+
+		libtorrent::bencode (std::back_inserter (Torrent_), ct.generate ());
+	}
+
+	void LiveStreamDeviceTest::cleanupTestCase ()
+	{
+		RemoveDir (Dir_);
+	}
+
+	void LiveStreamDeviceTest::readsFromLocalSeeder ()
+	{
+		const auto seeder = MakeSession (47300, 47400);
+		const auto leecher = MakeSession (47401, 47500);
+
+		AddTorrent (*seeder, Torrent_, Dir_ + "/seed", true);
+		const auto& handle = AddTorrent (*leecher, Torrent_, Dir_ + "/leech", false);
+		handle.connect_peer (libtorrent::tcp::endpoint (libtorrent::address_v4::loopback (),
+					seeder->listen_port ()));
+
+		LiveStreamDevice device (handle);
+		QCOMPARE (device.size (), static_cast<qint64> (DataSize));
+
+		QByteArray result;
+		int midStreamChecks = 0;
+		QElapsedTimer timer;
+		timer.start ();
+		while (result.size () < DataSize && timer.elapsed () < Timeout)
+		{
+			QTest::qWait (50);
+			DispatchAlerts (*leecher, device);
+			device.CheckReady ();
+
+			/* Read at most a piece at a time so that the stream is
+			 * checked while it's still partially consumed.
+			 */
+			const auto available = device.bytesAvailable ();
+			QCOMPARE (available, device.GetBufferedAhead ());
+			QVERIFY (available <= DataSize - result.size ());
+
+			const auto& chunk = device.read (std::min<qint64> (available, PieceSize));
+			QCOMPARE (static_cast<qint64> (chunk.size ()), std::min<qint64> (available, PieceSize));
+			result += chunk;
+
+			if (!result.isEmpty () && result.size () < DataSize)
+			{
+				QCOMPARE (device.pos (), static_cast<qint64> (result.size ()));
+				QVERIFY (result == Data_.left (result.size ()));
+				++midStreamChecks;
+			}
+		}
+
+		QCOMPARE (result.size (), DataSize);
+		QVERIFY (midStreamChecks > 0);
+		QVERIFY (result == Data_);
+		QCOMPARE (device.pos (), static_cast<qint64> (DataSize));
+		QCOMPARE (device.bytesAvailable (), 0LL);
+	}
+
+	void LiveStreamDeviceTest::stallIsCountedOnce ()
+	{
+		const auto leecher = MakeSession (47501, 47600);
+		const auto& handle = AddTorrent (*leecher, Torrent_, Dir_ + "/leech_nopeers", false);
+
+		LiveStreamDevice device (handle);
+		QCOMPARE (device.GetStallsCount (), 0);
+
+		char buf [16];
+		QCOMPARE (device.read (buf, sizeof (buf)), 0LL);
+		QCOMPARE (device.read (buf, sizeof (buf)), 0LL);
+		QCOMPARE (device.GetStallsCount (), 1);
+
+		QVERIFY (device.seek (PieceSize));
+		QCOMPARE (device.read (buf, sizeof (buf)), 0LL);
+		QCOMPARE (device.GetStallsCount (), 2);
+	}
+}
+}
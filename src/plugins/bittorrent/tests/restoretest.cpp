@@ -0,0 +1,180 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "restoretest.h"
+#include <deque>
+#include <iterator>
+#include <vector>
+#include <QtTest>
+#include <QtConcurrentMap>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <libtorrent/session.hpp>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/hasher.hpp>
+#include <libtorrent/alert_types.hpp>
+
+QTEST_MAIN (LeechCraft::BitTorrent::RestoreTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		const int TorrentsCount = 5000;
+		const int PieceSize = 16 * 1024;
+
+		// The same limit Core uses to keep the alerts queue from overflowing.
+		const int MaxPending = 200;
+		const qint64 Timeout = 300000;
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		struct Loaded
+		{
+			libtorrent::add_torrent_params Params_;
+			bool Valid_ = false;
+		};
+
+		/* Mirrors Core::LoadSavedTorrent(): reads and decodes a saved
+		 * torrent in a worker thread.
+		 */
+		Loaded Load (const QString& path)
+		{
+			Loaded result;
+
+			QFile file (path);
+			if (!file.open (QIODevice::ReadOnly))
+				return result;
+
+			const auto& data = file.readAll ();
+
+			boost::system::error_code ec;
+			result.Params_.ti = new libtorrent::torrent_info (data.constData (), data.size (), ec);
+			result.Params_.save_path = QDir::tempPath ().toUtf8 ().constData ();
+			result.Params_.flags |= libtorrent::add_torrent_params::flag_paused;
+			result.Valid_ = !ec;
+			return result;
+		}
+	}
+
+	void RestoreTest::initTestCase ()
+	{
+		Dir_ = QDir::temp ().filePath (QString ("lc_bittorrent_restore_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		QVERIFY (QDir {}.mkpath (Dir_));
+
+		for (int i = 0; i < TorrentsCount; ++i)
+		{
+			const auto& name = QString ("torrent_%1.bin").arg (i);
+
+			libtorrent::file_storage fs;
+			fs.add_file (name.toUtf8 ().constData (), PieceSize);
+			libtorrent::create_torrent ct (fs, PieceSize);
+			ct.set_hash (0, libtorrent::hasher (name.toUtf8 ().constData (), name.size ()).final ());
+
+			std::vector<char> torrent;
+			libtorrent::bencode (std::back_inserter (torrent), ct.generate ());
+
+			const auto& path = Dir_ + "/" + name + ".torrent";
+			QFile file (path);
+			QVERIFY (file.open (QIODevice::WriteOnly));
+			QCOMPARE (file.write (&torrent [0], torrent.size ()), static_cast<qint64> (torrent.size ()));
+			Files_ << path;
+		}
+	}
+
+	void RestoreTest::cleanupTestCase ()
+	{
+		RemoveDir (Dir_);
+	}
+
+	void RestoreTest::benchRestore ()
+	{
+		QBENCHMARK
+		{
+			libtorrent::session session (libtorrent::fingerprint ("LC", 0, 0, 0, 0), 0);
+			session.set_alert_mask (libtorrent::alert::status_notification |
+					libtorrent::alert::error_notification);
+
+			const auto& future = QtConcurrent::mapped (Files_, &Load);
+
+			int next = 0;
+			int pending = 0;
+			int added = 0;
+
+			QElapsedTimer timer;
+			timer.start ();
+			while (added < TorrentsCount && timer.elapsed () < Timeout)
+			{
+				while (next < TorrentsCount &&
+						pending < MaxPending &&
+						future.isResultReadyAt (next))
+				{
+					const auto& loaded = future.resultAt (next++);
+					QVERIFY (loaded.Valid_);
+					session.async_add_torrent (loaded.Params_);
+					++pending;
+				}
+
+				if (!session.wait_for_alert (libtorrent::milliseconds (10)))
+					continue;
+
+				std::deque<libtorrent::alert*> alerts;
+				session.pop_alerts (&alerts);
+				for (const auto alert : alerts)
+				{
+					if (const auto ata = libtorrent::alert_cast<libtorrent::add_torrent_alert> (alert))
+					{
+						--pending;
+						if (!ata->error)
+							++added;
+					}
+					delete alert;
+				}
+			}
+
+			QCOMPARE (added, TorrentsCount);
+			QCOMPARE (static_cast<int> (session.get_torrents ().size ()), TorrentsCount);
+		}
+	}
+}
+}
@@ -0,0 +1,107 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "resumedatasavertest.h"
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include "resumedatasaver.h"
+
+QTEST_MAIN (LeechCraft::BitTorrent::ResumeDataSaverTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		QByteArray ReadFile (const QString& path)
+		{
+			QFile file (path);
+			if (!file.open (QIODevice::ReadOnly))
+				return {};
+			return file.readAll ();
+		}
+	}
+
+	void ResumeDataSaverTest::init ()
+	{
+		Dir_ = QDir::temp ().filePath (QString ("lc_bittorrent_resumedata_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		QVERIFY (QDir {}.mkpath (Dir_));
+	}
+
+	void ResumeDataSaverTest::cleanup ()
+	{
+		QDir dir (Dir_);
+		for (const auto& name : dir.entryList (QDir::Files | QDir::Hidden))
+			dir.remove (name);
+		QDir {}.rmdir (Dir_);
+	}
+
+	void ResumeDataSaverTest::writesFiles ()
+	{
+		ResumeDataSaver saver (Dir_);
+		saver.Add ("a.torrent.resume", "first");
+		saver.Add ("b.torrent.resume", "second");
+		saver.Finish ();
+
+		QCOMPARE (ReadFile (Dir_ + "/a.torrent.resume"), QByteArray ("first"));
+		QCOMPARE (ReadFile (Dir_ + "/b.torrent.resume"), QByteArray ("second"));
+		QCOMPARE (QDir (Dir_).entryList (QDir::Files | QDir::Hidden).size (), 2);
+	}
+
+	void ResumeDataSaverTest::replacesExistingFile ()
+	{
+		const auto& path = Dir_ + "/a.torrent.resume";
+		{
+			QFile file (path);
+			QVERIFY (file.open (QIODevice::WriteOnly));
+			file.write ("some much longer old resume data");
+		}
+
+		ResumeDataSaver saver (Dir_);
+		saver.Add ("a.torrent.resume", "new");
+		saver.Finish ();
+
+		QCOMPARE (ReadFile (path), QByteArray ("new"));
+		QVERIFY (!QFile::exists (path + ".new"));
+	}
+
+	void ResumeDataSaverTest::latestDataWins ()
+	{
+		ResumeDataSaver saver (Dir_);
+		saver.Add ("a.torrent.resume", "old");
+		saver.Add ("a.torrent.resume", "new");
+		saver.Finish ();
+
+		QCOMPARE (ReadFile (Dir_ + "/a.torrent.resume"), QByteArray ("new"));
+	}
+}
+}
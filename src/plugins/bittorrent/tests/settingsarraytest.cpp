@@ -0,0 +1,130 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "settingsarraytest.h"
+#include <QtTest>
+#include <QSettings>
+#include <QDir>
+#include "settingsarray.h"
+
+QTEST_MAIN (LeechCraft::BitTorrent::SettingsArrayTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		void Write (const QString& path, int size, bool rewriteAll, const QMap<int, QString>& entries)
+		{
+			QSettings settings (path, QSettings::IniFormat);
+			settings.beginGroup ("Core");
+			BeginWriteArray (settings, "AddedTorrents", size, rewriteAll);
+			for (auto i = entries.begin (), end = entries.end (); i != end; ++i)
+			{
+				settings.setArrayIndex (i.key ());
+				settings.setValue ("Filename", i.value ());
+			}
+			settings.endArray ();
+			settings.endGroup ();
+		}
+
+		QStringList Read (const QString& path)
+		{
+			QSettings settings (path, QSettings::IniFormat);
+			settings.beginGroup ("Core");
+
+			QStringList result;
+			const auto size = settings.beginReadArray ("AddedTorrents");
+			for (int i = 0; i < size; ++i)
+			{
+				settings.setArrayIndex (i);
+				result << settings.value ("Filename").toString ();
+			}
+			settings.endArray ();
+			settings.endGroup ();
+			return result;
+		}
+
+		QMap<int, QString> MakeEntries (const QStringList& names)
+		{
+			QMap<int, QString> result;
+			for (int i = 0; i < names.size (); ++i)
+				result [i] = names.at (i);
+			return result;
+		}
+	}
+
+	void SettingsArrayTest::init ()
+	{
+		Path_ = QDir::temp ().filePath (QString ("lc_bittorrent_settingsarray_test_%1.ini")
+					.arg (QCoreApplication::applicationPid ()));
+		QFile::remove (Path_);
+	}
+
+	void SettingsArrayTest::cleanup ()
+	{
+		QFile::remove (Path_);
+	}
+
+	void SettingsArrayTest::rewriteKeepsSize ()
+	{
+		const QStringList names { "a.torrent", "b.torrent", "c.torrent" };
+		Write (Path_, names.size (), true, MakeEntries (names));
+		QCOMPARE (Read (Path_), names);
+
+		Write (Path_, names.size (), true, MakeEntries (names));
+		QCOMPARE (Read (Path_), names);
+	}
+
+	void SettingsArrayTest::partialUpdateKeepsEntries ()
+	{
+		const QStringList names { "a.torrent", "b.torrent", "c.torrent" };
+		Write (Path_, names.size (), true, MakeEntries (names));
+
+		QMap<int, QString> changed;
+		changed [1] = "d.torrent";
+		Write (Path_, names.size (), false, changed);
+
+		QCOMPARE (Read (Path_), (QStringList { "a.torrent", "d.torrent", "c.torrent" }));
+	}
+
+	void SettingsArrayTest::rewriteDropsStaleEntries ()
+	{
+		Write (Path_, 3, true, MakeEntries ({ "a.torrent", "b.torrent", "c.torrent" }));
+
+		const QStringList names { "c.torrent", "a.torrent" };
+		Write (Path_, names.size (), true, MakeEntries (names));
+		QCOMPARE (Read (Path_), names);
+
+		QSettings settings (Path_, QSettings::IniFormat);
+		QVERIFY (!settings.contains ("Core/AddedTorrents/3/Filename"));
+	}
+}
+}
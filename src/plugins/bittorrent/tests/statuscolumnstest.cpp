@@ -0,0 +1,149 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "statuscolumnstest.h"
+#include <QtTest>
+#include <libtorrent/torrent_handle.hpp>
+#include "statuscolumns.h"
+#include "core.h"
+
+QTEST_MAIN (LeechCraft::BitTorrent::StatusColumnsTest)
+
+namespace LeechCraft
+{
+namespace BitTorrent
+{
+	namespace
+	{
+		bool HasColumn (int mask, int column)
+		{
+			return mask & (1 << column);
+		}
+
+		libtorrent::torrent_status MakeStatus (int num)
+		{
+			libtorrent::torrent_status status;
+			status.state = num % 3 ?
+					libtorrent::torrent_status::seeding :
+					libtorrent::torrent_status::downloading;
+			status.total_wanted = 1024 * 1024 * (num + 1);
+			status.total_wanted_done = status.total_wanted / 2;
+			status.progress = 0.5;
+			status.download_rate = 1024 * (num % 100);
+			status.download_payload_rate = status.download_rate;
+			status.upload_rate = 512 * (num % 50);
+			status.upload_payload_rate = status.upload_rate;
+			status.num_peers = num % 20;
+			status.num_seeds = num % 5;
+			status.all_time_download = status.total_wanted_done;
+			status.all_time_upload = num * 1024;
+			return status;
+		}
+	}
+
+	void StatusColumnsTest::unchangedStatus ()
+	{
+		const auto& status = MakeStatus (0);
+		QCOMPARE (GetChangedColumns (status, status), 0);
+	}
+
+	void StatusColumnsTest::rateChangeMarksSpeedAndEta ()
+	{
+		const auto& o = MakeStatus (0);
+		QCOMPARE (o.state, libtorrent::torrent_status::downloading);
+
+		auto n = o;
+		n.download_rate += 1024;
+		n.download_payload_rate += 1024;
+
+		const auto mask = GetChangedColumns (o, n);
+		QVERIFY (HasColumn (mask, Core::ColumnDownSpeed));
+		QVERIFY (HasColumn (mask, Core::ColumnState));
+		QVERIFY (!HasColumn (mask, Core::ColumnUpSpeed));
+		QVERIFY (!HasColumn (mask, Core::ColumnSize));
+	}
+
+	void StatusColumnsTest::seedingRateChangeKeepsState ()
+	{
+		const auto& o = MakeStatus (1);
+		QCOMPARE (o.state, libtorrent::torrent_status::seeding);
+
+		auto n = o;
+		n.download_rate += 1024;
+
+		QVERIFY (!HasColumn (GetChangedColumns (o, n), Core::ColumnState));
+	}
+
+	void StatusColumnsTest::uploadMarksRatio ()
+	{
+		const auto& o = MakeStatus (1);
+		auto n = o;
+		n.all_time_upload += 1024;
+
+		const auto mask = GetChangedColumns (o, n);
+		QVERIFY (HasColumn (mask, Core::ColumnUploaded));
+		QVERIFY (HasColumn (mask, Core::ColumnRatio));
+		QVERIFY (!HasColumn (mask, Core::ColumnDownloaded));
+	}
+
+	void StatusColumnsTest::benchDiff10k ()
+	{
+		const int count = 10000;
+
+		std::vector<libtorrent::torrent_status> olds;
+		std::vector<libtorrent::torrent_status> news;
+		olds.reserve (count);
+		news.reserve (count);
+		for (int i = 0; i < count; ++i)
+		{
+			olds.push_back (MakeStatus (i));
+
+			// Roughly a tenth of the torrents is active in each update.
+			auto status = olds.back ();
+			if (!(i % 10))
+			{
+				status.upload_payload_rate += 1024;
+				status.all_time_upload += 1024;
+			}
+			news.push_back (status);
+		}
+
+		int changed = 0;
+		QBENCHMARK
+		{
+			changed = 0;
+			for (int i = 0; i < count; ++i)
+				if (GetChangedColumns (olds [i], news [i]))
+					++changed;
+		}
+
+		QCOMPARE (changed, count / 10);
+	}
+}
+}
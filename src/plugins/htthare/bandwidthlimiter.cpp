@@ -0,0 +1,91 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "bandwidthlimiter.h"
+#include <algorithm>
+#include <QMutexLocker>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	BandwidthLimiter::BandwidthLimiter ()
+	: Limit_ { 0 }
+	{
+	}
+
+	void BandwidthLimiter::SetLimit (qint64 limit)
+	{
+		Limit_ = limit;
+
+		QMutexLocker locker { &Lock_ };
+		Buckets_.clear ();
+	}
+
+	bool BandwidthLimiter::IsEnabled () const
+	{
+		return Limit_ > 0;
+	}
+
+	qint64 BandwidthLimiter::Acquire (const QString& client, qint64 wanted)
+	{
+		const qint64 limit = Limit_;
+		if (limit <= 0)
+			return wanted;
+
+		const auto now = std::chrono::steady_clock::now ();
+
+		QMutexLocker locker { &Lock_ };
+
+		if (Buckets_.size () > 1024)
+			for (auto i = Buckets_.begin (); i != Buckets_.end (); )
+				if (now - i->LastRefill_ > std::chrono::seconds (1))
+					i = Buckets_.erase (i);
+				else
+					++i;
+
+		if (!Buckets_.contains (client))
+			Buckets_ [client] = { limit, now };
+
+		auto& bucket = Buckets_ [client];
+
+		const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds> (now - bucket.LastRefill_).count ();
+		const auto refill = elapsedMs * limit / 1000;
+		if (refill > 0)
+		{
+			bucket.Tokens_ = std::min (limit, bucket.Tokens_ + refill);
+			bucket.LastRefill_ = now;
+		}
+
+		const auto allowed = std::min (wanted, bucket.Tokens_);
+		bucket.Tokens_ -= allowed;
+		return allowed;
+	}
+}
+}
@@ -0,0 +1,84 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <QMutex>
+#include <QHash>
+#include <QString>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	/** @brief Per-client token bucket bandwidth limiter.
+	 *
+	 * All the connections from the same client address share a single
+	 * bucket refilled at the configured rate and holding up to a second
+	 * worth of traffic.
+	 */
+	class BandwidthLimiter
+	{
+		std::atomic<qint64> Limit_;
+
+		struct Bucket
+		{
+			qint64 Tokens_;
+			std::chrono::steady_clock::time_point LastRefill_;
+		};
+
+		QMutex Lock_;
+		QHash<QString, Bucket> Buckets_;
+	public:
+		BandwidthLimiter ();
+
+		BandwidthLimiter (const BandwidthLimiter&) = delete;
+		BandwidthLimiter& operator= (const BandwidthLimiter&) = delete;
+
+		/** @brief Sets the per-client limit in bytes per second.
+		 *
+		 * A limit of 0 disables limiting.
+		 */
+		void SetLimit (qint64);
+
+		bool IsEnabled () const;
+
+		/** @brief Returns how many bytes the client may send right now.
+		 *
+		 * @param[in] client The address of the client.
+		 * @param[in] wanted The number of bytes the caller wants to send.
+		 * @return The number of bytes not greater than wanted that may be
+		 * sent now, or 0 if the caller should wait a bit and try again.
+		 */
+		qint64 Acquire (const QString& client, qint64 wanted);
+	};
+}
+}
@@ -30,22 +30,38 @@
 #include "connection.h"
 #include <QtDebug>
 #include "requesthandler.h"
+#include "serverstats.h"
+#include "idlepool.h"
 
 namespace LeechCraft
 {
 namespace HttHare
 {
 	Connection::Connection (boost::asio::io_service& service,
-			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr)
+			const StorageManager& stMgr, IconResolver *resolver, TrManager *trMgr,
+			ListingsCache *listingsCache, ServerStats *stats, BandwidthLimiter *limiter,
+			IdlePool *idlePool)
 	: Strand_ { service }
 	, Socket_ { service }
+	, IdleTimer_ { service }
+	, ShapingTimer_ { service }
 	, StorageMgr_ (stMgr)
 	, IconResolver_ { resolver }
 	, TrManager_ { trMgr }
+	, ListingsCache_ { listingsCache }
+	, Stats_ { stats }
+	, Limiter_ { limiter }
+	, IdlePool_ { idlePool }
 	, Buf_ { 2 * 1024 }
 	{
 	}
 
+	Connection::~Connection ()
+	{
+		if (Counted_.exchange (false))
+			Stats_->RemoveConnection ();
+	}
+
 	boost::asio::ip::tcp::socket& Connection::GetSocket ()
 	{
 		return Socket_;
@@ -66,14 +82,75 @@ namespace HttHare
 		return TrManager_;
 	}
 
+	ListingsCache* Connection::GetListingsCache () const
+	{
+		return ListingsCache_;
+	}
+
+	ServerStats* Connection::GetStats () const
+	{
+		return Stats_;
+	}
+
+	BandwidthLimiter* Connection::GetBandwidthLimiter () const
+	{
+		return Limiter_;
+	}
+
+	const QString& Connection::GetClientAddress () const
+	{
+		return ClientAddress_;
+	}
+
+	boost::asio::deadline_timer& Connection::GetShapingTimer ()
+	{
+		return ShapingTimer_;
+	}
+
 	const StorageManager& Connection::GetStorageManager () const
 	{
 		return StorageMgr_;
 	}
 
+	namespace
+	{
+		const auto IdleTimeout = 30;
+	}
+
+	bool Connection::Accept ()
+	{
+		if (!Stats_->TryAddConnection ())
+			return false;
+
+		Counted_ = true;
+
+		boost::system::error_code ec;
+		const auto& endpoint = Socket_.remote_endpoint (ec);
+		if (!ec)
+			ClientAddress_ = QString::fromStdString (endpoint.address ().to_string ());
+
+		Start ();
+		return true;
+	}
+
 	void Connection::Start ()
 	{
 		auto conn = shared_from_this ();
+
+		std::weak_ptr<Connection> weakConn { conn };
+		IdleTimer_.expires_from_now (boost::posix_time::seconds (IdleTimeout));
+		IdleTimer_.async_wait (Strand_.wrap ([weakConn] (const boost::system::error_code& ec)
+					{
+						if (ec == boost::asio::error::operation_aborted)
+							return;
+
+						if (const auto conn = weakConn.lock ())
+						{
+							boost::system::error_code iec;
+							conn->Socket_.close (iec);
+						}
+					}));
+
 		boost::asio::async_read_until (Socket_,
 				Buf_,
 				std::string { "\r\n\r\n" },
@@ -81,15 +158,69 @@ namespace HttHare
 					{ conn->HandleHeader (ec, transferred); }));
 	}
 
-	void Connection::HandleHeader (const boost::system::error_code&, unsigned long transferred)
+	void Connection::FinishRequest (bool keepAlive)
 	{
+		if (keepAlive)
+		{
+			Pooled_ = true;
+			IdlePool_->Add (shared_from_this ());
+			Start ();
+			return;
+		}
+
+		boost::system::error_code ec;
+		Socket_.shutdown (boost::asio::socket_base::shutdown_both, ec);
+	}
+
+	void Connection::CloseIdle ()
+	{
+		if (Counted_.exchange (false))
+			Stats_->RemoveConnection ();
+
+		auto conn = shared_from_this ();
+		Strand_.post ([conn]
+				{
+					boost::system::error_code ec;
+					conn->IdleTimer_.cancel (ec);
+					conn->Socket_.close (ec);
+				});
+	}
+
+	void Connection::HandleHeader (const boost::system::error_code& ec, unsigned long transferred)
+	{
+		/* If the connection isn't in the pool anymore, it has been
+		 * taken for closing by another thread, which has already freed
+		 * its slot, so the request must not be served.
+		 */
+		if (Pooled_)
+		{
+			Pooled_ = false;
+			if (!IdlePool_->Remove (this))
+				return;
+		}
+
+		boost::system::error_code iec;
+		IdleTimer_.cancel (iec);
+
+		if (ec)
+		{
+			if (ec != boost::asio::error::eof &&
+					ec != boost::asio::error::operation_aborted)
+				qWarning () << Q_FUNC_INFO
+						<< ec.message ().c_str ();
+
+			Socket_.shutdown (boost::asio::socket_base::shutdown_both, iec);
+			return;
+		}
+
 		QByteArray data;
 		data.resize (transferred);
 
 		std::istream istr (&Buf_);
 		istr.read (data.data (), transferred);
 
-		RequestHandler { shared_from_this () } (data);
+		const auto handler = std::make_shared<RequestHandler> (shared_from_this ());
+		(*handler) (data);
 	}
 }
 }
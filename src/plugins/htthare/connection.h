@@ -29,8 +29,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <boost/asio.hpp>
+#include <QString>
 
 namespace LeechCraft
 {
@@ -39,19 +41,38 @@ namespace HttHare
 	class StorageManager;
 	class IconResolver;
 	class TrManager;
+	class ListingsCache;
+	class ServerStats;
+	class BandwidthLimiter;
+	class IdlePool;
 
 	class Connection : public std::enable_shared_from_this<Connection>
 	{
 		boost::asio::io_service::strand Strand_;
 		boost::asio::ip::tcp::socket Socket_;
+		boost::asio::deadline_timer IdleTimer_;
+		boost::asio::deadline_timer ShapingTimer_;
 
 		const StorageManager& StorageMgr_;
 		IconResolver * const IconResolver_;
 		TrManager * const TrManager_;
+		ListingsCache * const ListingsCache_;
+		ServerStats * const Stats_;
+		BandwidthLimiter * const Limiter_;
+		IdlePool * const IdlePool_;
+
+		std::atomic<bool> Counted_ { false };
+		// Whether this connection has been put to the idle pool; only
+		// accessed from the strand.
+		bool Pooled_ = false;
+		QString ClientAddress_;
 
 		boost::asio::streambuf Buf_;
 	public:
-		Connection (boost::asio::io_service&, const StorageManager&, IconResolver*, TrManager*);
+		Connection (boost::asio::io_service&, const StorageManager&,
+				IconResolver*, TrManager*, ListingsCache*,
+				ServerStats*, BandwidthLimiter*, IdlePool*);
+		~Connection ();
 
 		Connection (const Connection&) = delete;
 		Connection& operator= (const Connection&) = delete;
@@ -60,10 +81,33 @@ namespace HttHare
 		boost::asio::io_service::strand& GetStrand ();
 		IconResolver* GetIconResolver () const;
 		TrManager* GetTrManager () const;
+		ListingsCache* GetListingsCache () const;
+		ServerStats* GetStats () const;
+		BandwidthLimiter* GetBandwidthLimiter () const;
+
+		const QString& GetClientAddress () const;
+		boost::asio::deadline_timer& GetShapingTimer ();
 
 		const StorageManager& GetStorageManager () const;
 
+		/** Registers the just accepted connection and starts handling
+		 * it, unless the connections limit is reached.
+		 *
+		 * @return Whether the connection has been accepted.
+		 */
+		bool Accept ();
+
 		void Start ();
+
+		/** Either waits for the next request on this connection if
+		 * keepAlive is true or closes the connection otherwise.
+		 */
+		void FinishRequest (bool keepAlive);
+
+		/** Closes this idle connection to make room for a new one, freeing
+		 * its slot in the connections limit right away.
+		 */
+		void CloseIdle ();
 	private:
 		void HandleHeader (const boost::system::error_code&, unsigned long);
 	};
@@ -61,6 +61,9 @@ namespace HttHare
 		XmlSettingsManager::Instance ().RegisterObject ("EnableServer",
 				this, "handleEnableServerChanged");
 		handleEnableServerChanged ();
+
+		XmlSettingsManager::Instance ().RegisterObject ({ "MaxConnections", "ClientBandwidthLimit" },
+				this, "handleLimitsChanged");
 	}
 
 	void Plugin::SecondInit ()
@@ -109,10 +112,21 @@ namespace HttHare
 		else
 		{
 			S_.reset (new Server { AddrMgr_->GetAddresses () });
+			handleLimitsChanged ();
 			S_->Start ();
 		}
 	}
 
+	void Plugin::handleLimitsChanged ()
+	{
+		if (!S_)
+			return;
+
+		auto& xsm = XmlSettingsManager::Instance ();
+		S_->SetMaxConnections (xsm.property ("MaxConnections").toInt ());
+		S_->SetClientBandwidthLimit (xsm.property ("ClientBandwidthLimit").toLongLong () * 1024);
+	}
+
 	void Plugin::reapplyAddresses ()
 	{
 		if (!S_)
@@ -126,6 +140,7 @@ namespace HttHare
 		loop.exec ();
 
 		S_.reset (new Server { AddrMgr_->GetAddresses () });
+		handleLimitsChanged ();
 		S_->Start ();
 	}
 }
@@ -71,6 +71,7 @@ namespace HttHare
 	private slots:
 		void handleEnableServerChanged ();
 		void reapplyAddresses ();
+		void handleLimitsChanged ();
 	};
 }
 }
@@ -0,0 +1,72 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <list>
+#include <memory>
+#include <QMutex>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	class Connection;
+
+	/** Keeps track of the keep-alive connections waiting for the next
+	 * request, so that they can be closed to make room for new clients
+	 * when the connections limit is reached.
+	 */
+	class IdlePool
+	{
+		QMutex Lock_;
+		std::list<std::weak_ptr<Connection>> Idle_;
+	public:
+		IdlePool () = default;
+
+		IdlePool (const IdlePool&) = delete;
+		IdlePool& operator= (const IdlePool&) = delete;
+
+		void Add (const std::shared_ptr<Connection>&);
+
+		/** Removes the given connection from the pool.
+		 *
+		 * @return Whether the connection was still in the pool, that
+		 * is, whether it hasn't been taken by TakeOldest() for closing.
+		 */
+		bool Remove (const Connection*);
+
+		/** Removes the connection that has been idle for the longest time
+		 * from the pool and returns it, or returns a null pointer if
+		 * there are no idle connections.
+		 */
+		std::shared_ptr<Connection> TakeOldest ();
+	};
+}
+}
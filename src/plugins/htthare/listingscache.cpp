@@ -0,0 +1,77 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "listingscache.h"
+#include <QMutexLocker>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const qint64 EntryTTL = 10 * 1000;
+	}
+
+	ListingsCache::ListingsCache ()
+	: Cache_ { 16 * 1024 * 1024 }
+	{
+	}
+
+	bool ListingsCache::Get (const QString& key, const QDateTime& modified, Listing& listing)
+	{
+		QMutexLocker locker { &Lock_ };
+
+		const auto entry = Cache_.object (key);
+		if (!entry)
+			return false;
+
+		if (entry->Modified_ != modified ||
+				entry->Age_.hasExpired (EntryTTL))
+		{
+			Cache_.remove (key);
+			return false;
+		}
+
+		listing = entry->Listing_;
+		return true;
+	}
+
+	void ListingsCache::Put (const QString& key, const QDateTime& modified, const Listing& listing)
+	{
+		QMutexLocker locker { &Lock_ };
+
+		const auto entry = new Entry { modified, {}, listing };
+		entry->Age_.start ();
+		Cache_.insert (key,
+				entry,
+				listing.Body_.size () + listing.Deflated_.size ());
+	}
+}
+}
@@ -0,0 +1,77 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QMutex>
+#include <QCache>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QByteArray>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	/** Caches rendered directory listings.
+	 *
+	 * An entry is dropped when the modification time of the directory
+	 * changes. Since files growing or being touched inside the directory
+	 * don't change its modification time, entries also expire after a
+	 * short while so that the listed sizes and dates don't get stale.
+	 */
+	class ListingsCache
+	{
+	public:
+		struct Listing
+		{
+			QByteArray Body_;
+			QByteArray Deflated_;
+		};
+	private:
+		struct Entry
+		{
+			QDateTime Modified_;
+			QElapsedTimer Age_;
+			Listing Listing_;
+		};
+
+		QMutex Lock_;
+		QCache<QString, Entry> Cache_;
+	public:
+		ListingsCache ();
+
+		ListingsCache (const ListingsCache&) = delete;
+		ListingsCache& operator= (const ListingsCache&) = delete;
+
+		bool Get (const QString& key, const QDateTime& modified, Listing& listing);
+		void Put (const QString& key, const QDateTime& modified, const Listing& listing);
+	};
+}
+}
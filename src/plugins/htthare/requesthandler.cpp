@@ -42,18 +42,23 @@
 #endif
 
 #include <errno.h>
+#include <array>
 #include <QList>
 #include <QString>
 #include <QtDebug>
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QLocale>
 #include <util/util.h>
 #include <util/sys/mimedetector.h>
 #include "connection.h"
 #include "storagemanager.h"
 #include "iconresolver.h"
 #include "trmanager.h"
+#include "listingscache.h"
+#include "serverstats.h"
+#include "bandwidthlimiter.h"
 
 namespace LeechCraft
 {
@@ -62,6 +67,8 @@ namespace HttHare
 	RequestHandler::RequestHandler (const Connection_ptr& conn)
 	: Conn_ (conn)
 	{
+		Timer_.start ();
+
 		ResponseHeaders_.append ({ "Accept-Ranges", "bytes" });
 	}
 
@@ -89,9 +96,16 @@ namespace HttHare
 			const auto colonPos = line.indexOf (':');
 			if (colonPos <= 0)
 				return ErrorResponse (400, "Bad Request");
-			Headers_ [line.left (colonPos)] = line.mid (colonPos + 1).trimmed ();
+			// Header names are case-insensitive, so they're looked up in lowercase.
+			Headers_ [line.left (colonPos).toLower ()] = line.mid (colonPos + 1).trimmed ();
 		}
 
+		const auto& connHeader = Headers_.value ("connection").toLower ();
+		if (req.value (2) == "HTTP/1.1")
+			KeepAlive_ = connHeader != "close";
+		else
+			KeepAlive_ = connHeader == "keep-alive";
+
 #ifdef QT_DEBUG
 		qDebug () << Q_FUNC_INFO << "got request";
 		qDebug () << req << Url_;
@@ -99,7 +113,10 @@ namespace HttHare
 			qDebug () << '\t' << i.key () << ": " << i.value ();
 #endif
 
-		if (verb == "head")
+		if (Url_.path () == "/.htthare/metrics" &&
+				(verb == "head" || verb == "get"))
+			WriteMetrics (verb == "head" ? Verb::Head : Verb::Get);
+		else if (verb == "head")
 			HandleRequest (Verb::Head);
 		else if (verb == "get")
 			HandleRequest (Verb::Get);
@@ -110,7 +127,7 @@ namespace HttHare
 
 	QString RequestHandler::Tr (const char *msg)
 	{
-		auto locales = Headers_ ["Accept-Language"].split (',');
+		auto locales = Headers_ ["accept-language"].split (',');
 		locales.removeAll ("*");
 		for (auto& locale : locales)
 		{
@@ -131,6 +148,11 @@ namespace HttHare
 	{
 		ResponseLine_ = "HTTP/1.1 " + QByteArray::number (code) + " " + reason + "\r\n";
 
+		/* The rest of a malformed or unsupported request (like its body)
+		 * can't be reliably skipped, so the connection can't be reused.
+		 */
+		KeepAlive_ = false;
+
 		ResponseBody_ = QString (R"delim(<html>
 				<head><title>%1 %2</title></head>
 				<body>
@@ -311,7 +333,7 @@ namespace HttHare
 
 		struct Sendfiler
 		{
-			boost::asio::ip::tcp::socket& Sock_;
+			Connection_ptr Conn_;
 			std::shared_ptr<QFile> File_;
 			off_t Offset_;
 
@@ -322,30 +344,49 @@ namespace HttHare
 
 			void operator() (boost::system::error_code ec, ulong)
 			{
+				auto& sock = Conn_->GetSocket ();
+				const auto limiter = Conn_->GetBandwidthLimiter ();
+
 				for (qint64 toTransfer = CurrentRange_.second - CurrentRange_.first + 1; toTransfer > 0; )
 				{
+					const auto chunk = limiter->Acquire (Conn_->GetClientAddress (), toTransfer);
+					if (!chunk)
+					{
+						auto& timer = Conn_->GetShapingTimer ();
+						timer.expires_from_now (boost::posix_time::milliseconds (50));
+
+						auto sendfiler = *this;
+						timer.async_wait (Conn_->GetStrand ().wrap ([sendfiler] (const boost::system::error_code& ec) mutable
+								{
+									if (ec == boost::asio::error::operation_aborted)
+										return;
+
+									sendfiler (ec, 0);
+								}));
+						return;
+					}
+
 					off_t offset = CurrentRange_.first;
 #ifdef Q_OS_LINUX
-					const auto rc = sendfile (Sock_.native_handle (),
-							File_->handle (), &offset, toTransfer);
+					const auto rc = sendfile (sock.native_handle (),
+							File_->handle (), &offset, chunk);
 					const auto transferred = rc > 0 ? rc : 0;
-					const auto errCode = rc > 0 ? 0 : errno;
+					const auto errCode = rc < 0 ? errno : 0;
 #elif defined (Q_OS_FREEBSD)
-					off_t transferred = toTransfer;
-					const auto rc = sendfile (File_->handle (), Sock_.native_handle (),
-							offset, toTransfer, nullptr, &transferred, 0);
-					if (rc == -1)
-						transferred = 0;
+					off_t transferred = 0;
+					const auto rc = sendfile (File_->handle (), sock.native_handle (),
+							offset, chunk, nullptr, &transferred, 0);
 					const auto errCode = rc == -1 ? errno : 0;
 #elif defined (Q_OS_MAC)
-					auto transferred = toTransfer;
-					auto errCode = sendfile (File_->handle (),
-							Sock_.native_handle (),
+					off_t transferred = chunk;
+					const auto rc = sendfile (File_->handle (),
+							sock.native_handle (),
 							offset, &transferred,
 							nullptr, 0);
+					const auto errCode = rc == -1 ? errno : 0;
 #else
 #warning "Using suboptimal file sending method"
-					const auto& pair = DumbSendfile (File_, Sock_, offset, toTransfer);
+					const auto& pair = DumbSendfile (File_, sock, offset, chunk);
 					const auto errCode = pair.first;
 					const auto transferred = pair.second;
 #endif
@@ -353,19 +394,34 @@ namespace HttHare
 					ec = boost::system::error_code (errCode,
 							boost::asio::error::get_system_category ());
 
-					if (!errCode)
+					/* No error and nothing sent means the file has been
+					 * truncated while being sent, so the response can't be
+					 * completed and the connection has to be closed.
+					 */
+					if (!errCode && !transferred)
 					{
-						CurrentRange_.first = offset;
-						toTransfer -= transferred;
+						qWarning () << Q_FUNC_INFO
+								<< "unexpected end of"
+								<< File_->fileName ()
+								<< "with"
+								<< toTransfer
+								<< "bytes left";
+						ec = boost::asio::error::eof;
+						break;
 					}
 
+					// Some systems report partially sent data along with EAGAIN.
+					CurrentRange_.first += transferred;
+					toTransfer -= transferred;
+					Conn_->GetStats ()->AddBytesSent (transferred);
+
 					if (ec == boost::asio::error::interrupted)
 						continue;
 
 					if (ec == boost::asio::error::would_block ||
 							ec == boost::asio::error::try_again)
 					{
-						Sock_.async_write_some (boost::asio::null_buffers {}, *this);
+						sock.async_write_some (boost::asio::null_buffers {}, *this);
 						return;
 					}
 
@@ -375,7 +431,7 @@ namespace HttHare
 					if (!toTransfer && !TailRanges_.isEmpty ())
 					{
 						CurrentRange_ = TailRanges_.takeFirst ();
-						Sock_.async_write_some (boost::asio::null_buffers {}, *this);
+						sock.async_write_some (boost::asio::null_buffers {}, *this);
 						return;
 					}
 				}
@@ -385,6 +441,116 @@ namespace HttHare
 		};
 	}
 
+	namespace
+	{
+		QByteArray Deflate (const QByteArray& data)
+		{
+			auto result = qCompress (data, 6);
+			result.remove (0, 4);
+			return result;
+		}
+
+		quint32 Crc32 (const QByteArray& data)
+		{
+			static const auto table = []
+			{
+				std::array<quint32, 256> result;
+				for (quint32 i = 0; i < result.size (); ++i)
+				{
+					auto c = i;
+					for (int k = 0; k < 8; ++k)
+						c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+					result [i] = c;
+				}
+				return result;
+			} ();
+
+			quint32 crc = 0xffffffff;
+			for (const char ch : data)
+				crc = table [(crc ^ static_cast<quint8> (ch)) & 0xff] ^ (crc >> 8);
+			return crc ^ 0xffffffff;
+		}
+
+		/** Converts the zlib stream produced by Deflate() for orig to a
+		 * gzip stream.
+		 */
+		QByteArray DeflatedToGzip (const QByteArray& deflated, const QByteArray& orig)
+		{
+			QByteArray result;
+			result.reserve (deflated.size () + 12);
+
+			const char header [] = { 0x1f, static_cast<char> (0x8b), 0x08, 0, 0, 0, 0, 0, 0, 0x03 };
+			result.append (header, sizeof (header));
+
+			// Skip the 2-byte zlib header and the trailing Adler-32 checksum.
+			result.append (deflated.constData () + 2, deflated.size () - 6);
+
+			auto appendLE = [&result] (quint32 val) -> void
+			{
+				for (int i = 0; i < 4; ++i)
+					result.append (static_cast<char> ((val >> (8 * i)) & 0xff));
+			};
+			appendLE (Crc32 (orig));
+			appendLE (static_cast<quint32> (orig.size ()));
+
+			return result;
+		}
+
+		QByteArray MakeHttpDate (const QDateTime& dt)
+		{
+			return QLocale::c ().toString (dt.toUTC (), "ddd, dd MMM yyyy hh:mm:ss").toLatin1 () + " GMT";
+		}
+
+		QDateTime ParseHttpDate (QString str)
+		{
+			str = str.trimmed ();
+			if (str.endsWith (" GMT"))
+				str.chop (4);
+
+			auto dt = QLocale::c ().toDateTime (str, "ddd, dd MMM yyyy hh:mm:ss");
+			dt.setTimeSpec (Qt::UTC);
+			return dt;
+		}
+	}
+
+	bool RequestHandler::CheckNotModified (const QFileInfo& fi)
+	{
+		const auto& modified = fi.lastModified ();
+		const auto& etag = '"' + QByteArray::number (fi.size (), 16) +
+				'-' + QByteArray::number (modified.toMSecsSinceEpoch (), 16) + '"';
+		ResponseHeaders_.append ({ "ETag", etag });
+		ResponseHeaders_.append ({ "Last-Modified", MakeHttpDate (modified) });
+
+		bool notModified = false;
+		if (Headers_.contains ("if-none-match"))
+		{
+			for (auto tag : Headers_ ["if-none-match"].split (','))
+			{
+				tag = tag.trimmed ();
+				if (tag.startsWith ("W/"))
+					tag = tag.mid (2);
+
+				if (tag == "*" || tag == QString::fromLatin1 (etag))
+				{
+					notModified = true;
+					break;
+				}
+			}
+		}
+		else if (Headers_.contains ("if-modified-since"))
+		{
+			const auto& since = ParseHttpDate (Headers_ ["if-modified-since"]);
+			notModified = since.isValid () && modified.toTime_t () <= since.toTime_t ();
+		}
+
+		if (!notModified)
+			return false;
+
+		ResponseLine_ = "HTTP/1.1 304 Not Modified\r\n";
+		DefaultWrite (Verb::Head);
+		return true;
+	}
+
 	void RequestHandler::HandleRequest (Verb verb)
 	{
 		QString path;
@@ -448,7 +614,21 @@ namespace HttHare
 			ResponseLine_ = "HTTP/1.1 200 OK\r\n";
 
 			ResponseHeaders_.append ({ "Content-Type", "text/html; charset=utf-8" });
-			ResponseBody_ = MakeDirResponse (fi, path, Url_);
+
+			const auto& key = path + '\n' + Url_.toString () + '\n' + Headers_.value ("accept-language");
+			const auto& modified = fi.lastModified ();
+
+			const auto cache = Conn_->GetListingsCache ();
+			ListingsCache::Listing listing;
+			if (!cache->Get (key, modified, listing))
+			{
+				listing.Body_ = MakeDirResponse (fi, path, Url_);
+				listing.Deflated_ = Deflate (listing.Body_);
+				cache->Put (key, modified, listing);
+			}
+
+			ResponseBody_ = listing.Body_;
+			DeflatedBody_ = listing.Deflated_;
 
 			DefaultWrite (verb);
 		}
@@ -467,7 +647,10 @@ namespace HttHare
 
 	void RequestHandler::WriteFile (const QString& path, const QFileInfo& fi, RequestHandler::Verb verb)
 	{
-		auto ranges = ParseRanges (Headers_.value ("Range"), fi.size ());
+		if (CheckNotModified (fi))
+			return;
+
+		auto ranges = ParseRanges (Headers_.value ("range"), fi.size ());
 
 		const auto& mime = Util::MimeDetector {} (path);
 		ResponseHeaders_.append ({ "Content-Type", mime });
@@ -488,64 +671,101 @@ namespace HttHare
 			ResponseHeaders_.append ({ "Content-Length", QByteArray::number (totalSize) });
 		}
 
+		auto self = shared_from_this ();
 		auto c = Conn_;
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c, path, verb, ranges] (boost::system::error_code ec, ulong) mutable -> void
+				c->GetStrand ().wrap ([self, path, verb, ranges] (boost::system::error_code ec, ulong transferred) mutable -> void
 					{
+						const auto& c = self->Conn_;
+
 						if (ec)
+						{
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
+							self->FinishRequest (false);
+							return;
+						}
 
-						auto& s = c->GetSocket ();
-
-						std::shared_ptr<void> shutdownGuard = std::shared_ptr<void> (nullptr,
-								[&s, &ec] (void*)
-								{
-									s.shutdown (boost::asio::socket_base::shutdown_both, ec);
-								});
+						c->GetStats ()->AddBytesSent (transferred);
 
 						if (verb != Verb::Get)
+						{
+							self->FinishRequest (true);
 							return;
+						}
 
 						std::shared_ptr<QFile> file { new QFile { path } };
-						file->open (QIODevice::ReadOnly);
+						if (!file->open (QIODevice::ReadOnly))
+						{
+							qWarning () << Q_FUNC_INFO
+									<< "unable to open"
+									<< path
+									<< file->errorString ();
+							self->FinishRequest (false);
+							return;
+						}
 
 						if (ranges.isEmpty ())
 							ranges.append ({ 0, file->size () - 1 });
 
+						auto& s = c->GetSocket ();
 						if (!s.native_non_blocking ())
 							s.native_non_blocking (true, ec);
 
 						const auto& headRange = ranges.takeFirst ();
 						Sendfiler
 						{
-							s,
+							c,
 							file,
 							0,
 							headRange,
 							ranges,
-							[c, shutdownGuard] (boost::system::error_code, ulong) {}
+							[self] (boost::system::error_code ec, ulong)
+							{
+								if (ec)
+									qWarning () << Q_FUNC_INFO
+											<< ec.message ().c_str ();
+
+								self->FinishRequest (!ec);
+							}
 						} (ec, 0);
 					}));
 	}
 
 	void RequestHandler::DefaultWrite (Verb verb)
 	{
+		auto self = shared_from_this ();
 		auto c = Conn_;
 		boost::asio::async_write (c->GetSocket (),
 				ToBuffers (verb),
-				c->GetStrand ().wrap ([c] (const boost::system::error_code& ec, ulong)
+				c->GetStrand ().wrap ([self] (const boost::system::error_code& ec, ulong transferred)
 					{
 						if (ec)
 							qWarning () << Q_FUNC_INFO
 									<< ec.message ().c_str ();
 
-						boost::system::error_code iec;
-						c->GetSocket ().shutdown (boost::asio::socket_base::shutdown_both, iec);
+						self->Conn_->GetStats ()->AddBytesSent (transferred);
+						self->FinishRequest (!ec);
 					}));
 	}
 
+	void RequestHandler::FinishRequest (bool success)
+	{
+		Conn_->GetStats ()->AddRequest (Timer_.elapsed ());
+		Conn_->FinishRequest (success && KeepAlive_);
+	}
+
+	void RequestHandler::WriteMetrics (Verb verb)
+	{
+		ResponseLine_ = "HTTP/1.1 200 OK\r\n";
+		ResponseHeaders_.append ({ "Content-Type", "text/plain; version=0.0.4" });
+		ResponseHeaders_.append ({ "Cache-Control", "no-cache" });
+		ResponseBody_ = Conn_->GetStats ()->FormatMetrics ();
+
+		DefaultWrite (verb);
+	}
+
 	namespace
 	{
 		boost::asio::const_buffer BA2Buffer (const QByteArray& ba)
@@ -553,11 +773,17 @@ namespace HttHare
 			return { ba.constData (), static_cast<size_t> (ba.size ()) };
 		}
 
-		bool SupportsDeflate (const QStringList& ae)
+		bool SupportsEncoding (const QStringList& ae, const QString& encoding)
 		{
-			for (const auto& val : ae)
-				if (!val.trimmed ().compare ("deflate", Qt::CaseInsensitive))
+			for (auto val : ae)
+			{
+				const auto scPos = val.indexOf (';');
+				if (scPos >= 0)
+					val = val.left (scPos);
+
+				if (!val.trimmed ().compare (encoding, Qt::CaseInsensitive))
 					return true;
+			}
 
 			return false;
 		}
@@ -571,19 +797,34 @@ namespace HttHare
 				[] (decltype (ResponseHeaders_.at (0)) pair)
 					{ return pair.first.toLower () == "content-length"; }) != ResponseHeaders_.end ();
 
-		const auto& splitAe = Headers_.value ("Accept-Encoding").split (',');
+		const auto& splitAe = Headers_.value ("accept-encoding").split (',');
+		const bool gzip = SupportsEncoding (splitAe, "gzip");
 		if (verb == Verb::Get &&
 				!ResponseBody_.isEmpty () &&
-				SupportsDeflate (splitAe))
+				(gzip || SupportsEncoding (splitAe, "deflate")))
 		{
-			ResponseHeaders_.append ({ "Content-Encoding", "deflate" });
-			ResponseBody_ = qCompress (ResponseBody_, 6);
-			ResponseBody_.remove (0, 4);
+			if (DeflatedBody_.isEmpty ())
+				DeflatedBody_ = Deflate (ResponseBody_);
+
+			ResponseHeaders_.append ({ "Vary", "Accept-Encoding" });
+			if (gzip)
+			{
+				ResponseHeaders_.append ({ "Content-Encoding", "gzip" });
+				ResponseBody_ = DeflatedToGzip (DeflatedBody_, ResponseBody_);
+			}
+			else
+			{
+				ResponseHeaders_.append ({ "Content-Encoding", "deflate" });
+				ResponseBody_ = DeflatedBody_;
+			}
 		}
 
-		if (!hasContentLength)
+		const bool isNotModified = ResponseLine_.contains (" 304 ");
+		if (!hasContentLength && !isNotModified)
 			ResponseHeaders_.append ({ "Content-Length", QByteArray::number (ResponseBody_.size ()) });
 
+		ResponseHeaders_.append ({ "Connection", KeepAlive_ ? "keep-alive" : "close" });
+
 		CookedRH_.clear ();
 		for (const auto& pair : ResponseHeaders_)
 			CookedRH_ += pair.first + ": " + pair.second + "\r\n";
@@ -35,6 +35,7 @@
 #include <QUrl>
 #include <QMap>
 #include <QCoreApplication>
+#include <QElapsedTimer>
 
 class QFileInfo;
 
@@ -45,7 +46,7 @@ namespace HttHare
 	class Connection;
 	typedef std::shared_ptr<Connection> Connection_ptr;
 
-	class RequestHandler
+	class RequestHandler : public std::enable_shared_from_this<RequestHandler>
 	{
 		Q_DECLARE_TR_FUNCTIONS (LeechCraft::HttHare::RequestHandler)
 
@@ -54,10 +55,15 @@ namespace HttHare
 		QUrl Url_;
 		QMap<QString, QString> Headers_;
 
+		bool KeepAlive_ = false;
+
+		QElapsedTimer Timer_;
+
 		QByteArray ResponseLine_;
 		QList<QPair<QByteArray, QByteArray>> ResponseHeaders_;
 		QByteArray CookedRH_;
 		QByteArray ResponseBody_;
+		QByteArray DeflatedBody_;
 
 		enum class Verb
 		{
@@ -73,11 +79,14 @@ namespace HttHare
 
 		void ErrorResponse (int, const QByteArray&, const QByteArray& = QByteArray ());
 		QByteArray MakeDirResponse (const QFileInfo&, const QString&, const QUrl&);
+		bool CheckNotModified (const QFileInfo&);
 
 		void HandleRequest (Verb);
 		void WriteDir (const QString&, const QFileInfo&, Verb);
 		void WriteFile (const QString&, const QFileInfo&, Verb);
+		void WriteMetrics (Verb);
 		void DefaultWrite (Verb);
+		void FinishRequest (bool success);
 		std::vector<boost::asio::const_buffer> ToBuffers (Verb);
 	};
 }
@@ -95,16 +95,42 @@ namespace HttHare
 		Threads_.clear ();
 	}
 
+	void Server::SetMaxConnections (int max)
+	{
+		Stats_.SetMaxConnections (max);
+	}
+
+	void Server::SetClientBandwidthLimit (qint64 limit)
+	{
+		Limiter_.SetLimit (limit);
+	}
+
 	void Server::StartAccept ()
 	{
-		Connection_ptr connection { new Connection { IoService_, StorageMgr_, IconResolver_, TrManager_ } };
+		Connection_ptr connection { new Connection { IoService_, StorageMgr_, IconResolver_, TrManager_, &ListingsCache_, &Stats_, &Limiter_, &IdlePool_ } };
 
 		for (auto& acceptor : Acceptors_)
 			acceptor->async_accept (connection->GetSocket (),
 					[this, connection] (const boost::system::error_code& ec)
 					{
 						if (!ec)
-							connection->Start ();
+						{
+							while (!connection->Accept ())
+							{
+								if (const auto idle = IdlePool_.TakeOldest ())
+								{
+									idle->CloseIdle ();
+									continue;
+								}
+
+								qWarning () << Q_FUNC_INFO
+										<< "connections limit reached, rejecting";
+
+								boost::system::error_code iec;
+								connection->GetSocket ().close (iec);
+								break;
+							}
+						}
 						else
 							qWarning () << Q_FUNC_INFO
 									<< "cannot accept:"
@@ -32,6 +32,10 @@
 #include <thread>
 #include <boost/asio.hpp>
 #include "storagemanager.h"
+#include "listingscache.h"
+#include "serverstats.h"
+#include "bandwidthlimiter.h"
+#include "idlepool.h"
 
 template<typename T>
 class QSet;
@@ -47,6 +51,13 @@ namespace HttHare
 
 	class Server
 	{
+		// These are used by the connections, which may be destroyed
+		// along with IoService_, so they should outlive it.
+		ListingsCache ListingsCache_;
+		ServerStats Stats_;
+		BandwidthLimiter Limiter_;
+		IdlePool IdlePool_;
+
 		boost::asio::io_service IoService_;
 		std::vector<std::unique_ptr<boost::asio::ip::tcp::acceptor>> Acceptors_;
 
@@ -65,6 +76,9 @@ namespace HttHare
 
 		void Start ();
 		void Stop ();
+
+		void SetMaxConnections (int);
+		void SetClientBandwidthLimit (qint64);
 	private:
 		void StartAccept ();
 	};
@@ -0,0 +1,163 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "serverstats.h"
+#include <algorithm>
+#include <QMutexLocker>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const std::array<qint64, 9> LatencyBounds { { 1, 5, 10, 25, 50, 100, 250, 1000, 5000 } };
+	}
+
+	ServerStats::ServerStats ()
+	: Started_ { std::chrono::steady_clock::now () }
+	, MaxConnections_ { 0 }
+	, ActiveConnections_ { 0 }
+	, TotalConnections_ { 0 }
+	, RejectedConnections_ { 0 }
+	, TotalRequests_ { 0 }
+	, BytesSent_ { 0 }
+	{
+		LatencyBuckets_.fill (0);
+		PerSecondRequests_.fill (0);
+	}
+
+	void ServerStats::SetMaxConnections (int max)
+	{
+		MaxConnections_ = max;
+	}
+
+	bool ServerStats::TryAddConnection ()
+	{
+		const auto active = ++ActiveConnections_;
+		const auto max = MaxConnections_.load ();
+		if (max > 0 && active > max)
+		{
+			--ActiveConnections_;
+			++RejectedConnections_;
+			return false;
+		}
+
+		++TotalConnections_;
+		return true;
+	}
+
+	void ServerStats::RemoveConnection ()
+	{
+		--ActiveConnections_;
+	}
+
+	void ServerStats::AddRequest (qint64 latencyMs)
+	{
+		++TotalRequests_;
+
+		const auto bucket = std::lower_bound (LatencyBounds.begin (), LatencyBounds.end (), latencyMs) -
+				LatencyBounds.begin ();
+
+		QMutexLocker locker { &Lock_ };
+		++LatencyBuckets_ [bucket];
+		LatencySumMs_ += latencyMs;
+
+		const auto now = GetUptimeSecs ();
+		AdvanceRateWindow (now);
+		++PerSecondRequests_ [now % RateWindowSecs];
+	}
+
+	void ServerStats::AddBytesSent (qint64 bytes)
+	{
+		BytesSent_ += bytes;
+	}
+
+	QByteArray ServerStats::FormatMetrics () const
+	{
+		QByteArray result;
+		auto append = [&result] (const QByteArray& name, qint64 value) -> void
+		{
+			result += "htthare_" + name + ' ' + QByteArray::number (value) + '\n';
+		};
+
+		const auto uptime = GetUptimeSecs ();
+
+		append ("uptime_seconds", uptime);
+		append ("connections_active", ActiveConnections_);
+		append ("connections_max", MaxConnections_);
+		append ("connections_total", TotalConnections_);
+		append ("connections_rejected_total", RejectedConnections_);
+		append ("requests_total", TotalRequests_);
+		append ("bytes_sent_total", BytesSent_);
+
+		QMutexLocker locker { &Lock_ };
+
+		// The current second is still in progress, so it isn't counted.
+		qint64 lastMinute = 0;
+		const auto windowSecs = std::min<qint64> (uptime, RateWindowSecs - 1);
+		for (qint64 i = 1; i <= windowSecs; ++i)
+			if (uptime - i <= LastSecond_)
+				lastMinute += PerSecondRequests_ [(uptime - i) % RateWindowSecs];
+		const auto rate = windowSecs ? static_cast<double> (lastMinute) / windowSecs : 0;
+		result += "htthare_requests_per_second " + QByteArray::number (rate, 'f', 2) + '\n';
+
+		qint64 cumulative = 0;
+		for (int i = 0; i < LatencyBucketsCount; ++i)
+		{
+			cumulative += LatencyBuckets_ [i];
+			const auto& le = i < static_cast<int> (LatencyBounds.size ()) ?
+					QByteArray::number (LatencyBounds [i]) :
+					QByteArray ("+Inf");
+			result += "htthare_request_latency_ms_bucket{le=\"" + le + "\"} " +
+					QByteArray::number (cumulative) + '\n';
+		}
+		append ("request_latency_ms_sum", LatencySumMs_);
+		append ("request_latency_ms_count", cumulative);
+
+		return result;
+	}
+
+	qint64 ServerStats::GetUptimeSecs () const
+	{
+		return std::chrono::duration_cast<std::chrono::seconds> (std::chrono::steady_clock::now () - Started_).count ();
+	}
+
+	void ServerStats::AdvanceRateWindow (qint64 now)
+	{
+		if (now - LastSecond_ >= RateWindowSecs)
+			PerSecondRequests_.fill (0);
+		else
+			for (auto sec = LastSecond_ + 1; sec <= now; ++sec)
+				PerSecondRequests_ [sec % RateWindowSecs] = 0;
+
+		LastSecond_ = now;
+	}
+}
+}
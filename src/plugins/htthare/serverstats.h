@@ -0,0 +1,83 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <QMutex>
+#include <QByteArray>
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	class ServerStats
+	{
+		const std::chrono::steady_clock::time_point Started_;
+
+		std::atomic<int> MaxConnections_;
+		std::atomic<int> ActiveConnections_;
+
+		std::atomic<qint64> TotalConnections_;
+		std::atomic<qint64> RejectedConnections_;
+		std::atomic<qint64> TotalRequests_;
+		std::atomic<qint64> BytesSent_;
+
+		mutable QMutex Lock_;
+
+		static const int LatencyBucketsCount = 10;
+		std::array<qint64, LatencyBucketsCount> LatencyBuckets_;
+		qint64 LatencySumMs_ = 0;
+
+		static const int RateWindowSecs = 60;
+		std::array<qint64, RateWindowSecs> PerSecondRequests_;
+		qint64 LastSecond_ = 0;
+	public:
+		ServerStats ();
+
+		ServerStats (const ServerStats&) = delete;
+		ServerStats& operator= (const ServerStats&) = delete;
+
+		void SetMaxConnections (int);
+
+		bool TryAddConnection ();
+		void RemoveConnection ();
+
+		void AddRequest (qint64 latencyMs);
+		void AddBytesSent (qint64);
+
+		QByteArray FormatMetrics () const;
+	private:
+		qint64 GetUptimeSecs () const;
+		void AdvanceRateWindow (qint64);
+	};
+}
+}
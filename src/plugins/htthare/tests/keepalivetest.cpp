@@ -0,0 +1,196 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "keepalivetest.h"
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QTcpSocket>
+#include "server.h"
+
+QTEST_MAIN (LeechCraft::HttHare::KeepAliveTest)
+
+namespace LeechCraft
+{
+namespace HttHare
+{
+	namespace
+	{
+		const quint16 Port = 14850;
+		const int Timeout = 5000;
+		const int FileSize = 4096;
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		struct Response
+		{
+			QByteArray Status_;
+			QMap<QByteArray, QByteArray> Headers_;
+			QByteArray Body_;
+		};
+
+		class Client
+		{
+			QTcpSocket Socket_;
+			QByteArray Buf_;
+		public:
+			bool Connect ()
+			{
+				Socket_.connectToHost ("127.0.0.1", Port);
+				return Socket_.waitForConnected (Timeout);
+			}
+
+			bool IsClosed ()
+			{
+				return Socket_.state () == QAbstractSocket::UnconnectedState ||
+						Socket_.waitForDisconnected (Timeout);
+			}
+
+			bool Request (const QByteArray& request, Response& response)
+			{
+				Socket_.write (request);
+				if (!Socket_.waitForBytesWritten (Timeout))
+					return false;
+
+				int headersEnd = -1;
+				while ((headersEnd = Buf_.indexOf ("\r\n\r\n")) < 0)
+					if (!Read ())
+						return false;
+
+				auto lines = Buf_.left (headersEnd).split ('\n');
+				Buf_.remove (0, headersEnd + 4);
+
+				response = Response {};
+				response.Status_ = lines.takeFirst ().trimmed ();
+				for (const auto& line : lines)
+				{
+					const auto colonPos = line.indexOf (':');
+					response.Headers_ [line.left (colonPos).trimmed ().toLower ()] =
+							line.mid (colonPos + 1).trimmed ();
+				}
+
+				const auto length = response.Headers_.value ("content-length").toInt ();
+				while (Buf_.size () < length)
+					if (!Read ())
+						return false;
+
+				response.Body_ = Buf_.left (length);
+				Buf_.remove (0, length);
+				return true;
+			}
+		private:
+			bool Read ()
+			{
+				if (!Socket_.bytesAvailable () && !Socket_.waitForReadyRead (Timeout))
+					return false;
+
+				Buf_ += Socket_.readAll ();
+				return true;
+			}
+		};
+	}
+
+	void KeepAliveTest::initTestCase ()
+	{
+		TestHome_ = QDir::temp ().filePath (QString ("lc_htthare_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		RemoveDir (TestHome_);
+		QVERIFY (QDir {}.mkpath (TestHome_));
+		qputenv ("HOME", QFile::encodeName (TestHome_));
+
+		QFile file { QDir { TestHome_ }.filePath ("file.txt") };
+		QVERIFY (file.open (QIODevice::WriteOnly));
+		QCOMPARE (file.write (QByteArray (FileSize, 'x')), static_cast<qint64> (FileSize));
+		file.close ();
+
+		QList<QPair<QString, QString>> addresses;
+		addresses.append ({ "127.0.0.1", QString::number (Port) });
+		Server_.reset (new Server { addresses });
+		Server_->Start ();
+	}
+
+	void KeepAliveTest::cleanupTestCase ()
+	{
+		Server_.reset ();
+		RemoveDir (TestHome_);
+	}
+
+	void KeepAliveTest::errorClosesConnection ()
+	{
+		Client client;
+		QVERIFY (client.Connect ());
+
+		Response response;
+		QVERIFY (client.Request ("PUT /file.txt HTTP/1.1\r\nHost: localhost\r\n\r\n", response));
+		QVERIFY (response.Status_.startsWith ("HTTP/1.1 405 "));
+		QCOMPARE (response.Headers_.value ("connection"), QByteArray { "close" });
+		QVERIFY (client.IsClosed ());
+	}
+
+	void KeepAliveTest::connectionHeaderIsCaseInsensitive ()
+	{
+		Client client;
+		QVERIFY (client.Connect ());
+
+		Response response;
+		QVERIFY (client.Request ("GET /file.txt HTTP/1.1\r\nHost: localhost\r\nconnection: Close\r\n\r\n", response));
+		QVERIFY (response.Status_.startsWith ("HTTP/1.1 200 "));
+		QCOMPARE (response.Headers_.value ("connection"), QByteArray { "close" });
+		QVERIFY (client.IsClosed ());
+	}
+
+	void KeepAliveTest::benchKeepAlive ()
+	{
+		Client client;
+		QVERIFY (client.Connect ());
+
+		const int requests = 1000;
+		QBENCHMARK
+		{
+			for (int i = 0; i < requests; ++i)
+			{
+				Response response;
+				QVERIFY (client.Request ("GET /file.txt HTTP/1.1\r\nHost: localhost\r\n\r\n", response));
+				QVERIFY (response.Status_.startsWith ("HTTP/1.1 200 "));
+				QCOMPARE (response.Headers_.value ("connection"), QByteArray { "keep-alive" });
+				QCOMPARE (response.Body_.size (), FileSize);
+			}
+		}
+	}
+}
+}
@@ -36,7 +36,7 @@
 #include <QStandardItemModel>
 #include <QMessageBox>
 #include <QClipboard>
-#include <QMutexLocker>
+#include <QReadLocker>
 #include <QFileInfo>
 #include <QtDebug>
 #include <taglib/taglib_config.h>
@@ -326,7 +326,7 @@ namespace LMP
 		if (info.LocalPath_.isEmpty ())
 			return;
 
-		QMutexLocker tlLocker (&Core::Instance ().GetLocalFileResolver ()->GetMutex ());
+		QReadLocker tlLocker (&Core::Instance ().GetLocalFileResolver ()->GetLock ());
 
 		auto r = Core::Instance ().GetLocalFileResolver ()->GetFileRef (info.LocalPath_);
 		auto tag = r.tag ();
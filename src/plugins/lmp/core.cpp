@@ -72,6 +72,7 @@ namespace LMP
 		ProgressManager_->AddSyncManager (SyncManager_);
 		ProgressManager_->AddSyncManager (SyncUnmountableManager_);
 		ProgressManager_->AddSyncManager (CloudUpMgr_);
+		ProgressManager_->AddLocalCollection (Collection_);
 
 		new RgAnalysisManager (Collection_, this);
 
@@ -31,7 +31,7 @@
 
 #include <QtPlugin>
 
-class QMutex;
+class QReadWriteLock;
 
 namespace TagLib
 {
@@ -51,9 +51,13 @@ namespace LMP
 
 		virtual TagLib::FileRef GetFileRef (const QString&) const = 0;
 		virtual MediaInfo ResolveInfo (const QString&) = 0;
-		virtual QMutex& GetMutex () = 0;
+		/** Returns the lock guarding TagLib file access. Tags are read
+		 * under the read lock, so tag writers should hold the write
+		 * lock while modifying files.
+		 */
+		virtual QReadWriteLock& GetLock () = 0;
 	};
 }
 }
 
-Q_DECLARE_INTERFACE (LeechCraft::LMP::ITagResolver, "org.LeechCraft.LMP.ITagResolver/1.0");
+Q_DECLARE_INTERFACE (LeechCraft::LMP::ITagResolver, "org.LeechCraft.LMP.ITagResolver/2.0");
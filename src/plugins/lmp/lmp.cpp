@@ -49,6 +49,7 @@
 #include "player.h"
 #include "xmlsettingsmanager.h"
 #include "core.h"
+#include "localfileresolver.h"
 #include "rootpathsettingsmanager.h"
 #include "collectionstatsdialog.h"
 #include "artistbrowsertab.h"
@@ -242,6 +243,7 @@ namespace LMP
 
 	void Plugin::Release ()
 	{
+		Core::Instance ().GetLocalFileResolver ()->SaveCache ();
 	}
 
 	QString Plugin::GetName () const
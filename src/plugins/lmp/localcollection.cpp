@@ -33,9 +33,10 @@
 #include <numeric>
 #include <QStandardItemModel>
 #include <QSortFilterProxyModel>
-#include <QtConcurrentMap>
 #include <QtConcurrentRun>
 #include <QTimer>
+#include <QFile>
+#include <QElapsedTimer>
 #include <QtDebug>
 #include <util/xpc/util.h>
 #include "localcollectionstorage.h"
@@ -170,55 +171,140 @@ namespace LMP
 				.property ("FollowSymLinks").toBool ();
 		auto worker = [path, symLinks] () -> IterateResult
 		{
+			QElapsedTimer timer;
+			timer.start ();
+
 			IterateResult result;
 
 			LocalCollectionStorage storage;
 
-			const auto& paths = storage.GetTracksPaths ();
+			QHash<QString, QDateTime> storedMTimes;
+			try
+			{
+				storedMTimes = storage.GetTracksMTimes ();
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error getting mtimes"
+						<< e.what ();
+			}
+
+			QList<QPair<QString, QDateTime>> changedMTimes;
 
 			const auto& allInfos = RecIterateInfo (path, symLinks);
 			for (const auto& info : allInfos)
 			{
 				const auto& trackPath = info.absoluteFilePath ();
 				const auto& mtime = info.lastModified ();
-				try
+
+				const auto storedPos = storedMTimes.find (trackPath);
+				if (storedPos != storedMTimes.end ())
 				{
-					const auto& storedDt = storage.GetMTime (trackPath);
+					const auto& storedDt = *storedPos;
 					if (storedDt.isValid () &&
 							std::abs (storedDt.msecsTo (mtime)) < 1500)
 					{
 						result.UnchangedFiles_ << trackPath;
 						continue;
 					}
+
+					changedMTimes.append ({ trackPath, mtime });
+				}
+
+				result.ChangedFiles_ << trackPath;
+			}
+
+			try
+			{
+				storage.SetMTimes (changedMTimes);
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "error setting mtimes"
+						<< e.what ();
+			}
+
+			const auto elapsed = std::max<qint64> (timer.elapsed (), 1);
+			qDebug () << Q_FUNC_INFO
+					<< "scanned"
+					<< allInfos.size ()
+					<< "files in"
+					<< path
+					<< "in"
+					<< elapsed
+					<< "ms,"
+					<< allInfos.size () * 1000 / elapsed
+					<< "files/sec;"
+					<< result.ChangedFiles_.size ()
+					<< "changed";
+
+			return result;
+		};
+		watcher->setFuture (QtConcurrent::run (worker));
+	}
+
+	void LocalCollection::UpdateFiles (const QSet<QString>& changed, const QSet<QString>& removed)
+	{
+		for (const auto& path : removed)
+		{
+			if (QFile::exists (path))
+				continue;
+
+			QStringList toRemove;
+			for (const auto& present : PresentPaths_)
+				if (present == path || present.startsWith (path + '/'))
+					toRemove << present;
+
+			for (const auto& present : toRemove)
+			{
+				try
+				{
+					RemoveTrack (present);
 				}
 				catch (const std::exception& e)
 				{
 					qWarning () << Q_FUNC_INFO
-							<< "error getting mtime"
-							<< trackPath
+							<< "error removing"
+							<< present
 							<< e.what ();
 				}
+			}
+		}
 
-				if (paths.contains (trackPath))
-				{
-					try
-					{
-						storage.SetMTime (trackPath, mtime);
-					}
-					catch (const std::exception& e)
-					{
-						qWarning () << Q_FUNC_INFO
-								<< "error setting mtime"
-								<< trackPath
-								<< e.what ();
-					}
-				}
-				result.ChangedFiles_ << trackPath;
+		const bool symLinks = XmlSettingsManager::Instance ()
+				.property ("FollowSymLinks").toBool ();
+
+		QSet<QString> toScan;
+		QList<QPair<QString, QDateTime>> changedMTimes;
+		for (const auto& path : changed)
+			for (const auto& info : RecIterateInfo (path, symLinks))
+			{
+				const auto& trackPath = info.absoluteFilePath ();
+				toScan << trackPath;
+				if (PresentPaths_.contains (trackPath))
+					changedMTimes.append ({ trackPath, info.lastModified () });
 			}
 
-			return result;
-		};
-		watcher->setFuture (QtConcurrent::run (worker));
+		try
+		{
+			Storage_->SetMTimes (changedMTimes);
+		}
+		catch (const std::exception& e)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "error setting mtimes"
+					<< e.what ();
+		}
+
+		if (toScan.isEmpty ())
+			return;
+
+		if (Watcher_->isRunning ())
+			NewPathsQueue_ << toScan;
+		else
+			InitiateScan (toScan);
 	}
 
 	void LocalCollection::Unscan (const QString& path)
@@ -684,6 +770,8 @@ namespace LMP
 
 		Q_FOREACH (const auto& path, toRemove)
 			RemoveTrack (path);
+
+		Core::Instance ().GetLocalFileResolver ()->ForgetPaths (toRemove.toList ());
 	}
 
 	void LocalCollection::InitiateScan (const QSet<QString>& newPaths)
@@ -691,24 +779,7 @@ namespace LMP
 		auto resolver = Core::Instance ().GetLocalFileResolver ();
 
 		emit scanStarted (newPaths.size ());
-		auto worker = [resolver] (const QString& path) -> MediaInfo
-		{
-			try
-			{
-				return resolver->ResolveInfo (path);
-			}
-			catch (const ResolveError& error)
-			{
-				qWarning () << Q_FUNC_INFO
-						<< "error resolving media info for"
-						<< error.GetPath ()
-						<< error.what ();
-				return MediaInfo ();
-			}
-		};
-		const auto& future = QtConcurrent::mapped (newPaths,
-				std::function<MediaInfo (const QString&)> (worker));
-		Watcher_->setFuture (future);
+		Watcher_->setFuture (resolver->ResolveInfos (newPaths.toList ()));
 	}
 
 	void LocalCollection::recordPlayedTrack (const QString& path)
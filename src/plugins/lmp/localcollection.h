@@ -123,6 +123,12 @@ namespace LMP
 		void Clear ();
 
 		void Scan (const QString&, bool root = true);
+
+		/** Rescans only the given changed files and removes the tracks
+		 * corresponding to the given removed paths, which may be both
+		 * files and directories.
+		 */
+		void UpdateFiles (const QSet<QString>& changed, const QSet<QString>& removed);
 		void Unscan (const QString&);
 		void Rescan ();
 
@@ -231,7 +231,7 @@ namespace LMP
 		PresentArtists_ = result.PresentArtists_;
 	}
 
-	QStringList LocalCollectionStorage::GetTracksPaths ()
+	QHash<QString, QDateTime> LocalCollectionStorage::GetTracksMTimes ()
 	{
 		if (!GetAllTracks_.exec ())
 		{
@@ -239,10 +239,9 @@ namespace LMP
 			throw std::runtime_error ("cannot get all tracks");
 		}
 
-		QStringList result;
-		result.reserve (GetAllTracks_.size ());
+		QHash<QString, QDateTime> result;
 		while (GetAllTracks_.next ())
-			result << GetAllTracks_.value (1).toString ();
+			result [GetAllTracks_.value (0).toString ()] = GetAllTracks_.value (1).toDateTime ();
 
 		GetAllTracks_.finish ();
 
@@ -384,6 +383,18 @@ namespace LMP
 		}
 	}
 
+	void LocalCollectionStorage::SetMTimes (const QList<QPair<QString, QDateTime>>& mtimes)
+	{
+		if (mtimes.isEmpty ())
+			return;
+
+		Util::DBLock lock (DB_);
+		lock.Init ();
+		for (const auto& pair : mtimes)
+			SetMTime (pair.first, pair.second);
+		lock.Good ();
+	}
+
 	const int LovedStateID = 1;
 	const int BannedStateID = 2;
 
@@ -703,7 +714,8 @@ namespace LMP
 		GetAlbums_.prepare ("SELECT Id, Name, Year, CoverPath FROM albums;");
 
 		GetAllTracks_ = QSqlQuery (DB_);
-		GetAllTracks_.prepare ("SELECT Id, Path FROM tracks;");
+		GetAllTracks_.prepare ("SELECT tracks.Path, fileTimes.MTime FROM tracks "
+				"LEFT OUTER JOIN fileTimes ON tracks.Id = fileTimes.TrackID;");
 
 		AddArtist_ = QSqlQuery (DB_);
 		AddArtist_.prepare ("INSERT INTO artists (Name) VALUES (:name);");
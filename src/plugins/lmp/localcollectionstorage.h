@@ -102,7 +102,11 @@ namespace LMP
 		LoadResult Load ();
 		void Load (const LoadResult&);
 
-		QStringList GetTracksPaths ();
+		/** Returns the paths of all the tracks in the collection along
+		 * with their stored modification times, which are invalid if
+		 * unknown.
+		 */
+		QHash<QString, QDateTime> GetTracksMTimes ();
 
 		void RemoveTrack (int);
 		void RemoveAlbum (int);
@@ -116,6 +120,7 @@ namespace LMP
 
 		QDateTime GetMTime (const QString&);
 		void SetMTime (const QString&, const QDateTime&);
+		void SetMTimes (const QList<QPair<QString, QDateTime>>&);
 
 		void SetTrackLoved (int);
 		void SetTrackBanned (int);
@@ -47,6 +47,14 @@ namespace LMP
 				SIGNAL (directoryChanged (QString)),
 				this,
 				SLOT (handleDirectoryChanged (QString)));
+		connect (Watcher_,
+				SIGNAL (filesChanged (QStringList)),
+				this,
+				SLOT (handleFilesChanged (QStringList)));
+		connect (Watcher_,
+				SIGNAL (filesRemoved (QStringList)),
+				this,
+				SLOT (handleFilesRemoved (QStringList)));
 
 		ScanTimer_->setSingleShot (true);
 		connect (ScanTimer_,
@@ -67,9 +75,7 @@ namespace LMP
 
 	void LocalCollectionWatcher::ScheduleDir (const QString& dir)
 	{
-		if (ScanTimer_->isActive ())
-			ScanTimer_->stop ();
-		ScanTimer_->start (2000);
+		RestartScanTimer ();
 
 		if (std::any_of (ScheduledDirs_.begin (), ScheduledDirs_.end (),
 				[&dir] (const QString& other) { return dir.startsWith (other); }))
@@ -82,17 +88,65 @@ namespace LMP
 		ScheduledDirs_ << dir;
 	}
 
+	void LocalCollectionWatcher::RestartScanTimer ()
+	{
+		if (ScanTimer_->isActive ())
+			ScanTimer_->stop ();
+		ScanTimer_->start (2000);
+	}
+
 	void LocalCollectionWatcher::handleDirectoryChanged (const QString& path)
 	{
 		ScheduleDir (path);
 	}
 
+	void LocalCollectionWatcher::handleFilesChanged (const QStringList& paths)
+	{
+		RestartScanTimer ();
+		ChangedFiles_ += QSet<QString>::fromList (paths);
+	}
+
+	void LocalCollectionWatcher::handleFilesRemoved (const QStringList& paths)
+	{
+		RestartScanTimer ();
+		RemovedFiles_ += QSet<QString>::fromList (paths);
+	}
+
 	void LocalCollectionWatcher::rescanQueue ()
 	{
+		const auto collection = Core::Instance ().GetLocalCollection ();
+
 		for (const auto& path : ScheduledDirs_)
-			Core::Instance ().GetLocalCollection ()->Scan (path, false);
+			collection->Scan (path, false);
+
+		/* The files in the directories scheduled for the full scan
+		 * will be handled by that scan anyway.
+		 */
+		auto isScheduled = [this] (const QString& path)
+		{
+			return std::any_of (ScheduledDirs_.begin (), ScheduledDirs_.end (),
+					[&path] (const QString& dir) -> bool
+					{
+						if (!path.startsWith (dir))
+							return false;
+
+						return path.size () == dir.size () ||
+								dir.endsWith ('/') ||
+								path.at (dir.size ()) == '/';
+					});
+		};
+		for (auto i = ChangedFiles_.begin (); i != ChangedFiles_.end (); )
+			if (isScheduled (*i))
+				i = ChangedFiles_.erase (i);
+			else
+				++i;
+
+		if (!ChangedFiles_.isEmpty () || !RemovedFiles_.isEmpty ())
+			collection->UpdateFiles (ChangedFiles_, RemovedFiles_);
 
 		ScheduledDirs_.clear ();
+		ChangedFiles_.clear ();
+		RemovedFiles_.clear ();
 	}
 }
 }
@@ -50,6 +50,8 @@ namespace LMP
 		RecursiveDirWatcher * const Watcher_;
 
 		QList<QString> ScheduledDirs_;
+		QSet<QString> ChangedFiles_;
+		QSet<QString> RemovedFiles_;
 		QTimer *ScanTimer_;
 	public:
 		LocalCollectionWatcher (QObject* = 0);
@@ -58,8 +60,11 @@ namespace LMP
 		void RemovePath (const QString&);
 	private:
 		void ScheduleDir (const QString&);
+		void RestartScanTimer ();
 	private slots:
 		void handleDirectoryChanged (const QString&);
+		void handleFilesChanged (const QStringList&);
+		void handleFilesRemoved (const QStringList&);
 		void rescanQueue ();
 	};
 }
@@ -28,10 +28,27 @@
  **********************************************************************/
 
 #include "localfileresolver.h"
+#include <memory>
+#include <algorithm>
+#include <functional>
 #include <QtDebug>
+#include <QFile>
 #include <QFileInfo>
+#include <QDataStream>
+#include <QTimer>
+#include <QThread>
+#include <QRunnable>
+#include <QFutureInterface>
+#include <QElapsedTimer>
+#include <QtConcurrentRun>
 #include <taglib/fileref.h>
 #include <taglib/tag.h>
+#include <util/sys/paths.h>
+#include "xmlsettingsmanager.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
 
 namespace LeechCraft
 {
@@ -52,36 +69,185 @@ namespace LMP
 		return Path_;
 	}
 
+	bool operator== (const LocalFileResolver::FileId& left, const LocalFileResolver::FileId& right)
+	{
+		return left.Inode_ == right.Inode_ &&
+				left.Size_ == right.Size_ &&
+				left.MTime_ == right.MTime_;
+	}
+
+	uint qHash (const LocalFileResolver::FileId& id)
+	{
+		return ::qHash (id.Inode_) ^ ::qHash (id.Size_) ^ ::qHash (id.MTime_);
+	}
+
+	namespace
+	{
+		const quint8 CacheVersion = 1;
+
+		bool GetFileId (const QString& path, LocalFileResolver::FileId& id)
+		{
+#ifdef Q_OS_UNIX
+			struct stat st;
+			if (stat (QFile::encodeName (path).constData (), &st))
+				return false;
+
+			id.Size_ = st.st_size;
+#ifdef Q_OS_LINUX
+			id.MTime_ = static_cast<qint64> (st.st_mtim.tv_sec) * 1000 + st.st_mtim.tv_nsec / 1000000;
+#else
+			id.MTime_ = static_cast<qint64> (st.st_mtime) * 1000;
+#endif
+			id.Inode_ = st.st_ino;
+#else
+			const QFileInfo fi (path);
+			if (!fi.exists ())
+				return false;
+
+			id.Size_ = fi.size ();
+			id.MTime_ = fi.lastModified ().toMSecsSinceEpoch ();
+			id.Inode_ = 0;
+#endif
+			return true;
+		}
+
+		class FunctionRunnable : public QRunnable
+		{
+			const std::function<void ()> Func_;
+		public:
+			FunctionRunnable (const std::function<void ()>& func)
+			: Func_ (func)
+			{
+			}
+
+			void run ()
+			{
+				Func_ ();
+			}
+		};
+
+		struct ResolveBatch
+		{
+			QList<QString> Paths_;
+			QFutureInterface<MediaInfo> Iface_;
+
+			QAtomicInt NextIdx_;
+			QAtomicInt DoneCount_;
+			QAtomicInt RunningWorkers_;
+
+			QElapsedTimer Timer_;
+		};
+
+		void RunBatch (LocalFileResolver *resolver, ResolveBatch& batch)
+		{
+			while (!batch.Iface_.isCanceled ())
+			{
+				const int idx = batch.NextIdx_.fetchAndAddOrdered (1);
+				if (idx >= batch.Paths_.size ())
+					break;
+
+				MediaInfo info;
+				try
+				{
+					info = resolver->ResolveInfo (batch.Paths_.at (idx));
+				}
+				catch (const ResolveError& error)
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "error resolving media info for"
+							<< error.GetPath ()
+							<< error.what ();
+				}
+
+				batch.Iface_.reportResult (info, idx);
+				batch.Iface_.setProgressValue (batch.DoneCount_.fetchAndAddOrdered (1) + 1);
+			}
+
+			if (batch.RunningWorkers_.deref ())
+				return;
+
+			const auto elapsed = std::max<qint64> (batch.Timer_.elapsed (), 1);
+			qDebug () << Q_FUNC_INFO
+					<< "resolved"
+					<< batch.Paths_.size ()
+					<< "files in"
+					<< elapsed
+					<< "ms,"
+					<< batch.Paths_.size () * 1000 / elapsed
+					<< "files/sec";
+
+			batch.Iface_.reportFinished ();
+
+			QMetaObject::invokeMethod (resolver,
+					"scheduleCacheSave",
+					Qt::QueuedConnection);
+		}
+	}
+
 	LocalFileResolver::LocalFileResolver (QObject *parent)
 	: QObject (parent)
+	, ReadStyle_ (TagLib::AudioProperties::Fast)
+	, CacheLoaded_ (false)
+	, CachePath_ (Util::CreateIfNotExists ("lmp").filePath ("tagcache.dat"))
+	, CacheDirty_ (false)
+	, CacheSaveTimer_ (new QTimer (this))
+	{
+		// Resolving tags is mostly waiting for the disk or the network,
+		// so use more threads than cores, but not so many that a single
+		// spinning disk would start thrashing.
+		Pool_.setMaxThreadCount (qBound (4, QThread::idealThreadCount () * 2, 16));
+
+		CacheSaveTimer_->setSingleShot (true);
+		CacheSaveTimer_->setInterval (5000);
+		connect (CacheSaveTimer_,
+				SIGNAL (timeout ()),
+				this,
+				SLOT (saveCache ()));
+
+		XmlSettingsManager::Instance ().RegisterObject ("TagsReadingMode",
+				this, "handleReadingModeChanged");
+		handleReadingModeChanged ();
+	}
+
+	LocalFileResolver::~LocalFileResolver ()
 	{
+		// Both the resolving workers and the cache saver use this object.
+		Pool_.waitForDone ();
+		PendingSave_.waitForFinished ();
 	}
 
 	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file) const
 	{
+		return GetFileRef (file, TagLib::AudioProperties::Accurate);
+	}
+
+	TagLib::FileRef LocalFileResolver::GetFileRef (const QString& file,
+			TagLib::AudioProperties::ReadStyle style) const
+	{
 #ifdef Q_OS_WIN32
-		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()));
+		return TagLib::FileRef (reinterpret_cast<const wchar_t*> (file.utf16 ()), true, style);
 #else
-		return TagLib::FileRef (file.toUtf8 ().constData (), true, TagLib::AudioProperties::Accurate);
+		return TagLib::FileRef (file.toUtf8 ().constData (), true, style);
 #endif
 	}
 
 	MediaInfo LocalFileResolver::ResolveInfo (const QString& file)
 	{
-		const auto& modified = QFileInfo (file).lastModified ();
-		{
-			QReadLocker locker (&CacheLock_);
-			if (Cache_.contains (file))
-			{
-				const auto& pair = Cache_ [file];
-				if (pair.first == modified)
-					return pair.second;
-			}
-		}
+		EnsureCacheLoaded ();
+
+		FileId id {};
+		const bool hasId = GetFileId (file, id);
+
+		MediaInfo info;
+		if (hasId && GetCached (file, id, info))
+			return info;
 
-		QMutexLocker tlLocker (&TaglibMutex_);
+		if (!hasId)
+			PruneCache ({ file });
 
-		auto r = GetFileRef (file);
+		QReadLocker tlLocker (&TaglibLock_);
+
+		auto r = GetFileRef (file, ReadStyle_);
 		auto tag = r.tag ();
 		if (!tag)
 			throw ResolveError (file, "failed to get file tags");
@@ -93,7 +259,7 @@ namespace LMP
 		std::for_each (genres.begin (), genres.end (),
 				[] (QString& genre) { genre = genre.trimmed (); });
 
-		MediaInfo info
+		info =
 		{
 			file,
 			ftl (tag->artist ()),
@@ -104,18 +270,275 @@ namespace LMP
 			static_cast<qint32> (tag->year ()),
 			static_cast<qint32> (tag->track ())
 		};
+
+		tlLocker.unlock ();
+
+		if (hasId)
+			PutCached (file, id, info);
+		return info;
+	}
+
+	QReadWriteLock& LocalFileResolver::GetLock ()
+	{
+		return TaglibLock_;
+	}
+
+	QFuture<MediaInfo> LocalFileResolver::ResolveInfos (const QList<QString>& paths)
+	{
+		const auto batch = std::make_shared<ResolveBatch> ();
+		batch->Paths_ = paths;
+		batch->Timer_.start ();
+		batch->Iface_.reportStarted ();
+		batch->Iface_.setProgressRange (0, paths.size ());
+
+		const auto& future = batch->Iface_.future ();
+		if (paths.isEmpty ())
+		{
+			batch->Iface_.reportFinished ();
+			return future;
+		}
+
+		const auto workers = std::min (Pool_.maxThreadCount (), paths.size ());
+		batch->RunningWorkers_.fetchAndStoreOrdered (workers);
+		for (int i = 0; i < workers; ++i)
+			Pool_.start (new FunctionRunnable ([this, batch] { RunBatch (this, *batch); }));
+
+		return future;
+	}
+
+	void LocalFileResolver::SaveCache ()
+	{
+		QMutexLocker saveLocker (&CacheSaveMutex_);
+
+		if (!CacheDirty_.exchange (false))
+			return;
+
+		/* The moved files have been re-pointed to their new locations
+		 * by now, so what's left of the removed ones can be dropped
+		 * without touching the disk.
+		 */
+		QList<QString> removed;
 		{
 			QWriteLocker locker (&CacheLock_);
-			if (Cache_.size () > 200)
-				Cache_.clear ();
-			Cache_ [file] = qMakePair (modified, info);
+			std::swap (removed, RemovedPaths_);
+		}
+		if (!removed.isEmpty ())
+			PruneCache (removed);
+
+		QHash<QString, CacheEntry> cache;
+		{
+			QReadLocker locker (&CacheLock_);
+			cache = Cache_;
+		}
+
+		QFile file (CachePath_ + ".new");
+		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to open"
+					<< file.fileName ()
+					<< file.errorString ();
+			CacheDirty_ = true;
+			return;
+		}
+
+		QDataStream out (&file);
+		out.setVersion (QDataStream::Qt_4_8);
+		out << CacheVersion
+				<< static_cast<quint32> (cache.size ());
+		for (auto i = cache.begin (), end = cache.end (); i != end; ++i)
+			out << i.key ()
+					<< i->ID_.Size_
+					<< i->ID_.MTime_
+					<< i->ID_.Inode_
+					<< i->Info_;
+		file.close ();
+
+		QFile::remove (CachePath_);
+		if (!file.rename (CachePath_))
+			qWarning () << Q_FUNC_INFO
+					<< "unable to rename"
+					<< file.fileName ()
+					<< "to"
+					<< CachePath_
+					<< file.errorString ();
+	}
+
+	void LocalFileResolver::ForgetPaths (const QList<QString>& paths)
+	{
+		if (paths.isEmpty ())
+			return;
+
+		{
+			QWriteLocker locker (&CacheLock_);
+			RemovedPaths_ += paths;
+		}
+
+		CacheDirty_ = true;
+		QMetaObject::invokeMethod (this,
+				"scheduleCacheSave",
+				Qt::QueuedConnection);
+	}
+
+	void LocalFileResolver::EnsureCacheLoaded ()
+	{
+		if (CacheLoaded_)
+			return;
+
+		QMutexLocker loadLocker (&CacheLoadMutex_);
+		if (CacheLoaded_)
+			return;
+
+		QFile file (CachePath_);
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			CacheLoaded_ = true;
+			return;
+		}
+
+		QDataStream in (&file);
+		in.setVersion (QDataStream::Qt_4_8);
+
+		quint8 version = 0;
+		quint32 count = 0;
+		in >> version >> count;
+		if (version != CacheVersion)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unknown cache version"
+					<< version;
+			CacheLoaded_ = true;
+			return;
+		}
+
+		QHash<QString, CacheEntry> cache;
+		QHash<FileId, QString> id2path;
+		cache.reserve (count);
+		for (quint32 i = 0; i < count && in.status () == QDataStream::Ok; ++i)
+		{
+			QString path;
+			CacheEntry entry;
+			in >> path
+					>> entry.ID_.Size_
+					>> entry.ID_.MTime_
+					>> entry.ID_.Inode_
+					>> entry.Info_;
+
+			if (entry.ID_.Inode_)
+				id2path [entry.ID_] = path;
+			cache [path] = entry;
+		}
+
+		if (in.status () != QDataStream::Ok)
+			qWarning () << Q_FUNC_INFO
+					<< "cache file is truncated, loaded"
+					<< cache.size ()
+					<< "entries";
+
+		{
+			QWriteLocker locker (&CacheLock_);
+			Cache_.swap (cache);
+			ID2Path_.swap (id2path);
+		}
+
+		CacheLoaded_ = true;
+	}
+
+	void LocalFileResolver::PruneCache (const QList<QString>& paths)
+	{
+		QWriteLocker locker (&CacheLock_);
+		for (const auto& path : paths)
+		{
+			const auto pos = Cache_.find (path);
+			if (pos == Cache_.end ())
+				continue;
+
+			if (pos->ID_.Inode_ && ID2Path_.value (pos->ID_) == path)
+				ID2Path_.remove (pos->ID_);
+			Cache_.erase (pos);
 		}
-		return info;
 	}
 
-	QMutex& LocalFileResolver::GetMutex ()
+	bool LocalFileResolver::GetCached (const QString& file, const FileId& id, MediaInfo& info)
 	{
-		return TaglibMutex_;
+		{
+			QReadLocker locker (&CacheLock_);
+
+			const auto pos = Cache_.constFind (file);
+			if (pos != Cache_.constEnd () && pos->ID_ == id)
+			{
+				info = pos->Info_;
+				return true;
+			}
+
+			if (!id.Inode_)
+				return false;
+
+			const auto idPos = ID2Path_.constFind (id);
+			if (idPos == ID2Path_.constEnd ())
+				return false;
+
+			const auto movedPos = Cache_.constFind (*idPos);
+			if (movedPos == Cache_.constEnd ())
+				return false;
+
+			info = movedPos->Info_;
+		}
+
+		info.LocalPath_ = file;
+		PutCached (file, id, info);
+		return true;
+	}
+
+	void LocalFileResolver::PutCached (const QString& file, const FileId& id, const MediaInfo& info)
+	{
+		QWriteLocker locker (&CacheLock_);
+
+		const auto pos = Cache_.constFind (file);
+		if (pos != Cache_.constEnd () &&
+				pos->ID_.Inode_ &&
+				ID2Path_.value (pos->ID_) == file)
+			ID2Path_.remove (pos->ID_);
+
+		if (id.Inode_)
+		{
+			// The file has been moved from its previous location.
+			const auto& oldPath = ID2Path_.value (id);
+			if (!oldPath.isEmpty () && oldPath != file)
+				Cache_.remove (oldPath);
+
+			ID2Path_ [id] = file;
+		}
+
+		Cache_ [file] = { id, info };
+		CacheDirty_ = true;
+	}
+
+	void LocalFileResolver::handleReadingModeChanged ()
+	{
+		const auto& mode = XmlSettingsManager::Instance ()
+				.property ("TagsReadingMode").toString ();
+		ReadStyle_ = mode == "Accurate" ?
+				TagLib::AudioProperties::Accurate :
+				TagLib::AudioProperties::Fast;
+	}
+
+	void LocalFileResolver::scheduleCacheSave ()
+	{
+		if (!CacheSaveTimer_->isActive ())
+			CacheSaveTimer_->start ();
+	}
+
+	void LocalFileResolver::saveCache ()
+	{
+		// The dirty flag is still set, so the next save will catch up.
+		if (PendingSave_.isRunning ())
+		{
+			scheduleCacheSave ();
+			return;
+		}
+
+		PendingSave_ = QtConcurrent::run ([this] { SaveCache (); });
 	}
 }
 }
@@ -30,15 +30,19 @@
 #pragma once
 
 #include <stdexcept>
+#include <atomic>
 #include <QObject>
 #include <QHash>
 #include <QReadWriteLock>
 #include <QMutex>
-#include <QDateTime>
+#include <QThreadPool>
+#include <QFuture>
 #include <taglib/fileref.h>
 #include "interfaces/lmp/itagresolver.h"
 #include "mediainfo.h"
 
+class QTimer;
+
 namespace LeechCraft
 {
 namespace LMP
@@ -59,15 +63,78 @@ namespace LMP
 		Q_OBJECT
 		Q_INTERFACES (LeechCraft::LMP::ITagResolver)
 
-		QMutex TaglibMutex_;
+		QReadWriteLock TaglibLock_;
+		std::atomic<TagLib::AudioProperties::ReadStyle> ReadStyle_;
+
+		QThreadPool Pool_;
+	public:
+		/** Identifies the contents of a file on disk independently of
+		 * its path, so that moved or renamed files could be recognized.
+		 */
+		struct FileId
+		{
+			qint64 Size_;
+			qint64 MTime_;
+			quint64 Inode_;
+		};
+	private:
+		struct CacheEntry
+		{
+			FileId ID_;
+			MediaInfo Info_;
+		};
+
 		QReadWriteLock CacheLock_;
-		QHash<QString, QPair<QDateTime, MediaInfo>> Cache_;
+		QHash<QString, CacheEntry> Cache_;
+		QHash<FileId, QString> ID2Path_;
+		QList<QString> RemovedPaths_;
+
+		QMutex CacheLoadMutex_;
+		std::atomic<bool> CacheLoaded_;
+
+		const QString CachePath_;
+		QMutex CacheSaveMutex_;
+		std::atomic<bool> CacheDirty_;
+		QTimer *CacheSaveTimer_;
+		QFuture<void> PendingSave_;
 	public:
 		LocalFileResolver (QObject* = 0);
+		~LocalFileResolver ();
 
 		TagLib::FileRef GetFileRef (const QString&) const;
+		TagLib::FileRef GetFileRef (const QString&, TagLib::AudioProperties::ReadStyle) const;
 		MediaInfo ResolveInfo (const QString&);
-		QMutex& GetMutex ();
+		QReadWriteLock& GetLock ();
+
+		/** Resolves the given paths on the resolver's own thread pool.
+		 *
+		 * The returned future has one result per path in the same
+		 * order, with an empty MediaInfo for the files that couldn't be
+		 * resolved, and reports the number of resolved files as its
+		 * progress.
+		 */
+		QFuture<MediaInfo> ResolveInfos (const QList<QString>&);
+
+		void SaveCache ();
+
+		/** Marks the given files as removed from the collection.
+		 *
+		 * Their cache entries are dropped on the next cache save, unless
+		 * the files turn out to have been moved by then.
+		 */
+		void ForgetPaths (const QList<QString>&);
+	private:
+		void EnsureCacheLoaded ();
+		void PruneCache (const QList<QString>&);
+		bool GetCached (const QString&, const FileId&, MediaInfo&);
+		void PutCached (const QString&, const FileId&, const MediaInfo&);
+	private slots:
+		void handleReadingModeChanged ();
+		void scheduleCacheSave ();
+		void saveCache ();
 	};
+
+	bool operator== (const LocalFileResolver::FileId&, const LocalFileResolver::FileId&);
+	uint qHash (const LocalFileResolver::FileId&);
 }
 }
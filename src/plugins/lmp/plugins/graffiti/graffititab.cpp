@@ -36,6 +36,7 @@
 #include <QProgressDialog>
 #include <QtConcurrentRun>
 #include <QFutureWatcher>
+#include <QReadWriteLock>
 #include <QtDebug>
 #include <QSettings>
 #include <taglib/fileref.h>
@@ -417,7 +418,7 @@ namespace Graffiti
 		{
 			const auto& newInfo = pair.first;
 
-			QMutexLocker locker (&resolver->GetMutex ());
+			QWriteLocker locker (&resolver->GetLock ());
 			auto file = resolver->GetFileRef (newInfo.LocalPath_);
 			auto tag = file.tag ();
 
@@ -32,6 +32,7 @@
 #include <util/xpc/util.h>
 #include <interfaces/ijobholder.h>
 #include "sync/syncmanagerbase.h"
+#include "localcollection.h"
 
 namespace LeechCraft
 {
@@ -60,6 +61,22 @@ namespace LMP
 				SLOT (handleUploadProgress (int, int, SyncManagerBase*)));
 	}
 
+	void ProgressManager::AddLocalCollection (LocalCollection *collection)
+	{
+		connect (collection,
+				SIGNAL (scanStarted (int)),
+				this,
+				SLOT (handleScanStarted (int)));
+		connect (collection,
+				SIGNAL (scanProgressChanged (int)),
+				this,
+				SLOT (handleScanProgress (int)));
+		connect (collection,
+				SIGNAL (scanFinished ()),
+				this,
+				SLOT (handleScanFinished ()));
+	}
+
 	void ProgressManager::HandleWithHash (int done, int total,
 			SyncManagerBase *syncer, Syncer2Row_t& hash, const QString& name, const QString& status)
 	{
@@ -104,5 +121,54 @@ namespace LMP
 		HandleWithHash (done, total, syncer, UpRows_,
 				tr ("Audio upload"), tr ("Uploading..."));
 	}
+
+	void ProgressManager::handleScanStarted (int total)
+	{
+		ScanTotal_ = total;
+		ScanTimer_.start ();
+
+		if (!ScanRow_.isEmpty ())
+		{
+			handleScanProgress (0);
+			return;
+		}
+
+		ScanRow_ = QList<QStandardItem*>
+		{
+			new QStandardItem (tr ("Collection scanning")),
+			new QStandardItem (tr ("Reading tags...")),
+			new QStandardItem ()
+		};
+		auto item = ScanRow_.at (JobHolderColumn::JobProgress);
+		item->setData (QVariant::fromValue<JobHolderRow> (JobHolderRow::ProcessProgress),
+				CustomDataRoles::RoleJobHolderRow);
+		Model_->appendRow (ScanRow_);
+
+		handleScanProgress (0);
+	}
+
+	void ProgressManager::handleScanProgress (int done)
+	{
+		if (ScanRow_.isEmpty ())
+			return;
+
+		const auto secs = ScanTimer_.elapsed () / 1000.;
+		const auto& text = secs > 0 && done ?
+				tr ("%1 of %2 (%3 files/s)")
+					.arg (done)
+					.arg (ScanTotal_)
+					.arg (static_cast<int> (done / secs)) :
+				tr ("%1 of %2").arg (done).arg (ScanTotal_);
+		Util::SetJobHolderProgress (ScanRow_, done, ScanTotal_, text);
+	}
+
+	void ProgressManager::handleScanFinished ()
+	{
+		if (ScanRow_.isEmpty ())
+			return;
+
+		Model_->removeRow (ScanRow_.first ()->row ());
+		ScanRow_.clear ();
+	}
 }
 }
@@ -31,6 +31,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QElapsedTimer>
 
 class QAbstractItemModel;
 class QStandardItemModel;
@@ -41,6 +42,7 @@ namespace LeechCraft
 namespace LMP
 {
 	class SyncManagerBase;
+	class LocalCollection;
 
 	class ProgressManager : public QObject
 	{
@@ -51,18 +53,27 @@ namespace LMP
 		typedef QHash<SyncManagerBase*, QList<QStandardItem*>> Syncer2Row_t;
 		Syncer2Row_t TCRows_;
 		Syncer2Row_t UpRows_;
+
+		QList<QStandardItem*> ScanRow_;
+		QElapsedTimer ScanTimer_;
+		int ScanTotal_ = 0;
 	public:
 		ProgressManager (QObject* = 0);
 
 		QAbstractItemModel* GetModel () const;
 
 		void AddSyncManager (SyncManagerBase*);
+		void AddLocalCollection (LocalCollection*);
 	private:
 		void HandleWithHash (int, int, SyncManagerBase*,
 				Syncer2Row_t&, const QString&, const QString&);
 	private slots:
 		void handleTCProgress (int, int, SyncManagerBase*);
 		void handleUploadProgress (int, int, SyncManagerBase*);
+
+		void handleScanStarted (int);
+		void handleScanProgress (int);
+		void handleScanFinished ();
 	};
 }
 }
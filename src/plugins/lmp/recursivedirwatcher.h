@@ -49,6 +49,8 @@ namespace LMP
 		void RemoveRoot (const QString&);
 	signals:
 		void directoryChanged (const QString&);
+		void filesChanged (const QStringList&);
+		void filesRemoved (const QStringList&);
 	};
 }
 }
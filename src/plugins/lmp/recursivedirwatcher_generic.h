@@ -53,6 +53,8 @@ namespace LMP
 		void handleSubdirsCollected ();
 	signals:
 		void directoryChanged (const QString&);
+		void filesChanged (const QStringList&);
+		void filesRemoved (const QStringList&);
 	};
 }
 }
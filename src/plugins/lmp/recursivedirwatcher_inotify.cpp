@@ -0,0 +1,252 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "recursivedirwatcher_inotify.h"
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <QSocketNotifier>
+#include <QDir>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QtConcurrentRun>
+#include <QtDebug>
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const uint32_t WatchMask = IN_CLOSE_WRITE |
+				IN_CREATE |
+				IN_DELETE |
+				IN_MOVED_FROM |
+				IN_MOVED_TO |
+				IN_ONLYDIR;
+
+		QStringList CollectSubdirsImpl (const QString& path)
+		{
+			QDir dir (path);
+			const auto& list = dir.entryList (QDir::Dirs | QDir::NoDotAndDotDot);
+
+			QStringList result (path);
+			for (const auto& item : list)
+				result += CollectSubdirsImpl (dir.filePath (item));
+			return result;
+		}
+
+		bool IsUnder (const QString& path, const QString& dir)
+		{
+			return path == dir || path.startsWith (dir + '/');
+		}
+	}
+
+	RecursiveDirWatcherImpl::RecursiveDirWatcherImpl (QObject *parent)
+	: QObject { parent }
+	, Fd_ { inotify_init1 (IN_NONBLOCK | IN_CLOEXEC) }
+	{
+		if (Fd_ < 0)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "unable to initialize inotify:"
+					<< std::strerror (errno);
+			return;
+		}
+
+		Notifier_ = new QSocketNotifier { Fd_, QSocketNotifier::Read, this };
+		connect (Notifier_,
+				SIGNAL (activated (int)),
+				this,
+				SLOT (readEvents ()));
+	}
+
+	RecursiveDirWatcherImpl::~RecursiveDirWatcherImpl ()
+	{
+		if (Fd_ >= 0)
+			close (Fd_);
+	}
+
+	void RecursiveDirWatcherImpl::AddRoot (const QString& root)
+	{
+		if (Roots_.contains (root))
+			return;
+
+		Roots_ << root;
+		CollectSubdirs (root);
+	}
+
+	void RecursiveDirWatcherImpl::RemoveRoot (const QString& root)
+	{
+		if (Roots_.removeOne (root))
+			RemoveWatches (root);
+	}
+
+	void RecursiveDirWatcherImpl::CollectSubdirs (const QString& path)
+	{
+		qDebug () << Q_FUNC_INFO << "scanning" << path;
+		auto watcher = new QFutureWatcher<QStringList> ();
+		connect (watcher,
+				SIGNAL (finished ()),
+				this,
+				SLOT (handleSubdirsCollected ()));
+
+		watcher->setFuture (QtConcurrent::run (CollectSubdirsImpl, path));
+	}
+
+	void RecursiveDirWatcherImpl::AddWatches (const QStringList& paths)
+	{
+		if (Fd_ < 0)
+			return;
+
+		for (const auto& path : paths)
+		{
+			if (Path2WD_.contains (path))
+				continue;
+
+			const auto wd = inotify_add_watch (Fd_, QFile::encodeName (path).constData (), WatchMask);
+			if (wd < 0)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "unable to watch"
+						<< path
+						<< std::strerror (errno);
+				if (errno == ENOSPC)
+					return;
+				continue;
+			}
+
+			WD2Path_ [wd] = path;
+			Path2WD_ [path] = wd;
+		}
+	}
+
+	void RecursiveDirWatcherImpl::RemoveWatches (const QString& dir)
+	{
+		for (auto i = Path2WD_.begin (); i != Path2WD_.end (); )
+		{
+			if (!IsUnder (i.key (), dir))
+			{
+				++i;
+				continue;
+			}
+
+			inotify_rm_watch (Fd_, *i);
+			WD2Path_.remove (*i);
+			i = Path2WD_.erase (i);
+		}
+	}
+
+	void RecursiveDirWatcherImpl::handleSubdirsCollected ()
+	{
+		auto watcher = dynamic_cast<QFutureWatcher<QStringList>*> (sender ());
+		if (!watcher)
+			return;
+
+		watcher->deleteLater ();
+
+		auto paths = watcher->result ();
+		if (paths.isEmpty ())
+			return;
+
+		/* The root might have been removed while its subdirectories
+		 * were being collected.
+		 */
+		if (std::none_of (Roots_.begin (), Roots_.end (),
+				[&paths] (const QString& root) { return IsUnder (paths.front (), root); }))
+			return;
+
+		AddWatches (paths);
+	}
+
+	void RecursiveDirWatcherImpl::readEvents ()
+	{
+		QStringList changed;
+		QStringList removed;
+
+		char buffer [64 * 1024] __attribute__ ((aligned (__alignof__ (inotify_event))));
+		while (true)
+		{
+			const auto len = read (Fd_, buffer, sizeof (buffer));
+			if (len <= 0)
+				break;
+
+			for (auto ptr = buffer; ptr < buffer + len; )
+			{
+				const auto event = reinterpret_cast<const inotify_event*> (ptr);
+				ptr += sizeof (inotify_event) + event->len;
+
+				if (event->mask & IN_Q_OVERFLOW)
+				{
+					qWarning () << Q_FUNC_INFO
+							<< "inotify queue overflow, rescanning everything";
+					for (const auto& root : Roots_)
+						emit directoryChanged (root);
+					continue;
+				}
+
+				if (event->mask & IN_IGNORED)
+				{
+					Path2WD_.remove (WD2Path_.take (event->wd));
+					continue;
+				}
+
+				if (!WD2Path_.contains (event->wd) || !event->len)
+					continue;
+
+				const auto& path = WD2Path_ [event->wd] + '/' + QFile::decodeName (event->name);
+				if (event->mask & IN_ISDIR)
+				{
+					if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					{
+						CollectSubdirs (path);
+						emit directoryChanged (path);
+					}
+					else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+					{
+						RemoveWatches (path);
+						removed << path;
+					}
+				}
+				else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+					changed << path;
+				else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+					removed << path;
+			}
+		}
+
+		if (!removed.isEmpty ())
+			emit filesRemoved (removed);
+		if (!changed.isEmpty ())
+			emit filesChanged (changed);
+	}
+}
+}
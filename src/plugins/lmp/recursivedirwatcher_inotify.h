@@ -0,0 +1,78 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+
+class QSocketNotifier;
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	/** Watches the directory trees via inotify.
+	 *
+	 * Unlike the generic implementation, this one reports the exact
+	 * files that have been changed or removed, so only these files need
+	 * to be rescanned. Newly created subdirectories are reported via
+	 * the directoryChanged() signal and are watched as well.
+	 */
+	class RecursiveDirWatcherImpl : public QObject
+	{
+		Q_OBJECT
+
+		const int Fd_;
+		QSocketNotifier *Notifier_ = nullptr;
+
+		QStringList Roots_;
+		QHash<int, QString> WD2Path_;
+		QHash<QString, int> Path2WD_;
+	public:
+		RecursiveDirWatcherImpl (QObject*);
+		~RecursiveDirWatcherImpl ();
+
+		void AddRoot (const QString&);
+		void RemoveRoot (const QString&);
+	private:
+		void CollectSubdirs (const QString&);
+		void AddWatches (const QStringList&);
+		void RemoveWatches (const QString&);
+	private slots:
+		void handleSubdirsCollected ();
+		void readEvents ();
+	signals:
+		void directoryChanged (const QString&);
+		void filesChanged (const QStringList&);
+		void filesRemoved (const QStringList&);
+	};
+}
+}
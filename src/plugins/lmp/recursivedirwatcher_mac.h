@@ -61,6 +61,8 @@ namespace LMP
 		void Stop ();
 	signals:
 		void directoryChanged (const QString&);
+		void filesChanged (const QStringList&);
+		void filesRemoved (const QStringList&);
 	};
 }
 }
@@ -0,0 +1,193 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "localfileresolvertest.h"
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include "localfileresolver.h"
+
+QTEST_MAIN (LeechCraft::LMP::LocalFileResolverTest)
+
+namespace LeechCraft
+{
+namespace LMP
+{
+	namespace
+	{
+		const int FilesCount = 500;
+
+		void RemoveDir (const QString& path)
+		{
+			QDir dir { path };
+			for (const auto& info : dir.entryInfoList (QDir::NoDotAndDotDot | QDir::AllEntries | QDir::Hidden))
+				if (info.isDir ())
+					RemoveDir (info.absoluteFilePath ());
+				else
+					dir.remove (info.fileName ());
+			QDir {}.rmdir (path);
+		}
+
+		/* Writes a second of silence as a 8 kHz mono 8-bit PCM WAV file,
+		 * which TagLib is able to open.
+		 */
+		bool WriteWav (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::WriteOnly))
+				return false;
+
+			const quint32 rate = 8000;
+			const QByteArray samples (rate, static_cast<char> (0x80));
+
+			QDataStream out { &file };
+			out.setByteOrder (QDataStream::LittleEndian);
+			out.writeRawData ("RIFF", 4);
+			out << static_cast<quint32> (36 + samples.size ());
+			out.writeRawData ("WAVEfmt ", 8);
+			out << static_cast<quint32> (16)
+					<< static_cast<quint16> (1)
+					<< static_cast<quint16> (1)
+					<< rate
+					<< rate
+					<< static_cast<quint16> (1)
+					<< static_cast<quint16> (8);
+			out.writeRawData ("data", 4);
+			out << static_cast<quint32> (samples.size ());
+			out.writeRawData (samples.constData (), samples.size ());
+			return out.status () == QDataStream::Ok;
+		}
+
+		QString GetCachePath (const QString& home)
+		{
+			return QDir { home }.filePath (".leechcraft/lmp/tagcache.dat");
+		}
+
+		void ResolveAll (LocalFileResolver& resolver, const QStringList& paths)
+		{
+			auto future = resolver.ResolveInfos (paths);
+			future.waitForFinished ();
+
+			const auto& infos = future.results ();
+			QCOMPARE (infos.size (), paths.size ());
+			for (int i = 0; i < infos.size (); ++i)
+				QCOMPARE (infos.at (i).LocalPath_, paths.at (i));
+		}
+	}
+
+	void LocalFileResolverTest::initTestCase ()
+	{
+		TestHome_ = QDir::temp ().filePath (QString ("lc_lmp_resolver_test_%1")
+					.arg (QCoreApplication::applicationPid ()));
+		RemoveDir (TestHome_);
+		QVERIFY (QDir {}.mkpath (TestHome_ + "/music"));
+		qputenv ("HOME", QFile::encodeName (TestHome_));
+
+		QCoreApplication::setOrganizationName ("LeechCraftTest");
+		QCoreApplication::setApplicationName ("LocalFileResolverTest");
+
+		for (int i = 0; i < FilesCount; ++i)
+		{
+			const auto& path = QString ("%1/music/track%2.wav").arg (TestHome_).arg (i);
+			QVERIFY (WriteWav (path));
+			Paths_ << path;
+		}
+	}
+
+	void LocalFileResolverTest::cleanupTestCase ()
+	{
+		RemoveDir (TestHome_);
+	}
+
+	void LocalFileResolverTest::movedFileKeepsTags ()
+	{
+		QFile::remove (GetCachePath (TestHome_));
+
+		LocalFileResolver resolver;
+		const auto& path = TestHome_ + "/music/moved.wav";
+		QVERIFY (WriteWav (path));
+		QCOMPARE (resolver.ResolveInfo (path).LocalPath_, path);
+
+		const auto& newPath = TestHome_ + "/music/renamed.wav";
+		QVERIFY (QFile::rename (path, newPath));
+		QCOMPARE (resolver.ResolveInfo (newPath).LocalPath_, newPath);
+
+		QVERIFY (QFile::remove (newPath));
+		bool thrown = false;
+		try
+		{
+			resolver.ResolveInfo (newPath);
+		}
+		catch (const ResolveError&)
+		{
+			thrown = true;
+		}
+		QVERIFY (thrown);
+	}
+
+	void LocalFileResolverTest::benchColdScan ()
+	{
+		QBENCHMARK
+		{
+			QFile::remove (GetCachePath (TestHome_));
+
+			LocalFileResolver resolver;
+			ResolveAll (resolver, Paths_);
+		}
+	}
+
+	void LocalFileResolverTest::benchCachedScan ()
+	{
+		LocalFileResolver resolver;
+		ResolveAll (resolver, Paths_);
+
+		QBENCHMARK
+		{
+			ResolveAll (resolver, Paths_);
+		}
+	}
+
+	void LocalFileResolverTest::benchPersistentCacheScan ()
+	{
+		{
+			LocalFileResolver resolver;
+			ResolveAll (resolver, Paths_);
+			resolver.SaveCache ();
+		}
+		QVERIFY (QFile::exists (GetCachePath (TestHome_)));
+
+		QBENCHMARK
+		{
+			LocalFileResolver resolver;
+			ResolveAll (resolver, Paths_);
+		}
+	}
+}
+}
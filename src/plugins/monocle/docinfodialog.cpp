@@ -30,9 +30,12 @@
 #include "docinfodialog.h"
 #include <QStandardItemModel>
 #include <QtDebug>
+#include <util/util.h>
 #include <util/sll/slotclosure.h>
 #include "interfaces/monocle/idocument.h"
 #include "interfaces/monocle/ihavefontinfo.h"
+#include "core.h"
+#include "pixmapcachemanager.h"
 
 namespace LeechCraft
 {
@@ -70,6 +73,15 @@ namespace Monocle
 				this
 			};
 		}
+
+		const auto& stats = Core::Instance ().GetPixmapCacheManager ()->GetStats ();
+		Ui_.CacheSize_->setText (tr ("%1 of %2")
+				.arg (Util::MakePrettySize (stats.CurrentSize_))
+				.arg (Util::MakePrettySize (stats.MaxSize_)));
+		Ui_.CacheEntries_->setText (QString::number (stats.Entries_));
+		Ui_.CacheHits_->setText (QString::number (stats.Hits_));
+		Ui_.CacheMisses_->setText (QString::number (stats.Misses_));
+		Ui_.CacheEvictions_->setText (QString::number (stats.Evictions_));
 	}
 
 	void DocInfoDialog::HandleFontsInfo (const QList<FontInfo>& infos)
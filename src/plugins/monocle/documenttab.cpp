@@ -29,6 +29,7 @@
 
 #include "documenttab.h"
 #include <functional>
+#include <algorithm>
 #include <QToolBar>
 #include <QComboBox>
 #include <QFileDialog>
@@ -828,6 +829,15 @@ namespace Monocle
 		return ihtc->GetTextContent (pageItem->GetPageNum (), bounding);
 	}
 
+	QList<PageGraphicsItem*> DocumentTab::GetVisiblePages () const
+	{
+		QList<PageGraphicsItem*> result;
+		for (auto item : Ui_.PagesView_->items (Ui_.PagesView_->viewport ()->rect ()))
+			if (auto page = dynamic_cast<PageGraphicsItem*> (item))
+				result << page;
+		return result;
+	}
+
 	void DocumentTab::RegenPageVisibility ()
 	{
 		if (receivers (SIGNAL (pagesVisibilityChanged (QMap<int, QRect>))) <= 0)
@@ -837,12 +847,8 @@ namespace Monocle
 		const auto& visibleRect = Ui_.PagesView_->mapToScene (viewRect);
 
 		QMap<int, QRect> rects;
-		for (auto item : Ui_.PagesView_->items (viewRect))
+		for (auto page : GetVisiblePages ())
 		{
-			auto page = dynamic_cast<PageGraphicsItem*> (item);
-			if (!page)
-				continue;
-
 			const auto& pageRect = page->mapToScene (page->boundingRect ());
 			const auto& xsect = visibleRect.intersected (pageRect);
 			const auto& pageXsect = page->MapToDoc (page->mapFromScene (xsect).boundingRect ());
@@ -852,6 +858,51 @@ namespace Monocle
 		emit pagesVisibilityChanged (rects);
 	}
 
+	void DocumentTab::UpdateRenderQueue ()
+	{
+		const auto& visible = GetVisiblePages ();
+		if (visible.isEmpty ())
+			return;
+
+		const auto scrollValue = Ui_.PagesView_->verticalScrollBar ()->value ();
+		const bool forward = scrollValue >= LastScrollValue_;
+		LastScrollValue_ = scrollValue;
+
+		const auto lastPage = Pages_.size () - 1;
+
+		// The same pages RegenPageVisibility() reports as visible.
+		auto firstVisible = lastPage;
+		auto lastVisible = 0;
+		for (auto page : visible)
+		{
+			firstVisible = std::min (firstVisible, page->GetPageNum ());
+			lastVisible = std::max (lastVisible, page->GetPageNum ());
+		}
+
+		const auto prefetch = XmlSettingsManager::Instance ().property ("PrefetchPages").toInt ();
+		const auto first = std::max (firstVisible - (forward ? 0 : prefetch), 0);
+		const auto last = std::min (lastVisible + (forward ? prefetch : 0), lastPage);
+
+		for (int i = RenderWindowFirst_; i <= std::min (RenderWindowLast_, lastPage); ++i)
+			if (i < first || i > last)
+				Pages_.at (i)->CancelPendingRenders ();
+
+		RenderWindowFirst_ = first;
+		RenderWindowLast_ = last;
+
+		for (int i = first; i <= last; ++i)
+			Pages_.at (i)->CancelInvisibleTiles ();
+
+		// The scheduler starts the most recently requested jobs first,
+		// so the pages closest to the visible ones are requested last.
+		if (forward)
+			for (int i = last; i > lastVisible; --i)
+				Pages_.at (i)->Prefetch ();
+		else
+			for (int i = first; i < firstVisible; ++i)
+				Pages_.at (i)->Prefetch ();
+	}
+
 	void DocumentTab::handleLoaderReady (const IDocument_ptr& document, const QString& path)
 	{
 		if (!document || !document->IsValid ())
@@ -1235,6 +1286,7 @@ namespace Monocle
 	void DocumentTab::checkCurrentPageChange (bool force)
 	{
 		RegenPageVisibility ();
+		UpdateRenderQueue ();
 
 		auto current = GetCurrentPage ();
 		if (PrevCurrentPage_ == current && !force)
@@ -114,6 +114,10 @@ namespace Monocle
 
 		int PrevCurrentPage_;
 
+		int LastScrollValue_ = 0;
+		int RenderWindowFirst_ = 0;
+		int RenderWindowLast_ = -1;
+
 		struct OnloadData
 		{
 			int Num_;
@@ -164,7 +168,9 @@ namespace Monocle
 		QImage GetSelectionImg ();
 		QString GetSelectionText () const;
 
+		QList<PageGraphicsItem*> GetVisiblePages () const;
 		void RegenPageVisibility ();
+		void UpdateRenderQueue ();
 	private slots:
 		void handleLoaderReady (const IDocument_ptr&, const QString&);
 
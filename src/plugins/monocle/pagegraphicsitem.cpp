@@ -29,17 +29,20 @@
 
 #include "pagegraphicsitem.h"
 #include <limits>
+#include <algorithm>
 #include <cmath>
 #include <QtDebug>
-#include <QtConcurrentRun>
 #include <QFutureWatcher>
 #include <QGraphicsSceneMouseEvent>
+#include <QStyleOptionGraphicsItem>
+#include <QPainter>
 #include <QCursor>
 #include <QApplication>
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QMenu>
 #include <QWidgetAction>
+#include "interfaces/monocle/isupporttiledrendering.h"
 #include "core.h"
 #include "pixmapcachemanager.h"
 #include "arbitraryrotationwidget.h"
@@ -49,6 +52,23 @@ namespace LeechCraft
 {
 namespace Monocle
 {
+	namespace
+	{
+		const int TileSize = 512;
+
+		// Pages larger than this amount of pixels at the current scale
+		// are rendered by tiles if the backend supports it.
+		const qint64 TiledRenderingThreshold = 4 * TileSize * TileSize;
+
+		const int PreviewMaxDimension = 512;
+		const int MaxTilesPerPage = 64;
+
+		qint64 GetPixmapBytes (const QPixmap& px)
+		{
+			return static_cast<qint64> (px.width ()) * px.height () * px.depth () / 8;
+		}
+	}
+
 	PageGraphicsItem::PageGraphicsItem (IDocument_ptr doc, int page, QGraphicsItem *parent)
 	: QGraphicsPixmapItem (parent)
 	, Doc_ (doc)
@@ -56,19 +76,24 @@ namespace Monocle
 	, XScale_ (1)
 	, YScale_ (1)
 	, Invalid_ (true)
+	, Tiled_ (false)
 	, LayoutManager_ (0)
+	, RenderPriority_ (RenderScheduler::Priority::Visible)
 	{
+		Tiled_ = ShouldTile ();
+
 		setTransformationMode (Qt::SmoothTransformation);
-		setPixmap (QPixmap (Doc_->GetPageSize (page)));
+		setFlag (ItemUsesExtendedStyleOption);
 		setAcceptHoverEvents (true);
 	}
 
 	PageGraphicsItem::~PageGraphicsItem ()
 	{
-		Core::Instance ().GetPixmapCacheManager ()->PixmapDeleted (this);
-
-		if (RenderFuture_)
-			RenderFuture_->waitForFinished ();
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Page));
+		cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Preview));
+		for (const auto& key : Tiles_.keys ())
+			cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Tile, key));
 	}
 
 	void PageGraphicsItem::SetLayoutManager (PagesLayoutManager *manager)
@@ -81,19 +106,36 @@ namespace Monocle
 		ReleaseHandler_ = handler;
 	}
 
+	void PageGraphicsItem::SetRenderPriority (RenderScheduler::Priority priority)
+	{
+		RenderPriority_ = priority;
+	}
+
 	void PageGraphicsItem::SetScale (double xs, double ys)
 	{
 		if (std::abs (xs - XScale_) < std::numeric_limits<double>::epsilon () &&
 			std::abs (ys - YScale_) < std::numeric_limits<double>::epsilon ())
 			return;
 
+		prepareGeometryChange ();
+
 		XScale_ = xs;
 		YScale_ = ys;
 
-		auto size = Doc_->GetPageSize (PageNum_);
-		size.rwidth () *= xs;
-		size.rheight () *= ys;
-		setPixmap (QPixmap (size));
+		RenderFuture_.reset ();
+		ClearTiles ();
+		FirstTileTimer_.invalidate ();
+
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Page));
+
+		Tiled_ = ShouldTile ();
+		setPixmap (QPixmap ());
+		if (!Tiled_)
+		{
+			Preview_ = QPixmap ();
+			cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Preview));
+		}
 
 		Invalid_ = true;
 
@@ -146,53 +188,131 @@ namespace Monocle
 		Item2RectInfo_.remove (item);
 	}
 
-	void PageGraphicsItem::ClearPixmap ()
+	void PageGraphicsItem::EvictRendering (PixmapCacheManager::EntryKind kind, const QPair<int, int>& tile)
 	{
-		auto size = Doc_->GetPageSize (PageNum_);
-		size.rwidth () *= XScale_;
-		size.rheight () *= YScale_;
-		setPixmap (QPixmap (size));
-
-		Invalid_ = true;
+		switch (kind)
+		{
+		case PixmapCacheManager::EntryKind::Page:
+			setPixmap (QPixmap ());
+			Invalid_ = true;
+			break;
+		case PixmapCacheManager::EntryKind::Preview:
+			Preview_ = QPixmap ();
+			break;
+		case PixmapCacheManager::EntryKind::Tile:
+			Tiles_.remove (tile);
+			break;
+		}
 	}
 
 	void PageGraphicsItem::UpdatePixmap ()
 	{
 		Invalid_ = true;
+		RenderFuture_.reset ();
+		if (Tiled_)
+			ClearTiles ();
 		if (IsDisplayed ())
 			update ();
 	}
 
+	void PageGraphicsItem::Prefetch ()
+	{
+		if (!IsThreaded () || IsDisplayed ())
+			return;
+
+		if (Tiled_)
+		{
+			if (Preview_.isNull ())
+				RequestPreview (RenderScheduler::Priority::Prefetch);
+			return;
+		}
+
+		if (Invalid_ && !RenderFuture_)
+			RequestThreadedRender (RenderScheduler::Priority::Prefetch);
+	}
+
+	void PageGraphicsItem::CancelPendingRenders ()
+	{
+		if (IsDisplayed ())
+		{
+			CancelInvisibleTiles ();
+			return;
+		}
+
+		if (RenderFuture_)
+		{
+			RenderFuture_.reset ();
+			Invalid_ = true;
+		}
+		PreviewFuture_.reset ();
+		PendingTiles_.clear ();
+	}
+
+	/* The geometry doesn't depend on the pixmap, since the pixmap is
+	 * null for the tiled pages, for the pages not rendered yet and for
+	 * the ones whose rendering has been evicted from the cache.
+	 */
+	QRectF PageGraphicsItem::boundingRect () const
+	{
+		return QRectF (QPointF (0, 0), GetScaledSize ());
+	}
+
+	QPainterPath PageGraphicsItem::shape () const
+	{
+		QPainterPath path;
+		path.addRect (boundingRect ());
+		return path;
+	}
+
+	bool PageGraphicsItem::contains (const QPointF& point) const
+	{
+		return boundingRect ().contains (point);
+	}
+
 	void PageGraphicsItem::paint (QPainter *painter,
 			const QStyleOptionGraphicsItem *option, QWidget *w)
 	{
+		if (Tiled_)
+		{
+			Invalid_ = false;
+			PaintTiles (painter, option);
+			return;
+		}
+
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		const auto& cacheKey = GetCacheKey (PixmapCacheManager::EntryKind::Page);
 		if (Invalid_ && IsDisplayed ())
 		{
-			auto backendObj = Doc_->GetBackendPlugin ();
-			if (qobject_cast<IBackendPlugin*> (backendObj)->IsThreaded ())
+			cache->RecordMiss ();
+
+			if (IsThreaded ())
 			{
+				// A prefetch render that hasn't started yet is
+				// rescheduled with the priority of visible pages.
+				if (RenderFuture_ && !RenderFuture_->isStarted ())
+					RenderFuture_.reset ();
 				if (!RenderFuture_)
-					RequestThreadedRender ();
-
-				auto size = Doc_->GetPageSize (PageNum_);
-				size.rwidth () *= XScale_;
-				size.rheight () *= YScale_;
-				QPixmap px (size);
-				px.fill ();
-				setPixmap (px);
+					RequestThreadedRender (RenderPriority_);
 			}
 			else
 			{
 				const auto& img = Doc_->RenderPage (PageNum_, XScale_, YScale_);
 				setPixmap (QPixmap::fromImage (img));
+				cache->Put (cacheKey, GetPixmapBytes (pixmap ()));
 			}
 			Invalid_ = false;
+		}
+		else
+			cache->Touch (cacheKey);
 
-			Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+		// The threaded render is still in progress.
+		if (pixmap ().isNull ())
+		{
+			painter->fillRect (boundingRect (), Qt::white);
+			return;
 		}
 
 		QGraphicsPixmapItem::paint (painter, option, w);
-		Core::Instance ().GetPixmapCacheManager ()->PixmapPainted (this);
 	}
 
 	void PageGraphicsItem::mousePressEvent (QGraphicsSceneMouseEvent *event)
@@ -244,31 +364,43 @@ namespace Monocle
 		rotateMenu.exec (event->screenPos ());
 	}
 
-	void PageGraphicsItem::RequestThreadedRender ()
+	PageGraphicsItem::RenderWatcher_ptr PageGraphicsItem::ScheduleRender (RenderScheduler::Priority priority,
+			const RenderScheduler::Renderer_f& renderer, const char *slot)
 	{
-		RenderFuture_.reset (new QFutureWatcher<RenderInfo>,
-				[this] (QFutureWatcher<RenderInfo> *watcher)
+		// Dropping the watcher cancels the render if it hasn't started
+		// yet, so stale renders don't waste the CPU.
+		RenderWatcher_ptr watcher (new QFutureWatcher<QImage>,
+				[this] (QFutureWatcher<QImage> *watcher)
 				{
 					disconnect (watcher, 0, this, 0);
+					watcher->cancel ();
 					watcher->deleteLater ();
 				});
-		connect (RenderFuture_.get (),
+		connect (watcher.get (),
 				SIGNAL (finished ()),
 				this,
+				slot);
+		watcher->setFuture (Core::Instance ().GetRenderScheduler ()->Schedule (priority, renderer));
+		return watcher;
+	}
+
+	void PageGraphicsItem::RequestThreadedRender (RenderScheduler::Priority priority)
+	{
+		// The renderers capture the document by value instead of this,
+		// so they may safely outlive this item.
+		const auto doc = Doc_;
+		const auto page = PageNum_;
+		const auto xscale = XScale_;
+		const auto yscale = YScale_;
+		RenderFuture_ = ScheduleRender (priority,
+				[doc, page, xscale, yscale] { return doc->RenderPage (page, xscale, yscale); },
 				SLOT (handlePixmapRendered ()));
+	}
 
-		// C++14
-		auto xscale = XScale_;
-		auto yscale = YScale_;
-		RenderFuture_->setFuture (QtConcurrent::run ([this, xscale, yscale]
-				{
-					return RenderInfo
-					{
-						Doc_->RenderPage (PageNum_, yscale, yscale),
-						xscale,
-						yscale
-					};
-				}));
+	bool PageGraphicsItem::IsThreaded () const
+	{
+		const auto backend = qobject_cast<IBackendPlugin*> (Doc_->GetBackendPlugin ());
+		return backend && backend->IsThreaded ();
 	}
 
 	bool PageGraphicsItem::IsDisplayed () const
@@ -287,6 +419,190 @@ namespace Monocle
 		return false;
 	}
 
+	QRectF PageGraphicsItem::GetVisibleRect () const
+	{
+		QRectF result;
+		if (!scene ())
+			return result;
+
+		for (auto view : scene ()->views ())
+		{
+			const auto& rect = view->viewport ()->rect ();
+			const auto& mapped = mapFromScene (view->mapToScene (rect)).boundingRect ();
+			result |= mapped.intersected (boundingRect ());
+		}
+
+		return result;
+	}
+
+	QSize PageGraphicsItem::GetScaledSize () const
+	{
+		auto size = Doc_->GetPageSize (PageNum_);
+		size.rwidth () *= XScale_;
+		size.rheight () *= YScale_;
+		return size;
+	}
+
+	bool PageGraphicsItem::ShouldTile () const
+	{
+		if (!qobject_cast<ISupportTiledRendering*> (Doc_->GetQObject ()))
+			return false;
+
+		if (!IsThreaded ())
+			return false;
+
+		const auto& size = GetScaledSize ();
+		return static_cast<qint64> (size.width ()) * size.height () > TiledRenderingThreshold;
+	}
+
+	QRect PageGraphicsItem::GetTileRect (const TileKey_t& key) const
+	{
+		const QRect tile { key.first * TileSize, key.second * TileSize, TileSize, TileSize };
+		return tile.intersected (QRect (QPoint (0, 0), GetScaledSize ()));
+	}
+
+	void PageGraphicsItem::PaintTiles (QPainter *painter, const QStyleOptionGraphicsItem *option)
+	{
+		const auto& bounding = boundingRect ();
+		const auto& exposed = option->exposedRect.intersected (bounding);
+		if (exposed.isEmpty ())
+			return;
+
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		bool previewUsed = false;
+
+		if (Preview_.isNull ())
+			RequestPreview (RenderPriority_);
+
+		const int firstCol = std::floor (exposed.left () / TileSize);
+		const int lastCol = std::floor ((exposed.right () - 1) / TileSize);
+		const int firstRow = std::floor (exposed.top () / TileSize);
+		const int lastRow = std::floor ((exposed.bottom () - 1) / TileSize);
+
+		for (int row = firstRow; row <= lastRow; ++row)
+			for (int col = firstCol; col <= lastCol; ++col)
+			{
+				const auto& key = qMakePair (col, row);
+				const auto& tileRect = GetTileRect (key);
+				if (tileRect.isEmpty ())
+					continue;
+
+				const auto pos = Tiles_.constFind (key);
+				if (pos != Tiles_.constEnd ())
+				{
+					painter->drawPixmap (tileRect.topLeft (), *pos);
+					cache->Touch (GetCacheKey (PixmapCacheManager::EntryKind::Tile, key));
+					continue;
+				}
+
+				if (!Preview_.isNull ())
+				{
+					previewUsed = true;
+
+					const auto xRatio = Preview_.width () / bounding.width ();
+					const auto yRatio = Preview_.height () / bounding.height ();
+					const QRectF source
+					{
+						tileRect.x () * xRatio,
+						tileRect.y () * yRatio,
+						tileRect.width () * xRatio,
+						tileRect.height () * yRatio
+					};
+					painter->drawPixmap (QRectF (tileRect), Preview_, source);
+				}
+				else
+					painter->fillRect (tileRect, Qt::white);
+
+				RequestTile (key);
+			}
+
+		if (previewUsed)
+			cache->Touch (GetCacheKey (PixmapCacheManager::EntryKind::Preview));
+	}
+
+	void PageGraphicsItem::RequestTile (const TileKey_t& key)
+	{
+		if (PendingTiles_.contains (key))
+			return;
+
+		if (!FirstTileTimer_.isValid () && Tiles_.isEmpty ())
+			FirstTileTimer_.start ();
+
+		Core::Instance ().GetPixmapCacheManager ()->RecordMiss ();
+
+		const auto doc = Doc_;
+		const auto page = PageNum_;
+		const auto xscale = XScale_;
+		const auto yscale = YScale_;
+		const auto& rect = GetTileRect (key);
+		PendingTiles_ [key] = ScheduleRender (RenderPriority_,
+				[doc, page, xscale, yscale, rect]
+				{
+					const auto tiled = qobject_cast<ISupportTiledRendering*> (doc->GetQObject ());
+					return tiled->RenderPageRect (page, xscale, yscale, rect);
+				},
+				SLOT (handleTileRendered ()));
+	}
+
+	void PageGraphicsItem::RequestPreview (RenderScheduler::Priority priority)
+	{
+		if (PreviewFuture_)
+			return;
+
+		const auto& size = Doc_->GetPageSize (PageNum_);
+		const auto scale = static_cast<double> (PreviewMaxDimension) /
+				std::max (std::max (size.width (), size.height ()), 1);
+
+		const auto doc = Doc_;
+		const auto page = PageNum_;
+		PreviewFuture_ = ScheduleRender (priority,
+				[doc, page, scale] { return doc->RenderPage (page, scale, scale); },
+				SLOT (handlePreviewRendered ()));
+	}
+
+	void PageGraphicsItem::CancelInvisibleTiles ()
+	{
+		const auto& visible = GetVisibleRect ().toAlignedRect ();
+		for (auto i = PendingTiles_.begin (); i != PendingTiles_.end (); )
+			if (GetTileRect (i.key ()).intersects (visible))
+				++i;
+			else
+				i = PendingTiles_.erase (i);
+	}
+
+	void PageGraphicsItem::PruneTiles ()
+	{
+		if (Tiles_.size () <= MaxTilesPerPage)
+			return;
+
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		const auto& visible = GetVisibleRect ().adjusted (-TileSize, -TileSize, TileSize, TileSize);
+		for (auto i = Tiles_.begin (); i != Tiles_.end (); )
+			if (GetTileRect (i.key ()).intersects (visible.toAlignedRect ()))
+				++i;
+			else
+			{
+				cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Tile, i.key ()));
+				i = Tiles_.erase (i);
+			}
+	}
+
+	void PageGraphicsItem::ClearTiles ()
+	{
+		const auto cache = Core::Instance ().GetPixmapCacheManager ();
+		for (const auto& key : Tiles_.keys ())
+			cache->Remove (GetCacheKey (PixmapCacheManager::EntryKind::Tile, key));
+
+		Tiles_.clear ();
+		PendingTiles_.clear ();
+	}
+
+	PixmapCacheManager::Key PageGraphicsItem::GetCacheKey (PixmapCacheManager::EntryKind kind,
+			const TileKey_t& tile)
+	{
+		return { this, kind, tile };
+	}
+
 	void PageGraphicsItem::rotateCCW ()
 	{
 		LayoutManager_->AddRotation (-90, PageNum_);
@@ -318,19 +634,71 @@ namespace Monocle
 		if (sender () != RenderFuture_.get ())
 			return;
 
-		const auto& result = RenderFuture_->result ();
+		const auto& image = RenderFuture_->result ();
 		RenderFuture_.reset ();
 
-		setPixmap (QPixmap::fromImage (result.Result_));
+		if (Tiled_)
+			return;
 
-		if (std::abs (result.XScale_ - XScale_) > std::numeric_limits<double>::epsilon () * XScale_ ||
-			std::abs (result.YScale_ - YScale_) > std::numeric_limits<double>::epsilon () * YScale_)
-		{
-			UpdatePixmap ();
+		setPixmap (QPixmap::fromImage (image));
+		Invalid_ = false;
+
+		Core::Instance ().GetPixmapCacheManager ()->Put (GetCacheKey (PixmapCacheManager::EntryKind::Page),
+				GetPixmapBytes (pixmap ()));
+	}
+
+	void PageGraphicsItem::handleTileRendered ()
+	{
+		const auto pos = std::find_if (PendingTiles_.begin (), PendingTiles_.end (),
+				[this] (const RenderWatcher_ptr& watcher) { return watcher.get () == sender (); });
+		if (pos == PendingTiles_.end ())
 			return;
+
+		const auto key = pos.key ();
+		const auto& image = (*pos)->result ();
+		PendingTiles_.erase (pos);
+
+		if (!Tiled_)
+			return;
+
+		if (FirstTileTimer_.isValid ())
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "first tile of page"
+					<< PageNum_
+					<< "at scale"
+					<< XScale_
+					<< "rendered in"
+					<< FirstTileTimer_.elapsed ()
+					<< "ms";
+			FirstTileTimer_.invalidate ();
 		}
 
-		Core::Instance ().GetPixmapCacheManager ()->PixmapChanged (this);
+		const auto& tile = QPixmap::fromImage (image);
+		Tiles_ [key] = tile;
+		Core::Instance ().GetPixmapCacheManager ()->Put (GetCacheKey (PixmapCacheManager::EntryKind::Tile, key),
+				GetPixmapBytes (tile));
+		PruneTiles ();
+
+		update (GetTileRect (key));
+	}
+
+	void PageGraphicsItem::handlePreviewRendered ()
+	{
+		if (sender () != PreviewFuture_.get ())
+			return;
+
+		const auto& image = PreviewFuture_->result ();
+		PreviewFuture_.reset ();
+
+		if (!Tiled_)
+			return;
+
+		Preview_ = QPixmap::fromImage (image);
+		update ();
+
+		Core::Instance ().GetPixmapCacheManager ()->Put (GetCacheKey (PixmapCacheManager::EntryKind::Preview),
+				GetPixmapBytes (Preview_));
 	}
 }
 }
@@ -33,7 +33,11 @@
 #include <memory>
 #include <QGraphicsPixmapItem>
 #include <QPointer>
+#include <QHash>
+#include <QElapsedTimer>
 #include "interfaces/monocle/idocument.h"
+#include "renderscheduler.h"
+#include "pixmapcachemanager.h"
 
 template<typename T>
 class QFutureWatcher;
@@ -57,6 +61,7 @@ namespace Monocle
 		double YScale_;
 
 		bool Invalid_;
+		bool Tiled_;
 
 		std::function<void (int, QPointF)> ReleaseHandler_;
 
@@ -64,13 +69,19 @@ namespace Monocle
 
 		QPointer<ArbitraryRotationWidget> ArbWidget_;
 
-		struct RenderInfo
-		{
-			QImage Result_;
-			double XScale_;
-			double YScale_;
-		};
-		std::shared_ptr<QFutureWatcher<RenderInfo>> RenderFuture_;
+		RenderScheduler::Priority RenderPriority_;
+
+		typedef std::shared_ptr<QFutureWatcher<QImage>> RenderWatcher_ptr;
+		RenderWatcher_ptr RenderFuture_;
+
+		typedef QPair<int, int> TileKey_t;
+		QHash<TileKey_t, QPixmap> Tiles_;
+		QHash<TileKey_t, RenderWatcher_ptr> PendingTiles_;
+
+		QPixmap Preview_;
+		RenderWatcher_ptr PreviewFuture_;
+
+		QElapsedTimer FirstTileTimer_;
 	public:
 		typedef std::function<void (QRectF)> RectSetter_f;
 	private:
@@ -88,6 +99,11 @@ namespace Monocle
 
 		void SetReleaseHandler (std::function<void (int, QPointF)>);
 
+		/** Sets the priority of the renders requested when this page is
+		 * displayed, RenderScheduler::Priority::Visible by default.
+		 */
+		void SetRenderPriority (RenderScheduler::Priority);
+
 		void SetScale (double, double);
 		int GetPageNum () const;
 
@@ -97,16 +113,55 @@ namespace Monocle
 		void RegisterChildRect (QGraphicsItem*, const QRectF&, RectSetter_f);
 		void UnregisterChildRect (QGraphicsItem*);
 
-		void ClearPixmap ();
 		void UpdatePixmap ();
+
+		/** Drops the given rendering evicted by the PixmapCacheManager.
+		 */
+		void EvictRendering (PixmapCacheManager::EntryKind, const QPair<int, int>&);
+
+		/** Requests a low-priority render of this page if it isn't
+		 * displayed and has no valid rendering yet.
+		 */
+		void Prefetch ();
+
+		/** Cancels the pending renders that aren't needed anymore: all
+		 * of them if the page isn't displayed, or the ones for the
+		 * tiles outside of the viewport otherwise.
+		 */
+		void CancelPendingRenders ();
+
+		/** Cancels the pending renders of the tiles outside of the
+		 * viewport.
+		 */
+		void CancelInvisibleTiles ();
+
+		QRectF boundingRect () const;
+		QPainterPath shape () const;
+		bool contains (const QPointF&) const;
 	protected:
 		void paint (QPainter*, const QStyleOptionGraphicsItem*, QWidget*);
 		void mousePressEvent (QGraphicsSceneMouseEvent*);
 		void mouseReleaseEvent (QGraphicsSceneMouseEvent*);
 		void contextMenuEvent (QGraphicsSceneContextMenuEvent*);
 	private:
-		void RequestThreadedRender ();
+		RenderWatcher_ptr ScheduleRender (RenderScheduler::Priority,
+				const RenderScheduler::Renderer_f&, const char*);
+
+		void RequestThreadedRender (RenderScheduler::Priority);
+		bool IsThreaded () const;
 		bool IsDisplayed () const;
+		QRectF GetVisibleRect () const;
+
+		QSize GetScaledSize () const;
+		bool ShouldTile () const;
+		QRect GetTileRect (const TileKey_t&) const;
+		void PaintTiles (QPainter*, const QStyleOptionGraphicsItem*);
+		void RequestTile (const TileKey_t&);
+		void RequestPreview (RenderScheduler::Priority);
+		void PruneTiles ();
+		void ClearTiles ();
+
+		PixmapCacheManager::Key GetCacheKey (PixmapCacheManager::EntryKind, const TileKey_t& = TileKey_t ());
 	private slots:
 		void rotateCCW ();
 		void rotateCW ();
@@ -115,6 +170,8 @@ namespace Monocle
 		void updateRotation (double, int);
 
 		void handlePixmapRendered ();
+		void handleTileRendered ();
+		void handlePreviewRendered ();
 	signals:
 		void rotateRequested (double);
 	};
@@ -28,7 +28,6 @@
  **********************************************************************/
 
 #include "pixmapcachemanager.h"
-#include <numeric>
 #include <QtDebug>
 #include "xmlsettingsmanager.h"
 #include "pagegraphicsitem.h"
@@ -37,56 +36,106 @@ namespace LeechCraft
 {
 namespace Monocle
 {
+	bool operator== (const PixmapCacheManager::Key& left, const PixmapCacheManager::Key& right)
+	{
+		return left.Item_ == right.Item_ &&
+				left.Kind_ == right.Kind_ &&
+				left.Tile_ == right.Tile_;
+	}
+
+	uint qHash (const PixmapCacheManager::Key& key)
+	{
+		return ::qHash (key.Item_) ^
+				(static_cast<uint> (key.Kind_) << 28) ^
+				::qHash (key.Tile_);
+	}
+
 	PixmapCacheManager::PixmapCacheManager (QObject *parent)
 	: QObject (parent)
 	, CurrentSize_ (0)
 	, MaxSize_ (0)
+	, Hits_ (0)
+	, Misses_ (0)
+	, Evictions_ (0)
 	{
 		XmlSettingsManager::Instance ().RegisterObject ("PixmapCacheSize",
 				this, "handleCacheSizeChanged");
 		handleCacheSizeChanged ();
 	}
 
-	namespace
+	void PixmapCacheManager::Put (const Key& key, qint64 size)
 	{
-		quint64 GetPixmapSize (const QPixmap& px)
+		const auto pos = Key2Entry_.find (key);
+		if (pos != Key2Entry_.end ())
+		{
+			const auto entry = *pos;
+			CurrentSize_ += size - entry->Size_;
+			entry->Size_ = size;
+			Entries_.splice (Entries_.end (), Entries_, entry);
+		}
+		else
 		{
-			return px.width () * px.height () * px.defaultDepth () / 8 * 1.5;
+			Entries_.push_back ({ key, size });
+			Key2Entry_ [key] = std::prev (Entries_.end ());
+			CurrentSize_ += size;
 		}
+
+		CheckCache ();
 	}
 
-	void PixmapCacheManager::PixmapPainted (PageGraphicsItem *item)
+	void PixmapCacheManager::Touch (const Key& key)
 	{
-		RecentlyUsed_.removeAll (item);
-		RecentlyUsed_ << item;
+		const auto pos = Key2Entry_.constFind (key);
+		if (pos == Key2Entry_.constEnd ())
+			return;
+
+		++Hits_;
+		Entries_.splice (Entries_.end (), Entries_, *pos);
 	}
 
-	void PixmapCacheManager::PixmapChanged (PageGraphicsItem *item)
+	void PixmapCacheManager::RecordMiss ()
 	{
-		if (RecentlyUsed_.removeAll (item))
-			CurrentSize_ = std::accumulate (RecentlyUsed_.begin (), RecentlyUsed_.end (), 0,
-					[] (qint64 size, decltype (RecentlyUsed_.front ()) item)
-						{ return size + GetPixmapSize (item->pixmap ()); });
+		++Misses_;
+	}
 
-		RecentlyUsed_ << item;
-		CurrentSize_ += GetPixmapSize (item->pixmap ());
-		CheckCache ();
+	void PixmapCacheManager::Remove (const Key& key)
+	{
+		const auto pos = Key2Entry_.find (key);
+		if (pos == Key2Entry_.end ())
+			return;
+
+		CurrentSize_ -= (*pos)->Size_;
+		Entries_.erase (*pos);
+		Key2Entry_.erase (pos);
 	}
 
-	void PixmapCacheManager::PixmapDeleted (PageGraphicsItem *item)
+	PixmapCacheManager::Stats PixmapCacheManager::GetStats () const
 	{
-		CurrentSize_ -= GetPixmapSize (item->pixmap ());
-		RecentlyUsed_.removeAll (item);
+		return
+		{
+			CurrentSize_,
+			MaxSize_,
+			Key2Entry_.size (),
+			Hits_,
+			Misses_,
+			Evictions_
+		};
 	}
 
 	void PixmapCacheManager::CheckCache ()
 	{
-		while (MaxSize_ < CurrentSize_ && RecentlyUsed_.size () > 2)
+		// The two most recently used renderings are always kept, so
+		// that the visible page isn't evicted right after being
+		// rendered even if it alone doesn't fit into the budget.
+		while (MaxSize_ < CurrentSize_ && Entries_.size () > 2)
 		{
-			auto page = RecentlyUsed_.takeFirst ();
-			const quint64 pxSize = GetPixmapSize (page->pixmap ());
-			CurrentSize_ -= pxSize;
-			page->ClearPixmap ();
+			const auto entry = Entries_.front ();
+			Entries_.pop_front ();
+			Key2Entry_.remove (entry.Key_);
+			CurrentSize_ -= entry.Size_;
+			++Evictions_;
+
+			entry.Key_.Item_->EvictRendering (entry.Key_.Kind_, entry.Key_.Tile_);
 		}
 	}
 
@@ -29,7 +29,12 @@
 
 #pragma once
 
+#include <list>
+#include <iterator>
 #include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QElapsedTimer>
 
 namespace LeechCraft
 {
@@ -37,23 +42,91 @@ namespace Monocle
 {
 	class PageGraphicsItem;
 
+	/** Keeps track of the memory used by the page renderings of all
+	 * open documents and evicts the least recently used ones when the
+	 * configured budget is exceeded.
+	 *
+	 * All operations are O(1): the renderings are kept in a list
+	 * ordered by the time of last use, indexed by a hash.
+	 */
 	class PixmapCacheManager : public QObject
 	{
 		Q_OBJECT
+	public:
+		enum class EntryKind
+		{
+			Page,
+			Preview,
+			Tile
+		};
+
+		/** Identifies a single rendering. The item identifies the
+		 * document and the page, and items drop all their renderings
+		 * when their scale changes, so the scale isn't a part of the
+		 * key.
+		 */
+		struct Key
+		{
+			PageGraphicsItem *Item_;
+			EntryKind Kind_;
+			QPair<int, int> Tile_;
+		};
+
+		struct Stats
+		{
+			qint64 CurrentSize_;
+			qint64 MaxSize_;
+			int Entries_;
+
+			quint64 Hits_;
+			quint64 Misses_;
+			quint64 Evictions_;
+		};
+	private:
+		struct Entry
+		{
+			Key Key_;
+			qint64 Size_;
+		};
+		typedef std::list<Entry> Entries_t;
+		Entries_t Entries_;
+		QHash<Key, Entries_t::iterator> Key2Entry_;
 
 		qint64 CurrentSize_;
 		qint64 MaxSize_;
-		QList<PageGraphicsItem*> RecentlyUsed_;
+
+		quint64 Hits_;
+		quint64 Misses_;
+		quint64 Evictions_;
 	public:
 		PixmapCacheManager (QObject* = 0);
 
-		void PixmapPainted (PageGraphicsItem*);
-		void PixmapChanged (PageGraphicsItem*);
-		void PixmapDeleted (PageGraphicsItem*);
+		/** Adds the rendering with the given key and size or updates
+		 * the size of an existing one, marking it as the most recently
+		 * used. This may evict other renderings.
+		 */
+		void Put (const Key&, qint64 size);
+
+		/** Marks the given rendering as the most recently used one and
+		 * counts a cache hit, if the rendering is known.
+		 */
+		void Touch (const Key&);
+
+		/** Counts a cache miss, that is, a rendering that had to be
+		 * requested because it wasn't available.
+		 */
+		void RecordMiss ();
+
+		void Remove (const Key&);
+
+		Stats GetStats () const;
 	private:
 		void CheckCache ();
 	private slots:
 		void handleCacheSizeChanged ();
 	};
+
+	bool operator== (const PixmapCacheManager::Key&, const PixmapCacheManager::Key&);
+	uint qHash (const PixmapCacheManager::Key&);
 }
 }
@@ -134,6 +134,16 @@ namespace PDF
 		return page->renderToImage (72 * xScale, 72 * yScale);
 	}
 
+	QImage Document::RenderPageRect (int num, double xScale, double yScale, const QRect& rect)
+	{
+		std::unique_ptr<Poppler::Page> page (PDocument_->page (num));
+		if (!page)
+			return QImage ();
+
+		return page->renderToImage (72 * xScale, 72 * yScale,
+				rect.x (), rect.y (), rect.width (), rect.height ());
+	}
+
 	QList<ILink_ptr> Document::GetPageLinks (int num)
 	{
 		QList<ILink_ptr> result;
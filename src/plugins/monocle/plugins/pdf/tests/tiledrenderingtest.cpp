@@ -0,0 +1,219 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "tiledrenderingtest.h"
+#include <cmath>
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include "renderscheduler.h"
+#include "document.h"
+
+QTEST_MAIN (LeechCraft::Monocle::PDF::TiledRenderingTest)
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+namespace PDF
+{
+	namespace
+	{
+		const int TileSize = 512;
+		const QSize PageSize { 612, 792 };
+
+		/* The scales the page is benchmarked at. The page is rendered by
+		 * tiles in the reader at the larger ones, see
+		 * PageGraphicsItem::ShouldTile().
+		 */
+		void AddScales ()
+		{
+			QTest::addColumn<double> ("scale");
+
+			QTest::newRow ("x2") << 2.;
+			QTest::newRow ("x4") << 4.;
+			QTest::newRow ("x8") << 8.;
+		}
+
+		/* A one-page letter-sized PDF with a grid of gray rectangles,
+		 * so that the whole page has something to rasterize.
+		 */
+		QByteArray MakePdf ()
+		{
+			QByteArray content;
+			for (int row = 0; row < 40; ++row)
+				for (int col = 0; col < 40; ++col)
+					content += QString ("%1 g %2 %3 13.7 17.3 re f\n")
+							.arg (((row + col) % 10) / 10.)
+							.arg (col * 15.3)
+							.arg (row * 19.8)
+							.toLatin1 ();
+
+			const QList<QByteArray> objects
+			{
+				"<< /Type /Catalog /Pages 2 0 R >>",
+				"<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+				"<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R >>",
+				"<< /Length " + QByteArray::number (content.size ()) + " >>\n"
+						"stream\n" + content + "endstream"
+			};
+
+			QByteArray result = "%PDF-1.4\n";
+			QList<int> offsets;
+			for (int i = 0; i < objects.size (); ++i)
+			{
+				offsets << result.size ();
+				result += QByteArray::number (i + 1) + " 0 obj\n" + objects.at (i) + "\nendobj\n";
+			}
+
+			const auto xrefPos = result.size ();
+			result += "xref\n0 " + QByteArray::number (objects.size () + 1) + "\n";
+			result += "0000000000 65535 f \n";
+			for (const auto offset : offsets)
+				result += QString ("%1 00000 n \n").arg (offset, 10, 10, QChar ('0')).toLatin1 ();
+			result += "trailer\n<< /Size " + QByteArray::number (objects.size () + 1) +
+					" /Root 1 0 R >>\nstartxref\n" + QByteArray::number (xrefPos) + "\n%%EOF\n";
+			return result;
+		}
+
+		int CountDifferentPixels (QImage left, QImage right)
+		{
+			left = left.convertToFormat (QImage::Format_ARGB32);
+			right = right.convertToFormat (QImage::Format_ARGB32);
+
+			int result = 0;
+			for (int y = 0; y < left.height (); ++y)
+				for (int x = 0; x < left.width (); ++x)
+				{
+					const auto l = left.pixel (x, y);
+					const auto r = right.pixel (x, y);
+					if (std::abs (qRed (l) - qRed (r)) > 8 ||
+							std::abs (qGreen (l) - qGreen (r)) > 8 ||
+							std::abs (qBlue (l) - qBlue (r)) > 8)
+						++result;
+				}
+			return result;
+		}
+
+		QImage RenderFirstVisibleTile (RenderScheduler& scheduler,
+				const std::shared_ptr<Document>& doc, double scale)
+		{
+			const QRect rect { 0, 0, TileSize, TileSize };
+			auto future = scheduler.Schedule (RenderScheduler::Priority::Visible,
+					[doc, rect, scale] { return doc->RenderPageRect (0, scale, scale, rect); });
+			future.waitForFinished ();
+			return future.result ();
+		}
+	}
+
+	void TiledRenderingTest::initTestCase ()
+	{
+		Path_ = QDir::temp ().filePath (QString ("lc_monocle_pdf_tiles_test_%1.pdf")
+					.arg (QCoreApplication::applicationPid ()));
+
+		QFile file (Path_);
+		QVERIFY (file.open (QIODevice::WriteOnly));
+		QVERIFY (file.write (MakePdf ()) > 0);
+		file.close ();
+
+		Doc_ = std::make_shared<Document> (Path_, nullptr);
+		QVERIFY (Doc_->IsValid ());
+		QCOMPARE (Doc_->GetNumPages (), 1);
+		QCOMPARE (Doc_->GetPageSize (0), PageSize);
+	}
+
+	void TiledRenderingTest::cleanupTestCase ()
+	{
+		Doc_.reset ();
+		QFile::remove (Path_);
+	}
+
+	void TiledRenderingTest::tileMatchesPageRender_data ()
+	{
+		QTest::addColumn<double> ("scale");
+
+		QTest::newRow ("x2") << 2.;
+		QTest::newRow ("x4") << 4.;
+	}
+
+	void TiledRenderingTest::tileMatchesPageRender ()
+	{
+		QFETCH (double, scale);
+
+		const auto& page = Doc_->RenderPage (0, scale, scale);
+		QCOMPARE (page.size (), PageSize * scale);
+
+		const auto width = page.width ();
+		const auto height = page.height ();
+		for (const auto& rect : { QRect (0, 0, TileSize, TileSize),
+				QRect (TileSize, TileSize, TileSize, TileSize),
+				QRect (width - TileSize / 2, height - TileSize / 2, TileSize / 2, TileSize / 2) })
+		{
+			const auto& tile = Doc_->RenderPageRect (0, scale, scale, rect);
+			QCOMPARE (tile.size (), rect.size ());
+			QVERIFY (CountDifferentPixels (tile, page.copy (rect)) < rect.width () * rect.height () / 100);
+		}
+	}
+
+	void TiledRenderingTest::benchFirstVisibleTile_data ()
+	{
+		AddScales ();
+	}
+
+	void TiledRenderingTest::benchFirstVisibleTile ()
+	{
+		QFETCH (double, scale);
+
+		RenderScheduler scheduler;
+		QBENCHMARK
+		{
+			const auto& tile = RenderFirstVisibleTile (scheduler, Doc_, scale);
+			QCOMPARE (tile.size (), QSize (TileSize, TileSize));
+		}
+	}
+
+	void TiledRenderingTest::benchFullPage_data ()
+	{
+		AddScales ();
+	}
+
+	void TiledRenderingTest::benchFullPage ()
+	{
+		QFETCH (double, scale);
+
+		QBENCHMARK
+		{
+			const auto& page = Doc_->RenderPage (0, scale, scale);
+			QCOMPARE (page.size (), PageSize * scale);
+		}
+	}
+}
+}
+}
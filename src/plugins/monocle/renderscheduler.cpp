@@ -0,0 +1,115 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "renderscheduler.h"
+#include <algorithm>
+#include <QRunnable>
+#include <QThread>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	namespace
+	{
+		class FunctionRunnable : public QRunnable
+		{
+			const std::function<void ()> Func_;
+		public:
+			FunctionRunnable (const std::function<void ()>& func)
+			: Func_ (func)
+			{
+			}
+
+			void run ()
+			{
+				Func_ ();
+			}
+		};
+	}
+
+	RenderScheduler::RenderScheduler (QObject *parent)
+	: QObject (parent)
+	, RunningWorkers_ (0)
+	{
+		Pool_.setMaxThreadCount (std::max (QThread::idealThreadCount (), 1));
+	}
+
+	QFuture<QImage> RenderScheduler::Schedule (Priority priority, const Renderer_f& renderer)
+	{
+		Job job { {}, renderer };
+		const auto& future = job.Iface_.future ();
+
+		bool startWorker = false;
+		{
+			QMutexLocker locker (&QueuesMutex_);
+			Queues_ [static_cast<int> (priority)] << job;
+
+			if (RunningWorkers_ < Pool_.maxThreadCount ())
+			{
+				++RunningWorkers_;
+				startWorker = true;
+			}
+		}
+
+		if (startWorker)
+			Pool_.start (new FunctionRunnable ([this] { RunJobs (); }));
+
+		return future;
+	}
+
+	bool RenderScheduler::TakeJob (Job& job)
+	{
+		QMutexLocker locker (&QueuesMutex_);
+
+		for (auto& queue : Queues_)
+			while (!queue.isEmpty ())
+			{
+				job = queue.takeLast ();
+				if (!job.Iface_.isCanceled ())
+					return true;
+			}
+
+		--RunningWorkers_;
+		return false;
+	}
+
+	void RenderScheduler::RunJobs ()
+	{
+		Job job;
+		while (TakeJob (job))
+		{
+			job.Iface_.reportStarted ();
+			if (!job.Iface_.isCanceled ())
+				job.Iface_.reportResult (job.Renderer_ ());
+			job.Iface_.reportFinished ();
+		}
+	}
+}
+}
@@ -0,0 +1,85 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+#include <QFutureInterface>
+#include <QImage>
+
+namespace LeechCraft
+{
+namespace Monocle
+{
+	/** Runs page rendering jobs on a dedicated thread pool.
+	 *
+	 * Jobs with higher priority are always started first, and among
+	 * jobs of the same priority the most recently scheduled one wins,
+	 * since it's the most likely to still be on screen. Jobs whose
+	 * futures are canceled before they start are dropped.
+	 */
+	class RenderScheduler : public QObject
+	{
+		Q_OBJECT
+	public:
+		enum class Priority
+		{
+			Visible,
+			Prefetch,
+			Thumbnail
+		};
+
+		typedef std::function<QImage ()> Renderer_f;
+	private:
+		struct Job
+		{
+			QFutureInterface<QImage> Iface_;
+			Renderer_f Renderer_;
+		};
+
+		static const int PrioritiesCount = static_cast<int> (Priority::Thumbnail) + 1;
+
+		QMutex QueuesMutex_;
+		QList<Job> Queues_ [PrioritiesCount];
+		int RunningWorkers_;
+
+		QThreadPool Pool_;
+	public:
+		RenderScheduler (QObject* = 0);
+
+		QFuture<QImage> Schedule (Priority, const Renderer_f&);
+	private:
+		bool TakeJob (Job&);
+		void RunJobs ();
+	};
+}
+}
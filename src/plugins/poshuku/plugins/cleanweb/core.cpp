@@ -44,11 +44,10 @@
 #include <qwebelement.h>
 #include <QCoreApplication>
 #include <QtConcurrentRun>
-#include <QtConcurrentMap>
 #include <QFutureWatcher>
 #include <QMenu>
 #include <QMainWindow>
-#include <QDir>
+#include <QElapsedTimer>
 #include <qwebview.h>
 
 #if QT_VERSION >= 0x050000
@@ -64,11 +63,12 @@
 #include "flashonclickwhitelist.h"
 #include "userfiltersmodel.h"
 #include "lineparser.h"
+#include "filtermatcher.h"
+#include "filterscache.h"
 
 Q_DECLARE_METATYPE (QNetworkReply*);
 Q_DECLARE_METATYPE (QWebFrame*);
 Q_DECLARE_METATYPE (QPointer<QWebFrame>);
-Q_DECLARE_METATYPE (LeechCraft::Poshuku::CleanWeb::HidingWorkerResult);
 
 namespace LeechCraft
 {
@@ -141,38 +141,76 @@ namespace CleanWeb
 				}
 			};
 
+		Filter ParseFile (const QString& filePath)
+		{
+			QFile file (filePath);
+			if (!file.open (QIODevice::ReadOnly))
+			{
+				qWarning () << Q_FUNC_INFO
+					<< "could not open file"
+					<< filePath
+					<< file.errorString ();
+				return Filter ();
+			}
+
+			const auto& data = QString::fromUtf8 (file.readAll ());
+			QStringList rawLines = data.split ('\n', QString::SkipEmptyParts);
+			if (rawLines.size ())
+				rawLines.removeAt (0);
+			QStringList lines;
+			std::transform (rawLines.begin (), rawLines.end (),
+					std::back_inserter (lines),
+					[] (const QString& t) { return t.trimmed (); });
+
+			Filter f;
+			std::for_each (lines.begin (), lines.end (), LineParser (&f));
+
+			f.SD_.Filename_ = QFileInfo (filePath).fileName ();
+
+			return f;
+		}
+
 		QList<Filter> ParseToFilters (const QStringList& paths)
 		{
 			QList<Filter> result;
+
+			qint64 parseTime = 0;
+			qint64 loadTime = 0;
+			int loadedCount = 0;
+
 			for (const auto& filePath : paths)
 			{
-				QFile file (filePath);
-				if (!file.open (QIODevice::ReadOnly))
-				{
-					qWarning () << Q_FUNC_INFO
-						<< "could not open file"
-						<< filePath
-						<< file.errorString ();
-					result << Filter ();
-					continue;
-				}
-
-				const auto& data = QString::fromUtf8 (file.readAll ());
-				QStringList rawLines = data.split ('\n', QString::SkipEmptyParts);
-				if (rawLines.size ())
-					rawLines.removeAt (0);
-				QStringList lines;
-				std::transform (rawLines.begin (), rawLines.end (),
-						std::back_inserter (lines),
-						[] (const QString& t) { return t.trimmed (); });
+				QElapsedTimer timer;
+				timer.start ();
 
 				Filter f;
-				std::for_each (lines.begin (), lines.end (), LineParser (&f));
-
-				f.SD_.Filename_ = QFileInfo (filePath).fileName ();
+				if (LoadCachedFilter (filePath, f))
+				{
+					loadTime += timer.elapsed ();
+					++loadedCount;
+				}
+				else
+				{
+					f = ParseFile (filePath);
+					if (!f.SD_.Filename_.isEmpty ())
+						SaveCachedFilter (filePath, f);
+					parseTime += timer.elapsed ();
+				}
 
 				result << f;
 			}
+
+			qDebug () << Q_FUNC_INFO
+					<< "loaded"
+					<< loadedCount
+					<< "snapshots in"
+					<< loadTime
+					<< "ms, parsed"
+					<< paths.size () - loadedCount
+					<< "files in"
+					<< parseTime
+					<< "ms";
+
 			return result;
 		}
 	};
@@ -181,6 +219,8 @@ namespace CleanWeb
 	: FlashOnClickPlugin_ (0)
 	, FlashOnClickWhitelist_ (new FlashOnClickWhitelist ())
 	, UserFilters_ (new UserFiltersModel (this))
+	, HidingStyleSheetsCache_ (4 * 1024 * 1024)
+	, HidingTime_ (0)
 	{
 		qRegisterMetaType<QWebFrame*> ("QWebFrame*");
 		qRegisterMetaType<QPointer<QWebFrame>> ("QPointer<QWebFrame>");
@@ -224,8 +264,6 @@ namespace CleanWeb
 				this,
 				SIGNAL (gotEntity (LeechCraft::Entity)));
 
-		qRegisterMetaType<HidingWorkerResult> ("HidingWorkerResult");
-
 		connect (UserFilters_,
 				SIGNAL (filtersChanged ()),
 				this,
@@ -359,14 +397,6 @@ namespace CleanWeb
 		Remove (Filters_ [index.row ()].SD_.Filename_);
 	}
 
-	namespace
-	{
-		void RemoveElem (QWebElement elem)
-		{
-			elem.setStyleProperty ("visibility", "hidden !important");
-		}
-	}
-
 	void Core::HandleInitialLayout (QWebPage*, QWebFrame *frame)
 	{
 		QMetaObject::invokeMethod (this,
@@ -475,130 +505,6 @@ namespace CleanWeb
 		return FlashOnClickWhitelist_;
 	}
 
-	namespace
-	{
-#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
-		// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
-		bool WildcardMatches (const char *pattern, const char *str)
-		{
-			enum State {
-				Exact,        // exact match
-				Any,        // ?
-				AnyRepeat    // *
-			};
-
-			const char *s = str;
-			const char *p = pattern;
-			const char *q = 0;
-			int state = 0;
-
-			bool match = true;
-			while (match && *p) {
-				if (*p == '*') {
-					state = AnyRepeat;
-					q = p+1;
-				} else if (*p == '?') state = Any;
-				else state = Exact;
-
-				if (*s == 0) break;
-
-				switch (state) {
-					case Exact:
-						match = *s == *p;
-						s++;
-						p++;
-						break;
-
-					case Any:
-						match = true;
-						s++;
-						p++;
-						break;
-
-					case AnyRepeat:
-						match = true;
-						s++;
-
-						if (*s == *q) p++;
-						break;
-				}
-			}
-
-			if (state == AnyRepeat) return (*s == *q);
-			else if (state == Any) return (*s == *p);
-			else return match && (*s == *p);
-		}
-#else
-#include <fnmatch.h>
-
-		bool WildcardMatches (const char *pat, const char *str)
-		{
-			return !fnmatch (pat, str, 0);
-		}
-#endif
-
-		bool Matches (const FilterItem_ptr& item,
-				const QString& urlStr, const QByteArray& urlUtf8, const QString& domain)
-		{
-			const auto& opt = item->Option_;
-			if (opt.MatchObjects_ != FilterOption::MatchObject::All)
-			{
-				if (!(opt.MatchObjects_ & FilterOption::MatchObject::CSS) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Image) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Script) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::Object) &&
-						!(opt.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
-					return false;
-			}
-
-			if (!opt.NotDomains_.isEmpty ())
-			{
-				for (const auto& notDomain : opt.NotDomains_)
-					if (domain.endsWith (notDomain, opt.Case_))
-						return false;
-			}
-
-			if (!opt.Domains_.isEmpty ())
-			{
-				bool shouldFurther = false;
-				for (const auto& doDomain : opt.Domains_)
-					if (domain.endsWith (doDomain, opt.Case_))
-					{
-						shouldFurther = true;
-						break;
-					}
-
-				if (!shouldFurther)
-					return false;
-			}
-
-			switch (opt.MatchType_)
-			{
-			case FilterOption::MTRegexp:
-				return item->RegExp_.Matches (urlStr);
-			case FilterOption::MTWildcard:
-				return WildcardMatches (item->PlainMatcher_.constData (), urlUtf8.constData ());
-			case FilterOption::MTPlain:
-				return urlUtf8.indexOf (item->PlainMatcher_) >= 0;
-			case FilterOption::MTBegin:
-				return urlStr.startsWith (QString::fromUtf8 (item->PlainMatcher_));
-			case FilterOption::MTEnd:
-				return urlStr.endsWith (QString::fromUtf8 (item->PlainMatcher_));
-			}
-
-			return false;
-		}
-	}
-
-	namespace
-	{
-		void DumbReductor (bool& res, bool value)
-		{
-			if (value)
-				res = true;
-		}
-	}
-
 	/** We test each filter until we know that we should reject it or until
 	 * it gets whitelisted.
 	 *
@@ -650,46 +556,19 @@ namespace CleanWeb
 		}
 
 		const QUrl& url = req.url ();
-		const QString& urlStr = url.toString ();
-		const auto& urlUtf8 = urlStr.toUtf8 ();
-		const QString& cinUrlStr = urlStr.toLower ();
-		const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
 
-		const QString& domain = url.host ();
-		const auto& domainUtf8 = domain.toUtf8 ();
-		const bool isForeign = !req.rawHeader ("Referer").contains (domainUtf8);
+		FilterMatcher::RequestInfo info;
+		info.UrlStr_ = url.toString ();
+		info.UrlUtf8_ = info.UrlStr_.toUtf8 ();
+		info.CinUrlStr_ = info.UrlStr_.toLower ();
+		info.CinUrlUtf8_ = info.CinUrlStr_.toUtf8 ();
+		info.Domain_ = url.host ();
+		info.IsForeign_ = !req.rawHeader ("Referer").contains (info.Domain_.toUtf8 ());
+		info.Objects_ = objs;
 
-		auto matches = [=] (const QList<QList<FilterItem_ptr>>& chunks) -> bool
-			{
-				return QtConcurrent::blockingMappedReduced (chunks.begin (), chunks.end (),
-						std::function<bool (const QList<FilterItem_ptr>&)>
-						{
-							[=] (const QList<FilterItem_ptr>& items) -> bool
-							{
-								for (const auto& item : items)
-								{
-									const auto& opt = item->Option_;
-									if (opt.AbortForeign_ && isForeign)
-										continue;
-
-									if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
-											objs != FilterOption::MatchObject::All &&
-											!(objs & opt.MatchObjects_))
-										continue;
-
-									const auto& url = item->Option_.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
-									const auto& utf8 = item->Option_.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-									if (Matches (item, url, utf8, domain))
-										return true;
-								}
-
-								return false;
-							}
-						}, DumbReductor);
-			};
-		if (matches (ExceptionsCache_))
+		if (ExceptionsMatcher_.Matches (info))
 			return false;
-		if (matches (FilterItemsCache_))
+		if (FiltersMatcher_.Matches (info))
 			return true;
 
 		return false;
@@ -825,6 +704,7 @@ namespace CleanWeb
 		home.cd (".leechcraft");
 		home.cd ("cleanweb");
 		home.remove (fileName);
+		RemoveCachedFilter (fileName);
 
 		QList<Filter>::iterator pos = std::find_if (Filters_.begin (), Filters_.end (),
 				FilterFinder<FTFilename_> (fileName));
@@ -965,49 +845,77 @@ namespace CleanWeb
 		PendingJobs_.remove (id);
 	}
 
+	namespace
+	{
+		QString MakeHidingRule (const QString& selector)
+		{
+			return selector + " { visibility: hidden !important; }\n";
+		}
+
+		bool IsSafeSelector (const QString& selector)
+		{
+			return !selector.contains ('{') &&
+					!selector.contains ('}') &&
+					!selector.contains ('<');
+		}
+	}
+
+	QString Core::GetHidingStyleSheet (const QUrl& frameUrl)
+	{
+		const auto& urlStr = frameUrl.toString ();
+		if (const auto cached = HidingStyleSheetsCache_.object (urlStr))
+			return GenericHidingStyleSheet_ + *cached;
+
+		FilterMatcher::RequestInfo info;
+		info.UrlStr_ = urlStr;
+		info.UrlUtf8_ = urlStr.toUtf8 ();
+		info.CinUrlStr_ = urlStr.toLower ();
+		info.CinUrlUtf8_ = info.CinUrlStr_.toUtf8 ();
+		info.Domain_ = frameUrl.host ();
+		info.IsForeign_ = false;
+		info.Objects_ = FilterOption::MatchObject::All;
+
+		QString specific;
+		for (const auto& item : SpecificHidingMatcher_.FindAll (info))
+			specific += MakeHidingRule (item->Option_.HideSelector_);
+
+		HidingStyleSheetsCache_.insert (urlStr, new QString (specific), urlStr.size () + specific.size ());
+		return GenericHidingStyleSheet_ + specific;
+	}
+
 	void Core::handleFrameLayout (QPointer<QWebFrame> frame)
 	{
 		if (!frame)
 			return;
 
+		QElapsedTimer timer;
+		timer.start ();
+
 		const QUrl& frameUrl = frame->url ().isEmpty () ?
 				frame->baseUrl () :
 				frame->url ();
-		qDebug () << Q_FUNC_INFO << frame << frameUrl;
-		const QString& urlStr = frameUrl.toString ();
-		const auto& urlUtf8 = urlStr.toUtf8 ();
-		const QString& cinUrlStr = urlStr.toLower ();
-		const auto& cinUrlUtf8 = cinUrlStr.toUtf8 ();
 
-		const QString& domain = frameUrl.host ();
+		const auto& styleSheet = GetHidingStyleSheet (frameUrl);
+		if (!styleSheet.isEmpty ())
+		{
+			const auto& doc = frame->documentElement ();
+			auto head = doc.findFirst ("head");
+			if (head.isNull ())
+				head = doc;
 
-		QList<Filter> allFilters = Filters_;
-		allFilters << UserFilters_->GetFilter ();
+			head.appendInside ("<style type=\"text/css\">" + styleSheet + "</style>");
+		}
 
-		auto watcher = new QFutureWatcher<HidingWorkerResult> (this);
-		connect (watcher,
-				SIGNAL (finished ()),
-				this,
-				SLOT (hidingElementsFound ()));
-		watcher->setFuture (QtConcurrent::run ([=] () -> HidingWorkerResult
-					{
-						QStringList sels;
-						for (const Filter& filter : allFilters)
-							for (const auto& item : filter.Filters_)
-							{
-								if (item->Option_.HideSelector_.isEmpty ())
-									continue;
-
-								const auto& opt = item->Option_;
-								const auto& url = opt.Case_ == Qt::CaseSensitive ? urlStr : cinUrlStr;
-								const auto& utf8 = opt.Case_ == Qt::CaseSensitive ? urlUtf8 : cinUrlUtf8;
-								if (!Matches (item, url, utf8, domain))
-									continue;
-
-								sels << item->Option_.HideSelector_;
-							}
-						return { frame, 0, sels };
-					}));
+		const auto elapsed = timer.nsecsElapsed () / 1000;
+		HidingTime_ += elapsed;
+		qDebug () << Q_FUNC_INFO
+				<< frame
+				<< frameUrl
+				<< "hiding took"
+				<< elapsed
+				<< "us, total"
+				<< HidingTime_ / 1000
+				<< "ms";
 
 		new Util::SlotClosure<Util::DeleteLaterPolicy>
 		{
@@ -1022,62 +930,23 @@ namespace CleanWeb
 		};
 	}
 
-	void Core::hidingElementsFound ()
-	{
-		auto watcher = dynamic_cast<QFutureWatcher<HidingWorkerResult>*> (sender ());
-		watcher->deleteLater ();
-
-		hideElementsChunk (watcher->result ());
-
-	}
-
-	void Core::hideElementsChunk (HidingWorkerResult result)
-	{
-		if (!result.Frame_)
-			return;
-
-		const int chunkSize = 100;
-
-		auto& i = result.CurrentPos_;
-		for (auto end = std::min (i + chunkSize, result.Selectors_.size ()); i < end; ++i)
-		{
-			const auto& selector = result.Selectors_.value (i);
-
-			const auto& matchingElems = result.Frame_->findAllElements (selector);
-			if (matchingElems.count ())
-				qDebug () << "removing"
-						<< matchingElems.count ()
-						<< "elems for"
-						<< selector
-						<< result.Frame_->url ();
-
-			for (int i = matchingElems.count () - 1; i >= 0; --i)
-				RemoveElem (matchingElems.at (i));
-		}
-
-		if (result.CurrentPos_ < result.Selectors_.size ())
-			QMetaObject::invokeMethod (this,
-					"hideElementsChunk",
-					Qt::QueuedConnection,
-					Q_ARG (HidingWorkerResult, result));
-	}
-
 	namespace
 	{
-		bool RemoveElements (QWebFrame *frame, const QList<QUrl>& urls)
+		QList<QUrl> RemoveElements (QWebFrame *frame, const QList<QUrl>& urls)
 		{
 			const auto& baseUrl = frame->baseUrl ();
 
 			const auto& elems = frame->findAllElements ("img,script,iframe,applet,object");
 
-			bool removed = false;
+			QList<QUrl> removed;
 			for (int i = elems.count () - 1; i >= 0; --i)
 			{
 				auto elem = elems.at (i);
-				if (urls.contains (baseUrl.resolved (QUrl::fromEncoded (elem.attribute ("src").toUtf8 ()))))
+				const auto& url = baseUrl.resolved (QUrl::fromEncoded (elem.attribute ("src").toUtf8 ()));
+				if (urls.contains (url))
 				{
 					elem.removeFromDocument ();
-					removed = true;
+					removed << url;
 				}
 			}
 			return removed;
@@ -1089,20 +958,42 @@ namespace CleanWeb
 		if (!frame)
 			return;
 
-		if (RemoveElements (frame, { url }))
-			return;
+		if (DelayedURLs_.isEmpty ())
+			QTimer::singleShot (0,
+					this,
+					SLOT (removeDelayedElements ()));
 
-		connect (frame,
-				SIGNAL (loadFinished (bool)),
-				this,
-				SLOT (moreDelayedRemoveElements ()),
-				Qt::UniqueConnection);
 		connect (frame,
 				SIGNAL (destroyed (QObject*)),
 				this,
 				SLOT (handleFrameDestroyed ()),
 				Qt::UniqueConnection);
-		MoreDelayedURLs_ [frame] << url;
+		DelayedURLs_ [frame] << url;
+	}
+
+	void Core::removeDelayedElements ()
+	{
+		const auto pending = DelayedURLs_;
+		DelayedURLs_.clear ();
+
+		for (auto i = pending.begin (), end = pending.end (); i != end; ++i)
+		{
+			const auto frame = i.key ();
+
+			auto urls = i.value ();
+			for (const auto& url : RemoveElements (frame, urls))
+				urls.removeAll (url);
+
+			if (urls.isEmpty ())
+				continue;
+
+			connect (frame,
+					SIGNAL (loadFinished (bool)),
+					this,
+					SLOT (moreDelayedRemoveElements ()),
+					Qt::UniqueConnection);
+			MoreDelayedURLs_ [frame] << urls;
+		}
 	}
 
 	void Core::moreDelayedRemoveElements ()
@@ -1110,7 +1001,7 @@ namespace CleanWeb
 		auto frame = qobject_cast<QWebFrame*> (sender ());
 
 		const auto& urls = MoreDelayedURLs_.take (frame);
-		if (!RemoveElements (frame, urls))
+		if (RemoveElements (frame, urls).isEmpty ())
 			qWarning () << Q_FUNC_INFO
 					<< urls
 					<< "not found for"
@@ -1119,66 +1010,59 @@ namespace CleanWeb
 
 	void Core::handleFrameDestroyed ()
 	{
-		MoreDelayedURLs_.remove (static_cast<QWebFrame*> (sender ()));
+		const auto frame = static_cast<QWebFrame*> (sender ());
+		DelayedURLs_.remove (frame);
+		MoreDelayedURLs_.remove (frame);
 	}
 
 	void Core::regenFilterCaches ()
 	{
-		ExceptionsCache_.clear ();
-		FilterItemsCache_.clear ();
-
 		QList<Filter> allFilters = Filters_;
 		allFilters << UserFilters_->GetFilter ();
 
-		int exceptionsCount = 0;
-		int filtersCount = 0;
-		for (const Filter& filter : allFilters)
-		{
-			exceptionsCount += filter.Exceptions_.size ();
-			filtersCount += filter.Filters_.size ();
-		}
-
-		auto idealThreads = std::max (QThread::idealThreadCount (), 2);
-
-		const int exChunkSize = std::max (exceptionsCount / idealThreads / 4, 200);
-		const int fChunkSize = std::max (filtersCount / idealThreads / 4, 200);
-		qDebug () << Q_FUNC_INFO << exceptionsCount << filtersCount << exChunkSize << fChunkSize;
-
-		QList<FilterItem_ptr> lastItemsChunk, lastExceptionsChunk;
-		lastItemsChunk.reserve (fChunkSize);
-		lastExceptionsChunk.reserve (exChunkSize);
-
+		QList<FilterItem_ptr> exceptions;
+		QList<FilterItem_ptr> filters;
+		QList<FilterItem_ptr> specificHiding;
+		GenericHidingStyleSheet_.clear ();
 		for (const Filter& filter : allFilters)
 		{
 			for (const auto& item : filter.Exceptions_)
 				if (item->Option_.HideSelector_.isEmpty ())
-				{
-					lastExceptionsChunk << item;
-					if (lastExceptionsChunk.size () >= exChunkSize)
-					{
-						ExceptionsCache_ << lastExceptionsChunk;
-						lastExceptionsChunk.clear ();
-					}
-				}
+					exceptions << item;
 
 			for (const auto& item : filter.Filters_)
 			{
-				if (!item->Option_.HideSelector_.isEmpty ())
+				const auto& opt = item->Option_;
+				if (opt.HideSelector_.isEmpty ())
+					filters << item;
+				else if (!IsSafeSelector (opt.HideSelector_))
 					continue;
-
-				lastItemsChunk << item;
-				if (lastItemsChunk.size () >= fChunkSize)
-				{
-					FilterItemsCache_ << lastItemsChunk;
-					lastItemsChunk.clear ();
-				}
+				else if (item->PlainMatcher_.isEmpty () &&
+						opt.MatchType_ == FilterOption::MTPlain &&
+						opt.Domains_.isEmpty () &&
+						opt.NotDomains_.isEmpty ())
+					GenericHidingStyleSheet_ += MakeHidingRule (opt.HideSelector_);
+				else
+					specificHiding << item;
 			}
 		}
 
-		if (!lastItemsChunk.isEmpty ())
-			ExceptionsCache_ << lastItemsChunk;
-		if (!lastExceptionsChunk.isEmpty ())
-			FilterItemsCache_ << lastExceptionsChunk;
+		QElapsedTimer timer;
+		timer.start ();
+
+		ExceptionsMatcher_.Rebuild (exceptions);
+		FiltersMatcher_.Rebuild (filters);
+		SpecificHidingMatcher_.Rebuild (specificHiding);
+		HidingStyleSheetsCache_.clear ();
+
+		qDebug () << Q_FUNC_INFO
+				<< "compiled"
+				<< exceptions.size ()
+				<< "exceptions and"
+				<< filters.size ()
+				<< "filters in"
+				<< timer.elapsed ()
+				<< "ms";
 	}
 }
 }
@@ -31,6 +31,7 @@
 
 #include <QAbstractItemModel>
 #include <QHash>
+#include <QCache>
 #include <QStringList>
 #include <QNetworkReply>
 #include <QDateTime>
@@ -40,6 +41,7 @@
 #include <interfaces/poshuku/poshukutypes.h>
 #include <interfaces/core/ihookproxy.h>
 #include "filter.h"
+#include "filtermatcher.h"
 
 class QNetworkRequest;
 class QWebPage;
@@ -56,14 +58,6 @@ namespace CleanWeb
 	class FlashOnClickWhitelist;
 	class UserFiltersModel;
 
-
-	struct HidingWorkerResult
-	{
-		QPointer<QWebFrame> Frame_;
-		int CurrentPos_;
-		QStringList Selectors_;
-	};
-
 	class Core : public QAbstractItemModel
 	{
 		Q_OBJECT
@@ -74,8 +68,14 @@ namespace CleanWeb
 
 		QList<Filter> Filters_;
 
-		QList<QList<FilterItem_ptr>> ExceptionsCache_;
-		QList<QList<FilterItem_ptr>> FilterItemsCache_;
+		FilterMatcher ExceptionsMatcher_;
+		FilterMatcher FiltersMatcher_;
+
+		QString GenericHidingStyleSheet_;
+		FilterMatcher SpecificHidingMatcher_;
+		// Only the URL-specific part, the generic one is shared.
+		QCache<QString, QString> HidingStyleSheetsCache_;
+		qint64 HidingTime_;
 
 		QObjectList Downloaders_;
 		QStringList HeaderLabels_;
@@ -89,6 +89,7 @@ namespace CleanWeb
 		};
 		QMap<int, PendingJob> PendingJobs_;
 
+		QHash<QWebFrame*, QList<QUrl>> DelayedURLs_;
 		QHash<QWebFrame*, QList<QUrl>> MoreDelayedURLs_;
 
 		ICoreProxy_ptr Proxy_;
@@ -179,15 +180,16 @@ namespace CleanWeb
 		void WriteSettings ();
 		void ReadSettings ();
 		bool AssignSD (const SubscriptionData&);
+
+		QString GetHidingStyleSheet (const QUrl&);
 	private slots:
 		void handleParsed ();
 		void update ();
 		void handleJobFinished (int);
 		void handleJobError (int, IDownload::Error);
 		void handleFrameLayout (QPointer<QWebFrame>);
-		void hidingElementsFound ();
-		void hideElementsChunk (HidingWorkerResult);
 		void delayedRemoveElements (QPointer<QWebFrame>, const QUrl&);
+		void removeDelayedElements ();
 		void moreDelayedRemoveElements ();
 		void handleFrameDestroyed ();
 
@@ -39,13 +39,15 @@ namespace CleanWeb
 {
 	QDataStream& operator<< (QDataStream& out, const FilterOption& opt)
 	{
-		qint8 version = 2;
+		qint8 version = 3;
 		out << version
 			<< static_cast<qint8> (opt.Case_)
 			<< static_cast<qint8> (opt.MatchType_)
 			<< opt.Domains_
 			<< opt.NotDomains_
-			<< opt.AbortForeign_;
+			<< opt.AbortForeign_
+			<< static_cast<qint32> (opt.MatchObjects_)
+			<< opt.HideSelector_;
 		return out;
 	}
 
@@ -54,7 +56,7 @@ namespace CleanWeb
 		qint8 version = 0;
 		in >> version;
 
-		if (version < 1 || version > 2)
+		if (version < 1 || version > 3)
 		{
 			qWarning () << Q_FUNC_INFO
 				<< "unknown version"
@@ -67,8 +69,8 @@ namespace CleanWeb
 			qint8 cs;
 			in >> cs;
 			opt.Case_ = cs ?
-				Qt::CaseInsensitive :
-				Qt::CaseSensitive;
+				Qt::CaseSensitive :
+				Qt::CaseInsensitive;
 			qint8 mt;
 			in >> mt;
 			opt.MatchType_ = static_cast<FilterOption::MatchType> (mt);
@@ -77,6 +79,12 @@ namespace CleanWeb
 		}
 		if (version >= 2)
 			in >> opt.AbortForeign_;
+		if (version >= 3)
+		{
+			qint32 objs;
+			in >> objs >> opt.HideSelector_;
+			opt.MatchObjects_ = FilterOption::MatchObjects (objs);
+		}
 
 		return in;
 	}
@@ -127,20 +135,29 @@ namespace CleanWeb
 		QString origStr;
 		in >> origStr;
 		item.PlainMatcher_ = origStr.toUtf8 ();
+
+		QString pattern;
+		Qt::CaseSensitivity cs = Qt::CaseSensitive;
 		if (version == 1)
 		{
 			QRegExp rx;
 			in >> rx;
-			item.RegExp_ = Util::RegExp (rx.pattern (), rx.caseSensitivity ());
+			pattern = rx.pattern ();
+			cs = rx.caseSensitivity ();
 		}
 		else if (version == 2)
 		{
-			QString str;
-			quint8 cs;
-			in >> str >> cs;
-			item.RegExp_ = Util::RegExp (str, static_cast<Qt::CaseSensitivity> (cs));
+			quint8 csByte;
+			in >> pattern >> csByte;
+			cs = static_cast<Qt::CaseSensitivity> (csByte);
 		}
 		in >> item.Option_;
+
+		// Compiling a regexp is costly, so only do it for the items that need it.
+		if (item.Option_.MatchType_ == FilterOption::MTRegexp || !pattern.isEmpty ())
+			item.RegExp_ = Util::RegExp (pattern, cs);
+		else
+			item.RegExp_ = Util::RegExp ();
 		return in;
 	}
 
@@ -0,0 +1,525 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filtermatcher.h"
+#include <algorithm>
+#include <vector>
+#include <QSet>
+#include <QtDebug>
+
+#if !defined (Q_OS_WIN32) && !defined (Q_OS_MAC)
+#include <fnmatch.h>
+#endif
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+#if defined (Q_OS_WIN32) || defined (Q_OS_MAC)
+		// Thanks for this goes to http://www.codeproject.com/KB/string/patmatch.aspx
+		bool WildcardMatches (const char *pattern, const char *str)
+		{
+			enum State {
+				Exact,        // exact match
+				Any,        // ?
+				AnyRepeat    // *
+			};
+
+			const char *s = str;
+			const char *p = pattern;
+			const char *q = 0;
+			int state = 0;
+
+			bool match = true;
+			while (match && *p) {
+				if (*p == '*') {
+					state = AnyRepeat;
+					q = p+1;
+				} else if (*p == '?') state = Any;
+				else state = Exact;
+
+				if (*s == 0) break;
+
+				switch (state) {
+					case Exact:
+						match = *s == *p;
+						s++;
+						p++;
+						break;
+
+					case Any:
+						match = true;
+						s++;
+						p++;
+						break;
+
+					case AnyRepeat:
+						match = true;
+						s++;
+
+						if (*s == *q) p++;
+						break;
+				}
+			}
+
+			if (state == AnyRepeat) return (*s == *q);
+			else if (state == Any) return (*s == *p);
+			else return match && (*s == *p);
+		}
+#else
+		bool WildcardMatches (const char *pat, const char *str)
+		{
+			return !fnmatch (pat, str, 0);
+		}
+#endif
+	}
+
+	bool Matches (const FilterItem_ptr& item,
+			const QString& urlStr, const QByteArray& urlUtf8, const QString& domain)
+	{
+		const auto& opt = item->Option_;
+		if (opt.MatchObjects_ != FilterOption::MatchObject::All)
+		{
+			if (!(opt.MatchObjects_ & FilterOption::MatchObject::CSS) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Image) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Script) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::Object) &&
+					!(opt.MatchObjects_ & FilterOption::MatchObject::ObjSubrequest))
+				return false;
+		}
+
+		if (!opt.NotDomains_.isEmpty ())
+		{
+			for (const auto& notDomain : opt.NotDomains_)
+				if (domain.endsWith (notDomain, opt.Case_))
+					return false;
+		}
+
+		if (!opt.Domains_.isEmpty ())
+		{
+			bool shouldFurther = false;
+			for (const auto& doDomain : opt.Domains_)
+				if (domain.endsWith (doDomain, opt.Case_))
+				{
+					shouldFurther = true;
+					break;
+				}
+
+			if (!shouldFurther)
+				return false;
+		}
+
+		switch (opt.MatchType_)
+		{
+		case FilterOption::MTRegexp:
+			return item->RegExp_.Matches (urlStr);
+		case FilterOption::MTWildcard:
+			return WildcardMatches (item->PlainMatcher_.constData (), urlUtf8.constData ());
+		case FilterOption::MTPlain:
+			return urlUtf8.indexOf (item->PlainMatcher_) >= 0;
+		case FilterOption::MTBegin:
+			return urlStr.startsWith (QString::fromUtf8 (item->PlainMatcher_));
+		case FilterOption::MTEnd:
+			return urlStr.endsWith (QString::fromUtf8 (item->PlainMatcher_));
+		}
+
+		return false;
+	}
+
+	namespace
+	{
+		const int ShingleSize = 4;
+
+		quint32 MakeShingle (const char *data)
+		{
+			return (static_cast<quint32> (static_cast<quint8> (data [0])) << 24) |
+					(static_cast<quint32> (static_cast<quint8> (data [1])) << 16) |
+					(static_cast<quint32> (static_cast<quint8> (data [2])) << 8) |
+					static_cast<quint32> (static_cast<quint8> (data [3]));
+		}
+
+		/** Splits the wildcard pattern into the parts that should be
+		 * present in the URL verbatim.
+		 */
+		QList<QByteArray> GetWildcardLiterals (const QByteArray& pattern)
+		{
+			QList<QByteArray> result;
+
+			QByteArray current;
+			bool inBrackets = false;
+			for (const char c : pattern)
+			{
+				// The contents of a [...] class aren't literals.
+				if (inBrackets)
+				{
+					if (c == ']')
+						inBrackets = false;
+					continue;
+				}
+
+				switch (c)
+				{
+				case '[':
+					inBrackets = true;
+					result << current;
+					current.clear ();
+					break;
+				case '*':
+				case '?':
+				case ']':
+				case '\\':
+					result << current;
+					current.clear ();
+					break;
+				default:
+					current += c;
+					break;
+				}
+			}
+			result << current;
+
+			return result;
+		}
+
+		/** Conservatively extracts the parts of the regexp that should be
+		 * present in any matching string. Returns an empty list if the
+		 * regexp has alternations or groups.
+		 */
+		QList<QByteArray> GetRegExpLiterals (const QString& pattern, Qt::CaseSensitivity cs)
+		{
+			QStringList literals;
+
+			QString current;
+			auto flush = [&current, &literals] () -> void
+			{
+				literals << current;
+				current.clear ();
+			};
+
+			for (int i = 0; i < pattern.size (); ++i)
+			{
+				const auto c = pattern.at (i);
+				switch (c.unicode ())
+				{
+				case '|':
+				case '(':
+				case ')':
+					return {};
+				case '*':
+				case '?':
+				case '+':
+				case '{':
+					// The previous character is quantified and may be absent.
+					current.chop (1);
+					flush ();
+					if (c == '{')
+						while (i < pattern.size () && pattern.at (i) != '}')
+							++i;
+					break;
+				case '[':
+					flush ();
+					if (i + 1 < pattern.size () && pattern.at (i + 1) == '^')
+						++i;
+					// The first character in the class may be a ']'.
+					i += 2;
+					while (i < pattern.size () && pattern.at (i) != ']')
+						++i;
+					break;
+				case '\\':
+				{
+					if (++i >= pattern.size ())
+						break;
+
+					// An escaped punctuation character stands for itself.
+					const auto next = pattern.at (i);
+					if (!next.isLetterOrNumber ())
+					{
+						current += next;
+						break;
+					}
+
+					/* Other escapes denote character classes or codes like
+					 * \xhh, \uhhhh and \0ooo, none of which are literals, so
+					 * skip them as a whole.
+					 */
+					flush ();
+
+					auto isCodeDigit = [next] (QChar c) -> bool
+					{
+						return next == '0' ?
+								c >= '0' && c <= '7' :
+								QString ("0123456789abcdefABCDEF").contains (c);
+					};
+
+					int digits = 0;
+					if (next == 'x')
+						digits = 2;
+					else if (next == 'u')
+						digits = 4;
+					else if (next == '0')
+						digits = 3;
+					for (; digits > 0 && i + 1 < pattern.size () && isCodeDigit (pattern.at (i + 1)); --digits)
+						++i;
+					break;
+				}
+				case '.':
+				case '^':
+				case '$':
+					flush ();
+					break;
+				default:
+					current += c;
+					break;
+				}
+			}
+			flush ();
+
+			QList<QByteArray> result;
+			for (const auto& literal : literals)
+				result << (cs == Qt::CaseSensitive ? literal : literal.toLower ()).toUtf8 ();
+			return result;
+		}
+
+		QList<QByteArray> GetLiterals (const FilterItem_ptr& item)
+		{
+			switch (item->Option_.MatchType_)
+			{
+			case FilterOption::MTPlain:
+			case FilterOption::MTBegin:
+			case FilterOption::MTEnd:
+				return { item->PlainMatcher_ };
+			case FilterOption::MTWildcard:
+				return GetWildcardLiterals (item->PlainMatcher_);
+			case FilterOption::MTRegexp:
+				return GetRegExpLiterals (item->RegExp_.GetPattern (), item->Option_.Case_);
+			}
+
+			return {};
+		}
+
+		std::vector<quint32> GetShingles (const QByteArray& str)
+		{
+			std::vector<quint32> result;
+			if (str.size () < ShingleSize)
+				return result;
+
+			result.reserve (str.size () - ShingleSize + 1);
+			const auto data = str.constData ();
+			for (int i = 0; i <= str.size () - ShingleSize; ++i)
+				result.push_back (MakeShingle (data + i));
+
+			std::sort (result.begin (), result.end ());
+			result.erase (std::unique (result.begin (), result.end ()), result.end ());
+			return result;
+		}
+
+		std::vector<quint32> GetShingles (const FilterItem_ptr& item)
+		{
+			std::vector<quint32> result;
+			for (const auto& literal : GetLiterals (item))
+			{
+				const auto& shingles = GetShingles (literal);
+				result.insert (result.end (), shingles.begin (), shingles.end ());
+			}
+
+			std::sort (result.begin (), result.end ());
+			result.erase (std::unique (result.begin (), result.end ()), result.end ());
+			return result;
+		}
+
+		template<typename Table, typename F>
+		bool CheckShingles (const Table& table, const QByteArray& str, F check)
+		{
+			if (table.isEmpty ())
+				return false;
+
+			for (const auto shingle : GetShingles (str))
+			{
+				const auto pos = table.find (shingle);
+				if (pos == table.end ())
+					continue;
+
+				for (const auto& item : *pos)
+					if (check (item))
+						return true;
+			}
+
+			return false;
+		}
+	}
+
+	void FilterMatcher::Rebuild (const QList<FilterItem_ptr>& items)
+	{
+		Clear ();
+
+		TotalCount_ = items.size ();
+
+		QList<std::vector<quint32>> itemsShingles;
+		itemsShingles.reserve (items.size ());
+
+		QHash<quint32, int> frequencies;
+		for (const auto& item : items)
+		{
+			const auto& shingles = GetShingles (item);
+			for (const auto shingle : shingles)
+				++frequencies [shingle];
+			itemsShingles << shingles;
+		}
+
+		for (int i = 0; i < items.size (); ++i)
+		{
+			const auto& item = items.at (i);
+			const auto& opt = item->Option_;
+
+			const auto& shingles = itemsShingles.at (i);
+			if (!shingles.empty ())
+			{
+				const auto rarest = *std::min_element (shingles.begin (), shingles.end (),
+						[&frequencies] (quint32 left, quint32 right)
+							{ return frequencies.value (left) < frequencies.value (right); });
+
+				auto& table = opt.Case_ == Qt::CaseSensitive ? CSShingles_ : CIShingles_;
+				table [rarest] << item;
+			}
+			else if (opt.Case_ == Qt::CaseInsensitive && !opt.Domains_.isEmpty ())
+			{
+				for (const auto& domain : opt.Domains_)
+					Domain2Items_ [domain.toLower ()] << item;
+			}
+			else
+				Unindexed_ << item;
+		}
+
+		qDebug () << Q_FUNC_INFO
+				<< TotalCount_
+				<< "items;"
+				<< CSShingles_.size () + CIShingles_.size ()
+				<< "shingles,"
+				<< Domain2Items_.size ()
+				<< "domains,"
+				<< Unindexed_.size ()
+				<< "unindexed";
+	}
+
+	void FilterMatcher::Clear ()
+	{
+		CSShingles_.clear ();
+		CIShingles_.clear ();
+		Domain2Items_.clear ();
+		Unindexed_.clear ();
+		TotalCount_ = 0;
+	}
+
+	bool FilterMatcher::Matches (const RequestInfo& info) const
+	{
+		return ForEachMatching (info, [] (const FilterItem_ptr&) { return true; });
+	}
+
+	QList<FilterItem_ptr> FilterMatcher::FindAll (const RequestInfo& info) const
+	{
+		QList<FilterItem_ptr> result;
+		QSet<FilterItem*> seen;
+		ForEachMatching (info,
+				[&result, &seen] (const FilterItem_ptr& item) -> bool
+				{
+					if (!seen.contains (item.get ()))
+					{
+						seen << item.get ();
+						result << item;
+					}
+					return false;
+				});
+		return result;
+	}
+
+	/** Calls the handler for each item matching the request until the
+	 * handler returns true.
+	 */
+	bool FilterMatcher::ForEachMatching (const RequestInfo& info,
+			const std::function<bool (FilterItem_ptr)>& handler) const
+	{
+		auto check = [&info, &handler] (const FilterItem_ptr& item) -> bool
+		{
+			const auto& opt = item->Option_;
+			if (opt.AbortForeign_ && info.IsForeign_)
+				return false;
+
+			if (opt.MatchObjects_ != FilterOption::MatchObject::All &&
+					info.Objects_ != FilterOption::MatchObject::All &&
+					!(info.Objects_ & opt.MatchObjects_))
+				return false;
+
+			const bool cs = opt.Case_ == Qt::CaseSensitive;
+			if (!CleanWeb::Matches (item,
+					cs ? info.UrlStr_ : info.CinUrlStr_,
+					cs ? info.UrlUtf8_ : info.CinUrlUtf8_,
+					info.Domain_))
+				return false;
+
+			return handler (item);
+		};
+
+		if (CheckShingles (CIShingles_, info.CinUrlUtf8_, check) ||
+				CheckShingles (CSShingles_, info.UrlUtf8_, check))
+			return true;
+
+		if (!Domain2Items_.isEmpty ())
+		{
+			const auto& domain = info.Domain_.toLower ();
+			for (int i = 0; i <= domain.size (); ++i)
+			{
+				const auto pos = Domain2Items_.find (domain.mid (i));
+				if (pos == Domain2Items_.end ())
+					continue;
+
+				for (const auto& item : *pos)
+					if (check (item))
+						return true;
+			}
+		}
+
+		return std::any_of (Unindexed_.begin (), Unindexed_.end (), check);
+	}
+
+	int FilterMatcher::GetTotalCount () const
+	{
+		return TotalCount_;
+	}
+
+	int FilterMatcher::GetUnindexedCount () const
+	{
+		return Unindexed_.size ();
+	}
+}
+}
+}
@@ -0,0 +1,97 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <QHash>
+#include <QList>
+#include "filter.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	bool Matches (const FilterItem_ptr& item,
+			const QString& urlStr, const QByteArray& urlUtf8, const QString& domain);
+
+	/** @brief Compiled index over a set of filter items.
+	 *
+	 * Instead of checking every rule against every request, the items are
+	 * indexed by a rare fixed-size substring (a shingle) of a literal part
+	 * of their pattern, which every matching URL has to contain. The URL
+	 * is then split into shingles, and only the items registered for these
+	 * shingles are checked.
+	 *
+	 * Items that don't have a suitable literal part but are restricted to
+	 * some domains are indexed by those domains and looked up by all the
+	 * suffixes of the request domain. The rest is checked linearly.
+	 */
+	class FilterMatcher
+	{
+		typedef QHash<quint32, QList<FilterItem_ptr>> Shingle2Items_t;
+		Shingle2Items_t CSShingles_;
+		Shingle2Items_t CIShingles_;
+
+		QHash<QString, QList<FilterItem_ptr>> Domain2Items_;
+
+		QList<FilterItem_ptr> Unindexed_;
+
+		int TotalCount_ = 0;
+	public:
+		struct RequestInfo
+		{
+			QString UrlStr_;
+			QByteArray UrlUtf8_;
+			QString CinUrlStr_;
+			QByteArray CinUrlUtf8_;
+
+			QString Domain_;
+
+			bool IsForeign_;
+			FilterOption::MatchObjects Objects_;
+		};
+
+		void Rebuild (const QList<FilterItem_ptr>&);
+		void Clear ();
+
+		bool Matches (const RequestInfo&) const;
+		QList<FilterItem_ptr> FindAll (const RequestInfo&) const;
+
+		int GetTotalCount () const;
+		int GetUnindexedCount () const;
+	private:
+		bool ForEachMatching (const RequestInfo&,
+				const std::function<bool (FilterItem_ptr)>&) const;
+	};
+}
+}
+}
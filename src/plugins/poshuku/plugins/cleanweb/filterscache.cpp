@@ -0,0 +1,185 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filterscache.h"
+#include <stdexcept>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDataStream>
+#include <QtDebug>
+#include <util/sys/paths.h>
+#include "filter.h"
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		const quint32 CacheMagic = 0x4c435743;
+		const quint16 CacheVersion = 1;
+
+		QString GetCachePath (const QString& fileName)
+		{
+			try
+			{
+				return Util::GetUserDir (Util::UserDir::Cache, "poshuku/cleanweb")
+						.absoluteFilePath (fileName + ".cache");
+			}
+			catch (const std::exception& e)
+			{
+				qWarning () << Q_FUNC_INFO
+						<< "cannot get cache directory:"
+						<< e.what ();
+				return {};
+			}
+		}
+
+		void ReadItems (QDataStream& in, QList<FilterItem_ptr>& items)
+		{
+			quint32 count = 0;
+			in >> count;
+			items.reserve (count);
+			for (quint32 i = 0; i < count && in.status () == QDataStream::Ok; ++i)
+			{
+				const FilterItem_ptr item (new FilterItem);
+				in >> *item;
+				items << item;
+			}
+		}
+
+		void WriteItems (QDataStream& out, const QList<FilterItem_ptr>& items)
+		{
+			out << static_cast<quint32> (items.size ());
+			for (const auto& item : items)
+				out << *item;
+		}
+	}
+
+	bool LoadCachedFilter (const QString& filePath, Filter& filter)
+	{
+		const QFileInfo srcInfo { filePath };
+		const auto& cachePath = GetCachePath (srcInfo.fileName ());
+		if (cachePath.isEmpty ())
+			return false;
+
+		QFile file { cachePath };
+		if (!file.exists ())
+			return false;
+
+		if (!file.open (QIODevice::ReadOnly))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "cannot open"
+					<< cachePath
+					<< file.errorString ();
+			return false;
+		}
+
+		const auto size = file.size ();
+		const auto mapped = file.map (0, size);
+		const auto& data = mapped ?
+				QByteArray::fromRawData (reinterpret_cast<const char*> (mapped), size) :
+				file.readAll ();
+
+		QDataStream in { data };
+
+		quint32 magic = 0;
+		quint16 version = 0;
+		in >> magic >> version;
+		if (magic != CacheMagic || version != CacheVersion)
+		{
+			qDebug () << Q_FUNC_INFO
+					<< "snapshot format mismatch for"
+					<< filePath;
+			return false;
+		}
+
+		qint64 srcSize = 0;
+		QDateTime srcModified;
+		in >> srcSize >> srcModified;
+		if (srcSize != srcInfo.size () ||
+				srcModified != srcInfo.lastModified ())
+			return false;
+
+		Filter result;
+		ReadItems (in, result.Filters_);
+		ReadItems (in, result.Exceptions_);
+
+		if (in.status () != QDataStream::Ok)
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "corrupted snapshot for"
+					<< filePath;
+			return false;
+		}
+
+		result.SD_.Filename_ = srcInfo.fileName ();
+		filter = result;
+		return true;
+	}
+
+	void SaveCachedFilter (const QString& filePath, const Filter& filter)
+	{
+		const QFileInfo srcInfo { filePath };
+		const auto& cachePath = GetCachePath (srcInfo.fileName ());
+		if (cachePath.isEmpty ())
+			return;
+
+		QFile file { cachePath };
+		if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+		{
+			qWarning () << Q_FUNC_INFO
+					<< "cannot open"
+					<< cachePath
+					<< file.errorString ();
+			return;
+		}
+
+		QDataStream out { &file };
+		out << CacheMagic
+				<< CacheVersion
+				<< srcInfo.size ()
+				<< srcInfo.lastModified ();
+		WriteItems (out, filter.Filters_);
+		WriteItems (out, filter.Exceptions_);
+	}
+
+	void RemoveCachedFilter (const QString& fileName)
+	{
+		const auto& cachePath = GetCachePath (fileName);
+		if (!cachePath.isEmpty ())
+			QFile::remove (cachePath);
+	}
+}
+}
+}
@@ -0,0 +1,303 @@
+/**********************************************************************
+ * LeechCraft - modular cross-platform feature rich internet client.
+ * Copyright (C) 2006-2014  Georg Rudoy
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ **********************************************************************/
+
+#include "filtermatchertest.h"
+#include <algorithm>
+#include <QtTest>
+#include <QFile>
+#include <QElapsedTimer>
+#include "../filter.h"
+#include "../filtermatcher.h"
+#include "../lineparser.h"
+
+QTEST_MAIN (LeechCraft::Poshuku::CleanWeb::FilterMatcherTest)
+
+namespace LeechCraft
+{
+namespace Poshuku
+{
+namespace CleanWeb
+{
+	namespace
+	{
+		QList<FilterItem_ptr> Parse (const QStringList& lines)
+		{
+			Filter filter;
+			LineParser parser { &filter };
+			for (const auto& line : lines)
+				parser (line);
+			return filter.Filters_;
+		}
+
+		FilterMatcher::RequestInfo MakeRequest (const QString& urlStr)
+		{
+			const QUrl url { urlStr };
+
+			FilterMatcher::RequestInfo info;
+			info.UrlStr_ = url.toString ();
+			info.UrlUtf8_ = info.UrlStr_.toUtf8 ();
+			info.CinUrlStr_ = info.UrlStr_.toLower ();
+			info.CinUrlUtf8_ = info.CinUrlStr_.toUtf8 ();
+			info.Domain_ = url.host ();
+			info.IsForeign_ = false;
+			info.Objects_ = FilterOption::MatchObject::All;
+			return info;
+		}
+
+		QStringList MakeLargeList (int count)
+		{
+			QStringList result;
+			for (int i = 0; i < count; ++i)
+				switch (i % 3)
+				{
+				case 0:
+					result << QString ("||adserver%1.com/").arg (i);
+					break;
+				case 1:
+					result << QString ("/promo%1/*.swf").arg (i);
+					break;
+				default:
+					result << QString ("&adid%1=").arg (i);
+					break;
+				}
+			return result;
+		}
+
+		QStringList ReadLines (const QString& path)
+		{
+			QFile file { path };
+			if (!file.open (QIODevice::ReadOnly))
+				return {};
+
+			QStringList result;
+			for (const auto& line : QString::fromUtf8 (file.readAll ()).split ('\n', QString::SkipEmptyParts))
+				if (!line.startsWith ('#'))
+					result << line.trimmed ();
+			return result;
+		}
+
+		/* The corpus rules are mixed with the large synthetic list, so the
+		 * matcher has to deal with a list of a realistic size.
+		 */
+		QList<FilterItem_ptr> GetCorpusFilters ()
+		{
+			return Parse (ReadLines (":/cleanwebtest/data/filters.txt") + MakeLargeList (30000));
+		}
+
+		QList<FilterMatcher::RequestInfo> GetCorpusRequests ()
+		{
+			QList<FilterMatcher::RequestInfo> result;
+			for (const auto& url : ReadLines (":/cleanwebtest/data/urls.txt"))
+				result << MakeRequest (url);
+			return result;
+		}
+
+		/** Checks every item in turn, as it's been done before the
+		 * FilterMatcher.
+		 */
+		bool LinearMatches (const QList<FilterItem_ptr>& items, const FilterMatcher::RequestInfo& info)
+		{
+			for (const auto& item : items)
+			{
+				const auto& opt = item->Option_;
+				if (opt.AbortForeign_ && info.IsForeign_)
+					continue;
+
+				const bool cs = opt.Case_ == Qt::CaseSensitive;
+				if (Matches (item,
+						cs ? info.UrlStr_ : info.CinUrlStr_,
+						cs ? info.UrlUtf8_ : info.CinUrlUtf8_,
+						info.Domain_))
+					return true;
+			}
+			return false;
+		}
+
+		QList<FilterMatcher::RequestInfo> MakeRequests (int count)
+		{
+			QList<FilterMatcher::RequestInfo> result;
+			for (int i = 0; i < count; ++i)
+				result << MakeRequest (QString ("http://www.site%1.org/path/to/page%1.html?id=%1&ref=main").arg (i));
+			return result;
+		}
+	}
+
+	void FilterMatcherTest::plainMatch ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse ({ "/banners/" }));
+
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/banners/top.png")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/images/top.png")), false);
+	}
+
+	void FilterMatcherTest::wildcardMatch ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse ({ "/adframe/*.swf" }));
+
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/adframe/some/movie.swf")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/adframe/some/movie.png")), false);
+	}
+
+	void FilterMatcherTest::wildcardBracketsMatch ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse ({ "/banner[0-9]*.gif" }));
+
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/banner5_wide.gif")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/bannerx_wide.gif")), false);
+	}
+
+	void FilterMatcherTest::anchoredDomainMatch ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse ({ "||ads.example.com^", "||tracker.org/" }));
+
+		QCOMPARE (matcher.Matches (MakeRequest ("http://tracker.org/pixel.gif")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.org/pixel.gif")), false);
+	}
+
+	void FilterMatcherTest::regExpEscapesMatch ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse ({ "/\\x2fpromo[_-]?box\\./", "/\\/ads?\\/[0-9]+x[0-9]+\\//" }));
+
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/promo-box.js")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/promobox.js")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/ad/300x250/top.png")), true);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/promo-box-js")), false);
+		QCOMPARE (matcher.Matches (MakeRequest ("http://example.com/ads/top.png")), false);
+	}
+
+	void FilterMatcherTest::corpusMatchesLinear ()
+	{
+		const auto& items = GetCorpusFilters ();
+		const auto& requests = GetCorpusRequests ();
+		QVERIFY (requests.size () > 1000);
+
+		FilterMatcher matcher;
+		matcher.Rebuild (items);
+
+		int hits = 0;
+		for (const auto& request : requests)
+		{
+			const bool linear = LinearMatches (items, request);
+			QCOMPARE (matcher.Matches (request), linear);
+			hits += linear;
+		}
+
+		QVERIFY (hits > requests.size () / 10);
+		QVERIFY (hits < requests.size () / 2);
+	}
+
+	void FilterMatcherTest::benchRebuild ()
+	{
+		const auto& items = Parse (MakeLargeList (30000));
+
+		QBENCHMARK
+		{
+			FilterMatcher matcher;
+			matcher.Rebuild (items);
+		}
+	}
+
+	void FilterMatcherTest::benchMatchLargeList ()
+	{
+		FilterMatcher matcher;
+		matcher.Rebuild (Parse (MakeLargeList (30000)));
+
+		const auto& requests = MakeRequests (100);
+
+		int matched = 0;
+		QBENCHMARK
+		{
+			for (const auto& request : requests)
+				matched += matcher.Matches (request);
+		}
+		QCOMPARE (matched, 0);
+	}
+
+	void FilterMatcherTest::benchCorpus_data ()
+	{
+		QTest::addColumn<bool> ("indexed");
+
+		QTest::newRow ("linear") << false;
+		QTest::newRow ("indexed") << true;
+	}
+
+	void FilterMatcherTest::benchCorpus ()
+	{
+		QFETCH (bool, indexed);
+
+		const auto& items = GetCorpusFilters ();
+		const auto& requests = GetCorpusRequests ();
+
+		FilterMatcher matcher;
+		matcher.Rebuild (items);
+
+		auto lookup = [&] (const FilterMatcher::RequestInfo& request) -> bool
+		{
+			return indexed ?
+					matcher.Matches (request) :
+					LinearMatches (items, request);
+		};
+
+		std::vector<qint64> times;
+		times.reserve (requests.size ());
+		QElapsedTimer total;
+		total.start ();
+		for (const auto& request : requests)
+		{
+			QElapsedTimer timer;
+			timer.start ();
+			lookup (request);
+			times.push_back (timer.nsecsElapsed ());
+		}
+		const auto totalNs = std::max<qint64> (total.nsecsElapsed (), 1);
+
+		std::sort (times.begin (), times.end ());
+		const auto p99 = times.at (times.size () * 99 / 100);
+		qDebug () << (indexed ? "indexed:" : "linear:")
+				<< static_cast<qint64> (requests.size () * 1000000000.0 / totalNs)
+				<< "lookups/sec, p99"
+				<< p99 / 1000.0
+				<< "us";
+
+		int hits = 0;
+		QBENCHMARK
+		{
+			for (const auto& request : requests)
+				hits += lookup (request);
+		}
+		QVERIFY (hits > 0);
+	}
+}
+}
+}
@@ -129,6 +129,34 @@ namespace Util
 		return item->GetModel ()->rowCount (item->GetIndex ());
 	}
 
+	bool MergeModel::canFetchMore (const QModelIndex& parent) const
+	{
+		if (!parent.isValid ())
+		{
+			for (const auto model : GetAllModels ())
+				if (model->canFetchMore ({}))
+					return true;
+			return false;
+		}
+
+		const auto item = static_cast<ModelItem*> (parent.internalPointer ());
+		return item->GetModel ()->canFetchMore (item->GetIndex ());
+	}
+
+	void MergeModel::fetchMore (const QModelIndex& parent)
+	{
+		if (!parent.isValid ())
+		{
+			for (const auto model : GetAllModels ())
+				if (model->canFetchMore ({}))
+					model->fetchMore ({});
+			return;
+		}
+
+		const auto item = static_cast<ModelItem*> (parent.internalPointer ());
+		item->GetModel ()->fetchMore (item->GetIndex ());
+	}
+
 	QStringList MergeModel::mimeTypes () const
 	{
 		QStringList result;
@@ -86,6 +86,30 @@ namespace LeechCraft
 			QModelIndex parent (const QModelIndex&) const override;
 			int rowCount (const QModelIndex& = QModelIndex ()) const override;
 
+			/** @brief Checks whether any of the source models has more
+			 * rows to fetch.
+			 *
+			 * For the root index this function returns true if at least
+			 * one of the source models can fetch more rows. For other
+			 * indices the request is forwarded to the corresponding
+			 * source model.
+			 *
+			 * @param[in] parent The parent index.
+			 * @return Whether there is more data to fetch.
+			 */
+			bool canFetchMore (const QModelIndex& parent) const override;
+
+			/** @brief Fetches more rows from the source models.
+			 *
+			 * For the root index this function asks every source model
+			 * that has more rows to fetch to fetch them. For other
+			 * indices the request is forwarded to the corresponding
+			 * source model.
+			 *
+			 * @param[in] parent The parent index.
+			 */
+			void fetchMore (const QModelIndex& parent) override;
+
 			/** @brief Returns the union of MIME types of the models.
 			 *
 			 * @return The union of all the MIME types.